@@ -0,0 +1,32 @@
+/*
+ Copyright (C) 2023 Quaternion Risk Management Ltd
+ All rights reserved.
+
+ This file is part of ORE, a free-software/open-source library
+ for transparent pricing and risk analysis - http://opensourcerisk.org
+
+ ORE is free software: you can redistribute it and/or modify it
+ under the terms of the Modified BSD License.  You should have received a
+ copy of the license along with this program.
+ The license is also available online at <http://opensourcerisk.org>
+
+ This program is distributed on the basis that it will form a useful
+ contribution to risk analytics and model standardisation, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ FITNESS FOR A PARTICULAR PURPOSE. See the license for more details.
+*/
+
+#include <orea/aggregation/collateralbalances.hpp>
+#include <ql/errors.hpp>
+
+namespace ore {
+namespace analytics {
+
+CollateralBalances::CollateralBalances(const std::vector<Date>& dates, const Size samples)
+    : dates_(dates), samples_(samples), balances_(dates.size() * samples, 0.0) {
+    QL_REQUIRE(!dates_.empty(), "CollateralBalances: empty date grid");
+    QL_REQUIRE(samples_ > 0, "CollateralBalances: no samples");
+}
+
+} // namespace analytics
+} // namespace ore
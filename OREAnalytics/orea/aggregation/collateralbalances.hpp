@@ -0,0 +1,73 @@
+/*
+ Copyright (C) 2023 Quaternion Risk Management Ltd
+ All rights reserved.
+
+ This file is part of ORE, a free-software/open-source library
+ for transparent pricing and risk analysis - http://opensourcerisk.org
+
+ ORE is free software: you can redistribute it and/or modify it
+ under the terms of the Modified BSD License.  You should have received a
+ copy of the license along with this program.
+ The license is also available online at <http://opensourcerisk.org>
+
+ This program is distributed on the basis that it will form a useful
+ contribution to risk analytics and model standardisation, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ FITNESS FOR A PARTICULAR PURPOSE. See the license for more details.
+*/
+
+/*! \file orea/aggregation/collateralbalances.hpp
+    \brief Collateral balance paths of a netting set on the exposure date grid
+    \ingroup analytics
+*/
+
+#pragma once
+
+#include <ql/time/date.hpp>
+#include <ql/types.hpp>
+
+#include <vector>
+
+namespace ore {
+namespace analytics {
+using namespace QuantLib;
+
+//! Collateral Balances
+/*!
+  This class holds the collateral account balances (in CSA currency) of all
+  samples of a netting set on the exposure date grid. The balances are stored
+  in one flat array, date-major, i.e. the balances of all samples for a given
+  date are contiguous.
+
+  The balance on a grid date is the account balance as of that date, as returned
+  by CollateralAccount::accountBalance(date) for the corresponding sample path.
+
+  \ingroup analytics
+*/
+class CollateralBalances {
+public:
+    CollateralBalances(const std::vector<Date>& dates, const Size samples);
+
+    //! Inspectors
+    //@{
+    /*! exposure date grid */
+    const std::vector<Date>& dates() const { return dates_; }
+    /*! number of samples */
+    Size samples() const { return samples_; }
+    /*! account balance on grid date dateIndex for a given sample */
+    Real balance(const Size dateIndex, const Size sample) const { return balances_[dateIndex * samples_ + sample]; }
+    /*! account balances on grid date dateIndex for all samples */
+    const Real* balances(const Size dateIndex) const { return &balances_[dateIndex * samples_]; }
+    //@}
+
+    /*! account balances on grid date dateIndex for all samples, to be populated by the collateral simulation */
+    Real* balances(const Size dateIndex) { return &balances_[dateIndex * samples_]; }
+
+private:
+    std::vector<Date> dates_;
+    Size samples_;
+    std::vector<Real> balances_;
+};
+
+} // namespace analytics
+} // namespace ore
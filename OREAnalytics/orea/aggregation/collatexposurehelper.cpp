@@ -18,6 +18,11 @@
 
 #include <orea/aggregation/collatexposurehelper.hpp>
 #include <ql/errors.hpp>
+#include <ql/utilities/null.hpp>
+
+#include <boost/make_shared.hpp>
+
+#include <algorithm>
 
 using namespace std;
 using namespace QuantLib;
@@ -28,6 +33,78 @@ namespace ore {
 using namespace data;
 namespace analytics {
 
+namespace {
+
+/* Position of a simulation date relative to the exposure date grid, following the logic of
+   CollateralExposureHelper::estimateUncollatValue(): the value as of the simulation date is v1 + (v2 - v1) * w,
+   an index Null<Size>() refers to the value as of date_t0. Since the position only depends on the dates, it is
+   computed once per simulation date and then applied to all scenarios. */
+struct GridPosition {
+    Size i1 = Null<Size>(), i2 = Null<Size>();
+    Real w = 0.0;
+};
+
+GridPosition gridPosition(const Date& simulationDate, const Date& date_t0, const vector<Date>& dateGrid) {
+    QL_REQUIRE(simulationDate >= date_t0, "CollatExposureHelper error: simulation date < start date");
+    QL_REQUIRE(dateGrid[0] >= date_t0, "CollatExposureHelper error: cube dateGrid starts before t0");
+
+    GridPosition p;
+    if (simulationDate >= dateGrid.back()) {
+        p.i1 = dateGrid.size() - 1; // flat extrapolation
+        return p;
+    }
+    if (simulationDate == date_t0)
+        return p;
+    for (Size i = 0; i < dateGrid.size(); i++) {
+        if (dateGrid[i] == simulationDate) {
+            p.i1 = i;
+            return p;
+        }
+#ifdef FLAT_INTERPOLATION
+        else if (simulationDate < dateGrid.front()) {
+            p.i1 = 0;
+            return p;
+        } else if (i < dateGrid.size() - 1 && simulationDate > dateGrid[i] && simulationDate < dateGrid[i + 1]) {
+            p.i1 = i + 1;
+            return p;
+        }
+#endif
+    }
+
+    Date t1, t2;
+    if (simulationDate <= dateGrid[0]) {
+        t1 = date_t0;
+        t2 = dateGrid[0];
+        p.i2 = 0;
+    } else {
+        vector<Date>::const_iterator it = lower_bound(dateGrid.begin(), dateGrid.end(), simulationDate);
+        QL_REQUIRE(it != dateGrid.end() && it != dateGrid.begin(),
+                   "CollatExposureHelper error; date interpolation points not found");
+        p.i1 = (it - 1) - dateGrid.begin();
+        p.i2 = it - dateGrid.begin();
+        t1 = dateGrid[p.i1];
+        t2 = dateGrid[p.i2];
+    }
+    p.w = double(simulationDate - t1) / double(t2 - t1);
+    return p;
+}
+
+Real gridValue(const GridPosition& p, const Real& value_t0, const vector<vector<Real>>& values, const Size k) {
+    Real v1 = p.i1 == Null<Size>() ? value_t0 : values[p.i1][k];
+    if (p.i2 == Null<Size>())
+        return v1;
+    return v1 + ((values[p.i2][k] - v1) * p.w);
+}
+
+// an outstanding margin call issued on margining date issueIndex, direction 0 = call (amount > 0), 1 = post
+struct OpenMarginCall {
+    Date payDate;
+    Size issueIndex;
+    Size direction;
+};
+
+} // namespace
+
 CollateralExposureHelper::CalculationType parseCollateralCalculationType(const string& s) {
     static map<string, CollateralExposureHelper::CalculationType> m = {
         {"Symmetric", CollateralExposureHelper::Symmetric},
@@ -62,17 +139,22 @@ Real CollateralExposureHelper::marginRequirementCalc(const boost::shared_ptr<Col
     // first step, make sure collateral balance is up to date.
     //        collat->updateAccountBalance(simulationDate);
 
-    Real collatBalance = collat->accountBalance();
-    Real csa = creditSupportAmount(collat->csaDef(), uncollatValue);
+    return marginRequirementCalc(collat->csaDef(), uncollatValue, collat->accountBalance(),
+                                 collat->outstandingMarginAmount(simulationDate));
+}
+
+Real CollateralExposureHelper::marginRequirementCalc(const boost::shared_ptr<NettingSetDefinition>& csaDef,
+                                                     const Real& uncollatValue, const Real& collatBalance,
+                                                     const Real& openMargins) {
+    Real csa = creditSupportAmount(csaDef, uncollatValue);
 
-    Real openMargins = collat->outstandingMarginAmount(simulationDate);
     Real collatShortfall = csa - collatBalance - openMargins;
 
     Real mta;
     if (collatShortfall >= 0.0)
-      mta = collat->csaDef()->csaDetails()->mtaRcv();
+      mta = csaDef->csaDetails()->mtaRcv();
     else
-      mta = collat->csaDef()->csaDetails()->mtaPay();
+      mta = csaDef->csaDetails()->mtaPay();
 
     Real deliveryAmount = fabs(collatShortfall) >= mta ? (collatShortfall) : 0.0;
 
@@ -248,5 +330,161 @@ boost::shared_ptr<vector<boost::shared_ptr<CollateralAccount>>> CollateralExposu
         QL_FAIL("CollateralExposureHelper - unknown error when generating collateralBalancePaths");
     }
 }
+boost::shared_ptr<CollateralBalances> CollateralExposureHelper::collateralBalances(
+    const boost::shared_ptr<NettingSetDefinition>& csaDef, const Real& nettingSetPv, const Date& date_t0,
+    const vector<vector<Real>>& nettingSetValues, const Date& nettingSet_maturity, const vector<Date>& dateGrid,
+    const Real& csaFxTodayRate, const vector<vector<Real>>& csaFxScenarioRates, const Real& csaTodayCollatCurve,
+    const vector<vector<Real>>& csaScenCollatCurves, const CalculationType& calcType) {
+    try {
+        const boost::shared_ptr<CSA>& csa = csaDef->csaDetails();
+        Size numScenarios = nettingSetValues.front().size();
+        QL_REQUIRE(numScenarios == csaFxScenarioRates.front().size(), "netting values -v- scenario FX rate mismatch");
+
+        // step 1; t0 balance, i.e. the margin requirement for an empty account
+        Real bal_t0 = marginRequirementCalc(csaDef, nettingSetPv, 0.0, 0.0);
+
+        // step 2; the margining dates, these do not depend on the scenario
+        Date simEndDate = std::min(nettingSet_maturity, dateGrid.back()) + csa->marginPeriodOfRisk();
+        vector<Date> simDates;
+        vector<bool> eligMarginReqDateUs, eligMarginReqDateCtp;
+        Date tmpDate = date_t0;
+        Date nextMarginReqDateUs = date_t0;
+        Date nextMarginReqDateCtp = date_t0;
+        while (tmpDate <= simEndDate) {
+            simDates.push_back(tmpDate);
+            eligMarginReqDateUs.push_back(tmpDate == nextMarginReqDateUs);
+            eligMarginReqDateCtp.push_back(tmpDate == nextMarginReqDateCtp);
+            if (nextMarginReqDateUs == tmpDate)
+                nextMarginReqDateUs = tmpDate + csa->marginCallFrequency();
+            if (nextMarginReqDateCtp == tmpDate)
+                nextMarginReqDateCtp = tmpDate + csa->marginPostFrequency();
+            tmpDate = std::min(nextMarginReqDateUs, nextMarginReqDateCtp);
+            QL_REQUIRE(tmpDate > simDates.back(), "collateral balance path generation error; invalid time stepping");
+        }
+
+        // step 3; per scenario state: balance and date of the latest account balance entry, next unpopulated grid date
+        boost::shared_ptr<CollateralBalances> result = boost::make_shared<CollateralBalances>(dateGrid, numScenarios);
+        vector<Real> balance(numScenarios, bal_t0);
+        vector<Date> balanceDate(numScenarios, date_t0);
+        vector<Size> nextGridIndex(numScenarios, 0);
+        vector<Real> uncollatValue(numScenarios), annualisedZeroRate(numScenarios), openMargins(numScenarios);
+
+        // the balance of a scenario is constant until the next account balance entry, populate the grid up to it
+        auto advance = [&dateGrid, &result, &balance, &nextGridIndex](const Size k, const Date& entryDate) {
+            while (nextGridIndex[k] < dateGrid.size() && dateGrid[nextGridIndex[k]] < entryDate) {
+                result->balances(nextGridIndex[k])[k] = balance[k];
+                ++nextGridIndex[k];
+            }
+        };
+
+        auto accrue = [&csa, &balance, &balanceDate, &annualisedZeroRate](const Size k, const Date& date) {
+            int accrualDays = date - balanceDate[k];
+            // apply "effective" accrual rate (i.e. adjust for spread specified in netting set definition)
+            Real accrualRate = (balance[k] >= 0.0) ? (annualisedZeroRate[k] - csa->collatSpreadRcv())
+                                                   : (annualisedZeroRate[k] - csa->collatSpreadPay());
+            return balance[k] * std::pow(1.0 + accrualRate / 365.0, accrualDays);
+        };
+
+        /* The outstanding margin calls sorted by pay date (and issue date for equal pay dates), the amounts are
+           stored per issue date for all scenarios, zero meaning that no margin call was issued in the scenario. */
+        vector<OpenMarginCall> openCalls;
+        std::map<Size, vector<Real>> marginCallAmounts;
+
+        Period lag = (calcType == NoLag ? 0 * Days : csa->marginPeriodOfRisk());
+        for (Size s = 0; s < simDates.size(); ++s) {
+            const Date& simulationDate = simDates[s];
+            GridPosition p = gridPosition(simulationDate, date_t0, dateGrid);
+            for (Size k = 0; k < numScenarios; ++k) {
+                uncollatValue[k] = gridValue(p, nettingSetPv, nettingSetValues, k) /
+                                   gridValue(p, csaFxTodayRate, csaFxScenarioRates, k);
+                annualisedZeroRate[k] = gridValue(p, csaTodayCollatCurve, csaScenCollatCurves, k);
+            }
+
+            // settle the margin calls due, see CollateralAccount::updateAccountBalance()
+            Size numSettled = 0;
+            while (numSettled < openCalls.size() && openCalls[numSettled].payDate <= simulationDate) {
+                const OpenMarginCall& c = openCalls[numSettled++];
+                const vector<Real>& amount = marginCallAmounts.at(c.issueIndex);
+                for (Size k = 0; k < numScenarios; ++k) {
+                    if (c.direction == 0 ? amount[k] <= 0.0 : amount[k] >= 0.0)
+                        continue;
+                    if (c.payDate == balanceDate[k]) {
+                        balance[k] += amount[k];
+                    } else {
+                        Real newBalance = accrue(k, c.payDate) + amount[k];
+                        advance(k, c.payDate);
+                        balance[k] = newBalance;
+                        balanceDate[k] = c.payDate;
+                    }
+                }
+            }
+            openCalls.erase(openCalls.begin(), openCalls.begin() + numSettled);
+            for (auto a = marginCallAmounts.begin(); a != marginCallAmounts.end();) {
+                if (std::none_of(openCalls.begin(), openCalls.end(),
+                                 [&a](const OpenMarginCall& c) { return c.issueIndex == a->first; }))
+                    a = marginCallAmounts.erase(a);
+                else
+                    ++a;
+            }
+
+            // bring the collateral accounts up to the simulation date
+            for (Size k = 0; k < numScenarios; ++k) {
+                if (simulationDate > balanceDate[k]) {
+                    Real newBalance = accrue(k, simulationDate);
+                    advance(k, simulationDate);
+                    balance[k] = newBalance;
+                    balanceDate[k] = simulationDate;
+                }
+            }
+
+            // sum of the outstanding margin calls, see CollateralAccount::outstandingMarginAmount()
+            std::fill(openMargins.begin(), openMargins.end(), 0.0);
+            for (auto const& c : openCalls) {
+                const vector<Real>& amount = marginCallAmounts.at(c.issueIndex);
+                for (Size k = 0; k < numScenarios; ++k) {
+                    if (c.direction == 0 ? amount[k] > 0.0 : amount[k] < 0.0)
+                        openMargins[k] += amount[k];
+                }
+            }
+
+            // issue new margin calls, see updateMarginCall()
+            if (!eligMarginReqDateUs[s] && !eligMarginReqDateCtp[s])
+                continue;
+            vector<Real> amount(numScenarios, 0.0);
+            for (Size k = 0; k < numScenarios; ++k) {
+                Real margin = marginRequirementCalc(csaDef, uncollatValue[k], balance[k], openMargins[k]);
+                if ((margin > 0.0 && eligMarginReqDateUs[s]) || (margin < 0.0 && eligMarginReqDateCtp[s]))
+                    amount[k] = margin;
+            }
+            for (Size d = 0; d < 2; ++d) {
+                if (!(d == 0 ? eligMarginReqDateUs[s] : eligMarginReqDateCtp[s]))
+                    continue;
+                OpenMarginCall c;
+                c.payDate = d == 0 ? (calcType == AsymmetricDVA ? simulationDate : simulationDate + lag)
+                                   : (calcType == AsymmetricCVA ? simulationDate : simulationDate + lag);
+                c.issueIndex = s;
+                c.direction = d;
+                openCalls.insert(std::upper_bound(openCalls.begin(), openCalls.end(), c,
+                                                  [](const OpenMarginCall& a, const OpenMarginCall& b) {
+                                                      return a.payDate < b.payDate;
+                                                  }),
+                                 c);
+            }
+            marginCallAmounts[s] = std::move(amount);
+        }
+
+        // set account balance to zero after maturity of portfolio, the remaining grid dates keep the initial zero
+        Date closeDate = simEndDate + Period(1, Days);
+        for (Size k = 0; k < numScenarios; ++k)
+            advance(k, closeDate);
+
+        return result;
+    } catch (const std::exception& e) {
+        QL_FAIL(e.what());
+    } catch (...) {
+        QL_FAIL("CollateralExposureHelper - unknown error when generating collateralBalances");
+    }
+}
+
 } // namespace analytics
 } // namespace ore
@@ -24,6 +24,7 @@
 #pragma once
 
 #include <orea/aggregation/collateralaccount.hpp>
+#include <orea/aggregation/collateralbalances.hpp>
 #include <ql/handle.hpp>
 #include <ql/termstructures/yieldtermstructure.hpp>
 #include <ql/time/date.hpp>
@@ -73,6 +74,13 @@ public:
     static Real marginRequirementCalc(const boost::shared_ptr<CollateralAccount>& collat, const Real& uncollatValue,
                                       const Date& simulationDate);
 
+    /*!
+      Calculates CSA margin requirement as above, given the current
+      collateral balance and the sum of the outstanding margin calls
+    */
+    static Real marginRequirementCalc(const boost::shared_ptr<NettingSetDefinition>& csaDef,
+                                      const Real& uncollatValue, const Real& collatBalance, const Real& openMargins);
+
     /*!
       Performs linear interpolation between dates to
       estimate the value as of simulationDate.
@@ -108,6 +116,21 @@ public:
         const vector<vector<Real>>& nettingSetValues, const Date& nettingSet_maturity, const vector<Date>& dateGrid,
         const Real& csaFxTodayRate, const vector<vector<Real>>& csaFxScenarioRates, const Real& csaTodayCollatCurve,
         const vector<vector<Real>>& csaScenCollatCurves, const CalculationType& calcType = Symmetric);
+
+    /*!
+      Takes the same input as collateralBalancePaths() and returns the
+      collateral balances of all scenarios on the dateGrid.
+
+      All scenarios are simulated together, date by date, on flat arrays
+      over the scenarios. The balances coincide with the account balances
+      of the collateral accounts returned by collateralBalancePaths() on the
+      dateGrid.
+    */
+    static boost::shared_ptr<CollateralBalances> collateralBalances(
+        const boost::shared_ptr<NettingSetDefinition>& csaDef, const Real& nettingSetPv, const Date& date_t0,
+        const vector<vector<Real>>& nettingSetValues, const Date& nettingSet_maturity, const vector<Date>& dateGrid,
+        const Real& csaFxTodayRate, const vector<vector<Real>>& csaFxScenarioRates, const Real& csaTodayCollatCurve,
+        const vector<vector<Real>>& csaScenCollatCurves, const CalculationType& calcType = Symmetric);
 };
 
 //! Convert text representation to CollateralExposureHelper::CalculationType
@@ -18,6 +18,7 @@
 
 #include <orea/aggregation/exposureallocator.hpp>
 #include <orea/cube/inmemorycube.hpp>
+#include <ored/utilities/parallelfor.hpp>
 
 using namespace std;
 using namespace QuantLib;
@@ -31,34 +32,56 @@ ExposureAllocator::ExposureAllocator(
         const boost::shared_ptr<NPVCube>& nettedExposureCube,
         const Size allocatedTradeEpeIndex, const Size allocatedTradeEneIndex,
         const Size tradeEpeIndex, const Size tradeEneIndex,
-        const Size nettingSetEpeIndex, const Size nettingSetEneIndex)
+        const Size nettingSetEpeIndex, const Size nettingSetEneIndex, const Size nThreads)
     : portfolio_(portfolio), tradeExposureCube_(tradeExposureCube),
       nettedExposureCube_(nettedExposureCube),
       tradeEpeIndex_(tradeEpeIndex), tradeEneIndex_(tradeEneIndex),
       allocatedTradeEpeIndex_(allocatedTradeEpeIndex), allocatedTradeEneIndex_(allocatedTradeEneIndex),
-      nettingSetEpeIndex_(nettingSetEpeIndex), nettingSetEneIndex_(nettingSetEneIndex) {}
+      nettingSetEpeIndex_(nettingSetEpeIndex), nettingSetEneIndex_(nettingSetEneIndex), nThreads_(nThreads) {}
 
 void ExposureAllocator::build() {
     LOG("Compute allocated trade exposures");
+    QL_REQUIRE(tradeExposureCube_->ids().size() == portfolio_->size(),
+               "ExposureAllocator: trade exposure cube size (" << tradeExposureCube_->ids().size()
+                                                               << ") does not match portfolio size ("
+                                                               << portfolio_->size() << ")");
+
+    // trade exposure cube index by trade id
+    map<string, Size> cubeIndex;
+    for (Size i = 0; i < tradeExposureCube_->ids().size(); ++i)
+        cubeIndex[tradeExposureCube_->ids()[i]] = i;
+
+    // pairs of portfolio and cube index of the trades by netting set, in portfolio order
+    map<string, vector<pair<Size, Size>>> nettingSetTrades;
+    for (Size i = 0; i < portfolio_->trades().size(); ++i) {
+        const boost::shared_ptr<Trade>& trade = portfolio_->trades()[i];
+        auto c = cubeIndex.find(trade->id());
+        QL_REQUIRE(c != cubeIndex.end(),
+                   "ExposureAllocator: trade " << trade->id() << " not found in trade exposure cube");
+        nettingSetTrades[trade->envelope().nettingSetId()].push_back(std::make_pair(i, c->second));
+    }
 
-    for (string nettingSetId : nettedExposureCube_->ids()) {
+    vector<pair<string, const vector<pair<Size, Size>>*>> nettingSets;
+    for (string nettingSetId : nettedExposureCube_->ids())
+        nettingSets.push_back(std::make_pair(nettingSetId, &nettingSetTrades[nettingSetId]));
 
-        for (auto trade : portfolio_->trades()) {
-            string nid = trade->envelope().nettingSetId();
-            if (nid != nettingSetId)
-                continue;
-            string tid = trade->id();
+    // The netting sets are processed in parallel, each trade writes to its own rows of the trade exposure cube
+    parallelFor(nettingSets.size(), nThreads_, [&](const Size n) {
+        const string& nid = nettingSets[n].first;
+        for (auto const& [p, i] : *nettingSets[n].second) {
+            const string& tid = portfolio_->trades()[p]->id();
 
-            for (Date date : tradeExposureCube_->dates()) {
+            for (Size j = 0; j < tradeExposureCube_->dates().size(); ++j) {
+                Date date = tradeExposureCube_->dates()[j];
                 for (Size k = 0; k < tradeExposureCube_->samples(); ++k) {
                     tradeExposureCube_->set(calculateAllocatedEpe(tid, nid, date, k),
-                                            tid, date, k, allocatedTradeEpeIndex_);
+                                            i, j, k, allocatedTradeEpeIndex_);
                     tradeExposureCube_->set(calculateAllocatedEne(tid, nid, date, k),
-                                            tid, date, k, allocatedTradeEneIndex_);
+                                            i, j, k, allocatedTradeEneIndex_);
                 }
             }
         }
-    }
+    });
     LOG("Completed calculating allocated trade exposures");
 }
 
@@ -69,11 +92,11 @@ RelativeFairValueNetExposureAllocator::RelativeFairValueNetExposureAllocator(
     const boost::shared_ptr<NPVCube>& npvCube,
     const Size allocatedTradeEpeIndex, const Size allocatedTradeEneIndex,
     const Size tradeEpeIndex, const Size tradeEneIndex,
-    const Size nettingSetEpeIndex, const Size nettingSetEneIndex)
+    const Size nettingSetEpeIndex, const Size nettingSetEneIndex, const Size nThreads)
     : ExposureAllocator(portfolio, tradeExposureCube, nettedExposureCube,
                         allocatedTradeEpeIndex, allocatedTradeEneIndex,
                         tradeEpeIndex, tradeEneIndex,
-                        nettingSetEpeIndex, nettingSetEneIndex) {
+                        nettingSetEpeIndex, nettingSetEneIndex, nThreads) {
     for (Size i = 0; i < portfolio->ids().size(); ++i) {
         string tradeId = portfolio_->ids()[i];
         string nettingSetId = portfolio->trades()[i]->envelope().nettingSetId();
@@ -93,17 +116,17 @@ RelativeFairValueNetExposureAllocator::RelativeFairValueNetExposureAllocator(
 Real RelativeFairValueNetExposureAllocator::calculateAllocatedEpe(const string& tid, const string& nid,
                                                                     const Date& date, const Size sample) {
     // FIXME: What to do when either the pos. or neg. netting set value is zero?
-    QL_REQUIRE(nettingSetPositiveValueToday_[nid] > 0.0, "non-zero positive NPV expected");
+    QL_REQUIRE(nettingSetPositiveValueToday_.at(nid) > 0.0, "non-zero positive NPV expected");
     Real netEPE = nettedExposureCube_->get(nid, date, sample, nettingSetEpeIndex_);
-    return netEPE * std::max(tradeValueToday_[tid], 0.0) / nettingSetPositiveValueToday_[nid];
+    return netEPE * std::max(tradeValueToday_.at(tid), 0.0) / nettingSetPositiveValueToday_.at(nid);
 }
 
 Real RelativeFairValueNetExposureAllocator::calculateAllocatedEne(const string& tid, const string& nid,
                                                                     const Date& date, const Size sample) {
     // FIXME: What to do when either the pos. or neg. netting set value is zero?
-    QL_REQUIRE(nettingSetNegativeValueToday_[nid] > 0.0, "non-zero negative NPV expected");
+    QL_REQUIRE(nettingSetNegativeValueToday_.at(nid) > 0.0, "non-zero negative NPV expected");
     Real netENE = nettedExposureCube_->get(nid, date, sample, nettingSetEneIndex_);
-    return netENE * -std::max(-tradeValueToday_[tid], 0.0) / nettingSetPositiveValueToday_[nid];
+    return netENE * -std::max(-tradeValueToday_.at(tid), 0.0) / nettingSetPositiveValueToday_.at(nid);
 }
 
 RelativeFairValueGrossExposureAllocator::RelativeFairValueGrossExposureAllocator(
@@ -113,11 +136,11 @@ RelativeFairValueGrossExposureAllocator::RelativeFairValueGrossExposureAllocator
     const boost::shared_ptr<NPVCube>& npvCube,
     const Size allocatedTradeEpeIndex, const Size allocatedTradeEneIndex,
     const Size tradeEpeIndex, const Size tradeEneIndex,
-    const Size nettingSetEpeIndex, const Size nettingSetEneIndex)
+    const Size nettingSetEpeIndex, const Size nettingSetEneIndex, const Size nThreads)
     : ExposureAllocator(portfolio, tradeExposureCube, nettedExposureCube,
                         allocatedTradeEpeIndex, allocatedTradeEneIndex,
                         tradeEpeIndex, tradeEneIndex,
-                        nettingSetEpeIndex, nettingSetEneIndex) {
+                        nettingSetEpeIndex, nettingSetEneIndex, nThreads) {
     for (Size i = 0; i < portfolio->ids().size(); ++i) {
         string tradeId = portfolio_->ids()[i];
         string nettingSetId = portfolio->trades()[i]->envelope().nettingSetId();
@@ -132,17 +155,17 @@ RelativeFairValueGrossExposureAllocator::RelativeFairValueGrossExposureAllocator
 Real RelativeFairValueGrossExposureAllocator::calculateAllocatedEpe(const string& tid, const string& nid,
                                                                     const Date& date, const Size sample) {
     // FIXME: What to do when the netting set value is zero?
-    QL_REQUIRE(nettingSetValueToday_[nid] != 0.0, "non-zero netting set value expected");
+    QL_REQUIRE(nettingSetValueToday_.at(nid) != 0.0, "non-zero netting set value expected");
     Real netEPE = nettedExposureCube_->get(nid, date, sample, nettingSetEpeIndex_);
-    return netEPE * tradeValueToday_[tid] / nettingSetValueToday_[nid];
+    return netEPE * tradeValueToday_.at(tid) / nettingSetValueToday_.at(nid);
 }
 
 Real RelativeFairValueGrossExposureAllocator::calculateAllocatedEne(const string& tid, const string& nid,
                                                                     const Date& date, const Size sample) {
     // FIXME: What to do when the netting set value is zero?
-    QL_REQUIRE(nettingSetValueToday_[nid] != 0.0, "non-zero netting set value expected");
+    QL_REQUIRE(nettingSetValueToday_.at(nid) != 0.0, "non-zero netting set value expected");
     Real netENE = nettedExposureCube_->get(nid, date, sample, nettingSetEneIndex_);
-    return netENE * tradeValueToday_[tid] / nettingSetValueToday_[nid];
+    return netENE * tradeValueToday_.at(tid) / nettingSetValueToday_.at(nid);
 }
 
 RelativeXvaExposureAllocator::RelativeXvaExposureAllocator(
@@ -156,30 +179,32 @@ RelativeXvaExposureAllocator::RelativeXvaExposureAllocator(
     const map<string, Real>& nettingSetSumDva,
     const Size allocatedTradeEpeIndex, const Size allocatedTradeEneIndex,
     const Size tradeEpeIndex, const Size tradeEneIndex,
-    const Size nettingSetEpeIndex, const Size nettingSetEneIndex)
+    const Size nettingSetEpeIndex, const Size nettingSetEneIndex, const Size nThreads)
     : ExposureAllocator(portfolio, tradeExposureCube, nettedExposureCube,
                         allocatedTradeEpeIndex, allocatedTradeEneIndex,
                         tradeEpeIndex, tradeEneIndex,
-                        nettingSetEpeIndex, nettingSetEneIndex),
+                        nettingSetEpeIndex, nettingSetEneIndex, nThreads),
       tradeCva_(tradeCva), tradeDva_(tradeDva),
       nettingSetSumCva_(nettingSetSumCva), nettingSetSumDva_(nettingSetSumDva) {}
 
 Real RelativeXvaExposureAllocator::calculateAllocatedEpe(const string& tid, const string& nid,
                                                          const Date& date, const Size sample) {
     Real netEPE = nettedExposureCube_->get(nid, date, sample, nettingSetEpeIndex_);
-    return netEPE * tradeCva_[tid] / nettingSetSumCva_[nid];
+    return netEPE * tradeCva_.at(tid) / nettingSetSumCva_.at(nid);
 }
 Real RelativeXvaExposureAllocator::calculateAllocatedEne(const string& tid, const string& nid,
                                                          const Date& date, const Size sample) {
     Real netENE = nettedExposureCube_->get(nid, date, sample, nettingSetEneIndex_);
-    return netENE * tradeDva_[tid] / nettingSetSumDva_[nid];
+    return netENE * tradeDva_.at(tid) / nettingSetSumDva_.at(nid);
 }
 
 NoneExposureAllocator::NoneExposureAllocator(
     const boost::shared_ptr<Portfolio>& portfolio,
     const boost::shared_ptr<NPVCube>& tradeExposureCube,
-    const boost::shared_ptr<NPVCube>& nettedExposureCube)
-    : ExposureAllocator(portfolio, tradeExposureCube, nettedExposureCube) {}
+    const boost::shared_ptr<NPVCube>& nettedExposureCube, const Size nThreads)
+    : ExposureAllocator(portfolio, tradeExposureCube, nettedExposureCube, defaultAllocatedTradeEpeIndex,
+                        defaultAllocatedTradeEneIndex, defaultTradeEpeIndex, defaultTradeEneIndex,
+                        defaultNettingSetEpeIndex, defaultNettingSetEneIndex, nThreads) {}
 
 Real NoneExposureAllocator::calculateAllocatedEpe(const string& tid, const string& nid,
                                                   const Date& date, const Size sample) {
@@ -50,13 +50,22 @@ public:
         RelativeXVA
     };
 
+    //! Default depth indices of the exposures in the trade and netting set exposure cubes
+    static constexpr Size defaultAllocatedTradeEpeIndex = 2, defaultAllocatedTradeEneIndex = 3,
+                          defaultTradeEpeIndex = 0, defaultTradeEneIndex = 1, defaultNettingSetEpeIndex = 1,
+                          defaultNettingSetEneIndex = 2;
+
     ExposureAllocator(
         const boost::shared_ptr<Portfolio>& portfolio,
         const boost::shared_ptr<NPVCube>& tradeExposureCube,
         const boost::shared_ptr<NPVCube>& nettedExposureCube,
-        const Size allocatedTradeEpeIndex = 2, const Size allocatedTradeEneIndex = 3,
-        const Size tradeEpeIndex = 0, const Size tradeEneIndex = 1,
-        const Size nettingSetEpeIndex = 1, const Size nettingSetEneIndex = 2);
+        const Size allocatedTradeEpeIndex = defaultAllocatedTradeEpeIndex,
+        const Size allocatedTradeEneIndex = defaultAllocatedTradeEneIndex,
+        const Size tradeEpeIndex = defaultTradeEpeIndex, const Size tradeEneIndex = defaultTradeEneIndex,
+        const Size nettingSetEpeIndex = defaultNettingSetEpeIndex,
+        const Size nettingSetEneIndex = defaultNettingSetEneIndex,
+        //! Number of threads used to process the netting sets
+        const Size nThreads = 1);
 
     virtual ~ExposureAllocator() {}
     const boost::shared_ptr<NPVCube>& exposureCube() { return tradeExposureCube_; }
@@ -65,6 +74,8 @@ public:
 
 
 protected:
+    /*! The allocated exposures are computed for several netting sets in parallel, so these must not modify the
+        allocator's state */
     virtual Real calculateAllocatedEpe(const string& tid, const string& nid, const Date& date, const Size sample) = 0;
     virtual Real calculateAllocatedEne(const string& tid, const string& nid, const Date& date, const Size sample) = 0;
     boost::shared_ptr<Portfolio> portfolio_;
@@ -76,6 +87,7 @@ protected:
     Size allocatedTradeEneIndex_;
     Size nettingSetEpeIndex_;
     Size nettingSetEneIndex_;
+    Size nThreads_;
     map<string, Real> nettingSetValueToday_, nettingSetPositiveValueToday_, nettingSetNegativeValueToday_;
 };
 
@@ -88,7 +100,7 @@ public:
         const boost::shared_ptr<NPVCube>& npvCube,
         const Size allocatedTradeEpeIndex = 2, const Size allocatedTradeEneIndex = 3,
         const Size tradeEpeIndex = 0, const Size tradeEneIndex = 1,
-        const Size nettingSetEpeIndex = 1, const Size nettingSetEneIndex = 2);
+        const Size nettingSetEpeIndex = 1, const Size nettingSetEneIndex = 2, const Size nThreads = 1);
 
 protected:
     virtual Real calculateAllocatedEpe(const string& tid, const string& nid, const Date& date, const Size sample) override;
@@ -107,7 +119,7 @@ public:
         const boost::shared_ptr<NPVCube>& npvCube,
         const Size allocatedTradeEpeIndex = 2, const Size allocatedTradeEneIndex = 3,
         const Size tradeEpeIndex = 0, const Size tradeEneIndex = 1,
-        const Size nettingSetEpeIndex = 1, const Size nettingSetEneIndex = 2);
+        const Size nettingSetEpeIndex = 1, const Size nettingSetEneIndex = 2, const Size nThreads = 1);
 
 protected:
     virtual Real calculateAllocatedEpe(const string& tid, const string& nid, const Date& date, const Size sample) override;
@@ -129,7 +141,7 @@ public:
         const map<string, Real>& nettingSetSumDva,
         const Size allocatedTradeEpeIndex = 2, const Size allocatedTradeEneIndex = 3,
         const Size tradeEpeIndex = 0, const Size tradeEneIndex = 1,
-        const Size nettingSetEpeIndex = 0, const Size nettingSetEneIndex = 1);
+        const Size nettingSetEpeIndex = 0, const Size nettingSetEneIndex = 1, const Size nThreads = 1);
 
 protected:
     virtual Real calculateAllocatedEpe(const string& tid, const string& nid, const Date& date, const Size sample) override;
@@ -146,7 +158,7 @@ public:
     NoneExposureAllocator(
         const boost::shared_ptr<Portfolio>& portfolio,
         const boost::shared_ptr<NPVCube>& tradeExposureCube,
-        const boost::shared_ptr<NPVCube>& nettedExposureCube);
+        const boost::shared_ptr<NPVCube>& nettedExposureCube, const Size nThreads = 1);
 
 protected:
     virtual Real calculateAllocatedEpe(const string& tid, const string& nid, const Date& date, const Size sample) override;
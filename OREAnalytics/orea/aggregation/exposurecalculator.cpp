@@ -17,7 +17,9 @@
 */
 
 #include <orea/aggregation/exposurecalculator.hpp>
+#include <orea/aggregation/quantileestimator.hpp>
 #include <orea/cube/inmemorycube.hpp>
+#include <ored/utilities/parallelfor.hpp>
 
 #include <ql/time/date.hpp>
 #include <ql/time/calendars/weekendsonly.hpp>
@@ -34,13 +36,14 @@ ExposureCalculator::ExposureCalculator(
     const boost::shared_ptr<Market>& market,
     bool exerciseNextBreak, const string& baseCurrency, const string& configuration,
     const Real quantile, const CollateralExposureHelper::CalculationType calcType, const bool multiPath,
-    const bool flipViewXVA)
+    const bool flipViewXVA, const Size nThreads)
     : portfolio_(portfolio), cube_(cube), cubeInterpretation_(cubeInterpretation),
        market_(market), exerciseNextBreak_(exerciseNextBreak),
       baseCurrency_(baseCurrency), configuration_(configuration),
       quantile_(quantile), calcType_(calcType),
       multiPath_(multiPath), dates_(cube->dates()),
-      today_(market_->asofDate()), dc_(ActualActual(ActualActual::ISDA)), flipViewXVA_(flipViewXVA) {
+      today_(market_->asofDate()), dc_(ActualActual(ActualActual::ISDA)), flipViewXVA_(flipViewXVA),
+      nThreads_(nThreads) {
 
     QL_REQUIRE(portfolio_, "portfolio is null");
 
@@ -70,15 +73,27 @@ ExposureCalculator::ExposureCalculator(
 
 void ExposureCalculator::build() {
     LOG("Compute trade exposure profiles, " << (flipViewXVA_ ? "inverted (flipViewXVA = Y)" : "regular (flipViewXVA = N)"));
-    
+
+    // Discount factors on the exposure grid, market data is accessed on the calling thread only
+    Handle<YieldTermStructure> curve = market_->discountCurve(baseCurrency_, configuration_);
+    vector<Real> discounts(dates_.size(), 1.0);
+    for (Size j = 0; j < dates_.size(); ++j)
+        discounts[j] = curve->discount(cube_->dates()[j]);
+
+    vector<Date> nextBreakDates(portfolio_->size());
+    vector<vector<Size>> nettingSetTrades; // trade indices by netting set, in portfolio order
+    map<string, Size> nettingSetIndex;
     for (Size i = 0; i < portfolio_->size(); ++i) {
         string tradeId = portfolio_->trades()[i]->id();
         string nettingSetId = portfolio_->trades()[i]->envelope().nettingSetId();
-        LOG("Aggregate exposure for trade " << tradeId);
         if (nettingSetDefaultValue_.find(nettingSetId) == nettingSetDefaultValue_.end()) {
             nettingSetDefaultValue_[nettingSetId] = vector<vector<Real>>(dates_.size(), vector<Real>(cube_->samples(), 0.0));
             nettingSetCloseOutValue_[nettingSetId] = vector<vector<Real>>(dates_.size(), vector<Real>(cube_->samples(), 0.0));
         }
+        auto n = nettingSetIndex.insert(std::make_pair(nettingSetId, nettingSetTrades.size()));
+        if (n.second)
+            nettingSetTrades.push_back(vector<Size>());
+        nettingSetTrades[n.first->second].push_back(i);
 
         // Identify the next break date if provided, default is trade maturity.
         Date nextBreakDate = portfolio_->trades()[i]->maturity();
@@ -106,30 +121,58 @@ void ExposureCalculator::build() {
                 }
             }
         }
+        nextBreakDates[i] = nextBreakDate;
+    }
 
-        Handle<YieldTermStructure> curve = market_->discountCurve(baseCurrency_, configuration_);
-        Real npv0;
-        if (flipViewXVA_) {
-            npv0 = -cube_->getT0(i);
-        } else {
-            npv0 = cube_->getT0(i);
-        }
-        vector<Real> epe(dates_.size() + 1, 0.0);
-        vector<Real> ene(dates_.size() + 1, 0.0);
-        vector<Real> ee_b(dates_.size() + 1, 0.0);
-        vector<Real> eee_b(dates_.size() + 1, 0.0);
-        vector<Real> pfe(dates_.size() + 1, 0.0);
-        epe[0] = std::max(npv0, 0.0);
-        ene[0] = std::max(-npv0, 0.0);
-        ee_b[0] = epe[0];
-        eee_b[0] = ee_b[0];
-        pfe[0] = std::max(npv0, 0.0);
-        exposureCube_->setT0(epe[0], tradeId, ExposureIndex::EPE);
-        exposureCube_->setT0(ene[0], tradeId, ExposureIndex::ENE);
-        for (Size j = 0; j < dates_.size(); ++j) {
-            Date d = cube_->dates()[j];
-            vector<Real> distribution(cube_->samples(), 0.0);
-            for (Size k = 0; k < cube_->samples(); ++k) {
+    // Trade results, reduced into the result maps on the calling thread in portfolio order
+    struct TradeResult {
+        vector<Real> ee_b, eee_b, pfe;
+        Real epe_b = 0.0, eepe_b = 0.0;
+    };
+    vector<TradeResult> results(portfolio_->size());
+
+    // Netting set values of each netting set, looked up on the calling thread
+    vector<vector<vector<Real>>*> nettingSetDefaultValues(nettingSetTrades.size()),
+        nettingSetCloseOutValues(nettingSetTrades.size());
+    for (auto const& n : nettingSetIndex) {
+        nettingSetDefaultValues[n.second] = &nettingSetDefaultValue_[n.first];
+        nettingSetCloseOutValues[n.second] = &nettingSetCloseOutValue_[n.first];
+    }
+
+    /* The netting sets are independent of each other, we distribute them over the worker threads. The trades of a
+       netting set are processed by one thread in portfolio order, so that the netting set values are aggregated in
+       the same order as in a single threaded run. Each trade writes to its own rows of the exposure cube and to its
+       own result slot. */
+    parallelFor(nettingSetTrades.size(), nThreads_, [&](const Size n) {
+        vector<vector<Real>>& nettingSetDefaultValue = *nettingSetDefaultValues[n];
+        vector<vector<Real>>& nettingSetCloseOutValue = *nettingSetCloseOutValues[n];
+        QuantileEstimator pfeEstimator(quantile_, cube_->samples());
+        for (Size i : nettingSetTrades[n]) {
+            string tradeId = portfolio_->trades()[i]->id();
+            LOG("Aggregate exposure for trade " << tradeId);
+            Date nextBreakDate = nextBreakDates[i];
+            Real npv0;
+            if (flipViewXVA_) {
+                npv0 = -cube_->getT0(i);
+            } else {
+                npv0 = cube_->getT0(i);
+            }
+            vector<Real> epe(dates_.size() + 1, 0.0);
+            vector<Real> ene(dates_.size() + 1, 0.0);
+            vector<Real> ee_b(dates_.size() + 1, 0.0);
+            vector<Real> eee_b(dates_.size() + 1, 0.0);
+            vector<Real> pfe(dates_.size() + 1, 0.0);
+            epe[0] = std::max(npv0, 0.0);
+            ene[0] = std::max(-npv0, 0.0);
+            ee_b[0] = epe[0];
+            eee_b[0] = ee_b[0];
+            pfe[0] = std::max(npv0, 0.0);
+            exposureCube_->setT0(epe[0], i, ExposureIndex::EPE);
+            exposureCube_->setT0(ene[0], i, ExposureIndex::ENE);
+            vector<Real> defaultValues(cube_->samples(), 0.0), closeOutValues(cube_->samples(), 0.0);
+            vector<Real> distribution(cube_->samples(), 0.0), exposure(cube_->samples(), 0.0);
+            for (Size j = 0; j < dates_.size(); ++j) {
+                Date d = cube_->dates()[j];
                 // RL 2020-07-17
                 // 1) If the calculation type is set to NoLag:
                 //    Collateral balances are NOT delayed by the MPoR, but we use the close-out NPV.
@@ -137,72 +180,90 @@ void ExposureCalculator::build() {
                 //    Collateral balances are delayed by the MPoR (if possible, i.e. the valuation
                 //    grid has MPoR spacing), and we use the default date NPV.
                 //    This is the treatment in the ORE releases up to June 2020).
-                Real defaultValue =
-                    d > nextBreakDate && exerciseNextBreak_ ? 0.0 : cubeInterpretation_->getDefaultNpv(cube_, i, j, k);
-                Real closeOutValue;
+                bool afterBreak = d > nextBreakDate && exerciseNextBreak_;
+                if (afterBreak)
+                    std::fill(defaultValues.begin(), defaultValues.end(), 0.0);
+                else
+                    cubeInterpretation_->getDefaultNpvs(cube_, i, j, defaultValues);
                 if (isRegularCubeStorage_ && j == dates_.size() - 1)
-                    closeOutValue = defaultValue;
+                    closeOutValues = defaultValues;
+                else if (afterBreak)
+                    std::fill(closeOutValues.begin(), closeOutValues.end(), 0.0);
                 else
-                    closeOutValue = d > nextBreakDate && exerciseNextBreak_
-                                        ? 0.0
-                                        : cubeInterpretation_->getCloseOutNpv(cube_, i, j, k);
-                Real npv = calcType_ == CollateralExposureHelper::CalculationType::NoLag ? closeOutValue : defaultValue;
-                epe[j + 1] += max(npv, 0.0) / cube_->samples();
-                ene[j + 1] += max(-npv, 0.0) / cube_->samples();
-                nettingSetDefaultValue_[nettingSetId][j][k] += defaultValue;
-                nettingSetCloseOutValue_[nettingSetId][j][k] += closeOutValue;
-                distribution[k] = npv;
+                    cubeInterpretation_->getCloseOutNpvs(cube_, i, j, closeOutValues);
+                vector<Real>& nettingSetDefaultValueDate = nettingSetDefaultValue[j];
+                vector<Real>& nettingSetCloseOutValueDate = nettingSetCloseOutValue[j];
+                for (Size k = 0; k < cube_->samples(); ++k) {
+                    Real defaultValue = defaultValues[k];
+                    Real closeOutValue = closeOutValues[k];
+                    Real npv =
+                        calcType_ == CollateralExposureHelper::CalculationType::NoLag ? closeOutValue : defaultValue;
+                    epe[j + 1] += max(npv, 0.0) / cube_->samples();
+                    ene[j + 1] += max(-npv, 0.0) / cube_->samples();
+                    nettingSetDefaultValueDate[k] += defaultValue;
+                    nettingSetCloseOutValueDate[k] += closeOutValue;
+                    distribution[k] = npv;
+                }
                 if (multiPath_) {
-                    exposureCube_->set(max(npv, 0.0), tradeId, d, k, ExposureIndex::EPE);
-                    exposureCube_->set(max(-npv, 0.0), tradeId, d, k, ExposureIndex::ENE);
+                    for (Size k = 0; k < cube_->samples(); ++k)
+                        exposure[k] = max(distribution[k], 0.0);
+                    exposureCube_->setSamples(exposure.data(), i, j, ExposureIndex::EPE);
+                    for (Size k = 0; k < cube_->samples(); ++k)
+                        exposure[k] = max(-distribution[k], 0.0);
+                    exposureCube_->setSamples(exposure.data(), i, j, ExposureIndex::ENE);
+                } else {
+                    exposureCube_->set(epe[j + 1], i, j, 0, ExposureIndex::EPE);
+                    exposureCube_->set(ene[j + 1], i, j, 0, ExposureIndex::ENE);
                 }
+                ee_b[j + 1] = epe[j + 1] / discounts[j];
+                eee_b[j + 1] = std::max(eee_b[j], ee_b[j + 1]);
+                // the distribution is not used after this point and can be reordered by the estimator
+                pfe[j + 1] = std::max(pfeEstimator.value(distribution), 0.0);
             }
-            if (!multiPath_) {
-                exposureCube_->set(epe[j + 1], tradeId, d, 0, ExposureIndex::EPE);
-                exposureCube_->set(ene[j + 1], tradeId, d, 0, ExposureIndex::ENE);
-            }
-            ee_b[j + 1] = epe[j + 1] / curve->discount(cube_->dates()[j]);
-            eee_b[j + 1] = std::max(eee_b[j], ee_b[j + 1]);
-            std::sort(distribution.begin(), distribution.end());
-            Size index = Size(floor(quantile_ * (cube_->samples() - 1) + 0.5));
-            pfe[j + 1] = std::max(distribution[index], 0.0);
-        }
-        ee_b_[tradeId] = ee_b;
-        eee_b_[tradeId] = eee_b;
-        pfe_[tradeId] = pfe;
-
-        Real epe_b = 0.0;
-        Real eepe_b = 0.0;
-
-        Size t = 0;
-        Calendar cal = WeekendsOnly();
-        /*The time average in the EEPE calculation is taken over the first year of the exposure evolution
-        (or until maturity if all positions of the netting set mature before one year).
-        This one year point is actually taken to be today+1Y+4D, so that the 1Y point on the dateGrid is always
-        included.
-        This may effect DateGrids with daily data points*/
-        Date maturity = std::min(cal.adjust(today_ + 1 * Years + 4 * Days), portfolio_->trades()[i]->maturity());
-        QuantLib::Real maturityTime = dc_.yearFraction(today_, maturity);
-
-        while (t < dates_.size() && times_[t] <= maturityTime)
-            ++t;
-
-        if (t > 0) {
-            vector<double> weights(t);
-            weights[0] = times_[0];
-            for (Size k = 1; k < t; k++)
-                weights[k] = times_[k] - times_[k - 1];
-            double totalWeights = std::accumulate(weights.begin(), weights.end(), 0.0);
-            for (Size k = 0; k < t; k++)
-                weights[k] /= totalWeights;
-
-            for (Size k = 0; k < t; k++) {
-                epe_b += ee_b[k] * weights[k];
-                eepe_b += eee_b[k] * weights[k];
+
+            TradeResult& res = results[i];
+
+            Size t = 0;
+            Calendar cal = WeekendsOnly();
+            /*The time average in the EEPE calculation is taken over the first year of the exposure evolution
+            (or until maturity if all positions of the netting set mature before one year).
+            This one year point is actually taken to be today+1Y+4D, so that the 1Y point on the dateGrid is always
+            included.
+            This may effect DateGrids with daily data points*/
+            Date maturity = std::min(cal.adjust(today_ + 1 * Years + 4 * Days), portfolio_->trades()[i]->maturity());
+            QuantLib::Real maturityTime = dc_.yearFraction(today_, maturity);
+
+            while (t < dates_.size() && times_[t] <= maturityTime)
+                ++t;
+
+            if (t > 0) {
+                vector<double> weights(t);
+                weights[0] = times_[0];
+                for (Size k = 1; k < t; k++)
+                    weights[k] = times_[k] - times_[k - 1];
+                double totalWeights = std::accumulate(weights.begin(), weights.end(), 0.0);
+                for (Size k = 0; k < t; k++)
+                    weights[k] /= totalWeights;
+
+                for (Size k = 0; k < t; k++) {
+                    res.epe_b += ee_b[k] * weights[k];
+                    res.eepe_b += eee_b[k] * weights[k];
+                }
             }
+            res.ee_b = std::move(ee_b);
+            res.eee_b = std::move(eee_b);
+            res.pfe = std::move(pfe);
         }
-        epe_b_[tradeId] = epe_b;
-        eepe_b_[tradeId] = eepe_b;
+    });
+
+    for (Size i = 0; i < portfolio_->size(); ++i) {
+        string tradeId = portfolio_->trades()[i]->id();
+        TradeResult& res = results[i];
+        ee_b_[tradeId] = std::move(res.ee_b);
+        eee_b_[tradeId] = std::move(res.eee_b);
+        pfe_[tradeId] = std::move(res.pfe);
+        epe_b_[tradeId] = res.epe_b;
+        eepe_b_[tradeId] = res.eepe_b;
     }
 }
 
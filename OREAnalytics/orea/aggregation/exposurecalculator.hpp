@@ -67,7 +67,9 @@ public:
 	    //! Flag to indicate exposure evaluation with dynamic credit
         const bool multiPath,
         //! Flag to indicate flipped xva calculation
-        const bool flipViewXVA
+        const bool flipViewXVA,
+        //! Number of threads used to process the netting sets
+        const Size nThreads = 1
     );
 
     virtual ~ExposureCalculator() {}
@@ -148,6 +150,7 @@ protected:
     map<string, Real> eepe_b_;
     vector<Real> getMeanExposure(const string& tid, ExposureIndex index);
     bool flipViewXVA_;
+    Size nThreads_;
 };
 
 } // namespace analytics
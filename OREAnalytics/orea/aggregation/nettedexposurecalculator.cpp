@@ -17,9 +17,12 @@
 */
 
 #include <orea/aggregation/nettedexposurecalculator.hpp>
+#include <orea/aggregation/quantileestimator.hpp>
+#include <ored/utilities/parallelfor.hpp>
 
 #include <ql/time/date.hpp>
 #include <ql/time/calendars/weekendsonly.hpp>
+#include <ql/utilities/null.hpp>
 
 using namespace std;
 using namespace QuantLib;
@@ -45,7 +48,8 @@ NettedExposureCalculator::NettedExposureCalculator(
     const boost::shared_ptr<NPVCube>& tradeExposureCube,
     const Size allocatedEpeIndex,
     const Size allocatedEneIndex, 
-    const bool flipViewXVA)
+    const bool flipViewXVA,
+    const Size nThreads)
     : portfolio_(portfolio), market_(market), cube_(cube),
       baseCurrency_(baseCurrency), configuration_(configuration),
       quantile_(quantile), calcType_(calcType),
@@ -58,7 +62,7 @@ NettedExposureCalculator::NettedExposureCalculator(
       marginalAllocation_(marginalAllocation),
       marginalAllocationLimit_(marginalAllocationLimit),
       tradeExposureCube_(tradeExposureCube), allocatedEpeIndex_(allocatedEpeIndex),
-      allocatedEneIndex_(allocatedEneIndex), flipViewXVA_(flipViewXVA) {
+      allocatedEneIndex_(allocatedEneIndex), flipViewXVA_(flipViewXVA), nThreads_(nThreads) {
 
     vector<string> nettingSetIds;
     for (auto nettingSet : nettingSetDefaultValue) {
@@ -96,7 +100,7 @@ void NettedExposureCalculator::build() {
     
     map<string, Real> nettingSetValueToday;
     map<string, Date> nettingSetMaturity;
-    map<string, Size> nettingSetSize;
+    map<string, vector<Size>> nettingSetTrades; // trade indices in portfolio order
     for (Size i = 0; i < portfolio_->trades().size(); ++i) {
         const auto& trade = portfolio_->trades()[i];
         string tradeId = trade->id();
@@ -117,80 +121,128 @@ void NettedExposureCalculator::build() {
         if (nettingSetValueToday.find(nettingSetId) == nettingSetValueToday.end()) {
             nettingSetValueToday[nettingSetId] = 0.0;
             nettingSetMaturity[nettingSetId] = today;
-            nettingSetSize[nettingSetId] = 0;
         }
 
         nettingSetValueToday[nettingSetId] += npv;
 
         if (trade->maturity() > nettingSetMaturity[nettingSetId])
             nettingSetMaturity[nettingSetId] = trade->maturity();
-        nettingSetSize[nettingSetId]++;
+        nettingSetTrades[nettingSetId].push_back(i);
     }
 
     vector<vector<Real>> averagePositiveAllocation(portfolio_->size(), vector<Real>(cube_->dates().size(), 0.0));
     vector<vector<Real>> averageNegativeAllocation(portfolio_->size(), vector<Real>(cube_->dates().size(), 0.0));
 
-    map<string, vector<vector<Real>>> nettingSetValue = (calcType_ == CollateralExposureHelper::CalculationType::NoLag
-							 ? nettingSetCloseOutValue_
-							 : nettingSetDefaultValue_);
-    Size nettingSetCount = 0;
-    for (auto n : nettingSetValue) {
-        string nettingSetId = n.first;
-
-        LOG("Aggregate exposure for netting set " << nettingSetId);
-        vector<vector<Real>> data = n.second;
-
-        // Get the collateral account balance paths for the netting set.
-        // The pointer may remain empty if there is no CSA or if it is inactive.
-        boost::shared_ptr<vector<boost::shared_ptr<CollateralAccount>>> collateral =
-            collateralPaths(nettingSetId,
-                            nettingSetValueToday[nettingSetId],
-                            nettingSetDefaultValue_[nettingSetId],
-                            nettingSetMaturity[nettingSetId]);
+    const map<string, vector<vector<Real>>>& nettingSetValue =
+        (calcType_ == CollateralExposureHelper::CalculationType::NoLag ? nettingSetCloseOutValue_
+                                                                        : nettingSetDefaultValue_);
+    // Get the collateral account balance paths for all netting sets with active CSA
+    map<string, boost::shared_ptr<CollateralBalances>> collateralBalances =
+        collateralPaths(nettingSetValueToday, nettingSetMaturity);
+
+    // Discount factors on the exposure grid, market data is accessed on the calling thread only
+    Handle<YieldTermStructure> curve = market_->discountCurve(baseCurrency_, configuration_);
+    vector<Real> discounts(cube_->dates().size(), 1.0);
+    for (Size j = 0; j < cube_->dates().size(); ++j)
+        discounts[j] = curve->discount(cube_->dates()[j]);
+
+    // Netting set data, collected on the calling thread
+    struct NettingSetInput {
+        string nettingSetId;
+        const vector<vector<Real>>* data;
+        boost::shared_ptr<CollateralBalances> collateral; // empty if there is no CSA or if it is inactive
+        boost::shared_ptr<NettingSetDefinition> netting;
+        string csaIndexName;
+        DayCounter collateralDc;
+        CSA::Type initialMarginType;
+        const vector<vector<Real>>* dim; // null if initial margin is not applied
+        const vector<Size>* trades;
+        // scenario data handles, null if the series is not needed
+        Size csaFxHandle, csaIndexHandle, numeraireHandle;
+    };
+    vector<NettingSetInput> inputs;
+
+    for (auto const& n : nettingSetValue) {
+        const string& nettingSetId = n.first;
+
+        NettingSetInput in;
+        in.nettingSetId = nettingSetId;
+        in.data = &n.second;
+        auto c = collateralBalances.find(nettingSetId);
+        if (c != collateralBalances.end())
+            in.collateral = c->second;
 
 	// Get the CSA index for Eonia Floor calculation below
         colva_[nettingSetId] = 0.0;
         collateralFloor_[nettingSetId] = 0.0;
-        boost::shared_ptr<NettingSetDefinition> netting = nettingSetManager_->get(nettingSetId);
-        string csaIndexName;
-        Handle<IborIndex> csaIndex;
+        in.netting = nettingSetManager_->get(nettingSetId);
+        in.collateralDc = ActualActual(ActualActual::ISDA);
         bool applyInitialMargin = false;
-        CSA::Type initialMarginType = CSA::Bilateral;
-        if (netting->activeCsaFlag()) {
-            csaIndexName = netting->csaDetails()->index();
-            if (csaIndexName != "") {
-                csaIndex = market_->iborIndex(csaIndexName);
-                QL_REQUIRE(scenarioData_->has(AggregationScenarioDataType::IndexFixing, csaIndexName),
-                           "scenario data does not provide index values for " << csaIndexName);
+        in.initialMarginType = CSA::Bilateral;
+        if (in.netting->activeCsaFlag()) {
+            in.csaIndexName = in.netting->csaDetails()->index();
+            if (in.csaIndexName != "") {
+                in.collateralDc = market_->iborIndex(in.csaIndexName)->dayCounter();
+                QL_REQUIRE(scenarioData_->has(AggregationScenarioDataType::IndexFixing, in.csaIndexName),
+                           "scenario data does not provide index values for " << in.csaIndexName);
             }
-            QL_REQUIRE(netting->csaDetails(), "active CSA for netting set " << nettingSetId
+            QL_REQUIRE(in.netting->csaDetails(), "active CSA for netting set " << nettingSetId
                     << ", but CSA details not initialised");
-            applyInitialMargin = netting->csaDetails()->applyInitialMargin() && applyInitialMargin_;
-            initialMarginType = netting->csaDetails()->initialMarginType();
+            applyInitialMargin = in.netting->csaDetails()->applyInitialMargin() && applyInitialMargin_;
+            in.initialMarginType = in.netting->csaDetails()->initialMarginType();
             LOG("ApplyInitialMargin=" << applyInitialMargin << " for netting set " << nettingSetId 
-                << ", CSA IM=" << netting->csaDetails()->applyInitialMargin()
-                << ", CSA IM Type=" << initialMarginType
+                << ", CSA IM=" << in.netting->csaDetails()->applyInitialMargin()
+                << ", CSA IM Type=" << in.initialMarginType
                 << ", Analytics DIM=" << applyInitialMargin_);
-            if (applyInitialMargin_ && !netting->csaDetails()->applyInitialMargin())
+            if (applyInitialMargin_ && !in.netting->csaDetails()->applyInitialMargin())
                 ALOG("ApplyInitialMargin deactivated at netting set level " << nettingSetId);
-            if (!applyInitialMargin_ && netting->csaDetails()->applyInitialMargin())
+            if (!applyInitialMargin_ && in.netting->csaDetails()->applyInitialMargin())
                 ALOG("ApplyInitialMargin deactivated in analytics, but active at netting set level " << nettingSetId);
         }
+        // don't apply initial margin without VM, i.e. inactive CSA
+        in.dim = applyInitialMargin && in.collateral ? &dimCalculator_->dynamicIM(nettingSetId) : nullptr;
+        in.trades = &nettingSetTrades[nettingSetId];
+        in.csaFxHandle = in.csaIndexHandle = in.numeraireHandle = Null<Size>();
+        if (in.collateral && in.netting->csaDetails()->csaCurrency() != baseCurrency_)
+            in.csaFxHandle =
+                scenarioData_->handle(AggregationScenarioDataType::FXSpot, in.netting->csaDetails()->csaCurrency());
+        if (in.netting->activeCsaFlag()) {
+            if (in.csaIndexName != "")
+                in.csaIndexHandle = scenarioData_->handle(AggregationScenarioDataType::IndexFixing, in.csaIndexName);
+            in.numeraireHandle = scenarioData_->handle(AggregationScenarioDataType::Numeraire);
+        }
+        inputs.push_back(in);
+    }
+
+    // Netting set results, reduced into the result maps on the calling thread in netting set order
+    struct NettingSetResult {
+        vector<Real> ee_b, eee_b, pfe, eab, colvaInc, eoniaFloorInc;
+        Real colva = 0.0, collateralFloor = 0.0, epe_b = 0.0, eepe_b = 0.0;
+    };
+    vector<NettingSetResult> results(inputs.size());
+
+    /* The netting sets are independent of each other, we distribute them over the worker threads. The netting set
+       with index nettingSetCount writes to its own rows of the netted and exposure cubes, to the rows of its own trades
+       in the trade exposure cube and allocation arrays, and to its own result slot. */
+    parallelFor(inputs.size(), nThreads_, [&](const Size nettingSetCount) {
+        const NettingSetInput& in = inputs[nettingSetCount];
+        NettingSetResult& res = results[nettingSetCount];
+        const string& nettingSetId = in.nettingSetId;
+        const vector<vector<Real>>& data = *in.data;
+        const boost::shared_ptr<CollateralBalances>& collateral = in.collateral;
+        const boost::shared_ptr<NettingSetDefinition>& netting = in.netting;
+
+        LOG("Aggregate exposure for netting set " << nettingSetId);
 
-        Handle<YieldTermStructure> curve = market_->discountCurve(baseCurrency_, configuration_);
         vector<Real> epe(cube_->dates().size() + 1, 0.0);
         vector<Real> ene(cube_->dates().size() + 1, 0.0);
         vector<Real> ee_b(cube_->dates().size() + 1, 0.0);
         vector<Real> eee_b(cube_->dates().size() + 1, 0.0);
-        vector<Real> eee_b_kva_1(cube_->dates().size() + 1, 0.0);
-        vector<Real> eee_b_kva_2(cube_->dates().size() + 1, 0.0);
-        vector<Real> eepe_b_kva_1(cube_->dates().size() + 1, 0.0);
-        vector<Real> eepe_b_kva_2(cube_->dates().size() + 1, 0.0);
         vector<Real> eab(cube_->dates().size() + 1, 0.0);
         vector<Real> pfe(cube_->dates().size() + 1, 0.0);
         vector<Real> colvaInc(cube_->dates().size() + 1, 0.0);
         vector<Real> eoniaFloorInc(cube_->dates().size() + 1, 0.0);
-        Real npv = nettingSetValueToday[nettingSetId];
+        Real npv = nettingSetValueToday.at(nettingSetId);
         if ((fullInitialCollateralisation_) & (netting->activeCsaFlag())) {
             // This assumes that the collateral at t=0 is the same as the npv at t=0.
             epe[0] = 0;
@@ -210,86 +262,92 @@ void NettedExposureCalculator::build() {
         exposureCube_->setT0(epe[0], nettingSetCount, ExposureIndex::EPE);
         exposureCube_->setT0(ene[0], nettingSetCount, ExposureIndex::ENE);
 
+        vector<Real> balances(cube_->samples(), 0.0), tradeNpvs(cube_->samples(), 0.0);
+        vector<Real> exposureEpe(cube_->samples(), 0.0), exposureEne(cube_->samples(), 0.0);
+        vector<Real> distribution(cube_->samples(), 0.0);
+        QuantileEstimator pfeEstimator(quantile_, cube_->samples());
         for (Size j = 0; j < cube_->dates().size(); ++j) {
 
             Date date = cube_->dates()[j];
             Date prevDate = j > 0 ? cube_->dates()[j - 1] : today;
-            vector<Real> distribution(cube_->samples(), 0.0);
+            const Real* fxRates =
+                in.csaFxHandle != Null<Size>() ? scenarioData_->samples(j, in.csaFxHandle) : nullptr;
+            const Real* indexValues =
+                in.csaIndexHandle != Null<Size>() ? scenarioData_->samples(j, in.csaIndexHandle) : nullptr;
+            const Real* numeraires =
+                in.numeraireHandle != Null<Size>() ? scenarioData_->samples(j, in.numeraireHandle) : nullptr;
             for (Size k = 0; k < cube_->samples(); ++k) {
                 Real balance = 0.0;
                 if (collateral) {
-                    balance = collateral->at(k)->accountBalance(date);
-                    if (netting->csaDetails()->csaCurrency() != baseCurrency_) {
-                        // Convert from CSACurrency to baseCurrency
-                        double fxRate = scenarioData_->get(j, k, AggregationScenarioDataType::FXSpot,
-                                                           netting->csaDetails()->csaCurrency());
-                        balance *= fxRate;
-                    }
+                    balance = collateral->balance(j, k);
+                    // Convert from CSACurrency to baseCurrency
+                    if (fxRates)
+                        balance *= fxRates[k];
                 }
                 eab[j + 1] += balance / cube_->samples();
                 Real exposure = data[j][k] - balance;
                 Real dim = 0.0;
-                if (applyInitialMargin && collateral) { // don't apply initial margin without VM, i.e. inactive CSA
+                if (in.dim) {
                     // Initial Margin
                     // Use IM to reduce exposure
                     // Size dimIndex = j == 0 ? 0 : j - 1;
                     Size dimIndex = j;
-                    dim = dimCalculator_->dynamicIM(nettingSetId)[dimIndex][k];
+                    dim = (*in.dim)[dimIndex][k];
                     QL_REQUIRE(dim >= 0, "negative DIM for set " << nettingSetId << ", date " << j << ", sample " << k
                                                                  << ": " << dim);
                 }
                 Real dim_epe = 0;
                 Real dim_ene = 0;
-                if (initialMarginType != CSA::Type::PostOnly)
+                if (in.initialMarginType != CSA::Type::PostOnly)
                     dim_epe = dim;
-                if (initialMarginType != CSA::Type::CallOnly)
+                if (in.initialMarginType != CSA::Type::CallOnly)
                     dim_ene = dim;
                 epe[j + 1] += std::max(exposure - dim_epe, 0.0) /
                               cube_->samples(); // dim here represents the held IM, and is expressed as a positive number
                 ene[j + 1] += std::max(-exposure - dim_ene, 0.0) /
                               cube_->samples(); // dim here represents the posted IM, and is expressed as a positive number
                 distribution[k] = exposure;
-                nettedCube_->set(exposure, nettingSetCount, j, k);
+                balances[k] = balance;
                 if (multiPath_) {
-                    exposureCube_->set(std::max(exposure - dim_epe, 0.0), nettingSetCount, j, k, ExposureIndex::EPE);
-                    exposureCube_->set(std::max(-exposure - dim_ene, 0.0), nettingSetCount, j, k, ExposureIndex::ENE);
+                    exposureEpe[k] = std::max(exposure - dim_epe, 0.0);
+                    exposureEne[k] = std::max(-exposure - dim_ene, 0.0);
                 }
 
                 if (netting->activeCsaFlag()) {
-                    Real indexValue = 0.0;
-                    DayCounter dc = ActualActual(ActualActual::ISDA);
-                    if (csaIndexName != "") {
-                        indexValue = scenarioData_->get(j, k, AggregationScenarioDataType::IndexFixing, csaIndexName);
-                        dc = csaIndex->dayCounter();
-                    }
-                    Real dcf = dc.yearFraction(prevDate, date);
+                    Real indexValue = indexValues ? indexValues[k] : 0.0;
+                    Real dcf = in.collateralDc.yearFraction(prevDate, date);
                     Real collateralSpread = (balance >= 0.0 ? netting->csaDetails()->collatSpreadRcv() : netting->csaDetails()->collatSpreadPay());
-                    Real numeraire = scenarioData_->get(j, k, AggregationScenarioDataType::Numeraire);
+                    Real numeraire = numeraires[k];
                     Real colvaDelta = -balance * collateralSpread * dcf / numeraire / cube_->samples();
                     // intuitive floorDelta including collateralSpread would be:
                     // -balance * (max(indexValue - collateralSpread,0) - (indexValue - collateralSpread)) * dcf /
                     // samples
                     Real floorDelta = -balance * std::max(-(indexValue - collateralSpread), 0.0) * dcf / numeraire / cube_->samples();
                     colvaInc[j + 1] += colvaDelta;
-                    colva_[nettingSetId] += colvaDelta;
+                    res.colva += colvaDelta;
                     eoniaFloorInc[j + 1] += floorDelta;
-                    collateralFloor_[nettingSetId] += floorDelta;
+                    res.collateralFloor += floorDelta;
                 }
+            }
+            nettedCube_->setSamples(distribution.data(), nettingSetCount, j);
+            if (multiPath_) {
+                exposureCube_->setSamples(exposureEpe.data(), nettingSetCount, j, ExposureIndex::EPE);
+                exposureCube_->setSamples(exposureEne.data(), nettingSetCount, j, ExposureIndex::ENE);
+            }
 
-                if (marginalAllocation_) {
-                    for (Size i = 0; i < portfolio_->trades().size(); ++i) {
-                        string nid = portfolio_->trades()[i]->envelope().nettingSetId();
-                        if (nid != nettingSetId)
-                            continue;
-                        string tid = portfolio_->trades()[i]->id();
+            if (marginalAllocation_) {
+                for (Size i : *in.trades) {
+                    cubeInterpretation_->getDefaultNpvs(cube_, i, j, tradeNpvs);
+                    for (Size k = 0; k < cube_->samples(); ++k) {
+                        Real exposure = distribution[k];
                         Real allocation = 0.0;
-                        if (balance == 0.0)
-                            allocation = cubeInterpretation_->getDefaultNpv(cube_, i, j, k);
+                        if (balances[k] == 0.0)
+                            allocation = tradeNpvs[k];
                         // else if (data[j][k] == 0.0)
                         else if (fabs(data[j][k]) <= marginalAllocationLimit_)
-                            allocation = exposure / nettingSetSize[nid];
+                            allocation = exposure / in.trades->size();
                         else
-                            allocation = exposure * cubeInterpretation_->getDefaultNpv(cube_, i, j, k) / data[j][k];
+                            allocation = exposure * tradeNpvs[k] / data[j][k];
 
                         if (multiPath_) {
                             if (exposure > 0.0)
@@ -309,27 +367,15 @@ void NettedExposureCalculator::build() {
                 exposureCube_->set(epe[j + 1], nettingSetCount, j, 0, ExposureIndex::EPE);
                 exposureCube_->set(ene[j + 1], nettingSetCount, j, 0, ExposureIndex::ENE);
             }
-            ee_b[j + 1] = epe[j + 1] / curve->discount(cube_->dates()[j]);
+            ee_b[j + 1] = epe[j + 1] / discounts[j];
             eee_b[j + 1] = std::max(eee_b[j], ee_b[j + 1]);
-            std::sort(distribution.begin(), distribution.end());
-            Size index = Size(floor(quantile_ * (cube_->samples() - 1) + 0.5));
-            pfe[j + 1] = std::max(distribution[index], 0.0);
+            // the distribution is not used after this point and can be reordered by the estimator
+            pfe[j + 1] = std::max(pfeEstimator.value(distribution), 0.0);
         }
-        ee_b_[nettingSetId] = ee_b;
-        eee_b_[nettingSetId] = eee_b;
-        pfe_[nettingSetId] = pfe;
-        expectedCollateral_[nettingSetId] = eab;
-        colvaInc_[nettingSetId] = colvaInc;
-        eoniaFloorInc_[nettingSetId] = eoniaFloorInc;
-
-        nettingSetCount++;
-
-        Real epe_b = 0;
-        Real eepe_b = 0;
 
         Size t = 0;
         Calendar cal = WeekendsOnly();
-        Date maturity = std::min(cal.adjust(today + 1 * Years + 4 * Days), nettingSetMaturity[nettingSetId]);
+        Date maturity = std::min(cal.adjust(today + 1 * Years + 4 * Days), nettingSetMaturity.at(nettingSetId));
         QuantLib::Real maturityTime = dc.yearFraction(today, maturity);
 
         while (t < cube_->dates().size() && times[t] <= maturityTime)
@@ -345,12 +391,32 @@ void NettedExposureCalculator::build() {
                 weights[k] /= totalWeights;
 
             for (Size k = 0; k < t; k++) {
-                epe_b += ee_b[k] * weights[k];
-                eepe_b += eee_b[k] * weights[k];
+                res.epe_b += ee_b[k] * weights[k];
+                res.eepe_b += eee_b[k] * weights[k];
             }
         }
-        epe_b_[nettingSetId] = epe_b;
-        eepe_b_[nettingSetId] = eepe_b;
+
+        res.ee_b = std::move(ee_b);
+        res.eee_b = std::move(eee_b);
+        res.pfe = std::move(pfe);
+        res.eab = std::move(eab);
+        res.colvaInc = std::move(colvaInc);
+        res.eoniaFloorInc = std::move(eoniaFloorInc);
+    });
+
+    for (Size n = 0; n < inputs.size(); ++n) {
+        const string& nettingSetId = inputs[n].nettingSetId;
+        NettingSetResult& res = results[n];
+        ee_b_[nettingSetId] = std::move(res.ee_b);
+        eee_b_[nettingSetId] = std::move(res.eee_b);
+        pfe_[nettingSetId] = std::move(res.pfe);
+        expectedCollateral_[nettingSetId] = std::move(res.eab);
+        colvaInc_[nettingSetId] = std::move(res.colvaInc);
+        eoniaFloorInc_[nettingSetId] = std::move(res.eoniaFloorInc);
+        colva_[nettingSetId] += res.colva;
+        collateralFloor_[nettingSetId] += res.collateralFloor;
+        epe_b_[nettingSetId] = res.epe_b;
+        eepe_b_[nettingSetId] = res.eepe_b;
     }
                 
     if (marginalAllocation_ && !multiPath_) {
@@ -363,77 +429,104 @@ void NettedExposureCalculator::build() {
     }
 }
 
-boost::shared_ptr<vector<boost::shared_ptr<CollateralAccount>>>
+map<string, boost::shared_ptr<CollateralBalances>>
 NettedExposureCalculator::collateralPaths(
-    const string& nettingSetId,
-    const Real& nettingSetValueToday,
-    const vector<vector<Real>>& nettingSetValue,
-    const Date& nettingSetMaturity) {
+    const map<string, Real>& nettingSetValueToday,
+    const map<string, Date>& nettingSetMaturity) {
+
+    // collateral simulation input for a netting set with active CSA
+    struct CollateralInput {
+        string nettingSetId;
+        boost::shared_ptr<NettingSetDefinition> netting;
+        Real csaFxRateToday;
+        Real csaRateToday;
+    };
+    vector<CollateralInput> inputs;
+
+    // Market data is accessed on the calling thread only
+    for (auto const& n : nettingSetDefaultValue_) {
+        const string& nettingSetId = n.first;
+        if (!nettingSetManager_->has(nettingSetId) || !nettingSetManager_->get(nettingSetId)->activeCsaFlag()) {
+            LOG("CSA missing or inactive for netting set " << nettingSetId);
+            continue;
+        }
 
-    boost::shared_ptr<vector<boost::shared_ptr<CollateralAccount>>> collateral;
+        boost::shared_ptr<NettingSetDefinition> netting = nettingSetManager_->get(nettingSetId);
+        string csaFxPair = netting->csaDetails()->csaCurrency() + baseCurrency_;
+        Real csaFxRateToday = 1.0;
+        if (netting->csaDetails()->csaCurrency() != baseCurrency_)
+            csaFxRateToday = market_->fxRate(csaFxPair, configuration_)->value();
+        LOG("CSA FX rate for pair " << csaFxPair << " = " << csaFxRateToday);
+
+        // Don't use Settings::instance().evaluationDate() here, this has moved to simulation end date.
+        Date today = market_->asofDate();
+        string csaIndexName = netting->csaDetails()->index();
+        // avoid thrown errors of the index fixing here on holidays of the index, instead take the preceding date then.
+        if (!market_->iborIndex(csaIndexName, configuration_)->isValidFixingDate(today)) {
+            today = market_->iborIndex(csaIndexName, configuration_)->fixingCalendar().adjust(today, Preceding);
+        }
+        Real csaRateToday = market_->iborIndex(csaIndexName, configuration_)->fixing(today);
+        LOG("CSA compounding rate for index " << csaIndexName << " = " << setprecision(8) << csaRateToday
+                                              << " as of " << today);
 
-    if (!nettingSetManager_->has(nettingSetId) || !nettingSetManager_->get(nettingSetId)->activeCsaFlag()) {
-        LOG("CSA missing or inactive for netting set " << nettingSetId);
-        return collateral;
-    }
+        if (netting->csaDetails()->csaCurrency() != baseCurrency_) {
+            QL_REQUIRE(scenarioData_->has(AggregationScenarioDataType::FXSpot, netting->csaDetails()->csaCurrency()),
+                       "scenario data does not provide FX rates for " << csaFxPair);
+        }
+        if (csaIndexName != "") {
+            QL_REQUIRE(scenarioData_->has(AggregationScenarioDataType::IndexFixing, csaIndexName),
+                       "scenario data does not provide index values for " << csaIndexName);
+        }
 
-    LOG("Build collateral account balance paths for netting set " << nettingSetId);
-    boost::shared_ptr<NettingSetDefinition> netting = nettingSetManager_->get(nettingSetId);
-    string csaFxPair = netting->csaDetails()->csaCurrency() + baseCurrency_;
-    Real csaFxRateToday = 1.0;
-    if (netting->csaDetails()->csaCurrency() != baseCurrency_)
-        csaFxRateToday = market_->fxRate(csaFxPair, configuration_)->value();
-    LOG("CSA FX rate for pair " << csaFxPair << " = " << csaFxRateToday);
-
-    // Don't use Settings::instance().evaluationDate() here, this has moved to simulation end date.
-    Date today = market_->asofDate();
-    string csaIndexName = netting->csaDetails()->index();
-    // avoid thrown errors of the index fixing here on holidays of the index, instead take the preceding date then.
-    if (!market_->iborIndex(csaIndexName, configuration_)->isValidFixingDate(today)) {
-        today = market_->iborIndex(csaIndexName, configuration_)->fixingCalendar().adjust(today, Preceding);
-    }
-    Real csaRateToday = market_->iborIndex(csaIndexName, configuration_)->fixing(today);
-    LOG("CSA compounding rate for index " << csaIndexName << " = " << setprecision(8) << csaRateToday << " as of " << today);
-
-    // Copy scenario data to keep the collateral exposure helper unchanged
-    vector<vector<Real>> csaScenFxRates(cube_->dates().size(), vector<Real>(cube_->samples(), 0.0));
-    vector<vector<Real>> csaScenRates(cube_->dates().size(), vector<Real>(cube_->samples(), 0.0));
-    if (netting->csaDetails()->csaCurrency() != baseCurrency_) {
-        QL_REQUIRE(scenarioData_->has(AggregationScenarioDataType::FXSpot, netting->csaDetails()->csaCurrency()),
-                   "scenario data does not provide FX rates for " << csaFxPair);
-    }
-    if (csaIndexName != "") {
-        QL_REQUIRE(scenarioData_->has(AggregationScenarioDataType::IndexFixing, csaIndexName),
-                   "scenario data does not provide index values for " << csaIndexName);
+        inputs.push_back({nettingSetId, netting, csaFxRateToday, csaRateToday});
     }
-    for (Size j = 0; j < cube_->dates().size(); ++j) {
-        for (Size k = 0; k < cube_->samples(); ++k) {
-	  if (netting->csaDetails()->csaCurrency() != baseCurrency_)
-                csaScenFxRates[j][k] = cubeInterpretation_->getDefaultAggrionScenarioData(
-                    scenarioData_, AggregationScenarioDataType::FXSpot, j, k, netting->csaDetails()->csaCurrency());
-            else
-                csaScenFxRates[j][k] = 1.0;
-            if (csaIndexName != "") {
-                csaScenRates[j][k] = cubeInterpretation_->getDefaultAggrionScenarioData(
-                    scenarioData_, AggregationScenarioDataType::IndexFixing, j, k, csaIndexName);
+
+    /* The collateral simulations of the netting sets are independent of each other, we distribute them over the
+       worker threads, each netting set writes to its own result slot. */
+
+    vector<boost::shared_ptr<CollateralBalances>> results(inputs.size());
+    parallelFor(inputs.size(), nThreads_, [&](const Size i) {
+        const CollateralInput& in = inputs[i];
+        const boost::shared_ptr<NettingSetDefinition>& netting = in.netting;
+        string csaIndexName = netting->csaDetails()->index();
+        LOG("Build collateral account balance paths for netting set " << in.nettingSetId);
+
+        // Copy scenario data to keep the collateral exposure helper unchanged
+        vector<vector<Real>> csaScenFxRates(cube_->dates().size(), vector<Real>(cube_->samples(), 0.0));
+        vector<vector<Real>> csaScenRates(cube_->dates().size(), vector<Real>(cube_->samples(), 0.0));
+        for (Size j = 0; j < cube_->dates().size(); ++j) {
+            for (Size k = 0; k < cube_->samples(); ++k) {
+                if (netting->csaDetails()->csaCurrency() != baseCurrency_)
+                    csaScenFxRates[j][k] = cubeInterpretation_->getDefaultAggrionScenarioData(
+                        scenarioData_, AggregationScenarioDataType::FXSpot, j, k,
+                        netting->csaDetails()->csaCurrency());
+                else
+                    csaScenFxRates[j][k] = 1.0;
+                if (csaIndexName != "") {
+                    csaScenRates[j][k] = cubeInterpretation_->getDefaultAggrionScenarioData(
+                        scenarioData_, AggregationScenarioDataType::IndexFixing, j, k, csaIndexName);
+                }
             }
         }
-    }
-
-    collateral = CollateralExposureHelper::collateralBalancePaths(
-        netting,              // this netting set's definition
-        nettingSetValueToday, // today's netting set NPV
-        market_->asofDate(),  // original evaluation date
-        nettingSetValue,      // matrix of netting set values by date and sample
-        nettingSetMaturity,   // netting set's maximum maturity date
-        cube_->dates(),               // vector of future evaluation dates
-        csaFxRateToday,       // today's FX rate for CSA to base currency, possibly 1
-        csaScenFxRates,       // matrix of fx rates by date and sample, possibly 1
-        csaRateToday,         // today's collateral compounding rate in CSA currency
-        csaScenRates,         // matrix of CSA ccy short rates by date and sample
-        calcType_);
-    LOG("Collateral account balance paths for netting set " << nettingSetId << " done");
 
+        results[i] = CollateralExposureHelper::collateralBalances(
+            netting,                                         // this netting set's definition
+            nettingSetValueToday.at(in.nettingSetId),        // today's netting set NPV
+            market_->asofDate(),                             // original evaluation date
+            nettingSetDefaultValue_.at(in.nettingSetId),     // netting set values by date and sample
+            nettingSetMaturity.at(in.nettingSetId),          // netting set's maximum maturity date
+            cube_->dates(),                                  // vector of future evaluation dates
+            in.csaFxRateToday,                               // today's FX rate for CSA to base currency
+            csaScenFxRates,                                  // fx rates by date and sample, possibly 1
+            in.csaRateToday,                                 // today's collateral compounding rate
+            csaScenRates,                                    // CSA ccy short rates by date and sample
+            calcType_);
+        LOG("Collateral account balance paths for netting set " << in.nettingSetId << " done");
+    });
+
+    map<string, boost::shared_ptr<CollateralBalances>> collateral;
+    for (Size i = 0; i < inputs.size(); ++i)
+        collateral[inputs[i].nettingSetId] = results[i];
     return collateral;
 }
 
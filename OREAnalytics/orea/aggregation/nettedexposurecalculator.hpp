@@ -63,7 +63,9 @@ public:
         const boost::shared_ptr<NPVCube>& tradeExposureCube,
         const Size allocatedEpeIndex,
         const Size allocatedEneIndex,
-        const bool flipViewXVA);
+        const bool flipViewXVA,
+        //! Number of threads used to process the netting sets
+        const Size nThreads = 1);
 
     virtual ~NettedExposureCalculator() {}
     const boost::shared_ptr<NPVCube>& exposureCube() { return exposureCube_; }
@@ -117,6 +119,7 @@ protected:
     const Size allocatedEpeIndex_;
     const Size allocatedEneIndex_;
     const bool flipViewXVA_;
+    const Size nThreads_;
 
     // Output
     boost::shared_ptr<NPVCube> nettedCube_;
@@ -134,11 +137,11 @@ protected:
     map<string, Real> collateralFloor_;
     vector<Real> getMeanExposure(const string& tid, ExposureIndex index);
 
-    boost::shared_ptr<vector<boost::shared_ptr<CollateralAccount>>>
-    collateralPaths(const string& nettingSetId,
-        const Real& nettingSetValueToday,
-        const vector<vector<Real>>& nettingSetValue,
-        const Date& nettingSetMaturity);
+    /*! Collateral balance paths of all netting sets with active CSA, the netting sets are processed in parallel on
+        nThreads threads. Netting sets without CSA or with inactive CSA are not contained in the result. */
+    map<string, boost::shared_ptr<CollateralBalances>>
+    collateralPaths(const map<string, Real>& nettingSetValueToday,
+        const map<string, Date>& nettingSetMaturity);
 };
 
 } // namespace analytics
@@ -63,7 +63,7 @@ PostProcess::PostProcess(
     vector<Period> cvaSensiGrid, Real cvaSensiShiftSize,
     Real kvaCapitalDiscountRate, Real kvaAlpha, Real kvaRegAdjustment, Real kvaCapitalHurdle, Real kvaOurPdFloor,
     Real kvaTheirPdFloor, Real kvaOurCvaRiskWeight, Real kvaTheirCvaRiskWeight, const boost::shared_ptr<NPVCube>& cptyCube,
-    const string& flipViewBorrowingCurvePostfix, const string& flipViewLendingCurvePostfix)
+    const string& flipViewBorrowingCurvePostfix, const string& flipViewLendingCurvePostfix, Size nThreads)
     : portfolio_(portfolio), nettingSetManager_(nettingSetManager), market_(market), configuration_(configuration),
       cube_(cube), cptyCube_(cptyCube), scenarioData_(scenarioData), analytics_(analytics), baseCurrency_(baseCurrency), quantile_(quantile),
       calcType_(parseCollateralCalculationType(calculationType)), dvaName_(dvaName),
@@ -155,7 +155,7 @@ PostProcess::PostProcess(
         boost::make_shared<ExposureCalculator>(
             portfolio, cube_, cubeInterpretation_,
             market_, analytics_["exerciseNextBreak"], baseCurrency_, configuration_,
-            quantile_, calcType_, analytics_["dynamicCredit"], analytics_["flipViewXVA"]
+            quantile_, calcType_, analytics_["dynamicCredit"], analytics_["flipViewXVA"], nThreads
         );
     exposureCalculator_->build();
 
@@ -182,7 +182,7 @@ PostProcess::PostProcess(
             dimCalculator_, fullInitialCollateralisation_,
             allocationMethod == ExposureAllocator::AllocationMethod::Marginal, marginalAllocationLimit,
             exposureCalculator_->exposureCube(), ExposureCalculator::allocatedEPE, ExposureCalculator::allocatedENE,
-            analytics_["flipViewXVA"]
+            analytics_["flipViewXVA"], nThreads
         );
     nettedExposureCalculator_->build();
 
@@ -228,14 +228,14 @@ PostProcess::PostProcess(
             nettedExposureCalculator_->exposureCube(), cube_,
             ExposureCalculator::allocatedEPE, ExposureCalculator::allocatedENE,
             ExposureCalculator::EPE, ExposureCalculator::ENE,
-            NettedExposureCalculator::EPE, NettedExposureCalculator::ENE);
+            NettedExposureCalculator::EPE, NettedExposureCalculator::ENE, nThreads);
     else if (allocationMethod == ExposureAllocator::AllocationMethod::RelativeFairValueGross)
         exposureAllocator = boost::make_shared<RelativeFairValueGrossExposureAllocator>(
             portfolio, exposureCalculator_->exposureCube(),
             nettedExposureCalculator_->exposureCube(), cube_,
             ExposureCalculator::allocatedEPE, ExposureCalculator::allocatedENE,
             ExposureCalculator::EPE, ExposureCalculator::ENE,
-            NettedExposureCalculator::EPE, NettedExposureCalculator::ENE);
+            NettedExposureCalculator::EPE, NettedExposureCalculator::ENE, nThreads);
     else if (allocationMethod == ExposureAllocator::AllocationMethod::RelativeXVA)
         exposureAllocator = boost::make_shared<RelativeXvaExposureAllocator>(
             portfolio, exposureCalculator_->exposureCube(),
@@ -244,11 +244,11 @@ PostProcess::PostProcess(
             cvaCalculator_->nettingSetSumCva(), cvaCalculator_->nettingSetSumDva(),
             ExposureCalculator::allocatedEPE, ExposureCalculator::allocatedENE,
             ExposureCalculator::EPE, ExposureCalculator::ENE,
-            NettedExposureCalculator::EPE, NettedExposureCalculator::ENE);
+            NettedExposureCalculator::EPE, NettedExposureCalculator::ENE, nThreads);
     else if (allocationMethod == ExposureAllocator::AllocationMethod::None)
         exposureAllocator = boost::make_shared<NoneExposureAllocator>(
             portfolio, exposureCalculator_->exposureCube(),
-            nettedExposureCalculator_->exposureCube());
+            nettedExposureCalculator_->exposureCube(), nThreads);
     else
         QL_FAIL("allocationMethod " << allocationMethod << " not available");
     if(exposureAllocator)
@@ -153,7 +153,9 @@ public:
         //! Postfix for flipView borrowing curve for fva
         const string& flipViewBorrowingCurvePostfix = "_BORROW", 
         //! Postfix for flipView lending curve for fva
-        const string& flipViewLendingCurvePostfix = "_LEND");
+        const string& flipViewLendingCurvePostfix = "_LEND",
+        //! Number of threads used to process the netting sets in the exposure calculation and allocation
+        Size nThreads = 1);
 
     void setDimCalculator(boost::shared_ptr<DynamicInitialMarginCalculator> dimCalculator) {
         dimCalculator_ = dimCalculator;
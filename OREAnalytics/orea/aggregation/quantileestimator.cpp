@@ -0,0 +1,43 @@
+/*
+ Copyright (C) 2023 Quaternion Risk Management Ltd
+ All rights reserved.
+
+ This file is part of ORE, a free-software/open-source library
+ for transparent pricing and risk analysis - http://opensourcerisk.org
+
+ ORE is free software: you can redistribute it and/or modify it
+ under the terms of the Modified BSD License.  You should have received a
+ copy of the license along with this program.
+ The license is also available online at <http://opensourcerisk.org>
+
+ This program is distributed on the basis that it will form a useful
+ contribution to risk analytics and model standardisation, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ FITNESS FOR A PARTICULAR PURPOSE. See the license for more details.
+*/
+
+#include <orea/aggregation/quantileestimator.hpp>
+#include <ql/errors.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+namespace ore {
+namespace analytics {
+
+QuantileEstimator::QuantileEstimator(const Real quantile, const Size samples)
+    : quantile_(quantile), samples_(samples), index_(0) {
+    QL_REQUIRE(quantile_ >= 0.0 && quantile_ <= 1.0, "QuantileEstimator: quantile (" << quantile_ << ") must be in [0, 1]");
+    QL_REQUIRE(samples_ > 0, "QuantileEstimator: no samples");
+    index_ = Size(std::floor(quantile_ * (samples_ - 1) + 0.5));
+}
+
+Real QuantileEstimator::value(std::vector<Real>& samples) const {
+    QL_REQUIRE(samples.size() == samples_,
+               "QuantileEstimator: " << samples.size() << " samples given, expected " << samples_);
+    std::nth_element(samples.begin(), samples.begin() + index_, samples.end());
+    return samples[index_];
+}
+
+} // namespace analytics
+} // namespace ore
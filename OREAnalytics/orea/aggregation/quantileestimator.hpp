@@ -0,0 +1,65 @@
+/*
+ Copyright (C) 2023 Quaternion Risk Management Ltd
+ All rights reserved.
+
+ This file is part of ORE, a free-software/open-source library
+ for transparent pricing and risk analysis - http://opensourcerisk.org
+
+ ORE is free software: you can redistribute it and/or modify it
+ under the terms of the Modified BSD License.  You should have received a
+ copy of the license along with this program.
+ The license is also available online at <http://opensourcerisk.org>
+
+ This program is distributed on the basis that it will form a useful
+ contribution to risk analytics and model standardisation, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ FITNESS FOR A PARTICULAR PURPOSE. See the license for more details.
+*/
+
+/*! \file orea/aggregation/quantileestimator.hpp
+    \brief Quantile of a sample distribution, used for the PFE
+    \ingroup analytics
+*/
+
+#pragma once
+
+#include <ql/types.hpp>
+
+#include <vector>
+
+namespace ore {
+namespace analytics {
+using namespace QuantLib;
+
+//! Quantile Estimator
+/*!
+  This class computes a quantile of a distribution given by a fixed number of samples,
+  e.g. the Potential Future Exposure of a trade or netting set on a given date.
+
+  The quantile is the sample with index floor(quantile * (samples - 1) + 0.5) in ascending
+  order. It is found by std::nth_element on the caller's samples, which are reordered but
+  not copied or fully sorted.
+
+  \ingroup analytics
+*/
+class QuantileEstimator {
+public:
+    QuantileEstimator(const Real quantile, const Size samples);
+
+    //! Quantile of the distribution given by \p samples, the samples are reordered
+    Real value(std::vector<Real>& samples) const;
+
+    //! Inspectors
+    //@{
+    Real quantile() const { return quantile_; }
+    Size samples() const { return samples_; }
+    //@}
+
+private:
+    Real quantile_;
+    Size samples_;
+    Size index_;
+};
+
+} // namespace analytics
+} // namespace ore
@@ -27,7 +27,9 @@
 #pragma warning(disable : 4503)
 #endif
 
+#include <boost/dll/runtime_symbol_info.hpp>
 #include <boost/filesystem.hpp>
+#include <boost/process.hpp>
 
 #include <orea/orea.hpp>
 #include <ored/ored.hpp>
@@ -40,6 +42,8 @@
 
 #include <orea/app/oreapp.hpp>
 
+#include <fstream>
+
 using namespace std;
 using namespace ore::data;
 using namespace ore::analytics;
@@ -65,7 +69,7 @@ namespace analytics {
 
 OREApp::OREApp(boost::shared_ptr<Parameters> params, ostream& out)
     : tab_(40), progressBarWidth_(72 - std::min<Size>(tab_, 67)), params_(params),
-      asof_(parseDate(params_->get("setup", "asofDate"))), out_(out), cubeDepth_(0) {
+      asof_(parseDate(params_->get("setup", "asofDate"))), out_(out), sampleRangeStart_(0), cubeDepth_(0) {
 
     // Set global evaluation date
     Settings::instance().evaluationDate() = asof_;
@@ -162,6 +166,12 @@ int OREApp::run() {
             // We reset this here because the date grid building in sensitivity analysis depends on it.
             Settings::instance().evaluationDate() = asof_;
             sensitivityRunner_ = getSensitivityRunner();
+            sensitivityRunner_->setMarketBuilder([this]() -> boost::shared_ptr<Market> {
+                QL_REQUIRE(loader_, "OREApp: no market data loader available to build a sensitivity worker market");
+                return boost::make_shared<TodaysMarket>(asof_, marketParameters_, loader_, curveConfigs_,
+                                                        continueOnError_, true, lazyMarketBuilding_, referenceData_,
+                                                        false, iborFallbackConfig_);
+            });
             sensitivityRunner_->runSensitivityAnalysis(market_, curveConfigs_, marketParameters_);
             out_ << "OK" << endl;
         } else {
@@ -435,6 +445,47 @@ void OREApp::readSetup() {
     if (params_->has("setup", "buildFailedTrades"))
         buildFailedTrades_ = parseBool(params_->get("setup", "buildFailedTrades"));
 
+    marketBuildThreads_ = 1;
+    if (params_->has("setup", "marketBuildThreads")) {
+        Integer n = parseInteger(params_->get("setup", "marketBuildThreads"));
+        QL_REQUIRE(n > 0, "setup/marketBuildThreads (" << n << ") must be positive");
+        marketBuildThreads_ = n;
+    }
+
+    marketDataThreads_ = 1;
+    if (params_->has("setup", "marketDataThreads")) {
+        Integer n = parseInteger(params_->get("setup", "marketDataThreads"));
+        QL_REQUIRE(n > 0, "setup/marketDataThreads (" << n << ") must be positive");
+        marketDataThreads_ = n;
+    }
+
+    nThreads_ = 1;
+    if (params_->has("simulation", "nThreads")) {
+        Integer nThreads = parseInteger(params_->get("simulation", "nThreads"));
+        QL_REQUIRE(nThreads > 0, "simulation/nThreads (" << nThreads << ") must be positive");
+        nThreads_ = nThreads;
+    }
+
+    nProcesses_ = 1;
+    if (params_->has("simulation", "nProcesses")) {
+        Integer nProcesses = parseInteger(params_->get("simulation", "nProcesses"));
+        QL_REQUIRE(nProcesses > 0, "simulation/nProcesses (" << nProcesses << ") must be positive");
+        nProcesses_ = nProcesses;
+    }
+
+    cubeLayout_ = boost::none;
+    if (params_->has("simulation", "cubeLayout") && params_->get("simulation", "cubeLayout") != "")
+        cubeLayout_ = parseNPVCubeLayout(params_->get("simulation", "cubeLayout"));
+
+    memoryMappedCube_ = false;
+    if (params_->has("simulation", "memoryMappedCube"))
+        memoryMappedCube_ = parseBool(params_->get("simulation", "memoryMappedCube"));
+    QL_REQUIRE(!(memoryMappedCube_ && cubeLayout_),
+               "simulation/memoryMappedCube and simulation/cubeLayout can not be combined");
+
+    linearBookCalculator_ = false;
+    if (params_->has("simulation", "linearBookCalculator"))
+        linearBookCalculator_ = parseBool(params_->get("simulation", "linearBookCalculator"));
 }
 
 void OREApp::setupLog() {
@@ -456,9 +507,38 @@ void OREApp::setupLog() {
     Log::instance().registerLogger(boost::make_shared<FileLogger>(logFile));
     Log::instance().setMask(logMask);
     Log::instance().switchOn();
+
+    if (params_->has("setup", "structuredMessageRepeatLimit")) {
+        Integer limit = parseInteger(params_->get("setup", "structuredMessageRepeatLimit"));
+        QL_REQUIRE(limit >= 0, "setup/structuredMessageRepeatLimit (" << limit << ") must be non-negative");
+        Log::instance().setStructuredMessageRepeatLimit(limit);
+    }
+
+    if (params_->has("setup", "asyncLogging") && parseBool(params_->get("setup", "asyncLogging"))) {
+        Size queueSize = 4096;
+        if (params_->has("setup", "asyncLogQueueSize")) {
+            Integer n = parseInteger(params_->get("setup", "asyncLogQueueSize"));
+            QL_REQUIRE(n > 0, "setup/asyncLogQueueSize (" << n << ") must be positive");
+            queueSize = n;
+        }
+        Log::QueueFullPolicy policy = Log::QueueFullPolicy::Block;
+        if (params_->has("setup", "asyncLogQueueFull")) {
+            string policyName = params_->get("setup", "asyncLogQueueFull");
+            if (policyName == "Drop")
+                policy = Log::QueueFullPolicy::Drop;
+            else
+                QL_REQUIRE(policyName == "Block", "setup/asyncLogQueueFull '"
+                                                      << policyName << "' not recognised, expected Block or Drop");
+        }
+        Log::instance().startAsync(queueSize, policy);
+    }
 }
 
-void OREApp::closeLog() { Log::instance().removeAllLoggers(); }
+void OREApp::closeLog() {
+    Log::instance().stopAsync();
+    Log::instance().setStructuredMessageRepeatLimit(0);
+    Log::instance().removeAllLoggers();
+}
 
 void OREApp::getReferenceData() {
     if (params_->has("setup", "referenceDataFile") && params_->get("setup", "referenceDataFile") != "") {
@@ -899,9 +979,20 @@ void OREApp::initAggregationScenarioData() {
     scenarioData_ = boost::make_shared<InMemoryAggregationScenarioData>(grid_->valuationDates().size(), samples_);
 }
 
-void OREApp::initCube(boost::shared_ptr<NPVCube>& cube, const std::vector<std::string>& ids, const Size cubeDepth) {
+void OREApp::initCube(boost::shared_ptr<NPVCube>& cube, const std::vector<std::string>& ids, const Size cubeDepth,
+                      const std::string& cubeFileParam) {
     QL_REQUIRE(cubeDepth > 0, "zero cube depth given");
-    if (cubeDepth == 1)
+    if (memoryMappedCube_) {
+        QL_REQUIRE(params_->has("simulation", cubeFileParam),
+                   "simulation/memoryMappedCube requires the parameter simulation/" << cubeFileParam);
+        string cubeFileName = outputPath_ + "/" + params_->get("simulation", cubeFileParam);
+        cube = boost::make_shared<SinglePrecisionMemoryMappedCube>(cubeFileName, asof_, ids, grid_->valuationDates(),
+                                                                   samples_, cubeDepth, 0.0f);
+        LOG("init memory mapped NPV cube " << cubeFileName);
+    } else if (cubeLayout_)
+        cube = boost::make_shared<SinglePrecisionFlatInMemoryCube>(asof_, ids, grid_->valuationDates(), samples_,
+                                                                   cubeDepth, *cubeLayout_, 0.0f);
+    else if (cubeDepth == 1)
         cube = boost::make_shared<SinglePrecisionInMemoryCube>(asof_, ids, grid_->valuationDates(), samples_, 0.0f);
     else
         cube = boost::make_shared<SinglePrecisionInMemoryCubeN>(asof_, ids, grid_->valuationDates(), samples_,
@@ -910,19 +1001,21 @@ void OREApp::initCube(boost::shared_ptr<NPVCube>& cube, const std::vector<std::s
     LOG("init NPV cube with depth: " << cubeDepth);
 }
 
-void OREApp::buildNPVCube() {
-    LOG("Build valuation cube engine");
-    // Valuation calculators
+std::vector<boost::shared_ptr<ValuationCalculator>> OREApp::buildValuationCalculators() const {
     string baseCurrency = params_->get("simulation", "baseCurrency");
     vector<boost::shared_ptr<ValuationCalculator>> calculators;
 
+    boost::shared_ptr<NPVCalculator> npvCalc;
+    if (linearBookCalculator_)
+        npvCalc = boost::make_shared<LinearBookNPVCalculator>(baseCurrency);
+    else
+        npvCalc = boost::make_shared<NPVCalculator>(baseCurrency);
+
     if (useCloseOutLag_) {
-        boost::shared_ptr<NPVCalculator> npvCalc = boost::make_shared<NPVCalculator>(baseCurrency);
-        // calculators.push_back(boost::make_shared<NPVCalculator>(baseCurrency));
         // default date value stored at index 0, close-out value at index 1
         calculators.push_back(boost::make_shared<MPORCalculator>(npvCalc, 0, 1));
     } else {
-        calculators.push_back(boost::make_shared<NPVCalculator>(baseCurrency));
+        calculators.push_back(npvCalc);
     }
 
     if (storeFlows_) {
@@ -930,6 +1023,51 @@ void OREApp::buildNPVCube() {
         calculators.push_back(boost::make_shared<CashflowCalculator>(baseCurrency, asof_, grid_, cubeDepth_ - 1));
     }
 
+    return calculators;
+}
+
+std::vector<boost::shared_ptr<CounterpartyCalculator>> OREApp::buildCounterpartyCalculators() const {
+    vector<boost::shared_ptr<CounterpartyCalculator>> cptyCalculators;
+
+    if (storeSp_) {
+        const string configuration = params_->get("markets", "simulation");
+        cptyCalculators.push_back(boost::make_shared<SurvivalProbabilityCalculator>(configuration));
+    }
+
+    return cptyCalculators;
+}
+
+MultiThreadedValuationEngine::WorkerContext OREApp::buildValuationWorkerContext() {
+    QL_REQUIRE(loader_, "OREApp::buildValuationWorkerContext(): no market data loader available");
+    MultiThreadedValuationEngine::WorkerContext context;
+
+    auto market = boost::make_shared<TodaysMarket>(asof_, marketParameters_, loader_, curveConfigs_,
+                                                   continueOnError_, true, lazyMarketBuilding_, referenceData_, false,
+                                                   iborFallbackConfig_);
+    context.simMarket = boost::make_shared<ScenarioSimMarket>(
+        market, simMarketData_, boost::make_shared<FixingManager>(asof_), params_->get("markets", "simulation"),
+        *curveConfigs_, *marketParameters_, continueOnError_, false, true, false, iborFallbackConfig_, false);
+    boost::shared_ptr<EngineFactory> simFactory = buildEngineFactory(context.simMarket, "simulation");
+
+    auto continueOnCalErr = simFactory->engineData()->globalParameters().find("ContinueOnCalibrationError");
+    context.simMarket->scenarioGenerator() =
+        buildScenarioGenerator(market, simMarketData_, scenarioGeneratorData_,
+                               continueOnCalErr != simFactory->engineData()->globalParameters().end() &&
+                                   parseBool(continueOnCalErr->second));
+    skipScenarioPaths(context.simMarket->scenarioGenerator(), grid_->dates(), sampleRangeStart_);
+
+    context.portfolio = loadPortfolio();
+    context.portfolio->build(simFactory, "oreapp/sim");
+    context.calculators = buildValuationCalculators();
+    context.cptyCalculators = buildCounterpartyCalculators();
+    return context;
+}
+
+void OREApp::buildNPVCube() {
+    LOG("Build valuation cube engine");
+    // Valuation calculators
+    vector<boost::shared_ptr<ValuationCalculator>> calculators = buildValuationCalculators();
+
     bool flipViewXVA = false;
     if (params_->has("xva", "flipViewXVA")) {
         flipViewXVA = parseBool(params_->get("xva", "flipViewXVA"));
@@ -940,15 +1078,8 @@ void OREApp::buildNPVCube() {
     else
         cubeInterpreter_ = boost::make_shared<RegularCubeInterpretation>(flipViewXVA);
 
-    vector<boost::shared_ptr<CounterpartyCalculator>> cptyCalculators;
-
-    if (storeSp_) {
-        const string configuration = params_->get("markets", "simulation");
-        cptyCalculators.push_back(boost::make_shared<SurvivalProbabilityCalculator>(configuration));
-    }
+    vector<boost::shared_ptr<CounterpartyCalculator>> cptyCalculators = buildCounterpartyCalculators();
 
-    LOG("Build cube");
-    ValuationEngine engine(asof_, grid_, simMarket_);
     ostringstream o;
     o.str("");
     o << "Build Cube " << simPortfolio_->size() << " x " << grid_->valuationDates().size() << " x " << samples_
@@ -956,14 +1087,151 @@ void OREApp::buildNPVCube() {
 
     auto progressBar = boost::make_shared<SimpleProgressBar>(o.str(), tab_, progressBarWidth_);
     auto progressLog = boost::make_shared<ProgressLog>("Building cube...");
-    engine.registerProgressIndicator(progressBar);
-    engine.registerProgressIndicator(progressLog);
 
-    engine.buildCube(simPortfolio_, cube_, calculators, useMporStickyDate_, nettingSetCube_, cptyCube_, cptyCalculators);
+    if (nProcesses_ > 1) {
+        buildNPVCubeInWorkerProcesses();
+        progressBar->updateProgress(samples_, samples_);
+    } else if (nThreads_ > 1) {
+        LOG("Build cube using " << nThreads_ << " threads");
+        QL_REQUIRE(!params_->has("simulation", "scenariodump"),
+                   "simulation/scenariodump is not supported with nThreads > 1");
+        MultiThreadedValuationEngine engine(nThreads_, asof_, grid_,
+                                            [this]() { return buildValuationWorkerContext(); });
+        engine.registerProgressIndicator(progressBar);
+        engine.registerProgressIndicator(progressLog);
+        engine.buildCube(cube_, useMporStickyDate_, nettingSetCube_, cptyCube_, scenarioData_);
+        erroneousTrades_ = engine.erroneousTrades();
+    } else {
+        LOG("Build cube");
+        ValuationEngine engine(asof_, grid_, simMarket_);
+        engine.registerProgressIndicator(progressBar);
+        engine.registerProgressIndicator(progressLog);
+        engine.buildCube(simPortfolio_, cube_, calculators, useMporStickyDate_, nettingSetCube_, cptyCube_,
+                         cptyCalculators);
+        erroneousTrades_ = engine.erroneousTrades();
+    }
 
     out_ << "OK" << endl;
 }
 
+void OREApp::buildNPVCubeInWorkerProcesses() {
+    LOG("Build cube using " << nProcesses_ << " worker processes");
+    QL_REQUIRE(!params_->has("simulation", "scenariodump"),
+               "simulation/scenariodump is not supported with nProcesses > 1");
+    QL_REQUIRE(!nettingSetCube_, "a netting set cube is not supported with nProcesses > 1");
+
+    string executable = params_->has("simulation", "workerExecutable")
+                            ? params_->get("simulation", "workerExecutable")
+                            : boost::dll::program_location().string();
+
+    // split the samples into contiguous ranges, the first (samples % nProcesses) ranges get one extra sample
+
+    Size nProcesses = std::min(nProcesses_, samples_);
+    vector<Size> sampleStart(nProcesses + 1, 0);
+    for (Size w = 0; w < nProcesses; ++w)
+        sampleStart[w + 1] = sampleStart[w] + samples_ / nProcesses + (w < samples_ % nProcesses ? 1 : 0);
+
+    /* each worker runs the simulation only, for its sample range and in its own output directory, the initial reports
+       and all other analytics are produced by the main process */
+
+    vector<string> workerPaths(nProcesses);
+    vector<boost::process::child> workers;
+    for (Size w = 0; w < nProcesses; ++w) {
+        workerPaths[w] = outputPath_ + "/worker_" + std::to_string(w);
+        boost::filesystem::create_directories(workerPaths[w]);
+        Parameters workerParams = *params_;
+        workerParams.set("setup", "outputPath", workerPaths[w]);
+        workerParams.set("simulation", "nProcesses", "1");
+        workerParams.set("simulation", "sampleRangeStart", std::to_string(sampleStart[w]));
+        workerParams.set("simulation", "sampleRangeEnd", std::to_string(sampleStart[w + 1]));
+        workerParams.set("simulation", "cubeFile", "cube.dat");
+        workerParams.set("simulation", "cptyCubeFile", "cptyCube.dat");
+        workerParams.set("simulation", "aggregationScenarioDataFileName", "scenariodata.dat");
+        workerParams.set("simulation", "erroneousTradesFile", "erroneousTrades.txt");
+        for (auto const& g : {"curves", "npv", "additionalResults", "todaysMarketCalibration", "cashflow",
+                              "cashflowNpv", "xva", "sensitivity", "stress", "parametricVar", "baseScenario"}) {
+            if (workerParams.hasGroup(g))
+                workerParams.set(g, "active", "N");
+        }
+        string workerParamsFile = workerPaths[w] + "/ore.xml";
+        workerParams.toFile(workerParamsFile);
+        LOG("Start worker " << w << " for samples [" << sampleStart[w] << ", " << sampleStart[w + 1] << "): "
+                            << executable << " " << workerParamsFile);
+        workers.emplace_back(executable, workerParamsFile,
+                             boost::process::std_out > (workerPaths[w] + "/ore.out"));
+    }
+
+    std::ostringstream failed;
+    for (Size w = 0; w < nProcesses; ++w) {
+        workers[w].wait();
+        if (workers[w].exit_code() != 0) {
+            ALOG("Worker " << w << " failed with exit code " << workers[w].exit_code() << ", see " << workerPaths[w]);
+            failed << " " << w;
+        }
+    }
+    QL_REQUIRE(failed.str().empty(), "worker processes failed:" << failed.str());
+
+    // merge the partial results
+
+    LOG("Merge results of " << nProcesses << " worker processes");
+    auto loadPartialCube = [this](const string& fileName, Size depth) {
+        if (memoryMappedCube_)
+            return openMemoryMappedCube(fileName);
+        boost::shared_ptr<NPVCube> cube;
+        if (cubeLayout_)
+            cube = boost::make_shared<SinglePrecisionFlatInMemoryCube>();
+        else if (depth == 1)
+            cube = boost::make_shared<SinglePrecisionInMemoryCube>();
+        else
+            cube = boost::make_shared<SinglePrecisionInMemoryCubeN>();
+        cube->load(fileName);
+        return cube;
+    };
+
+    vector<boost::shared_ptr<NPVCube>> cubes, cptyCubes;
+    vector<boost::shared_ptr<AggregationScenarioData>> scenarioData;
+    for (Size w = 0; w < nProcesses; ++w) {
+        cubes.push_back(loadPartialCube(workerPaths[w] + "/cube.dat", cube_->depth()));
+        if (cptyCube_)
+            cptyCubes.push_back(loadPartialCube(workerPaths[w] + "/cptyCube.dat", cptyCube_->depth()));
+        auto asd = boost::make_shared<InMemoryAggregationScenarioData>();
+        asd->load(workerPaths[w] + "/scenariodata.dat");
+        scenarioData.push_back(asd);
+    }
+    mergeCubes(cubes, cube_);
+    if (cptyCube_)
+        mergeCubes(cptyCubes, cptyCube_);
+    mergeAggregationScenarioData(scenarioData, scenarioData_);
+
+    // a trade with an error in any worker is set to zero on all samples, as in the single process run
+
+    erroneousTrades_.clear();
+    for (Size w = 0; w < nProcesses; ++w) {
+        std::ifstream file(workerPaths[w] + "/erroneousTrades.txt");
+        QL_REQUIRE(file.is_open(), "could not open " << workerPaths[w] << "/erroneousTrades.txt");
+        string tradeId;
+        while (std::getline(file, tradeId)) {
+            if (!tradeId.empty())
+                erroneousTrades_.insert(tradeId);
+        }
+    }
+    for (auto const& tradeId : erroneousTrades_) {
+        auto it = std::find(cube_->ids().begin(), cube_->ids().end(), tradeId);
+        QL_REQUIRE(it != cube_->ids().end(), "unknown trade id " << tradeId << " reported by worker process");
+        Size i = std::distance(cube_->ids().begin(), it);
+        ALOG("setting all results in output cube to zero for trade '"
+             << tradeId << "' since there was at least one error during simulation");
+        for (Size index = 0; index < cube_->depth(); ++index) {
+            cube_->setT0(0.0, i, index);
+            for (Size dateIndex = 0; dateIndex < cube_->numDates(); ++dateIndex) {
+                for (Size sample = 0; sample < cube_->samples(); ++sample) {
+                    cube_->set(0.0, i, dateIndex, sample, index);
+                }
+            }
+        }
+    }
+}
+
 void OREApp::setCubeDepth(const boost::shared_ptr<ScenarioGeneratorData>& sgd) {
     cubeDepth_ = 1;
     if (sgd->withCloseOutLag())
@@ -980,6 +1248,21 @@ void OREApp::initialiseNPVCubeGeneration(boost::shared_ptr<Portfolio> portfolio)
     boost::shared_ptr<ScenarioGeneratorData> sgd = getScenarioGeneratorData();
     grid_ = sgd->getGrid();
     samples_ = sgd->samples();
+    simMarketData_ = simMarketData;
+    scenarioGeneratorData_ = sgd;
+
+    // restrict the simulation to a sample range, this is used by the worker processes of a multi-process run
+    sampleRangeStart_ = 0;
+    if (params_->has("simulation", "sampleRangeStart") || params_->has("simulation", "sampleRangeEnd")) {
+        Integer start = parseInteger(params_->get("simulation", "sampleRangeStart"));
+        Integer end = parseInteger(params_->get("simulation", "sampleRangeEnd"));
+        QL_REQUIRE(start >= 0 && start < end && static_cast<Size>(end) <= samples_,
+                   "invalid sample range [" << start << ", " << end << "), expected 0 <= start < end <= "
+                                            << samples_);
+        sampleRangeStart_ = start;
+        samples_ = end - start;
+        LOG("Restrict simulation to sample range [" << start << ", " << end << ")");
+    }
 
     if (buildSimMarket_) {
         LOG("Build Simulation Market");
@@ -995,6 +1278,7 @@ void OREApp::initialiseNPVCubeGeneration(boost::shared_ptr<Portfolio> portfolio)
             buildScenarioGenerator(market_, simMarketData, sgd,
                                    continueOnCalErr != simFactory->engineData()->globalParameters().end() &&
                                        parseBool(continueOnCalErr->second));
+        skipScenarioPaths(sg, grid_->dates(), sampleRangeStart_);
         simMarket_->scenarioGenerator() = sg;
 
         LOG("Build portfolio linked to sim market");
@@ -1023,7 +1307,7 @@ void OREApp::initialiseNPVCubeGeneration(boost::shared_ptr<Portfolio> portfolio)
         storeSp_ = true;
         auto counterparties = simPortfolio_->counterparties();
         counterparties.push_back(params_->get("xva", "dvaName"));
-        initCube(cptyCube_, counterparties, 1);
+        initCube(cptyCube_, counterparties, 1, "cptyCubeFile");
     } else {
         cptyCube_ = nullptr;
     }
@@ -1051,6 +1335,7 @@ void OREApp::generateNPVCube() {
     if (cptyCube_)
         writeCube(cptyCube_, "cptyCubeFile");
     writeScenarioData();
+    writeErroneousTrades();
 
     LOG("NPV cube generation completed");
     MEM_LOG;
@@ -1094,6 +1379,18 @@ void OREApp::writeScenarioData() {
         out_ << "SKIP" << endl;
 }
 
+void OREApp::writeErroneousTrades() {
+    // used by the worker processes of a multi-process run to report their erroneous trades to the main process
+    if (!params_->has("simulation", "erroneousTradesFile"))
+        return;
+    string fileName = outputPath_ + "/" + params_->get("simulation", "erroneousTradesFile");
+    std::ofstream file(fileName);
+    QL_REQUIRE(file.is_open(), "could not open " << fileName);
+    for (auto const& tradeId : erroneousTrades_)
+        file << tradeId << "\n";
+    LOG("Write " << erroneousTrades_.size() << " erroneous trade ids to '" << fileName << "'");
+}
+
 void OREApp::loadScenarioData() {
     string scenarioFile = outputPath_ + "/" + params_->get("xva", "scenarioFile");
     scenarioData_ = boost::make_shared<InMemoryAggregationScenarioData>();
@@ -1108,13 +1405,28 @@ void OREApp::loadCube() {
     bool hyperCube = false;
     if (params_->has("xva", "hyperCube"))
         hyperCube = parseBool(params_->get("xva", "hyperCube"));
+    bool flatCube = false;
+    if (params_->has("xva", "flatCube"))
+        flatCube = parseBool(params_->get("xva", "flatCube"));
+    bool memoryMappedCube = false;
+    if (params_->has("xva", "memoryMappedCube"))
+        memoryMappedCube = parseBool(params_->get("xva", "memoryMappedCube"));
+    auto loadCubeFile = [flatCube, memoryMappedCube](const string& fileName, bool hyper) {
+        if (memoryMappedCube)
+            return openMemoryMappedCube(fileName);
+        boost::shared_ptr<NPVCube> cube;
+        if (flatCube)
+            cube = boost::make_shared<SinglePrecisionFlatInMemoryCube>();
+        else if (hyper)
+            cube = boost::make_shared<SinglePrecisionInMemoryCubeN>();
+        else
+            cube = boost::make_shared<SinglePrecisionInMemoryCube>();
+        cube->load(fileName);
+        return cube;
+    };
 
-    if (hyperCube)
-        cube_ = boost::make_shared<SinglePrecisionInMemoryCubeN>();
-    else
-        cube_ = boost::make_shared<SinglePrecisionInMemoryCube>();
     LOG("Load cube from file " << cubeFile);
-    cube_->load(cubeFile);
+    cube_ = loadCubeFile(cubeFile, hyperCube);
     cubeDepth_ = cube_->depth();
     LOG("Cube loading done: ids=" << cube_->numIds() << " dates=" << cube_->numDates()
                                   << " samples=" << cube_->samples() << " depth=" << cube_->depth());
@@ -1127,12 +1439,8 @@ void OREApp::loadCube() {
         if (params_->has("xva", "hyperNettingSetCube"))
             hyperCube2 = parseBool(params_->get("xva", "hyperNettingSetCube"));
 
-        if (hyperCube2)
-            nettingSetCube_ = boost::make_shared<SinglePrecisionInMemoryCubeN>();
-        else
-            nettingSetCube_ = boost::make_shared<SinglePrecisionInMemoryCube>();
         LOG("Load netting set cube from file " << cubeFile2);
-        nettingSetCube_->load(cubeFile2);
+        nettingSetCube_ = loadCubeFile(cubeFile2, hyperCube2);
         LOG("Cube loading done: ids=" << nettingSetCube_->numIds() << " dates=" << nettingSetCube_->numDates()
                                       << " samples=" << nettingSetCube_->samples()
                                       << " depth=" << nettingSetCube_->depth());
@@ -1142,9 +1450,8 @@ void OREApp::loadCube() {
 
     if (params_->has("xva", "cptyCubeFile") && params_->get("xva", "cptyCubeFile") != "") {
         string cubeFile3 = outputPath_ + "/" + params_->get("xva", "cptyCubeFile");
-        cptyCube_ = boost::make_shared<SinglePrecisionInMemoryCube>();
         LOG("Load counterparty cube from file " << cubeFile3);
-        cptyCube_->load(cubeFile3);
+        cptyCube_ = loadCubeFile(cubeFile3, false);
         LOG("Cube loading done: ids=" << cptyCube_->numIds() << " dates=" << cptyCube_->numDates()
                                       << " samples=" << cptyCube_->samples()
                                       << " depth=" << cptyCube_->depth());
@@ -1277,13 +1584,20 @@ void OREApp::runPostProcessor() {
         flipViewLendingCurvePostfix = params_->get("xva", "flipViewLendingCurvePostfix");
     }
 
+    Size nThreads = 1;
+    if (params_->has("xva", "nThreads")) {
+        Integer n = parseInteger(params_->get("xva", "nThreads"));
+        QL_REQUIRE(n > 0, "xva/nThreads (" << n << ") must be positive");
+        nThreads = n;
+    }
+
     postProcess_ = boost::make_shared<PostProcess>(
         portfolio_, netting, market_, marketConfiguration, cube_, scenarioData_, analytics, baseCurrency,
         allocationMethod, marginalAllocationLimit, quantile, calculationType, dvaName, fvaBorrowingCurve,
         fvaLendingCurve, dimCalculator_, cubeInterpreter_, fullInitialCollateralisation, cvaSensiGrid,
         cvaSensiShiftSize, kvaCapitalDiscountRate, kvaAlpha, kvaRegAdjustment, kvaCapitalHurdle, kvaOurPdFloor,
         kvaTheirPdFloor, kvaOurCvaRiskWeight, kvaTheirCvaRiskWeight, cptyCube_, flipViewBorrowingCurvePostfix,
-        flipViewLendingCurvePostfix);
+        flipViewLendingCurvePostfix, nThreads);
 }
 
 void OREApp::writeXVAReports() {
@@ -1410,7 +1724,8 @@ void OREApp::buildMarket(const std::string& todaysMarketXML, const std::string&
                 string dividendFileString = params_->get("setup", "dividendDataFile");
                 dividendFiles = getFilenames(dividendFileString, inputPath_);
             }
-            loader = boost::make_shared<CSVLoader>(marketFiles, fixingFiles, dividendFiles, implyTodaysFixings);
+            loader = boost::make_shared<CSVLoader>(marketFiles, fixingFiles, dividendFiles, implyTodaysFixings,
+                                                   marketDataThreads_);
             out_ << "OK" << endl;
         } else {
             WLOG("No market data loaded from file");
@@ -1431,11 +1746,14 @@ void OREApp::buildMarket(const std::string& todaysMarketXML, const std::string&
         jointLoader = loader;
     }
 
+    // keep the loader, so that further markets can be built (e.g. in multi-threaded cube generation)
+    loader_ = jointLoader;
+
     // build market
     out_ << setw(tab_) << left << "Market... " << flush;
     market_ = boost::make_shared<TodaysMarket>(asof_, marketParameters_, jointLoader, curveConfigs_,
                                                continueOnError_, true, lazyMarketBuilding_, referenceData_, false,
-                                               iborFallbackConfig_);
+                                               iborFallbackConfig_, true, true, marketBuildThreads_);
     out_ << "OK" << endl;
 
     LOG("Today's market built");
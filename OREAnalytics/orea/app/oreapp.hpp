@@ -33,6 +33,9 @@
 #include <orea/app/sensitivityrunner.hpp>
 #include <orea/app/xvarunner.hpp>
 #include <orea/cube/cubeinterpretation.hpp>
+#include <orea/cube/flatinmemorycube.hpp>
+#include <orea/cube/memorymappedcube.hpp>
+#include <orea/engine/multithreadedvaluationengine.hpp>
 #include <orea/engine/parametricvar.hpp>
 #include <orea/scenario/scenariogenerator.hpp>
 #include <orea/scenario/scenariogeneratorbuilder.hpp>
@@ -108,11 +111,20 @@ protected:
     //! get an instance of an aggregationScenarioData class
     virtual void initAggregationScenarioData();
     //! get an instance of a cube class
-    virtual void initCube(boost::shared_ptr<NPVCube>& cube, const std::vector<std::string>& ids, const Size cubeDepth);
+    virtual void initCube(boost::shared_ptr<NPVCube>& cube, const std::vector<std::string>& ids, const Size cubeDepth,
+                          const std::string& cubeFileParam = "cubeFile");
     //! set depth of NPV cube in cubeDepth_
     virtual void setCubeDepth(const boost::shared_ptr<ScenarioGeneratorData>& sgd);
+    //! build the valuation calculators used in NPV cube generation
+    virtual std::vector<boost::shared_ptr<ValuationCalculator>> buildValuationCalculators() const;
+    //! build the counterparty calculators used in NPV cube generation
+    virtual std::vector<boost::shared_ptr<CounterpartyCalculator>> buildCounterpartyCalculators() const;
+    //! build market, sim market, scenario generator and portfolio for a worker of the multi-threaded cube generation
+    virtual MultiThreadedValuationEngine::WorkerContext buildValuationWorkerContext();
     //! build an NPV cube
     virtual void buildNPVCube();
+    //! build an NPV cube by running the simulation for sample ranges in separate processes and merging the results
+    virtual void buildNPVCubeInWorkerProcesses();
     //! initialise NPV cube generation
     virtual void initialiseNPVCubeGeneration(boost::shared_ptr<Portfolio> portfolio);
     //! load simMarketData
@@ -155,6 +167,8 @@ protected:
     void writeCube(boost::shared_ptr<NPVCube> cube, const std::string& cubeFileParam);
     //! write out scenarioData
     void writeScenarioData();
+    //! write out the ids of the trades with errors during the cube generation
+    void writeErroneousTrades();
     //! write out base scenario
     void writeBaseScenario();
     //! load in nettingSet data
@@ -230,7 +244,14 @@ protected:
     std::string inputPath_;
     std::string outputPath_;
     bool buildFailedTrades_;
+    Size nThreads_, nProcesses_;
+    Size marketBuildThreads_;
+    Size marketDataThreads_;
+    boost::optional<NPVCubeLayout> cubeLayout_; // if set, cubes are FlatInMemoryCubes with this layout
+    bool memoryMappedCube_; // if true, cubes are MemoryMappedCubes written directly to the cube files
+    bool linearBookCalculator_; // if true, linear trades are priced from compiled cashflow tables in the simulation
 
+    boost::shared_ptr<Loader> loader_;               // market data and fixings loader
     boost::shared_ptr<Market> market_;               // T0 market
     boost::shared_ptr<EngineFactory> engineFactory_; // engine factory linked to T0 market
     boost::shared_ptr<Portfolio> portfolio_;         // portfolio linked to T0 market
@@ -240,10 +261,13 @@ protected:
     IborFallbackConfig iborFallbackConfig_;
 
     boost::shared_ptr<ScenarioSimMarket> simMarket_; // sim market
+    boost::shared_ptr<ScenarioSimMarketParameters> simMarketData_;
+    boost::shared_ptr<ScenarioGeneratorData> scenarioGeneratorData_;
     boost::shared_ptr<Portfolio> simPortfolio_;      // portfolio linked to sim market
 
     boost::shared_ptr<DateGrid> grid_;
     Size samples_;
+    Size sampleRangeStart_; // first sample of grid_ covered by this run, non-zero in worker processes only
 
     Size cubeDepth_; // depth of cube_ defined below
     bool storeFlows_, useCloseOutLag_, useMporStickyDate_, storeSp_;
@@ -251,6 +275,7 @@ protected:
     boost::shared_ptr<NPVCube> cube_;           // cube to store results on trade level (e.g. NPVs, flows)
     boost::shared_ptr<NPVCube> nettingSetCube_; // cube to store results on netting set level
     boost::shared_ptr<NPVCube> cptyCube_; // cube to store results at counterparty level (e.g. survival probability)
+    std::set<std::string> erroneousTrades_; // trades with errors during the cube generation, set to zero in cube_
     boost::shared_ptr<AggregationScenarioData> scenarioData_;
     boost::shared_ptr<PostProcess> postProcess_;
     boost::shared_ptr<CubeInterpretation> cubeInterpreter_;
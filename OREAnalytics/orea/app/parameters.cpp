@@ -44,6 +44,10 @@ string Parameters::get(const string& groupName, const string& paramName) const {
     return it->second.find(paramName)->second;
 }
 
+void Parameters::set(const string& groupName, const string& paramName, const string& value) {
+    data_[groupName][paramName] = value;
+}
+
 void Parameters::fromFile(const string& fileName) {
     LOG("load ORE configuration from " << fileName);
     clear();
@@ -96,7 +100,30 @@ void Parameters::fromXML(XMLNode* node) {
 
 XMLNode* Parameters::toXML(XMLDocument& doc) {
     XMLNode* node = doc.allocNode("ORE");
-    QL_FAIL("Parameters::toXML not implemented yet");
+
+    auto addParameters = [&doc](XMLNode* parent, const map<string, string>& parameters) {
+        for (auto const& p : parameters)
+            XMLUtils::addChild(doc, parent, "Parameter", p.second, "name", p.first);
+    };
+
+    XMLNode* setupNode = XMLUtils::addChild(doc, node, "Setup");
+    if (hasGroup("setup"))
+        addParameters(setupNode, data_.at("setup"));
+
+    if (hasGroup("markets")) {
+        XMLNode* marketsNode = XMLUtils::addChild(doc, node, "Markets");
+        addParameters(marketsNode, data_.at("markets"));
+    }
+
+    XMLNode* analyticsNode = XMLUtils::addChild(doc, node, "Analytics");
+    for (auto const& g : data_) {
+        if (g.first == "setup" || g.first == "markets")
+            continue;
+        XMLNode* analyticNode = XMLUtils::addChild(doc, analyticsNode, "Analytic");
+        XMLUtils::addAttribute(doc, analyticNode, "type", g.first);
+        addParameters(analyticNode, g.second);
+    }
+
     return node;
 }
 
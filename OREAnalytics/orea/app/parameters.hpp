@@ -49,6 +49,8 @@ public:
     bool hasGroup(const string& groupName) const;
     bool has(const string& groupName, const string& paramName) const;
     string get(const string& groupName, const string& paramName) const;
+    //! Set a parameter, the group is created if it does not exist yet
+    void set(const string& groupName, const string& paramName, const string& value);
 
     void log();
 
@@ -989,29 +989,37 @@ void ReportWriter::writeScenarioReport(ore::data::Report& report,
     auto tradeIds = sensitivityCube->tradeIds();
     auto npvCube = sensitivityCube->npvCube();
 
+    auto writeRow = [&report, &scenarioDescriptions, outputThreshold](const string& tradeId, Size j, Real baseNpv,
+                                                                       Real scenarioNpv) {
+        auto const& scenarioDescription = scenarioDescriptions[j];
+        Real difference = scenarioNpv - baseNpv;
+        if (fabs(difference) > outputThreshold) {
+            report.next();
+            report.add(tradeId);
+            report.add(prettyPrintInternalCurveName(scenarioDescription.factors()));
+            report.add(scenarioDescription.typeString());
+            report.add(baseNpv);
+            report.add(scenarioNpv);
+            report.add(difference);
+        } else if (!std::isfinite(difference)) {
+            // TODO: is this needed?
+            ALOG("sensitivity scenario for trade " << tradeId << ", factor " << scenarioDescription.factors()
+                                                   << " is not finite (" << difference << ")");
+        }
+    };
+
     for (Size i = 0; i < tradeIds.size(); i++) {
         Real baseNpv = npvCube->getT0(i);
         auto tradeId = tradeIds[i];
 
-        for (Size j = 0; j < scenarioDescriptions.size(); j++) {
-            auto scenarioDescription = scenarioDescriptions[j];
-
-            Real scenarioNpv = npvCube->get(i, j);
-            Real difference = scenarioNpv - baseNpv;
-
-            if (fabs(difference) > outputThreshold) {
-                report.next();
-                report.add(tradeId);
-                report.add(prettyPrintInternalCurveName(scenarioDescription.factors()));
-                report.add(scenarioDescription.typeString());
-                report.add(baseNpv);
-                report.add(scenarioNpv);
-                report.add(difference);
-            } else if (!std::isfinite(difference)) {
-                // TODO: is this needed?
-                ALOG("sensitivity scenario for trade " << tradeId << ", factor " << scenarioDescription.factors()
-                                                       << " is not finite (" << difference << ")");
-            }
+        if (outputThreshold >= 0.0) {
+            // only scenarios that move the npv can pass the threshold, visit the stored entries only
+            npvCube->forEachTradeNPV(i, [&](Size j, Real scenarioNpv) {
+                writeRow(tradeId, j, baseNpv, scenarioNpv);
+            });
+        } else {
+            for (Size j = 0; j < scenarioDescriptions.size(); j++)
+                writeRow(tradeId, j, baseNpv, npvCube->get(i, j));
         }
     }
 
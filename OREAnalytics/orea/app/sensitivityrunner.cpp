@@ -69,6 +69,21 @@ void SensitivityRunner::runSensitivityAnalysis(boost::shared_ptr<Market> market,
         sensiPortfolio, market, marketConfiguration, engineData, simMarketData, sensiData_, recalibrateModels,
         curveConfigs, todaysMarketParams, false, extraEngineBuilders_, extraLegBuilders_, referenceData_,
         iborFallbackConfig_, continueOnError_, analyticFxSensis);
+
+    if (params_->has("sensitivity", "nThreads")) {
+        Integer nThreads = parseInteger(params_->get("sensitivity", "nThreads"));
+        QL_REQUIRE(nThreads > 0, "sensitivity/nThreads (" << nThreads << ") must be positive");
+        if (nThreads > 1) {
+            QL_REQUIRE(marketBuilder_, "sensitivity/nThreads > 1 requires a market builder");
+            LOG("Run sensitivity analysis on " << nThreads << " threads");
+            sensiAnalysis->setParallel(nThreads, marketBuilder_, [this]() {
+                auto portfolio = boost::make_shared<Portfolio>();
+                loadPortfolio(portfolio);
+                return portfolio;
+            });
+        }
+    }
+
     sensiAnalysis->generateSensitivities();
 
     simMarket_ = sensiAnalysis->simMarket();
@@ -100,14 +115,19 @@ void SensitivityRunner::sensiInputInitialize(boost::shared_ptr<ScenarioSimMarket
     engineData->fromFile(sensiPricingEnginesFile);
 
     LOG("Get Portfolio");
+    // Just load here. We build the portfolio in SensitivityAnalysis, after building SimMarket.
+    loadPortfolio(sensiPortfolio);
+
+    DLOG("sensiInputInitialize done");
+}
+
+void SensitivityRunner::loadPortfolio(const boost::shared_ptr<Portfolio>& portfolio) const {
+    string inputPath = params_->get("setup", "inputPath");
     string portfoliosString = params_->get("setup", "portfolioFile");
     vector<string> portfolioFiles = getFilenames(portfoliosString, inputPath);
-    // Just load here. We build the portfolio in SensitivityAnalysis, after building SimMarket.
     for (auto portfolioFile : portfolioFiles) {
-        sensiPortfolio->load(portfolioFile, tradeFactory_);
+        portfolio->load(portfolioFile, tradeFactory_);
     }
-
-    DLOG("sensiInputInitialize done");
 }
 
 void SensitivityRunner::sensiOutputReports(const boost::shared_ptr<SensitivityAnalysis>& sensiAnalysis) {
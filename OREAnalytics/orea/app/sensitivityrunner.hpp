@@ -77,6 +77,9 @@ public:
     //! Write out some standard sensitivities reports
     virtual void sensiOutputReports(const boost::shared_ptr<SensitivityAnalysis>& sensiAnalysis);
 
+    //! Set the builder for the worker markets, required if sensitivity/nThreads > 1
+    void setMarketBuilder(const SensitivityAnalysis::MarketBuilder& marketBuilder) { marketBuilder_ = marketBuilder; }
+
     //! \name Inspectors
     //@{
     const boost::shared_ptr<ScenarioSimMarket>& simMarket() const { return simMarket_; }
@@ -84,6 +87,9 @@ public:
     //@}
 
 protected:
+    //! Load the portfolio files given in the setup into \p portfolio
+    void loadPortfolio(const boost::shared_ptr<Portfolio>& portfolio) const;
+
     boost::shared_ptr<Parameters> params_;
     boost::shared_ptr<TradeFactory> tradeFactory_;
     std::vector<boost::shared_ptr<ore::data::EngineBuilder>> extraEngineBuilders_;
@@ -97,6 +103,9 @@ protected:
 
     //! Sensitivity configuration data used for the sensitivity run.
     boost::shared_ptr<SensitivityScenarioData> sensiData_;
+
+    //! Builds the worker markets for a parallel sensitivity run.
+    SensitivityAnalysis::MarketBuilder marketBuilder_;
 };
 
 } // namespace analytics
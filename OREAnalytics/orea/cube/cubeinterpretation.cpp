@@ -23,6 +23,27 @@
 namespace ore {
 namespace analytics {
 
+void CubeInterpretation::getGenericValues(const boost::shared_ptr<NPVCube>& cube, Size tradeIdx, Size dateIdx,
+                                          Size depth, std::vector<Real>& values) const {
+    values.resize(cube->samples());
+    for (Size k = 0; k < values.size(); ++k)
+        values[k] = getGenericValue(cube, tradeIdx, dateIdx, k, depth);
+}
+
+void CubeInterpretation::getDefaultNpvs(const boost::shared_ptr<NPVCube>& cube, Size tradeIdx, Size dateIdx,
+                                        std::vector<Real>& values) const {
+    values.resize(cube->samples());
+    for (Size k = 0; k < values.size(); ++k)
+        values[k] = getDefaultNpv(cube, tradeIdx, dateIdx, k);
+}
+
+void CubeInterpretation::getCloseOutNpvs(const boost::shared_ptr<NPVCube>& cube, Size tradeIdx, Size dateIdx,
+                                         std::vector<Real>& values) const {
+    values.resize(cube->samples());
+    for (Size k = 0; k < values.size(); ++k)
+        values[k] = getCloseOutNpv(cube, tradeIdx, dateIdx, k);
+}
+
 Real RegularCubeInterpretation::getGenericValue(const boost::shared_ptr<NPVCube>& cube, Size tradeIdx, Size dateIdx,
                                                 Size sampleIdx, Size depth) const {
     if (flipViewXVA_) {
@@ -43,6 +64,26 @@ Real RegularCubeInterpretation::getCloseOutNpv(const boost::shared_ptr<NPVCube>&
     return getGenericValue(cube, tradeIdx, closeOutDateIdx, sampleIdx, npvIdx_);
 }
 
+void RegularCubeInterpretation::getGenericValues(const boost::shared_ptr<NPVCube>& cube, Size tradeIdx, Size dateIdx,
+                                                 Size depth, std::vector<Real>& values) const {
+    values.resize(cube->samples());
+    cube->getSamples(values.data(), tradeIdx, dateIdx, depth);
+    if (flipViewXVA_) {
+        for (auto& v : values)
+            v = -v;
+    }
+}
+
+void RegularCubeInterpretation::getDefaultNpvs(const boost::shared_ptr<NPVCube>& cube, Size tradeIdx, Size dateIdx,
+                                               std::vector<Real>& values) const {
+    getGenericValues(cube, tradeIdx, dateIdx, npvIdx_, values);
+}
+
+void RegularCubeInterpretation::getCloseOutNpvs(const boost::shared_ptr<NPVCube>& cube, Size tradeIdx, Size dateIdx,
+                                                std::vector<Real>& values) const {
+    getGenericValues(cube, tradeIdx, dateIdx + 1, npvIdx_, values);
+}
+
 Real RegularCubeInterpretation::getMporFlows(const boost::shared_ptr<NPVCube>& cube, Size tradeIdx, Size dateIdx,
                                              Size sampleIdx) const {
     Real aggMporFlowsVal = 0.0;
@@ -97,6 +138,26 @@ Real MporGridCubeInterpretation::getCloseOutNpv(const boost::shared_ptr<NPVCube>
     return getGenericValue(cube, tradeIdx, closeOutDateIdx, sampleIdx, closeOutDateNpvIdx_);
 }
 
+void MporGridCubeInterpretation::getGenericValues(const boost::shared_ptr<NPVCube>& cube, Size tradeIdx, Size dateIdx,
+                                                  Size depth, std::vector<Real>& values) const {
+    values.resize(cube->samples());
+    cube->getSamples(values.data(), tradeIdx, dateIdx, depth);
+    if (flipViewXVA_) {
+        for (auto& v : values)
+            v = -v;
+    }
+}
+
+void MporGridCubeInterpretation::getDefaultNpvs(const boost::shared_ptr<NPVCube>& cube, Size tradeIdx, Size dateIdx,
+                                                std::vector<Real>& values) const {
+    getGenericValues(cube, tradeIdx, dateIdx, defaultDateNpvIdx_, values);
+}
+
+void MporGridCubeInterpretation::getCloseOutNpvs(const boost::shared_ptr<NPVCube>& cube, Size tradeIdx, Size dateIdx,
+                                                 std::vector<Real>& values) const {
+    getGenericValues(cube, tradeIdx, dateIdx, closeOutDateNpvIdx_, values);
+}
+
 Real MporGridCubeInterpretation::getMporFlows(const boost::shared_ptr<NPVCube>& cube, Size tradeIdx, Size dateIdx,
                                               Size sampleIdx) const {
     Real aggMporFlowsVal = 0.0;
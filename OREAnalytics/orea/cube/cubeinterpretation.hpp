@@ -53,6 +53,18 @@ public:
     virtual Real getCloseOutNpv(const boost::shared_ptr<NPVCube>& cube, Size tradeIdx, Size dateIdx,
                                 Size sampleIdx) const = 0;
 
+    //! Retrieve the values of all samples from the Cube, values is resized to the number of samples
+    virtual void getGenericValues(const boost::shared_ptr<NPVCube>& cube, Size tradeIdx, Size dateIdx, Size depth,
+                                  std::vector<Real>& values) const;
+
+    //! Retrieve the default date NPVs of all samples from the Cube, values is resized to the number of samples
+    virtual void getDefaultNpvs(const boost::shared_ptr<NPVCube>& cube, Size tradeIdx, Size dateIdx,
+                                std::vector<Real>& values) const;
+
+    //! Retrieve the close-out date NPVs of all samples from the Cube, values is resized to the number of samples
+    virtual void getCloseOutNpvs(const boost::shared_ptr<NPVCube>& cube, Size tradeIdx, Size dateIdx,
+                                 std::vector<Real>& values) const;
+
     //! Retrieve the aggregate value of Margin Period of Risk cashflows from the Cube
     virtual Real getMporFlows(const boost::shared_ptr<NPVCube>& cube, Size tradeIdx, Size dateIdx,
                               Size sampleIdx) const = 0;
@@ -96,6 +108,15 @@ public:
 
     Real getCloseOutNpv(const boost::shared_ptr<NPVCube>& cube, Size tradeIdx, Size dateIdx, Size sampleIdx) const override;
 
+    void getGenericValues(const boost::shared_ptr<NPVCube>& cube, Size tradeIdx, Size dateIdx, Size depth,
+                          std::vector<Real>& values) const override;
+
+    void getDefaultNpvs(const boost::shared_ptr<NPVCube>& cube, Size tradeIdx, Size dateIdx,
+                        std::vector<Real>& values) const override;
+
+    void getCloseOutNpvs(const boost::shared_ptr<NPVCube>& cube, Size tradeIdx, Size dateIdx,
+                         std::vector<Real>& values) const override;
+
     Real getMporFlows(const boost::shared_ptr<NPVCube>& cube, Size tradeIdx, Size dateIdx, Size sampleIdx) const override;
 
     bool hasMporFlows(const boost::shared_ptr<NPVCube>& cube) const override;
@@ -142,6 +163,15 @@ public:
 
     Real getCloseOutNpv(const boost::shared_ptr<NPVCube>& cube, Size tradeIdx, Size dateIdx, Size sampleIdx) const override;
 
+    void getGenericValues(const boost::shared_ptr<NPVCube>& cube, Size tradeIdx, Size dateIdx, Size depth,
+                          std::vector<Real>& values) const override;
+
+    void getDefaultNpvs(const boost::shared_ptr<NPVCube>& cube, Size tradeIdx, Size dateIdx,
+                        std::vector<Real>& values) const override;
+
+    void getCloseOutNpvs(const boost::shared_ptr<NPVCube>& cube, Size tradeIdx, Size dateIdx,
+                         std::vector<Real>& values) const override;
+
     Real getMporFlows(const boost::shared_ptr<NPVCube>& cube, Size tradeIdx, Size dateIdx, Size sampleIdx) const override;
 
     bool hasMporFlows(const boost::shared_ptr<NPVCube>& cube) const override;
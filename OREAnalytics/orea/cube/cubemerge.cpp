@@ -0,0 +1,122 @@
+/*
+ Copyright (C) 2023 Quaternion Risk Management Ltd
+ All rights reserved.
+
+ This file is part of ORE, a free-software/open-source library
+ for transparent pricing and risk analysis - http://opensourcerisk.org
+
+ ORE is free software: you can redistribute it and/or modify it
+ under the terms of the Modified BSD License.  You should have received a
+ copy of the license along with this program.
+ The license is also available online at <http://opensourcerisk.org>
+
+ This program is distributed on the basis that it will form a useful
+ contribution to risk analytics and model standardisation, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ FITNESS FOR A PARTICULAR PURPOSE. See the license for more details.
+*/
+
+#include <orea/cube/cubemerge.hpp>
+
+#include <ql/errors.hpp>
+
+namespace ore {
+namespace analytics {
+
+void mergeCubes(const std::vector<boost::shared_ptr<NPVCube>>& cubes, const boost::shared_ptr<NPVCube>& result) {
+    QL_REQUIRE(!cubes.empty(), "mergeCubes(): no cubes given");
+    QL_REQUIRE(result, "mergeCubes(): result cube is null");
+
+    Size samples = 0;
+    for (auto const& c : cubes) {
+        QL_REQUIRE(c, "mergeCubes(): cube is null");
+        QL_REQUIRE(c->ids() == result->ids(), "mergeCubes(): cube ids do not match result cube ids");
+        QL_REQUIRE(c->dates() == result->dates(), "mergeCubes(): cube dates do not match result cube dates");
+        QL_REQUIRE(c->depth() == result->depth(), "mergeCubes(): cube depth (" << c->depth()
+                                                                                << ") does not match result cube depth ("
+                                                                                << result->depth() << ")");
+        samples += c->samples();
+    }
+    QL_REQUIRE(samples == result->samples(), "mergeCubes(): total number of samples ("
+                                                 << samples << ") does not match result cube samples ("
+                                                 << result->samples() << ")");
+
+    for (Size i = 0; i < result->numIds(); ++i)
+        for (Size d = 0; d < result->depth(); ++d)
+            result->setT0(cubes.front()->getT0(i, d), i, d);
+
+    Size offset = 0;
+    for (auto const& c : cubes) {
+        for (Size i = 0; i < c->numIds(); ++i) {
+            for (Size j = 0; j < c->numDates(); ++j) {
+                for (Size k = 0; k < c->samples(); ++k) {
+                    for (Size d = 0; d < c->depth(); ++d) {
+                        result->set(c->get(i, j, k, d), i, j, offset + k, d);
+                    }
+                }
+            }
+        }
+        offset += c->samples();
+    }
+}
+
+void mergeSensiCubes(const std::vector<boost::shared_ptr<NPVSensiCube>>& cubes,
+                     const boost::shared_ptr<NPVSensiCube>& result) {
+    QL_REQUIRE(!cubes.empty(), "mergeSensiCubes(): no cubes given");
+    QL_REQUIRE(result, "mergeSensiCubes(): result cube is null");
+
+    Size samples = 0;
+    for (auto const& c : cubes) {
+        QL_REQUIRE(c, "mergeSensiCubes(): cube is null");
+        QL_REQUIRE(c->ids() == result->ids(), "mergeSensiCubes(): cube ids do not match result cube ids");
+        samples += c->samples();
+    }
+    QL_REQUIRE(samples == result->samples(), "mergeSensiCubes(): total number of samples ("
+                                                 << samples << ") does not match result cube samples ("
+                                                 << result->samples() << ")");
+
+    for (Size i = 0; i < result->numIds(); ++i)
+        result->setT0(cubes.front()->getT0(i), i);
+
+    Size offset = 0;
+    for (auto const& c : cubes) {
+        for (Size i = 0; i < c->numIds(); ++i)
+            c->forEachTradeNPV(i, [&result, i, offset](Size k, Real v) { result->set(v, i, offset + k); });
+        offset += c->samples();
+    }
+}
+
+void mergeAggregationScenarioData(const std::vector<boost::shared_ptr<AggregationScenarioData>>& data,
+                                  const boost::shared_ptr<AggregationScenarioData>& result) {
+    QL_REQUIRE(result, "mergeAggregationScenarioData(): result is null");
+
+    Size samples = 0;
+    for (auto const& a : data) {
+        QL_REQUIRE(a, "mergeAggregationScenarioData(): scenario data is null");
+        QL_REQUIRE(a->dimDates() == result->dimDates(), "mergeAggregationScenarioData(): dates ("
+                                                            << a->dimDates() << ") do not match result dates ("
+                                                            << result->dimDates() << ")");
+        samples += a->dimSamples();
+    }
+    QL_REQUIRE(samples == result->dimSamples(), "mergeAggregationScenarioData(): total number of samples ("
+                                                    << samples << ") does not match result samples ("
+                                                    << result->dimSamples() << ")");
+
+    Size offset = 0;
+    for (auto const& a : data) {
+        for (auto const& k : a->keys()) {
+            Size source = a->handle(k.first, k.second);
+            Size target = result->add(k.first, k.second);
+            for (Size d = 0; d < a->dimDates(); ++d) {
+                const Real* values = a->samples(d, source);
+                for (Size s = 0; s < a->dimSamples(); ++s) {
+                    result->set(d, offset + s, values[s], target);
+                }
+            }
+        }
+        offset += a->dimSamples();
+    }
+}
+
+} // namespace analytics
+} // namespace ore
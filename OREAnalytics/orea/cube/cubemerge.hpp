@@ -0,0 +1,65 @@
+/*
+ Copyright (C) 2023 Quaternion Risk Management Ltd
+ All rights reserved.
+
+ This file is part of ORE, a free-software/open-source library
+ for transparent pricing and risk analysis - http://opensourcerisk.org
+
+ ORE is free software: you can redistribute it and/or modify it
+ under the terms of the Modified BSD License.  You should have received a
+ copy of the license along with this program.
+ The license is also available online at <http://opensourcerisk.org>
+
+ This program is distributed on the basis that it will form a useful
+ contribution to risk analytics and model standardisation, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ FITNESS FOR A PARTICULAR PURPOSE. See the license for more details.
+*/
+
+/*! \file orea/cube/cubemerge.hpp
+    \brief Merge cubes and scenario data generated for consecutive sample ranges
+    \ingroup cube
+*/
+
+#pragma once
+
+#include <orea/cube/npvcube.hpp>
+#include <orea/cube/npvsensicube.hpp>
+#include <orea/scenario/aggregationscenariodata.hpp>
+
+#include <boost/shared_ptr.hpp>
+
+#include <vector>
+
+namespace ore {
+namespace analytics {
+
+//! Merge cubes holding consecutive sample ranges into one cube
+/*! The cubes must have the same ids, dates and depth as the result cube, and their number of samples
+    must add up to the number of samples of the result cube. The cubes are copied in the given order, i.e.
+    sample k of cubes[i] goes to sample cubes[0]->samples() + ... + cubes[i-1]->samples() + k of the result.
+    T0 values are taken from the first cube.
+
+    \ingroup cube
+*/
+void mergeCubes(const std::vector<boost::shared_ptr<NPVCube>>& cubes, const boost::shared_ptr<NPVCube>& result);
+
+//! Merge sensi cubes holding consecutive scenario ranges into one sensi cube
+/*! Same conventions as in mergeCubes(). Only the stored scenario NPVs of the cubes are copied, so that the sparse
+    storage of the result cube is preserved.
+
+    \ingroup cube
+*/
+void mergeSensiCubes(const std::vector<boost::shared_ptr<NPVSensiCube>>& cubes,
+                     const boost::shared_ptr<NPVSensiCube>& result);
+
+//! Merge aggregation scenario data holding consecutive sample ranges
+/*! Same conventions as in mergeCubes(), all keys found in any of the inputs are merged.
+
+    \ingroup cube
+*/
+void mergeAggregationScenarioData(const std::vector<boost::shared_ptr<AggregationScenarioData>>& data,
+                                  const boost::shared_ptr<AggregationScenarioData>& result);
+
+} // namespace analytics
+} // namespace ore
@@ -0,0 +1,256 @@
+/*
+ Copyright (C) 2023 Quaternion Risk Management Ltd
+ All rights reserved.
+
+ This file is part of ORE, a free-software/open-source library
+ for transparent pricing and risk analysis - http://opensourcerisk.org
+
+ ORE is free software: you can redistribute it and/or modify it
+ under the terms of the Modified BSD License.  You should have received a
+ copy of the license along with this program.
+ The license is also available online at <http://opensourcerisk.org>
+
+ This program is distributed on the basis that it will form a useful
+ contribution to risk analytics and model standardisation, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ FITNESS FOR A PARTICULAR PURPOSE. See the license for more details.
+*/
+
+/*! \file orea/cube/flatinmemorycube.hpp
+    \brief A cube implementation that stores the cube in one contiguous buffer
+    \ingroup cube
+*/
+
+#pragma once
+
+#include <orea/cube/npvcube.hpp>
+#include <ored/utilities/serializationdate.hpp>
+
+#include <ql/errors.hpp>
+
+#include <boost/align/aligned_allocator.hpp>
+#include <boost/archive/binary_iarchive.hpp>
+#include <boost/archive/binary_oarchive.hpp>
+#include <boost/serialization/string.hpp>
+#include <boost/serialization/vector.hpp>
+
+#include <fstream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace ore {
+namespace analytics {
+using QuantLib::Date;
+using QuantLib::Real;
+using QuantLib::Size;
+using std::vector;
+
+//! Order of the dimensions in the buffer of a FlatInMemoryCube
+/*! The last dimension named has unit stride. The depth is always stored next to the unit stride dimension, i.e.
+    - IdDateSample: position = ((id * dates + date) * depth + d) * samples + sample, the samples of one
+      (id, date, depth) form a contiguous vector
+    - DateSampleId: position = ((date * samples + sample) * depth + d) * ids + id, the ids of one
+      (date, sample, depth) form a contiguous vector
+
+    \ingroup cube
+*/
+enum class NPVCubeLayout { IdDateSample, DateSampleId };
+
+inline std::ostream& operator<<(std::ostream& out, const NPVCubeLayout& l) {
+    switch (l) {
+    case NPVCubeLayout::IdDateSample:
+        return out << "IdDateSample";
+    case NPVCubeLayout::DateSampleId:
+        return out << "DateSampleId";
+    default:
+        return out << "Unknown NPVCubeLayout (" << static_cast<int>(l) << ")";
+    }
+}
+
+inline NPVCubeLayout parseNPVCubeLayout(const std::string& s) {
+    if (s == "IdDateSample")
+        return NPVCubeLayout::IdDateSample;
+    else if (s == "DateSampleId")
+        return NPVCubeLayout::DateSampleId;
+    QL_FAIL("NPVCubeLayout '" << s << "' not recognised, expected IdDateSample or DateSampleId");
+}
+
+//! FlatInMemoryCube stores the cube in memory in one contiguous, cache line aligned buffer
+/*! In contrast to InMemoryCubeBase no nested containers are used, so that a cube is a single heap block
+    independent of its size. The dimension order is given by the NPVCubeLayout and should be chosen such that
+    the innermost loop of the consumer runs over the unit stride dimension.
+
+    The class is a template to allow both single and double precision implementations.
+
+    \ingroup cube
+*/
+template <typename T> class FlatInMemoryCube : public NPVCube {
+public:
+    //! ctor
+    FlatInMemoryCube(const Date& asof, const vector<std::string>& ids, const vector<Date>& dates, Size samples,
+                     Size depth = 1, NPVCubeLayout layout = NPVCubeLayout::IdDateSample, const T& t = T())
+        : asof_(asof), ids_(ids), dates_(dates), samples_(samples), depth_(depth), layout_(layout),
+          t0Data_(ids.size() * depth, t), data_(ids.size() * dates.size() * samples * depth, t) {
+        QL_REQUIRE(ids.size() > 0, "FlatInMemoryCube::FlatInMemoryCube no ids specified");
+        QL_REQUIRE(dates.size() > 0, "FlatInMemoryCube::FlatInMemoryCube no dates specified");
+        QL_REQUIRE(samples > 0, "FlatInMemoryCube::FlatInMemoryCube samples must be > 0");
+        QL_REQUIRE(depth > 0, "FlatInMemoryCube::FlatInMemoryCube depth must be > 0");
+    }
+
+    //! construct from file
+    FlatInMemoryCube(const std::string& fileName) {
+        load(fileName);
+        QL_REQUIRE(numIds() > 0 && numDates() > 0 && samples() > 0 && depth() > 0,
+                   "FlatInMemoryCube::FlatInMemoryCube failed to load from file " << fileName);
+    }
+
+    //! default constructor
+    FlatInMemoryCube() : samples_(0), depth_(0), layout_(NPVCubeLayout::IdDateSample) {}
+
+    //! load cube from an archive
+    void load(const std::string& fileName) override {
+        std::ifstream ifs(fileName.c_str(), std::fstream::binary);
+        QL_REQUIRE(ifs.is_open(), "error opening file " << fileName);
+        boost::archive::binary_iarchive ia(ifs);
+        ia >> *this;
+    }
+
+    //! write cube to an archive
+    void save(const std::string& fileName) const override {
+        std::ofstream ofs(fileName.c_str(), std::fstream::binary);
+        QL_REQUIRE(ofs.is_open(), "error opening file " << fileName);
+        boost::archive::binary_oarchive oa(ofs);
+        oa << *this;
+    }
+
+    //! Return the length of each dimension
+    Size numIds() const override { return ids_.size(); }
+    Size numDates() const override { return dates_.size(); }
+    Size samples() const override { return samples_; }
+    Size depth() const override { return depth_; }
+
+    //! Get the vector of ids for this cube
+    const std::vector<std::string>& ids() const override { return ids_; }
+    //! Get the vector of dates for this cube
+    const std::vector<QuantLib::Date>& dates() const override { return dates_; }
+
+    //! Return the asof date (T0 date)
+    QuantLib::Date asof() const override { return asof_; }
+
+    //! Return the dimension order of the buffer
+    NPVCubeLayout layout() const { return layout_; }
+
+    //! Get a T0 value from the cube
+    Real getT0(Size i, Size d) const override {
+        check(i, 0, 0, d);
+        return t0Data_[i * depth_ + d];
+    }
+
+    //! Set a T0 value in the cube
+    void setT0(Real value, Size i, Size d) override {
+        check(i, 0, 0, d);
+        t0Data_[i * depth_ + d] = static_cast<T>(value);
+    }
+
+    //! Get a value from the cube
+    Real get(Size i, Size j, Size k, Size d) const override {
+        check(i, j, k, d);
+        return data_[position(i, j, k, d)];
+    }
+
+    //! Set a value in the cube
+    void set(Real value, Size i, Size j, Size k, Size d) override {
+        check(i, j, k, d);
+        data_[position(i, j, k, d)] = static_cast<T>(value);
+    }
+
+    //! Get the values of all samples for given id, date and depth
+    void getSamples(Real* values, Size i, Size j, Size d) const override {
+        check(i, j, 0, d);
+        const T* p = &data_[position(i, j, 0, d)];
+        Size stride = sampleStride();
+        for (Size k = 0; k < samples_; ++k, p += stride)
+            values[k] = *p;
+    }
+
+    //! Set the values of all samples for given id, date and depth
+    void setSamples(const Real* values, Size i, Size j, Size d) override {
+        check(i, j, 0, d);
+        T* p = &data_[position(i, j, 0, d)];
+        Size stride = sampleStride();
+        for (Size k = 0; k < samples_; ++k, p += stride)
+            *p = static_cast<T>(values[k]);
+    }
+
+    //! Get the values of all dates and samples for given id and depth
+    void getSlab(Real* values, Size i, Size d) const override {
+        check(i, 0, 0, d);
+        Size stride = sampleStride();
+        for (Size j = 0; j < dates_.size(); ++j) {
+            const T* p = &data_[position(i, j, 0, d)];
+            for (Size k = 0; k < samples_; ++k, p += stride)
+                *values++ = *p;
+        }
+    }
+
+    //! Set the values of all dates and samples for given id and depth
+    void setSlab(const Real* values, Size i, Size d) override {
+        check(i, 0, 0, d);
+        Size stride = sampleStride();
+        for (Size j = 0; j < dates_.size(); ++j) {
+            T* p = &data_[position(i, j, 0, d)];
+            for (Size k = 0; k < samples_; ++k, p += stride)
+                *p = static_cast<T>(*values++);
+        }
+    }
+
+protected:
+    void check(Size i, Size j, Size k, Size d) const {
+        QL_REQUIRE(i < numIds(), "Out of bounds on ids (i=" << i << ", numIds=" << numIds() << ")");
+        QL_REQUIRE(j < numDates(), "Out of bounds on dates (j=" << j << ", numDates=" << numDates() << ")");
+        QL_REQUIRE(k < samples(), "Out of bounds on samples (k=" << k << ", samples=" << samples() << ")");
+        QL_REQUIRE(d < depth(), "Out of bounds on depth (d=" << d << ", depth=" << depth() << ")");
+    }
+
+    Size sampleStride() const { return layout_ == NPVCubeLayout::IdDateSample ? 1 : depth_ * ids_.size(); }
+
+    Size position(Size i, Size j, Size k, Size d) const {
+        if (layout_ == NPVCubeLayout::IdDateSample)
+            return ((i * dates_.size() + j) * depth_ + d) * samples_ + k;
+        else
+            return ((j * samples_ + k) * depth_ + d) * ids_.size() + i;
+    }
+
+private:
+    friend class boost::serialization::access;
+    template <class Archive> void serialize(Archive& ar, const unsigned int) {
+        ar& asof_;
+        ar& ids_;
+        ar& dates_;
+        ar& samples_;
+        ar& depth_;
+        ar& layout_;
+        ar& t0Data_;
+        ar& data_;
+    }
+
+    QuantLib::Date asof_;
+    vector<std::string> ids_;
+    vector<QuantLib::Date> dates_;
+    Size samples_, depth_;
+    NPVCubeLayout layout_;
+
+protected:
+    vector<T> t0Data_;
+    vector<T, boost::alignment::aligned_allocator<T, 64>> data_;
+};
+
+//! FlatInMemoryCube with single precision floating point numbers.
+using SinglePrecisionFlatInMemoryCube = FlatInMemoryCube<float>;
+
+//! FlatInMemoryCube with double precision floating point numbers.
+using DoublePrecisionFlatInMemoryCube = FlatInMemoryCube<double>;
+
+} // namespace analytics
+} // namespace ore
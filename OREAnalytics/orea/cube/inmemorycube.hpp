@@ -23,6 +23,7 @@
 
 #pragma once
 
+#include <algorithm>
 #include <fstream>
 #include <vector>
 
@@ -168,6 +169,34 @@ public:
         this->check(i, j, k, d);
         this->data_[i][j][k] = static_cast<T>(value);
     }
+
+    //! Get the values of all samples for given id, date and depth
+    void getSamples(Real* values, Size i, Size j, Size d) const override {
+        this->check(i, j, 0, d);
+        std::copy(this->data_[i][j].begin(), this->data_[i][j].end(), values);
+    }
+
+    //! Set the values of all samples for given id, date and depth
+    void setSamples(const Real* values, Size i, Size j, Size d) override {
+        this->check(i, j, 0, d);
+        for (Size k = 0; k < this->samples(); ++k)
+            this->data_[i][j][k] = static_cast<T>(values[k]);
+    }
+
+    //! Get the values of all dates and samples for given id and depth
+    void getSlab(Real* values, Size i, Size d) const override {
+        this->check(i, 0, 0, d);
+        for (auto const& v : this->data_[i])
+            values = std::copy(v.begin(), v.end(), values);
+    }
+
+    //! Set the values of all dates and samples for given id and depth
+    void setSlab(const Real* values, Size i, Size d) override {
+        this->check(i, 0, 0, d);
+        for (auto& v : this->data_[i])
+            for (auto& x : v)
+                x = static_cast<T>(*values++);
+    }
 };
 
 //! InMemoryCube of variable depth
@@ -209,6 +238,36 @@ public:
         this->check(i, j, k, d);
         this->data_[i][j][k][d] = static_cast<T>(value);
     }
+
+    //! Get the values of all samples for given id, date and depth
+    void getSamples(Real* values, Size i, Size j, Size d) const override {
+        this->check(i, j, 0, d);
+        for (auto const& v : this->data_[i][j])
+            *values++ = v[d];
+    }
+
+    //! Set the values of all samples for given id, date and depth
+    void setSamples(const Real* values, Size i, Size j, Size d) override {
+        this->check(i, j, 0, d);
+        for (auto& v : this->data_[i][j])
+            v[d] = static_cast<T>(*values++);
+    }
+
+    //! Get the values of all dates and samples for given id and depth
+    void getSlab(Real* values, Size i, Size d) const override {
+        this->check(i, 0, 0, d);
+        for (auto const& w : this->data_[i])
+            for (auto const& v : w)
+                *values++ = v[d];
+    }
+
+    //! Set the values of all dates and samples for given id and depth
+    void setSlab(const Real* values, Size i, Size d) override {
+        this->check(i, 0, 0, d);
+        for (auto& w : this->data_[i])
+            for (auto& v : w)
+                v[d] = static_cast<T>(*values++);
+    }
 };
 
 //! InMemoryCube of depth 1 with single precision floating point numbers.
@@ -0,0 +1,351 @@
+/*
+ Copyright (C) 2023 Quaternion Risk Management Ltd
+ All rights reserved.
+
+ This file is part of ORE, a free-software/open-source library
+ for transparent pricing and risk analysis - http://opensourcerisk.org
+
+ ORE is free software: you can redistribute it and/or modify it
+ under the terms of the Modified BSD License.  You should have received a
+ copy of the license along with this program.
+ The license is also available online at <http://opensourcerisk.org>
+
+ This program is distributed on the basis that it will form a useful
+ contribution to risk analytics and model standardisation, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ FITNESS FOR A PARTICULAR PURPOSE. See the license for more details.
+*/
+
+/*! \file orea/cube/memorymappedcube.hpp
+    \brief A cube implementation that lives in a memory mapped file
+    \ingroup cube
+*/
+
+#pragma once
+
+#include <orea/cube/npvcube.hpp>
+
+#include <ql/errors.hpp>
+
+#include <boost/filesystem.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/version.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace ore {
+namespace analytics {
+using QuantLib::Date;
+using QuantLib::Real;
+using QuantLib::Size;
+using std::vector;
+
+//! Fixed size header at the start of a memory mapped cube file
+/*! The file layout is
+    - the header (64 bytes)
+    - the ids, each as its length (std::uint64_t) followed by the characters
+    - the dates as serial numbers (std::int64_t, 0 for a null date)
+    - padding up to dataOffset, which is a multiple of 64
+    - the T0 values, numIds x depth
+    - the future values, numIds x numDates x depth x samples, i.e. the samples of one (id, date, depth) are
+      contiguous
+
+    All numbers are stored in the byte order of the machine that wrote the file.
+
+    \ingroup cube
+*/
+struct MemoryMappedCubeHeader {
+    char magic[8];           // "ORECUBE" followed by a null character
+    std::uint32_t version;   // file format version
+    std::uint32_t precision; // bytes per value, 4 (float) or 8 (double)
+    std::int64_t asof;       // serial number of the asof date
+    std::uint64_t numIds, numDates, samples, depth;
+    std::uint64_t dataOffset; // byte offset of the T0 values from the start of the file
+};
+
+namespace detail {
+constexpr char memoryMappedCubeMagic[8] = {'O', 'R', 'E', 'C', 'U', 'B', 'E', '\0'};
+constexpr std::uint32_t memoryMappedCubeVersion = 1;
+static_assert(sizeof(MemoryMappedCubeHeader) == 64, "MemoryMappedCubeHeader is expected to have 64 bytes");
+
+inline MemoryMappedCubeHeader readMemoryMappedCubeHeader(const std::string& fileName) {
+    std::ifstream ifs(fileName.c_str(), std::fstream::binary);
+    QL_REQUIRE(ifs.is_open(), "error opening file " << fileName);
+    MemoryMappedCubeHeader header;
+    ifs.read(reinterpret_cast<char*>(&header), sizeof(header));
+    QL_REQUIRE(ifs.good(), "MemoryMappedCube: could not read header from " << fileName);
+    QL_REQUIRE(std::memcmp(header.magic, memoryMappedCubeMagic, sizeof(header.magic)) == 0,
+               "MemoryMappedCube: " << fileName << " is not a memory mapped cube file");
+    QL_REQUIRE(header.version == memoryMappedCubeVersion, "MemoryMappedCube: file version "
+                                                              << header.version << " in " << fileName
+                                                              << " not supported, expected "
+                                                              << memoryMappedCubeVersion);
+    return header;
+}
+} // namespace detail
+
+//! MemoryMappedCube stores the cube in a file that is mapped into memory
+/*! The cube file is created with its final size when the cube is constructed, values written via set() go
+    directly to the mapped pages and are flushed to disk by the operating system or explicitly by save(). When
+    an existing cube file is opened, only the header, ids and dates are read, the values are paged in on demand
+    when they are accessed. This allows to post process cubes that do not fit into memory.
+
+    The class is a template to allow both single and double precision implementations.
+
+    \ingroup cube
+*/
+template <typename T> class MemoryMappedCube : public NPVCube {
+public:
+    //! Create a new cube file, an existing file with the same name is overwritten
+    MemoryMappedCube(const std::string& fileName, const Date& asof, const vector<std::string>& ids,
+                     const vector<Date>& dates, Size samples, Size depth = 1, const T& t = T())
+        : fileName_(fileName), asof_(asof), ids_(ids), dates_(dates), samples_(samples), depth_(depth),
+          readOnly_(false), t0Data_(nullptr), data_(nullptr) {
+        QL_REQUIRE(ids.size() > 0, "MemoryMappedCube::MemoryMappedCube no ids specified");
+        QL_REQUIRE(dates.size() > 0, "MemoryMappedCube::MemoryMappedCube no dates specified");
+        QL_REQUIRE(samples > 0, "MemoryMappedCube::MemoryMappedCube samples must be > 0");
+        QL_REQUIRE(depth > 0, "MemoryMappedCube::MemoryMappedCube depth must be > 0");
+        create();
+        if (t != T()) {
+            std::fill(t0Data_, t0Data_ + numIds() * depth_, t);
+            std::fill(data_, data_ + numIds() * numDates() * depth_ * samples_, t);
+        }
+    }
+
+    //! Open an existing cube file
+    explicit MemoryMappedCube(const std::string& fileName, bool readOnly = true)
+        : MemoryMappedCube() {
+        open(fileName, readOnly);
+    }
+
+    //! default constructor, the cube can be opened with load()
+    MemoryMappedCube() : samples_(0), depth_(0), readOnly_(true), t0Data_(nullptr), data_(nullptr) {}
+
+    //! open an existing cube file read-only
+    void load(const std::string& fileName) override { open(fileName, true); }
+
+    //! flush the mapped pages and copy the file if fileName differs from the mapped file
+    void save(const std::string& fileName) const override {
+        flush();
+        if (boost::filesystem::exists(fileName) && boost::filesystem::equivalent(fileName, fileName_))
+            return;
+#if BOOST_VERSION >= 107400
+        boost::filesystem::copy_file(fileName_, fileName, boost::filesystem::copy_options::overwrite_existing);
+#else
+        boost::filesystem::copy_file(fileName_, fileName, boost::filesystem::copy_option::overwrite_if_exists);
+#endif
+    }
+
+    //! write modified pages back to the file
+    void flush() const {
+        if (!readOnly_ && region_.get_address() != nullptr)
+            QL_REQUIRE(region_.flush(), "MemoryMappedCube: error flushing " << fileName_);
+    }
+
+    //! Return the length of each dimension
+    Size numIds() const override { return ids_.size(); }
+    Size numDates() const override { return dates_.size(); }
+    Size samples() const override { return samples_; }
+    Size depth() const override { return depth_; }
+
+    //! Get the vector of ids for this cube
+    const std::vector<std::string>& ids() const override { return ids_; }
+    //! Get the vector of dates for this cube
+    const std::vector<QuantLib::Date>& dates() const override { return dates_; }
+
+    //! Return the asof date (T0 date)
+    QuantLib::Date asof() const override { return asof_; }
+
+    //! The name of the mapped file
+    const std::string& fileName() const { return fileName_; }
+
+    //! Get a T0 value from the cube
+    Real getT0(Size i, Size d) const override {
+        check(i, 0, 0, d);
+        return t0Data_[i * depth_ + d];
+    }
+
+    //! Set a T0 value in the cube
+    void setT0(Real value, Size i, Size d) override {
+        check(i, 0, 0, d);
+        checkWritable();
+        t0Data_[i * depth_ + d] = static_cast<T>(value);
+    }
+
+    //! Get a value from the cube
+    Real get(Size i, Size j, Size k, Size d) const override {
+        check(i, j, k, d);
+        return data_[((i * dates_.size() + j) * depth_ + d) * samples_ + k];
+    }
+
+    //! Set a value in the cube
+    void set(Real value, Size i, Size j, Size k, Size d) override {
+        check(i, j, k, d);
+        checkWritable();
+        data_[((i * dates_.size() + j) * depth_ + d) * samples_ + k] = static_cast<T>(value);
+    }
+
+    //! Get the values of all samples for given id, date and depth
+    void getSamples(Real* values, Size i, Size j, Size d) const override {
+        check(i, j, 0, d);
+        const T* p = data_ + ((i * dates_.size() + j) * depth_ + d) * samples_;
+        std::copy(p, p + samples_, values);
+    }
+
+    //! Set the values of all samples for given id, date and depth
+    void setSamples(const Real* values, Size i, Size j, Size d) override {
+        check(i, j, 0, d);
+        checkWritable();
+        T* p = data_ + ((i * dates_.size() + j) * depth_ + d) * samples_;
+        for (Size k = 0; k < samples_; ++k)
+            p[k] = static_cast<T>(values[k]);
+    }
+
+    //! Get the values of all dates and samples for given id and depth
+    void getSlab(Real* values, Size i, Size d) const override {
+        check(i, 0, 0, d);
+        for (Size j = 0; j < dates_.size(); ++j, values += samples_) {
+            const T* p = data_ + ((i * dates_.size() + j) * depth_ + d) * samples_;
+            std::copy(p, p + samples_, values);
+        }
+    }
+
+    //! Set the values of all dates and samples for given id and depth
+    void setSlab(const Real* values, Size i, Size d) override {
+        check(i, 0, 0, d);
+        checkWritable();
+        for (Size j = 0; j < dates_.size(); ++j) {
+            T* p = data_ + ((i * dates_.size() + j) * depth_ + d) * samples_;
+            for (Size k = 0; k < samples_; ++k)
+                p[k] = static_cast<T>(*values++);
+        }
+    }
+
+private:
+    void check(Size i, Size j, Size k, Size d) const {
+        QL_REQUIRE(i < numIds(), "Out of bounds on ids (i=" << i << ", numIds=" << numIds() << ")");
+        QL_REQUIRE(j < numDates(), "Out of bounds on dates (j=" << j << ", numDates=" << numDates() << ")");
+        QL_REQUIRE(k < samples(), "Out of bounds on samples (k=" << k << ", samples=" << samples() << ")");
+        QL_REQUIRE(d < depth(), "Out of bounds on depth (d=" << d << ", depth=" << depth() << ")");
+    }
+
+    void checkWritable() const {
+        QL_REQUIRE(!readOnly_, "MemoryMappedCube: " << fileName_ << " is opened read-only");
+    }
+
+    Size fileSize(std::uint64_t dataOffset) const {
+        return dataOffset + (numIds() * depth_ + numIds() * numDates() * depth_ * samples_) * sizeof(T);
+    }
+
+    void create() {
+        MemoryMappedCubeHeader header;
+        std::memcpy(header.magic, detail::memoryMappedCubeMagic, sizeof(header.magic));
+        header.version = detail::memoryMappedCubeVersion;
+        header.precision = sizeof(T);
+        header.asof = asof_ == Date() ? 0 : asof_.serialNumber();
+        header.numIds = ids_.size();
+        header.numDates = dates_.size();
+        header.samples = samples_;
+        header.depth = depth_;
+        std::uint64_t offset = sizeof(header);
+        for (auto const& id : ids_)
+            offset += sizeof(std::uint64_t) + id.size();
+        offset += dates_.size() * sizeof(std::int64_t);
+        header.dataOffset = (offset + 63) / 64 * 64;
+        {
+            std::ofstream ofs(fileName_.c_str(), std::fstream::binary | std::fstream::trunc);
+            QL_REQUIRE(ofs.is_open(), "error opening file " << fileName_);
+            ofs.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            for (auto const& id : ids_) {
+                std::uint64_t length = id.size();
+                ofs.write(reinterpret_cast<const char*>(&length), sizeof(length));
+                ofs.write(id.data(), id.size());
+            }
+            for (auto const& d : dates_) {
+                std::int64_t serial = d == Date() ? 0 : d.serialNumber();
+                ofs.write(reinterpret_cast<const char*>(&serial), sizeof(serial));
+            }
+            QL_REQUIRE(ofs.good(), "MemoryMappedCube: error writing header to " << fileName_);
+        }
+        // the values are zero initialised by resize_file
+        boost::filesystem::resize_file(fileName_, fileSize(header.dataOffset));
+        map(header.dataOffset);
+    }
+
+    void open(const std::string& fileName, bool readOnly) {
+        MemoryMappedCubeHeader header = detail::readMemoryMappedCubeHeader(fileName);
+        QL_REQUIRE(header.precision == sizeof(T), "MemoryMappedCube: " << fileName << " has precision "
+                                                                       << header.precision << ", expected "
+                                                                       << sizeof(T));
+        fileName_ = fileName;
+        readOnly_ = readOnly;
+        asof_ = header.asof == 0 ? Date() : Date(static_cast<Date::serial_type>(header.asof));
+        samples_ = header.samples;
+        depth_ = header.depth;
+        std::ifstream ifs(fileName.c_str(), std::fstream::binary);
+        QL_REQUIRE(ifs.is_open(), "error opening file " << fileName);
+        ifs.seekg(sizeof(header));
+        ids_.resize(header.numIds);
+        for (auto& id : ids_) {
+            std::uint64_t length;
+            ifs.read(reinterpret_cast<char*>(&length), sizeof(length));
+            id.resize(length);
+            ifs.read(&id[0], length);
+        }
+        dates_.resize(header.numDates);
+        for (auto& d : dates_) {
+            std::int64_t serial;
+            ifs.read(reinterpret_cast<char*>(&serial), sizeof(serial));
+            d = serial == 0 ? Date() : Date(static_cast<Date::serial_type>(serial));
+        }
+        QL_REQUIRE(ifs.good(), "MemoryMappedCube: error reading ids and dates from " << fileName);
+        QL_REQUIRE(boost::filesystem::file_size(fileName) >= fileSize(header.dataOffset),
+                   "MemoryMappedCube: " << fileName << " is truncated, expected at least "
+                                        << fileSize(header.dataOffset) << " bytes");
+        map(header.dataOffset);
+    }
+
+    void map(std::uint64_t dataOffset) {
+        auto mode = readOnly_ ? boost::interprocess::read_only : boost::interprocess::read_write;
+        boost::interprocess::file_mapping mapping(fileName_.c_str(), mode);
+        region_ = boost::interprocess::mapped_region(mapping, mode);
+        t0Data_ = reinterpret_cast<T*>(static_cast<char*>(region_.get_address()) + dataOffset);
+        data_ = t0Data_ + numIds() * depth_;
+    }
+
+    std::string fileName_;
+    QuantLib::Date asof_;
+    vector<std::string> ids_;
+    vector<QuantLib::Date> dates_;
+    Size samples_, depth_;
+    bool readOnly_;
+    mutable boost::interprocess::mapped_region region_;
+    T* t0Data_;
+    T* data_;
+};
+
+//! MemoryMappedCube with single precision floating point numbers.
+using SinglePrecisionMemoryMappedCube = MemoryMappedCube<float>;
+
+//! MemoryMappedCube with double precision floating point numbers.
+using DoublePrecisionMemoryMappedCube = MemoryMappedCube<double>;
+
+//! Open an existing memory mapped cube file with the precision given in its header
+inline boost::shared_ptr<NPVCube> openMemoryMappedCube(const std::string& fileName, bool readOnly = true) {
+    MemoryMappedCubeHeader header = detail::readMemoryMappedCubeHeader(fileName);
+    if (header.precision == sizeof(float))
+        return boost::make_shared<SinglePrecisionMemoryMappedCube>(fileName, readOnly);
+    else if (header.precision == sizeof(double))
+        return boost::make_shared<DoublePrecisionMemoryMappedCube>(fileName, readOnly);
+    QL_FAIL("openMemoryMappedCube: precision " << header.precision << " in " << fileName << " not supported");
+}
+
+} // namespace analytics
+} // namespace ore
@@ -89,6 +89,29 @@ public:
         set(value, index(id), index(date), sample, depth);
     }
 
+    //! Get the values of all samples for given id, date and depth, values must point to samples() elements
+    virtual void getSamples(Real* values, Size id, Size date, Size depth = 0) const {
+        for (Size k = 0; k < samples(); ++k)
+            values[k] = get(id, date, k, depth);
+    }
+    //! Set the values of all samples for given id, date and depth, values must point to samples() elements
+    virtual void setSamples(const Real* values, Size id, Size date, Size depth = 0) {
+        for (Size k = 0; k < samples(); ++k)
+            set(values[k], id, date, k, depth);
+    }
+
+    //! Get the values of all dates and samples for given id and depth
+    /*! values must point to numDates() x samples() elements, the samples of date j start at values + j * samples() */
+    virtual void getSlab(Real* values, Size id, Size depth = 0) const {
+        for (Size j = 0; j < numDates(); ++j)
+            getSamples(values + j * samples(), id, j, depth);
+    }
+    //! Set the values of all dates and samples for given id and depth, see getSlab() for the layout of values
+    virtual void setSlab(const Real* values, Size id, Size depth = 0) {
+        for (Size j = 0; j < numDates(); ++j)
+            setSamples(values + j * samples(), id, j, depth);
+    }
+
     //! Load cube contents from disk
     virtual void load(const std::string& fileName) = 0;
     //! Persist cube contents to disk
@@ -23,6 +23,7 @@
 
 #pragma once
 
+#include <functional>
 #include <map>
 #include <orea/cube/npvcube.hpp>
 #include <ql/time/date.hpp>
@@ -77,6 +78,25 @@ public:
         return getTradeNPVs(index(tradeId));
     }
 
+    /*! Call \p f(scenarioIdx, npv) for the trade at index \p tradeIdx for all risk factor shifts with an NPV
+        different from the base NPV, in increasing order of the shift index. Implementations with sparse storage
+        should override this to iterate over their storage without copying.
+    */
+    virtual void forEachTradeNPV(Size tradeIdx, const std::function<void(QuantLib::Size, QuantLib::Real)>& f) const {
+        for (auto const& v : getTradeNPVs(tradeIdx))
+            f(v.first, v.second);
+    }
+
+    /*! Return the base NPV of the trade at index \p tradeIdx and write its NPVs under the \p n risk factor shifts
+        \p scenarioIdx[0], ..., \p scenarioIdx[n-1] to \p npvs. Implementations with sparse storage should
+        override this to look up all shifts in their storage of the trade directly.
+    */
+    virtual QuantLib::Real getNPVs(Size tradeIdx, Size n, const Size* scenarioIdx, QuantLib::Real* npvs) const {
+        for (Size m = 0; m < n; ++m)
+            npvs[m] = get(tradeIdx, scenarioIdx[m]);
+        return getT0(tradeIdx, 0);
+    }
+
     /*! Return the set of scenario indices with non-zero result */
     virtual std::set<QuantLib::Size> relevantScenarios() const = 0;
 };
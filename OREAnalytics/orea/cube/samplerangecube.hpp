@@ -0,0 +1,107 @@
+/*
+ Copyright (C) 2023 Quaternion Risk Management Ltd
+ All rights reserved.
+
+ This file is part of ORE, a free-software/open-source library
+ for transparent pricing and risk analysis - http://opensourcerisk.org
+
+ ORE is free software: you can redistribute it and/or modify it
+ under the terms of the Modified BSD License.  You should have received a
+ copy of the license along with this program.
+ The license is also available online at <http://opensourcerisk.org>
+
+ This program is distributed on the basis that it will form a useful
+ contribution to risk analytics and model standardisation, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ FITNESS FOR A PARTICULAR PURPOSE. See the license for more details.
+*/
+
+/*! \file orea/cube/samplerangecube.hpp
+    \brief A view on a contiguous range of samples of an underlying cube
+    \ingroup cube
+*/
+
+#pragma once
+
+#include <orea/cube/npvcube.hpp>
+
+#include <ql/errors.hpp>
+
+#include <vector>
+
+namespace ore {
+namespace analytics {
+
+//! Cube view on the samples [sampleStart, sampleEnd) of an underlying cube
+/*! Future values are read from and written to the underlying cube with the sample index shifted by
+    sampleStart, so that several views on disjoint sample ranges can be filled concurrently. T0 values
+    are kept in the view itself and are not forwarded to the underlying cube, they can be copied over
+    with copyT0() once all writers are done.
+
+    \ingroup cube
+*/
+class SampleRangeCube : public NPVCube {
+public:
+    SampleRangeCube(const boost::shared_ptr<NPVCube>& cube, Size sampleStart, Size sampleEnd)
+        : cube_(cube), sampleStart_(sampleStart), sampleEnd_(sampleEnd) {
+        QL_REQUIRE(cube_, "SampleRangeCube: underlying cube is null");
+        QL_REQUIRE(sampleStart_ < sampleEnd_ && sampleEnd_ <= cube_->samples(),
+                   "SampleRangeCube: invalid sample range [" << sampleStart_ << ", " << sampleEnd_
+                                                             << "), underlying cube has " << cube_->samples()
+                                                             << " samples");
+        t0Data_.resize(cube_->numIds() * cube_->depth(), 0.0);
+    }
+
+    Size numIds() const override { return cube_->numIds(); }
+    Size numDates() const override { return cube_->numDates(); }
+    Size samples() const override { return sampleEnd_ - sampleStart_; }
+    Size depth() const override { return cube_->depth(); }
+
+    const std::vector<std::string>& ids() const override { return cube_->ids(); }
+    const std::vector<QuantLib::Date>& dates() const override { return cube_->dates(); }
+    QuantLib::Date asof() const override { return cube_->asof(); }
+
+    Real getT0(Size id, Size depth = 0) const override {
+        checkT0(id, depth);
+        return t0Data_[id * cube_->depth() + depth];
+    }
+    void setT0(Real value, Size id, Size depth = 0) override {
+        checkT0(id, depth);
+        t0Data_[id * cube_->depth() + depth] = value;
+    }
+
+    Real get(Size id, Size date, Size sample, Size depth = 0) const override {
+        QL_REQUIRE(sample < samples(), "SampleRangeCube: sample " << sample << " out of range, samples=" << samples());
+        return cube_->get(id, date, sampleStart_ + sample, depth);
+    }
+    void set(Real value, Size id, Size date, Size sample, Size depth = 0) override {
+        QL_REQUIRE(sample < samples(), "SampleRangeCube: sample " << sample << " out of range, samples=" << samples());
+        cube_->set(value, id, date, sampleStart_ + sample, depth);
+    }
+
+    void load(const std::string&) override { QL_FAIL("SampleRangeCube::load() not supported"); }
+    void save(const std::string&) const override { QL_FAIL("SampleRangeCube::save() not supported"); }
+
+    //! First sample of the underlying cube covered by this view
+    Size sampleStart() const { return sampleStart_; }
+    //! Copy the T0 values held in this view to the underlying cube
+    void copyT0() const {
+        for (Size i = 0; i < cube_->numIds(); ++i)
+            for (Size d = 0; d < cube_->depth(); ++d)
+                cube_->setT0(t0Data_[i * cube_->depth() + d], i, d);
+    }
+
+private:
+    void checkT0(Size id, Size depth) const {
+        QL_REQUIRE(id < numIds(), "SampleRangeCube: out of bounds on ids (id=" << id << ", numIds=" << numIds() << ")");
+        QL_REQUIRE(depth < this->depth(),
+                   "SampleRangeCube: out of bounds on depth (d=" << depth << ", depth=" << this->depth() << ")");
+    }
+
+    boost::shared_ptr<NPVCube> cube_;
+    Size sampleStart_, sampleEnd_;
+    std::vector<Real> t0Data_;
+};
+
+} // namespace analytics
+} // namespace ore
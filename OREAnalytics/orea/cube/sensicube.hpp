@@ -34,6 +34,7 @@
 #include <boost/serialization/vector.hpp>
 #include <boost/math/special_functions/relative_difference.hpp>
 
+#include <algorithm>
 #include <fstream>
 #include <iostream>
 #include <vector>
@@ -43,11 +44,17 @@ namespace ore {
 namespace analytics {
 
 //! SensiCube stores only npvs not equal to the base npvs
+/*! For each trade the scenario indices and npvs of the scenarios that move the npv are stored in two arrays sorted
+    by scenario index. The valuation engine sets the scenarios of a trade in increasing order, so that a new npv is
+    appended to the arrays in this case. Setting a scenario out of order requires an insertion into the arrays.
+
+    The stored npvs of a trade can be iterated over without copying via forEachTradeNPV().
+*/
 template <typename T> class SensiCube : public NPVSensiCube {
 public:
     SensiCube(const std::vector<std::string>& ids, const QuantLib::Date& asof, QuantLib::Size samples, const T& t = T())
         : ids_(ids), asof_(asof), dates_(1, asof), samples_(samples), t0Data_(ids.size(), t),
-          tradeNPVs_(ids.size(), map<Size, T>()) {}
+          scenarioIdx_(ids.size()), npvs_(ids.size()), relevantScenarios_(samples, false) {}
 
     //! load cube from an archive
     void load(const std::string& fileName) override {
@@ -93,10 +100,10 @@ public:
     //! Get a value from the cube
     Real get(Size i, Size j, Size k, Size) const override {
         this->check(i, j, k);
-
-        auto itr = this->tradeNPVs_[i].find(k);
-        if (itr != tradeNPVs_[i].end()) {
-            return itr->second;
+        const std::vector<Size>& idx = scenarioIdx_[i];
+        auto it = std::lower_bound(idx.begin(), idx.end(), k);
+        if (it != idx.end() && *it == k) {
+            return npvs_[i][it - idx.begin()];
         } else {
             return this->t0Data_[i];
         }
@@ -106,15 +113,73 @@ public:
     void set(Real value, Size i, Size j, Size k, Size) override {
         this->check(i, j, k);
         T castValue = static_cast<T>(value);
-        if (boost::math::epsilon_difference<T>(castValue, t0Data_[i]) > 42) {
-            this->tradeNPVs_[i][k] = castValue;
-            relevantScenarios_.insert(k);
+        bool isRelevant = boost::math::epsilon_difference<T>(castValue, t0Data_[i]) > 42;
+        std::vector<Size>& idx = scenarioIdx_[i];
+        std::vector<T>& npvs = npvs_[i];
+        // fast path, scenarios set in increasing order
+        if (idx.empty() || k > idx.back()) {
+            if (isRelevant) {
+                idx.push_back(k);
+                npvs.push_back(castValue);
+                relevantScenarios_[k] = true;
+            }
+            return;
+        }
+        auto it = std::lower_bound(idx.begin(), idx.end(), k);
+        auto pos = it - idx.begin();
+        if (it != idx.end() && *it == k) {
+            if (isRelevant) {
+                npvs[pos] = castValue;
+            } else {
+                // the scenario does not move the npv anymore
+                idx.erase(it);
+                npvs.erase(npvs.begin() + pos);
+            }
+        } else if (isRelevant) {
+            idx.insert(it, k);
+            npvs.insert(npvs.begin() + pos, castValue);
+            relevantScenarios_[k] = true;
         }
     }
 
-    std::map<QuantLib::Size, QuantLib::Real> getTradeNPVs(QuantLib::Size i) const override { return tradeNPVs_[i]; }
+    std::map<QuantLib::Size, QuantLib::Real> getTradeNPVs(QuantLib::Size i) const override {
+        this->check(i, 0, 0);
+        std::map<QuantLib::Size, QuantLib::Real> result;
+        for (Size n = 0; n < scenarioIdx_[i].size(); ++n)
+            result.emplace_hint(result.end(), scenarioIdx_[i][n], npvs_[i][n]);
+        return result;
+    }
 
-    std::set<QuantLib::Size> relevantScenarios() const override { return relevantScenarios_; }
+    void forEachTradeNPV(QuantLib::Size i,
+                         const std::function<void(QuantLib::Size, QuantLib::Real)>& f) const override {
+        this->check(i, 0, 0);
+        const std::vector<Size>& idx = scenarioIdx_[i];
+        const std::vector<T>& npvs = npvs_[i];
+        for (Size n = 0; n < idx.size(); ++n)
+            f(idx[n], npvs[n]);
+    }
+
+    Real getNPVs(Size i, Size n, const Size* scenarioIdx, Real* npvs) const override {
+        QL_REQUIRE(i < numIds(), "Out of bounds on ids (i=" << i << ")");
+        const std::vector<Size>& idx = scenarioIdx_[i];
+        const std::vector<T>& values = npvs_[i];
+        Real base = t0Data_[i];
+        for (Size m = 0; m < n; ++m) {
+            QL_REQUIRE(scenarioIdx[m] < samples_, "Out of bounds on samples (k=" << scenarioIdx[m] << ")");
+            auto it = std::lower_bound(idx.begin(), idx.end(), scenarioIdx[m]);
+            npvs[m] = it != idx.end() && *it == scenarioIdx[m] ? values[it - idx.begin()] : base;
+        }
+        return base;
+    }
+
+    std::set<QuantLib::Size> relevantScenarios() const override {
+        std::set<QuantLib::Size> result;
+        for (Size k = 0; k < relevantScenarios_.size(); ++k) {
+            if (relevantScenarios_[k])
+                result.insert(result.end(), k);
+        }
+        return result;
+    }
 
 private:
     friend class boost::serialization::access;
@@ -123,7 +188,9 @@ private:
         ar& asof_;
         ar& samples_;
         ar& t0Data_;
-        ar& tradeNPVs_;
+        ar& scenarioIdx_;
+        ar& npvs_;
+        ar& relevantScenarios_;
     }
 
     std::vector<std::string> ids_;
@@ -133,8 +200,11 @@ private:
 
 protected:
     std::vector<T> t0Data_;
-    std::vector<std::map<QuantLib::Size, T>> tradeNPVs_;
-    std::set<QuantLib::Size> relevantScenarios_;
+    //! per trade the indices of the scenarios that move the npv in increasing order and the corresponding npvs
+    std::vector<std::vector<QuantLib::Size>> scenarioIdx_;
+    std::vector<std::vector<T>> npvs_;
+    //! flags the scenarios that move the npv of at least one trade
+    std::vector<bool> relevantScenarios_;
 
     void check(QuantLib::Size i, QuantLib::Size j, QuantLib::Size k) const {
         QL_REQUIRE(i < numIds(), "Out of bounds on ids (i=" << i << ")");
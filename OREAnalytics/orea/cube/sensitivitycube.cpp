@@ -203,11 +203,16 @@ Real SensitivityCube::npv(const string& tradeId, const ShiftScenarioDescription&
 }
 
 Real SensitivityCube::delta(Size id, Size scenarioIdx) const {
-    return cube_->get(id, scenarioIdx) - cube_->getT0(id, 0);
+    Real npv;
+    Real baseNpv = cube_->getNPVs(id, 1, &scenarioIdx, &npv);
+    return npv - baseNpv;
 }
 
 Real SensitivityCube::delta(Size id, Size upIdx, Size downIdx) const {
-    return (cube_->get(id, upIdx) - cube_->get(id, downIdx)) / 2.0;
+    Size idx[] = {upIdx, downIdx};
+    Real npvs[2];
+    cube_->getNPVs(id, 2, idx, npvs);
+    return (npvs[0] - npvs[1]) / 2.0;
 }
 
 Real SensitivityCube::delta(const string& tradeId, const RiskFactorKey& riskFactorKey) const {
@@ -223,11 +228,11 @@ Real SensitivityCube::delta(const string& tradeId, const RiskFactorKey& riskFact
 
 Real SensitivityCube::gamma(Size id, Size upScenarioIdx, Size downScenarioIdx) const {
 
-    Real baseNpv = cube_->getT0(id, 0);
-    Real upNpv = cube_->get(id, upScenarioIdx);
-    Real downNpv = cube_->get(id, downScenarioIdx);
+    Size idx[] = {upScenarioIdx, downScenarioIdx};
+    Real npvs[2];
+    Real baseNpv = cube_->getNPVs(id, 2, idx, npvs);
 
-    return upNpv - 2.0 * baseNpv + downNpv;
+    return npvs[0] - 2.0 * baseNpv + npvs[1];
 }
 
 Real SensitivityCube::gamma(const std::string& tradeId, const RiskFactorKey& riskFactorKey) const {
@@ -242,12 +247,11 @@ Real SensitivityCube::crossGamma(Size id, Size upIdx_1, Size upIdx_2, Size cross
     // Approximate f_{xy}|(x,y) by
     // ([f_{x}|(x,y + dy)] - [f_{x}|(x,y)]) / dy
     // ([f(x + dx,y + dy) - f(x, y + dy)] - [f(x + dx,y) - f(x,y)]) / (dx dy)
-    Real baseNpv = cube_->getT0(id, 0);
-    Real upNpv_1 = cube_->get(id, upIdx_1);
-    Real upNpv_2 = cube_->get(id, upIdx_2);
-    Real crossNpv = cube_->get(id, crossIdx);
+    Size idx[] = {upIdx_1, upIdx_2, crossIdx};
+    Real npvs[3];
+    Real baseNpv = cube_->getNPVs(id, 3, idx, npvs);
 
-    return crossNpv - upNpv_1 - upNpv_2 + baseNpv;
+    return npvs[2] - npvs[0] - npvs[1] + baseNpv;
 }
 
 std::set<RiskFactorKey> SensitivityCube::relevantRiskFactors() {
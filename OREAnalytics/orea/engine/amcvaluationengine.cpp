@@ -17,15 +17,24 @@
 */
 
 #include <orea/engine/amcvaluationengine.hpp>
+#include <orea/engine/observationmode.hpp>
 
 #include <qle/pricingengines/mcmultilegbaseengine.hpp>
+#include <qle/methods/batchedmultipathgenerator.hpp>
 #include <qle/methods/multipathvariategenerator.hpp>
 #include <qle/methods/multipathgeneratorbase.hpp>
 
 #include <ored/portfolio/optionwrapper.hpp>
 
+#include <ql/indexes/indexmanager.hpp>
+
 #include <boost/timer/timer.hpp>
 
+#include <atomic>
+#include <mutex>
+#include <set>
+#include <thread>
+
 using namespace ore::data;
 using namespace ore::analytics;
 
@@ -34,6 +43,19 @@ namespace analytics {
 
 namespace {
 
+// frees the random variable buffers cached on the calling thread on destruction, i.e. when the cube is built
+struct RandomVariableBufferPoolTrimmer {
+    ~RandomVariableBufferPoolTrimmer() { RandomVariableBufferPool::clear(); }
+};
+
+void addStatistics(RandomVariableBufferPool::Statistics& total, const RandomVariableBufferPool::Statistics& s) {
+    total.hits += s.hits;
+    total.misses += s.misses;
+    total.bytesInUse += s.bytesInUse;
+    total.peakBytesInUse += s.peakBytesInUse;
+    total.bytesCached += s.bytesCached;
+}
+
 Real fx(const std::vector<std::vector<std::vector<Real>>>& fxBuffer, const Size ccyIndex, const Size timeIndex,
         const Size sample) {
     if (ccyIndex == 0)
@@ -56,6 +78,13 @@ Real numRatio(const boost::shared_ptr<CrossAssetModel>& model,
     return model->numeraire(ccyIndex, time, state_curr) / model->numeraire(0, time, state_base);
 }
 
+Real numRatio(const std::vector<std::vector<std::vector<Real>>>& numRatioBuffer, const Size ccyIndex,
+              const Size timeIndex, const Size sample) {
+    if (ccyIndex == 0)
+        return 1.0;
+    return numRatioBuffer[ccyIndex][timeIndex][sample];
+}
+
 Real num(const boost::shared_ptr<CrossAssetModel>& model,
          const std::vector<std::vector<std::vector<Real>>>& irStateBuffer, const Size ccyIndex, const Size timeIndex,
          const Real time, const Size sample) {
@@ -92,9 +121,11 @@ AMCValuationEngine::AMCValuationEngine(const boost::shared_ptr<QuantExt::CrossAs
                                        const boost::shared_ptr<ScenarioGeneratorData>& sgd,
                                        const boost::shared_ptr<Market>& market,
                                        const std::vector<string>& aggDataIndices,
-                                       const std::vector<string>& aggDataCurrencies)
+                                       const std::vector<string>& aggDataCurrencies, const Size nThreads)
     : model_(model), sgd_(sgd), market_(market), aggDataIndices_(aggDataIndices),
-      aggDataCurrencies_(aggDataCurrencies) {
+      aggDataCurrencies_(aggDataCurrencies), nThreads_(nThreads) {
+
+    QL_REQUIRE(nThreads_ > 0, "AMCValuationEngine: nThreads must be > 0");
 
     QL_REQUIRE((aggDataIndices.empty() && aggDataCurrencies.empty()) || market != nullptr,
                "AMCValuationEngine: market is required for asd generation");
@@ -134,6 +165,9 @@ void AMCValuationEngine::buildCube(const boost::shared_ptr<Portfolio>& portfolio
 
     QL_REQUIRE(portfolio->size() > 0, "AMCValuationEngine::buildCube: empty portfolio");
 
+    // declared first, so that the buffers released by the locals below are freed as well
+    RandomVariableBufferPoolTrimmer bufferPoolTrimmer;
+
     QL_REQUIRE(outputCube->numIds() == portfolio->trades().size(),
                "cube x dimension (" << outputCube->numIds() << ") "
                                     << "different from portfolio size (" << portfolio->trades().size() << ")");
@@ -149,6 +183,7 @@ void AMCValuationEngine::buildCube(const boost::shared_ptr<Portfolio>& portfolio
 
     // timings
 
+    RandomVariableBufferPool::resetStatistics();
     boost::timer::cpu_timer timer, timerTotal;
     Real calibrationTime = 0.0, valuationTime = 0.0, asdTime = 0.0, pathGenTime = 0.0, residualTime, totalTime;
     timerTotal.start();
@@ -232,6 +267,15 @@ void AMCValuationEngine::buildCube(const boost::shared_ptr<Portfolio>& portfolio
     // run the simulation and populate the cube with NPVs, and write aggregation scenario data
 
     auto process = model_->stateProcess();
+    Size samples = outputCube->samples();
+
+    // check which interfaces are implemented by the amc calculators, the path storage below depends on that
+
+    bool hasInterface1 = false, hasInterface2 = false;
+    for (auto const& c : amcCalculators) {
+        hasInterface1 = hasInterface1 || boost::dynamic_pointer_cast<AmcCalculatorSinglePath>(c) != nullptr;
+        hasInterface2 = hasInterface2 || boost::dynamic_pointer_cast<AmcCalculatorMultiVariates>(c) != nullptr;
+    }
 
     /* set up buffers for fx rates and ir states that we need below for the runs against interface 1 and 2
        we set these buffers up on the full grid (i.e. valuation + close-out dates, also including the T0 date)
@@ -239,75 +283,172 @@ void AMCValuationEngine::buildCube(const boost::shared_ptr<Portfolio>& portfolio
 
     std::vector<std::vector<std::vector<Real>>> fxBuffer(
         model_->components(CrossAssetModel::AssetType::FX),
-        std::vector<std::vector<Real>>(sgd_->getGrid()->dates().size() + 1, std::vector<Real>(outputCube->samples())));
+        std::vector<std::vector<Real>>(sgd_->getGrid()->dates().size() + 1, std::vector<Real>(samples)));
     std::vector<std::vector<std::vector<Real>>> irStateBuffer(
         model_->components(CrossAssetModel::AssetType::IR),
-        std::vector<std::vector<Real>>(sgd_->getGrid()->dates().size() + 1, std::vector<Real>(outputCube->samples())));
+        std::vector<std::vector<Real>>(sgd_->getGrid()->dates().size() + 1, std::vector<Real>(samples)));
 
-    /* set up cache for paths, this is used in interface 2 below */
+    /* generate all samples in one batch, the state k at grid time j + 1 is stored in statePaths[j][k] holding the
+       values of all samples contiguously, these random variables serve as the paths for interface 2 below */
 
     Size nStates = process->size();
     QL_REQUIRE(sgd_->getGrid()->timeGrid().size() > 0, "AMCValuationEngine: empty time grid given");
     std::vector<Real> pathTimes(std::next(sgd_->getGrid()->timeGrid().begin(), 1), sgd_->getGrid()->timeGrid().end());
-    std::vector<std::vector<RandomVariable>> paths(
-        pathTimes.size(), std::vector<RandomVariable>(nStates, RandomVariable(outputCube->samples())));
-
-    // Run AmcCalculators implementing interface 1, write ASD and fill fxBuffer / irStateBuffer
+    Size gridSize = sgd_->getGrid()->timeGrid().size();
 
     // FIXME hardcoded ordering and directionIntegers here...
-    auto pathGenerator =
-        makeMultiPathGenerator(sgd_->sequenceType(), process, sgd_->getGrid()->timeGrid(), sgd_->seed());
-    LOG("Run simulation (amc calculators implementing interface 1, write ASD, fill internal fx and irState "
-        "buffers)...");
-    resetProgress();
-    for (Size i = 0; i < outputCube->samples(); ++i) {
-        timer.start();
-        const MultiPath& path = pathGenerator->next().value;
-        timer.stop();
-        pathGenTime += timer.elapsed().wall * 1e-9;
+    LOG("Generate paths...");
+    timer.start();
+    BatchedMultiPathGenerator pathGenerator(process, sgd_->getGrid()->timeGrid(), sgd_->sequenceType(), sgd_->seed());
+    std::vector<std::vector<RandomVariable>> statePaths;
+    pathGenerator.next(samples, statePaths);
+    timer.stop();
+    pathGenTime += timer.elapsed().wall * 1e-9;
+    LOG("Generated " << samples << " paths, batched evolution = " << std::boolalpha << pathGenerator.batched());
+
+    Array initialState = process->initialValues();
+    auto pathValue = [&initialState, &statePaths](const Size k, const Size j, const Size i) {
+        return j == 0 ? initialState[k] : statePaths[j - 1][k][i];
+    };
 
-        // populate fx and ir state buffers, populate cached paths for interface 2
+    // populate fx and ir state buffers
+
+    for (Size k = 0; k < fxBuffer.size(); ++k) {
+        Size idx = model_->pIdx(CrossAssetModel::AssetType::FX, k);
+        for (Size j = 0; j < gridSize; ++j) {
+            for (Size i = 0; i < samples; ++i)
+                fxBuffer[k][j][i] = std::exp(pathValue(idx, j, i));
+        }
+    }
+    for (Size k = 0; k < irStateBuffer.size(); ++k) {
+        Size idx = model_->pIdx(CrossAssetModel::AssetType::IR, k);
+        for (Size j = 0; j < gridSize; ++j) {
+            for (Size i = 0; i < samples; ++i)
+                irStateBuffer[k][j][i] = pathValue(idx, j, i);
+        }
+    }
 
-        for (Size k = 0; k < fxBuffer.size(); ++k) {
-            for (Size j = 0; j < sgd_->getGrid()->timeGrid().size(); ++j) {
-                fxBuffer[k][j][i] = std::exp(path[model_->pIdx(CrossAssetModel::AssetType::FX, k)][j]);
+    /* set up cache for paths used in interface 1 below, the states of one sample are stored contiguously, i.e. the
+       value of state k at time index j on sample i is found at index (i * nStates + k) * gridSize + j */
+
+    std::vector<Real> pathBuffer;
+    if (hasInterface1) {
+        pathBuffer.resize(samples * nStates * gridSize);
+        for (Size i = 0; i < samples; ++i) {
+            for (Size k = 0; k < nStates; ++k) {
+                Real* p = &pathBuffer[(i * nStates + k) * gridSize];
+                for (Size j = 0; j < gridSize; ++j)
+                    p[j] = pathValue(k, j, i);
             }
         }
-        for (Size k = 0; k < irStateBuffer.size(); ++k) {
-            for (Size j = 0; j < sgd_->getGrid()->timeGrid().size(); ++j) {
-                irStateBuffer[k][j][i] = path[model_->pIdx(CrossAssetModel::AssetType::IR, k)][j];
+    }
+
+    // the paths for interface 2 adopt the generated buffers
+
+    std::vector<std::vector<RandomVariable>> paths;
+    if (hasInterface2)
+        paths = std::move(statePaths);
+    else
+        statePaths.clear();
+
+    // write aggregation scenario data, TODO this seems relatively slow, can we speed it up using LgmVectorised etc.?
+
+    if (asd_ != nullptr) {
+        LOG("Write aggregation scenario data...");
+        resetProgress();
+        timer.start();
+        Size numeraireHandle = asd_->add(AggregationScenarioDataType::Numeraire);
+        std::vector<Size> fxHandle, indexHandle;
+        for (auto const& c : asdCurrencyCode)
+            fxHandle.push_back(asd_->add(AggregationScenarioDataType::FXSpot, c));
+        for (auto const& n : asdIndexName)
+            indexHandle.push_back(asd_->add(AggregationScenarioDataType::IndexFixing, n));
+        for (Size i = 0; i < samples; ++i) {
+            Size dateIndex = 0;
+            for (Size k = 1; k < gridSize; ++k) {
+                // only write asd on valuation dates
+                if (!sgd_->getGrid()->isValuationDate()[k - 1])
+                    continue;
+                // set numeraire
+                asd_->set(dateIndex, i,
+                          model_->numeraire(0, sgd_->getGrid()->timeGrid()[k], state(irStateBuffer, 0, k, i)),
+                          numeraireHandle);
+                // set fx spots
+                for (Size j = 0; j < asdCurrencyIndex.size(); ++j) {
+                    asd_->set(dateIndex, i, fx(fxBuffer, asdCurrencyIndex[j], k, i), fxHandle[j]);
+                }
+                // set index fixings
+                Date d = sgd_->getGrid()->dates()[k - 1];
+                for (Size j = 0; j < asdIndex.size(); ++j) {
+                    asdIndexCurve[j]->move(d, state(irStateBuffer, asdIndexIndex[j], k, i));
+                    asd_->set(dateIndex, i, asdIndex[j]->fixing(d), indexHandle[j]);
+                }
+                ++dateIndex;
             }
+            updateProgress(i + 1, samples);
         }
+        timer.stop();
+        asdTime += timer.elapsed().wall * 1e-9;
+    }
 
-        // TODO we do not need this if there are no amc calculators implementing interface 2
-        for (Size k = 0; k < nStates; ++k) {
-            for (Size j = 0; j < pathTimes.size(); ++j) {
-                paths[j][k].set(i, path[k][j]);
+    /* precompute the numeraire ratios (valuation dates) and the numeraires (close-out dates) for the npv currencies
+       of the amc calculators, so that the valuation below does not call into the model and can run on several
+       threads */
+
+    timer.start();
+    std::vector<std::vector<std::vector<Real>>> numRatioBuffer(irStateBuffer.size()), numBuffer(irStateBuffer.size());
+    for (auto const c : std::set<Size>(currencyIndex.begin(), currencyIndex.end())) {
+        if (c > 0) {
+            numRatioBuffer[c] = std::vector<std::vector<Real>>(gridSize, std::vector<Real>(samples));
+            for (Size k = 0; k < gridSize; ++k) {
+                Real t = sgd_->getGrid()->timeGrid()[k];
+                for (Size i = 0; i < samples; ++i)
+                    numRatioBuffer[c][k][i] = numRatio(model_, irStateBuffer, c, k, t, i);
+            }
+        }
+        if (sgd_->withCloseOutLag()) {
+            // in sticky date mpor mode the close-out npvs are inflated with the numeraire at the valuation time
+            numBuffer[c] = std::vector<std::vector<Real>>(gridSize, std::vector<Real>(samples));
+            for (Size k = 1; k < gridSize; ++k) {
+                Real t = sgd_->getGrid()->timeGrid()[sgd_->withMporStickyDate() ? k - 1 : k];
+                for (Size i = 0; i < samples; ++i)
+                    numBuffer[c][k][i] = num(model_, irStateBuffer, c, k, t, i);
             }
         }
+    }
+    timer.stop();
+    valuationTime += timer.elapsed().wall * 1e-9;
 
-        // amc valuation and output to cube
+    // set up vectors indicating valuation times, close-out times and all times
 
-        timer.start();
-        for (Size j = 0; j < amcCalculators.size(); ++j) {
-            auto amcCalc = boost::dynamic_pointer_cast<AmcCalculatorSinglePath>(amcCalculators[j]);
-            if (amcCalc == nullptr)
-                continue;
+    std::vector<bool> allTimes(pathTimes.size(), true);
+    std::vector<bool> valuationTimes(pathTimes.size()), closeOutTimes(pathTimes.size());
+    for (Size i = 0; i < pathTimes.size(); ++i) {
+        valuationTimes[i] = sgd_->getGrid()->isValuationDate()[i];
+        closeOutTimes[i] = sgd_->getGrid()->isCloseOutDate()[i];
+    }
+
+    // run an amc calculator implementing interface 1 on all samples and populate its cube row
 
+    auto runInterface1 = [&](const boost::shared_ptr<AmcCalculatorSinglePath>& amcCalc, const Size j,
+                             MultiPath& path) {
+        for (Size i = 0; i < samples; ++i) {
+            for (Size k = 0; k < nStates; ++k) {
+                const Real* p = &pathBuffer[(i * nStates + k) * gridSize];
+                for (Size l = 0; l < gridSize; ++l)
+                    path[k][l] = p[l];
+            }
             if (!sgd_->withCloseOutLag()) {
                 // no close-out lag, fill depth 0 of cube with npvs on path
                 Array res = simulatePathInterface1(amcCalc, path, false, tradeLabel[j], i);
                 outputCube->setT0(res[0] * fx(fxBuffer, currencyIndex[j], 0, 0) *
-                                      numRatio(model_, irStateBuffer, currencyIndex[j], 0, 0.0, 0) *
-                                      effectiveMultiplier[j],
+                                      numRatio(numRatioBuffer, currencyIndex[j], 0, 0) * effectiveMultiplier[j],
                                   tradeId[j], 0);
                 int dateIndex = -1;
                 for (Size k = 1; k < res.size(); ++k) {
                     ++dateIndex;
-                    Real t = sgd_->getGrid()->timeGrid()[k];
                     outputCube->set(res[k] * fx(fxBuffer, currencyIndex[j], k, i) *
-                                        numRatio(model_, irStateBuffer, currencyIndex[j], k, t, i) *
-                                        effectiveMultiplier[j],
+                                        numRatio(numRatioBuffer, currencyIndex[j], k, i) * effectiveMultiplier[j],
                                     tradeId[j], dateIndex, i, 0);
                 }
             } else {
@@ -319,24 +460,20 @@ void AMCValuationEngine::buildCube(const boost::shared_ptr<Portfolio>& portfolio
                     Array resCout =
                         simulatePathInterface1(amcCalc, effectiveSimulationPath(path, true), true, tradeLabel[j], i);
                     outputCube->setT0(res[0] * fx(fxBuffer, currencyIndex[j], 0, 0) *
-                                          numRatio(model_, irStateBuffer, currencyIndex[j], 0, 0.0, 0) *
-                                          effectiveMultiplier[j],
+                                          numRatio(numRatioBuffer, currencyIndex[j], 0, 0) * effectiveMultiplier[j],
                                       tradeId[j], 0);
                     int dateIndex = -1;
                     for (Size k = 0; k < sgd_->getGrid()->dates().size(); ++k) {
-                        Real t = sgd_->getGrid()->timeGrid()[k + 1];
-                        Real tm = sgd_->getGrid()->timeGrid()[k];
                         if (sgd_->getGrid()->isCloseOutDate()[k]) {
                             QL_REQUIRE(dateIndex >= 0, "first date in grid must be a valuation date");
                             outputCube->set(resCout[dateIndex + 1] * fx(fxBuffer, currencyIndex[j], k + 1, i) *
-                                                num(model_, irStateBuffer, currencyIndex[j], k + 1, tm, i) *
-                                                effectiveMultiplier[j],
+                                                numBuffer[currencyIndex[j]][k + 1][i] * effectiveMultiplier[j],
                                             tradeId[j], dateIndex, i, 1);
                         }
                         if (sgd_->getGrid()->isValuationDate()[k]) {
                             dateIndex++;
                             outputCube->set(res[dateIndex + 1] * fx(fxBuffer, currencyIndex[j], k + 1, i) *
-                                                numRatio(model_, irStateBuffer, currencyIndex[j], k + 1, t, i) *
+                                                numRatio(numRatioBuffer, currencyIndex[j], k + 1, i) *
                                                 effectiveMultiplier[j],
                                             tradeId[j], dateIndex, i, 0);
                         }
@@ -345,23 +482,20 @@ void AMCValuationEngine::buildCube(const boost::shared_ptr<Portfolio>& portfolio
                     // actual date mport mode: simulate all times in one go
                     Array res = simulatePathInterface1(amcCalc, path, false, tradeLabel[j], i);
                     outputCube->setT0(res[0] * fx(fxBuffer, currencyIndex[j], 0, 0) *
-                                          numRatio(model_, irStateBuffer, currencyIndex[j], 0, 0.0, 0) *
-                                          effectiveMultiplier[j],
+                                          numRatio(numRatioBuffer, currencyIndex[j], 0, 0) * effectiveMultiplier[j],
                                       tradeId[j], 0);
                     int dateIndex = -1;
                     for (Size k = 1; k < res.size(); ++k) {
-                        Real t = sgd_->getGrid()->timeGrid()[k];
                         if (sgd_->getGrid()->isCloseOutDate()[k - 1]) {
                             QL_REQUIRE(dateIndex >= 0, "first date in grid must be a valuation date");
                             outputCube->set(res[k] * fx(fxBuffer, currencyIndex[j], k, i) *
-                                                num(model_, irStateBuffer, currencyIndex[j], k, t, i) *
-                                                effectiveMultiplier[j],
+                                                numBuffer[currencyIndex[j]][k][i] * effectiveMultiplier[j],
                                             tradeId[j], dateIndex, i, 1);
                         }
                         if (sgd_->getGrid()->isValuationDate()[k - 1]) {
                             dateIndex++;
                             outputCube->set(res[k] * fx(fxBuffer, currencyIndex[j], k, i) *
-                                                numRatio(model_, irStateBuffer, currencyIndex[j], k, t, i) *
+                                                numRatio(numRatioBuffer, currencyIndex[j], k, i) *
                                                 effectiveMultiplier[j],
                                             tradeId[j], dateIndex, i, 0);
                         }
@@ -369,75 +503,21 @@ void AMCValuationEngine::buildCube(const boost::shared_ptr<Portfolio>& portfolio
                 }
             }
         }
-        timer.stop();
-        valuationTime += timer.elapsed().wall * 1e-9;
-
-        // write aggregation scenario data, TODO this seems relatively slow, can we speed it up using LgmVectorised
-        // etc.?
-
-        if (asd_ != nullptr) {
-            timer.start();
-            Size dateIndex = 0;
-            for (Size k = 1; k < sgd_->getGrid()->timeGrid().size(); ++k) {
-                // only write asd on valuation dates
-                if (!sgd_->getGrid()->isValuationDate()[k - 1])
-                    continue;
-                // set numeraire
-                asd_->set(dateIndex, i, model_->numeraire(0, path[0].time(k), path[0][k]),
-                          AggregationScenarioDataType::Numeraire);
-                // set fx spots
-                for (Size j = 0; j < asdCurrencyIndex.size(); ++j) {
-                    asd_->set(dateIndex, i, fx(fxBuffer, asdCurrencyIndex[j], k, i),
-                              AggregationScenarioDataType::FXSpot, asdCurrencyCode[j]);
-                }
-                // set index fixings
-                Date d = sgd_->getGrid()->dates()[k - 1];
-                for (Size j = 0; j < asdIndex.size(); ++j) {
-                    asdIndexCurve[j]->move(d, state(irStateBuffer, asdIndexIndex[j], k, i));
-                    asd_->set(dateIndex, i, asdIndex[j]->fixing(d), AggregationScenarioDataType::IndexFixing,
-                              asdIndexName[j]);
-                }
-                ++dateIndex;
-            }
-            timer.stop();
-            asdTime += timer.elapsed().wall * 1e-9;
-        }
-        updateProgress(i + 1, outputCube->samples());
-    }
-
-    // Run AmcCalculators implementing interface 2
-
-    LOG("Run simulation (amc calculators implementing interface 2)...");
-    resetProgress();
+    };
 
-    // set up vectors indicating valuation times, close-out times and all times
+    // run an amc calculator implementing interface 2 and populate its cube row
 
-    std::vector<bool> allTimes(pathTimes.size(), true);
-    std::vector<bool> valuationTimes(pathTimes.size()), closeOutTimes(pathTimes.size());
-    for (Size i = 0; i < pathTimes.size(); ++i) {
-        valuationTimes[i] = sgd_->getGrid()->isValuationDate()[i];
-        closeOutTimes[i] = sgd_->getGrid()->isCloseOutDate()[i];
-    }
-
-    // loop over amc calculators, get result and populate cube
-
-    timer.start();
-    for (Size j = 0; j < amcCalculators.size(); ++j) {
-        auto amcCalc = boost::dynamic_pointer_cast<AmcCalculatorMultiVariates>(amcCalculators[j]);
-        if (amcCalc == nullptr)
-            continue;
+    auto runInterface2 = [&](const boost::shared_ptr<AmcCalculatorMultiVariates>& amcCalc, const Size j) {
         if (!sgd_->withCloseOutLag()) {
             // no close-out lag, fill depth 0 with npv on path
             auto res = simulatePathInterface2(amcCalc, pathTimes, paths, allTimes, false, tradeLabel[j]);
             outputCube->setT0(res[0].at(0) * fx(fxBuffer, currencyIndex[j], 0, 0) *
-                                  numRatio(model_, irStateBuffer, currencyIndex[j], 0, 0.0, 0) * effectiveMultiplier[j],
+                                  numRatio(numRatioBuffer, currencyIndex[j], 0, 0) * effectiveMultiplier[j],
                               tradeId[j], 0);
             for (Size k = 1; k < res.size(); ++k) {
-                Real t = sgd_->getGrid()->timeGrid()[k];
-                for (Size i = 0; i < outputCube->samples(); ++i) {
+                for (Size i = 0; i < samples; ++i) {
                     outputCube->set(res[k][i] * fx(fxBuffer, currencyIndex[j], k, i) *
-                                        numRatio(model_, irStateBuffer, currencyIndex[j], k, t, i) *
-                                        effectiveMultiplier[j],
+                                        numRatio(numRatioBuffer, currencyIndex[j], k, i) * effectiveMultiplier[j],
                                     tradeId[j], k - 1, i, 0);
                 }
             }
@@ -449,27 +529,23 @@ void AMCValuationEngine::buildCube(const boost::shared_ptr<Portfolio>& portfolio
                 // ... and then the close-out times, but times moved to the valuation times
                 auto resLag = simulatePathInterface2(amcCalc, pathTimes, paths, closeOutTimes, true, tradeLabel[j]);
                 outputCube->setT0(res[0].at(0) * fx(fxBuffer, currencyIndex[j], 0, 0) *
-                                      numRatio(model_, irStateBuffer, currencyIndex[j], 0, 0.0, 0) *
-                                      effectiveMultiplier[j],
+                                      numRatio(numRatioBuffer, currencyIndex[j], 0, 0) * effectiveMultiplier[j],
                                   tradeId[j], 0);
                 int dateIndex = -1;
                 for (Size k = 0; k < sgd_->getGrid()->dates().size(); ++k) {
-                    Real t = sgd_->getGrid()->timeGrid()[k + 1];
-                    Real tm = sgd_->getGrid()->timeGrid()[k];
                     if (sgd_->getGrid()->isCloseOutDate()[k]) {
                         QL_REQUIRE(dateIndex >= 0, "first date in grid must be a valuation date");
-                        for (Size i = 0; i < outputCube->samples(); ++i) {
+                        for (Size i = 0; i < samples; ++i) {
                             outputCube->set(resLag[dateIndex + 1][i] * fx(fxBuffer, currencyIndex[j], k + 1, i) *
-                                                num(model_, irStateBuffer, currencyIndex[j], k + 1, tm, i) *
-                                                effectiveMultiplier[j],
+                                                numBuffer[currencyIndex[j]][k + 1][i] * effectiveMultiplier[j],
                                             tradeId[j], dateIndex, i, 1);
                         }
                     }
                     if (sgd_->getGrid()->isValuationDate()[k]) {
                         ++dateIndex;
-                        for (Size i = 0; i < outputCube->samples(); ++i) {
+                        for (Size i = 0; i < samples; ++i) {
                             outputCube->set(res[dateIndex + 1][i] * fx(fxBuffer, currencyIndex[j], k + 1, i) *
-                                                numRatio(model_, irStateBuffer, currencyIndex[j], k + 1, t, i) *
+                                                numRatio(numRatioBuffer, currencyIndex[j], k + 1, i) *
                                                 effectiveMultiplier[j],
                                             tradeId[j], dateIndex, i, 0);
                         }
@@ -479,26 +555,23 @@ void AMCValuationEngine::buildCube(const boost::shared_ptr<Portfolio>& portfolio
                 // actual date mpor mode: simulate all times in one go
                 auto res = simulatePathInterface2(amcCalc, pathTimes, paths, allTimes, false, tradeLabel[j]);
                 outputCube->setT0(res[0].at(0) * fx(fxBuffer, currencyIndex[j], 0, 0) *
-                                      numRatio(model_, irStateBuffer, currencyIndex[j], 0, 0.0, 0) *
-                                      effectiveMultiplier[j],
+                                      numRatio(numRatioBuffer, currencyIndex[j], 0, 0) * effectiveMultiplier[j],
                                   tradeId[j], 0);
                 int dateIndex = -1;
                 for (Size k = 1; k < res.size(); ++k) {
-                    Real t = sgd_->getGrid()->timeGrid()[k];
                     if (sgd_->getGrid()->isCloseOutDate()[k - 1]) {
                         QL_REQUIRE(dateIndex >= 0, "first date in grid must be a valuation date");
-                        for (Size i = 0; i < outputCube->samples(); ++i) {
+                        for (Size i = 0; i < samples; ++i) {
                             outputCube->set(res[k][i] * fx(fxBuffer, currencyIndex[j], k, i) *
-                                                num(model_, irStateBuffer, currencyIndex[j], k, t, i) *
-                                                effectiveMultiplier[j],
+                                                numBuffer[currencyIndex[j]][k][i] * effectiveMultiplier[j],
                                             tradeId[j], dateIndex, i, 1);
                         }
                     }
                     if (sgd_->getGrid()->isValuationDate()[k - 1]) {
                         ++dateIndex;
-                        for (Size i = 0; i < outputCube->samples(); ++i) {
+                        for (Size i = 0; i < samples; ++i) {
                             outputCube->set(res[k][i] * fx(fxBuffer, currencyIndex[j], k, i) *
-                                                numRatio(model_, irStateBuffer, currencyIndex[j], k, t, i) *
+                                                numRatio(numRatioBuffer, currencyIndex[j], k, i) *
                                                 effectiveMultiplier[j],
                                             tradeId[j], dateIndex, i, 0);
                         }
@@ -506,11 +579,95 @@ void AMCValuationEngine::buildCube(const boost::shared_ptr<Portfolio>& portfolio
                 }
             }
         }
-        updateProgress(j + 1, amcCalculators.size());
+    };
+
+    /* Run the amc calculators. The calculators are independent of each other and each of them writes to its own row
+       of the cube only, so we distribute them over the worker threads. Each worker picks the next calculator not yet
+       processed, until all calculators are done. */
+
+    Size nThreads = std::max<Size>(std::min(nThreads_, amcCalculators.size()), 1);
+    LOG("Run simulation (" << amcCalculators.size() << " amc calculators on " << nThreads << " threads)...");
+    resetProgress();
+
+    std::atomic<Size> nextCalculator(0);
+    Size calculatorsDone = 0;
+    std::mutex progressMutex;
+    std::vector<std::exception_ptr> exceptions(nThreads);
+    std::vector<RandomVariableBufferPool::Statistics> workerPoolStats(nThreads);
+#ifdef QL_ENABLE_SESSIONS
+    // session dependent singletons are thread local, take a copy of the state of the calling thread
+    Date today = Settings::instance().evaluationDate();
+    bool includeReferenceDateEvents = Settings::instance().includeReferenceDateEvents();
+    boost::optional<bool> includeTodaysCashFlows = Settings::instance().includeTodaysCashFlows();
+    bool enforcesTodaysHistoricFixings = Settings::instance().enforcesTodaysHistoricFixings();
+    ObservationMode::Mode om = ObservationMode::instance().mode();
+    std::vector<std::pair<std::string, TimeSeries<Real>>> fixings;
+    if (nThreads > 1) {
+        for (auto const& name : IndexManager::instance().histories())
+            fixings.push_back(std::make_pair(name, IndexManager::instance().getHistory(name)));
+    }
+#endif
+
+    auto worker = [&](const Size t) {
+        try {
+#ifdef QL_ENABLE_SESSIONS
+            // initialise the session dependent singletons of the worker threads from the calling thread
+            if (nThreads > 1) {
+                Settings::instance().evaluationDate() = today;
+                Settings::instance().includeReferenceDateEvents() = includeReferenceDateEvents;
+                Settings::instance().includeTodaysCashFlows() = includeTodaysCashFlows;
+                Settings::instance().enforcesTodaysHistoricFixings() = enforcesTodaysHistoricFixings;
+                ObservationMode::instance().setMode(om);
+                for (auto const& f : fixings)
+                    IndexManager::instance().setHistory(f.first, f.second);
+            }
+#endif
+            // path used by the interface 1 calculators, populated from the path cache for each sample
+            MultiPath path(nStates, sgd_->getGrid()->timeGrid());
+            Size j;
+            while ((j = nextCalculator++) < amcCalculators.size()) {
+                if (auto amcCalc1 = boost::dynamic_pointer_cast<AmcCalculatorSinglePath>(amcCalculators[j]))
+                    runInterface1(amcCalc1, j, path);
+                else if (auto amcCalc2 = boost::dynamic_pointer_cast<AmcCalculatorMultiVariates>(amcCalculators[j]))
+                    runInterface2(amcCalc2, j);
+                std::lock_guard<std::mutex> lock(progressMutex);
+                updateProgress(++calculatorsDone, amcCalculators.size());
+            }
+        } catch (...) {
+            exceptions[t] = std::current_exception();
+        }
+        // collect the buffer pool statistics of the worker thread and free its cached buffers before it exits
+        if (nThreads > 1) {
+            workerPoolStats[t] = RandomVariableBufferPool::statistics();
+            RandomVariableBufferPool::clear();
+        }
+    };
+
+    timer.start();
+    if (nThreads == 1) {
+        worker(0);
+    } else {
+        std::vector<std::thread> threads;
+        for (Size t = 0; t < nThreads; ++t)
+            threads.emplace_back(worker, t);
+        for (auto& th : threads)
+            th.join();
     }
     timer.stop();
     valuationTime += timer.elapsed().wall * 1e-9;
 
+    for (Size t = 0; t < nThreads; ++t) {
+        if (exceptions[t]) {
+            try {
+                std::rethrow_exception(exceptions[t]);
+            } catch (const std::exception& e) {
+                QL_FAIL("AMCValuationEngine: worker " << t << " failed: " << e.what());
+            } catch (...) {
+                QL_FAIL("AMCValuationEngine: worker " << t << " failed: unknown error");
+            }
+        }
+    }
+
     totalTime = timerTotal.elapsed().wall * 1e-9;
     residualTime = totalTime - (calibrationTime + pathGenTime + valuationTime + asdTime);
     LOG("calibration time     : " << calibrationTime << " sec");
@@ -519,6 +676,22 @@ void AMCValuationEngine::buildCube(const boost::shared_ptr<Portfolio>& portfolio
     LOG("asd time             : " << asdTime << " sec");
     LOG("residual time        : " << residualTime << " sec");
     LOG("total time           : " << totalTime << " sec");
+    auto poolStats = RandomVariableBufferPool::statistics();
+    if (nThreads > 1) {
+        DLOG("random variable buffer pool (calling thread): " << poolStats.hits << " hits, " << poolStats.misses
+                                                              << " misses, peak " << poolStats.peakBytesInUse
+                                                              << " bytes in use");
+        for (Size t = 0; t < nThreads; ++t) {
+            DLOG("random variable buffer pool (worker " << t << "): " << workerPoolStats[t].hits << " hits, "
+                                                        << workerPoolStats[t].misses << " misses, peak "
+                                                        << workerPoolStats[t].peakBytesInUse << " bytes in use");
+            addStatistics(poolStats, workerPoolStats[t]);
+        }
+    }
+    LOG("random variable buffer pool (all threads): " << poolStats.hits << " hits, " << poolStats.misses
+                                                      << " misses, peak " << poolStats.peakBytesInUse
+                                                      << " bytes in use (sum over threads), " << poolStats.bytesCached
+                                                      << " bytes cached");
     LOG("AMCValuationEngine finished");
 }
 
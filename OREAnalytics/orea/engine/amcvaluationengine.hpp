@@ -36,13 +36,17 @@ namespace analytics {
 using std::string;
 
 //! AMC Valuation Engine
+/*! The paths are generated once up front. The AMC calculators are then run on nThreads threads, each calculator
+    writes to its own row of the output cube, so the cube must support concurrent set() calls for distinct ids (which
+    is the case for all in-memory cube implementations). Calculators implementing interface 2 share the path buffer
+    and must not modify it. */
 class AMCValuationEngine : public ore::data::ProgressReporter {
 public:
     //! Constructor
     AMCValuationEngine(const boost::shared_ptr<QuantExt::CrossAssetModel>& model,
                        const boost::shared_ptr<ore::analytics::ScenarioGeneratorData>& sgd,
                        const boost::shared_ptr<ore::data::Market>& market, const std::vector<string>& aggDataIndices,
-                       const std::vector<string>& aggDataCurrencies);
+                       const std::vector<string>& aggDataCurrencies, const Size nThreads = 1);
     //! Build NPV cube
     void buildCube(
         //! Portfolio to be priced
@@ -65,6 +69,7 @@ private:
     const boost::shared_ptr<ore::analytics::ScenarioGeneratorData> sgd_;
     const boost::shared_ptr<ore::data::Market> market_;
     const std::vector<string> aggDataIndices_, aggDataCurrencies_;
+    const Size nThreads_;
 
     boost::shared_ptr<ore::analytics::AggregationScenarioData> asd_;
 };
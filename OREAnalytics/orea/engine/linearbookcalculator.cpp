@@ -0,0 +1,358 @@
+/*
+ Copyright (C) 2023 Quaternion Risk Management Ltd
+ All rights reserved.
+
+ This file is part of ORE, a free-software/open-source library
+ for transparent pricing and risk analysis - http://opensourcerisk.org
+
+ ORE is free software: you can redistribute it and/or modify it
+ under the terms of the Modified BSD License.  You should have received a
+ copy of the license along with this program.
+ The license is also available online at <http://opensourcerisk.org>
+
+ This program is distributed on the basis that it will form a useful
+ contribution to risk analytics and model standardisation, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ FITNESS FOR A PARTICULAR PURPOSE. See the license for more details.
+*/
+
+#include <orea/engine/linearbookcalculator.hpp>
+#include <ored/portfolio/instrumentwrapper.hpp>
+#include <ored/utilities/log.hpp>
+
+#include <qle/cashflows/overnightindexedcoupon.hpp>
+
+#include <ql/cashflows/fixedratecoupon.hpp>
+#include <ql/cashflows/iborcoupon.hpp>
+#include <ql/cashflows/simplecashflow.hpp>
+#include <ql/instruments/swap.hpp>
+#include <ql/settings.hpp>
+#include <ql/utilities/null.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <typeinfo>
+
+namespace ore {
+namespace analytics {
+
+using namespace QuantLib;
+
+namespace {
+
+// cashflows that can be compiled, the pricers of the coupons are replicated in compiledNpv()
+bool isCompilable(const boost::shared_ptr<CashFlow>& cf) {
+    if (boost::dynamic_pointer_cast<SimpleCashFlow>(cf))
+        return true;
+    auto cpn = boost::dynamic_pointer_cast<Coupon>(cf);
+    if (!cpn || cpn->exCouponDate() != Date())
+        return false;
+    if (typeid(*cpn) == typeid(FixedRateCoupon))
+        return true;
+    if (typeid(*cpn) == typeid(IborCoupon)) {
+        auto ibor = boost::static_pointer_cast<IborCoupon>(cpn);
+        return !ibor->isInArrears() && !ibor->iborIndex()->forwardingTermStructure().empty();
+    }
+    if (typeid(*cpn) == typeid(QuantExt::OvernightIndexedCoupon)) {
+        auto on = boost::static_pointer_cast<QuantExt::OvernightIndexedCoupon>(cpn);
+        return !on->includeSpread() && on->rateCutoff() == 0 && on->valueDates().size() > 1 &&
+               !on->overnightIndex()->forwardingTermStructure().empty();
+    }
+    return false;
+}
+
+} // namespace
+
+void LinearBookNPVCalculator::init(const boost::shared_ptr<Portfolio>& portfolio,
+                                   const boost::shared_ptr<SimMarket>& simMarket) {
+    NPVCalculator::init(portfolio, simMarket);
+    DLOG("init LinearBookNPVCalculator");
+
+    Size n = portfolio->size();
+    tradeState_.assign(n, TradeState::None);
+    compiledIndex_.assign(n, Null<Size>());
+    tradeBegin_.assign(1, 0);
+    tradeCurves_.clear();
+
+    flowType_.clear();
+    flowPayDate_.clear();
+    flowFixingDate_.clear();
+    flowWeight_.clear();
+    flowAmount_.clear();
+    flowGearing_.clear();
+    flowSpread_.clear();
+    flowTau_.clear();
+    flowDiscountCurve_.clear();
+    flowForwardCurve_.clear();
+    flowStartDate_.clear();
+    flowEndDate_.clear();
+    flowCashflow_.clear();
+    curves_.clear();
+    curveDates_.clear();
+
+    for (Size i = 0; i < n; ++i) {
+        auto const& trade = portfolio->trades()[i];
+        try {
+            if (compile(trade, simMarket)) {
+                tradeState_[i] = TradeState::Unchecked;
+                compiledIndex_[i] = tradeCurves_.size() - 1;
+            }
+        } catch (const std::exception& e) {
+            DLOG("LinearBookNPVCalculator: trade " << trade->id() << " is not compiled: " << e.what());
+        }
+    }
+
+    buildPoints();
+
+    LOG("LinearBookNPVCalculator: compiled " << tradeCurves_.size() << " out of " << n << " trades into "
+                                             << flowType_.size() << " cashflows on " << curves_.size()
+                                             << " curves with " << pointDate_.size() << " dates");
+}
+
+void LinearBookNPVCalculator::initScenario() {
+    NPVCalculator::initScenario();
+    today_ = Settings::instance().evaluationDate();
+    includeReferenceDateEvents_ = Settings::instance().includeReferenceDateEvents();
+    std::fill(curveUpToDate_.begin(), curveUpToDate_.end(), false);
+}
+
+Real LinearBookNPVCalculator::npv(Size tradeIndex, const boost::shared_ptr<Trade>& trade,
+                                  const boost::shared_ptr<SimMarket>& simMarket) {
+    TradeState state = tradeState_[tradeIndex];
+    if (state == TradeState::None)
+        return NPVCalculator::npv(tradeIndex, trade, simMarket);
+
+    Real npv;
+    if (state == TradeState::Compiled) {
+        npv = compiledNpv(compiledIndex_[tradeIndex]);
+    } else {
+        // first valuation, compare the compiled NPV to the instrument NPV
+        npv = trade->instrument()->NPV();
+        Real compiled = Null<Real>(), gross = 0.0;
+        try {
+            compiled = compiledNpv(compiledIndex_[tradeIndex], &gross);
+        } catch (const std::exception& e) {
+            DLOG("LinearBookNPVCalculator: compiled valuation of trade " << trade->id() << " failed: " << e.what());
+        }
+        if (compiled != Null<Real>() && std::fabs(compiled - npv) <= std::max(1.0E-10 * gross, 1.0E-8)) {
+            tradeState_[tradeIndex] = TradeState::Compiled;
+        } else {
+            DLOG("LinearBookNPVCalculator: compiled NPV of trade " << trade->id() << " (" << compiled
+                                                                   << ") does not match instrument NPV (" << npv
+                                                                   << "), trade is priced by the instrument");
+            tradeState_[tradeIndex] = TradeState::None;
+        }
+    }
+
+    if (close_enough(npv, 0.0))
+        return npv;
+    Real fx = fxRates_[tradeCcyIndex_[tradeIndex]];
+    Real numeraire = simMarket->numeraire();
+    return npv * fx / numeraire;
+}
+
+Size LinearBookNPVCalculator::compiledTrades() const {
+    return std::count_if(tradeState_.begin(), tradeState_.end(),
+                         [](const TradeState s) { return s != TradeState::None; });
+}
+
+bool LinearBookNPVCalculator::compile(const boost::shared_ptr<Trade>& trade,
+                                      const boost::shared_ptr<SimMarket>& simMarket) {
+    auto wrapper = boost::dynamic_pointer_cast<ore::data::VanillaInstrument>(trade->instrument());
+    if (!wrapper || !wrapper->additionalInstruments().empty() ||
+        !boost::dynamic_pointer_cast<QuantLib::Swap>(wrapper->qlInstrument()))
+        return false;
+    for (auto const& ccy : trade->legCurrencies()) {
+        if (ccy != trade->npvCurrency())
+            return false;
+    }
+    for (auto const& leg : trade->legs()) {
+        for (auto const& cf : leg) {
+            if (!isCompilable(cf))
+                return false;
+        }
+    }
+    Handle<YieldTermStructure> discountCurve = simMarket->discountCurve(trade->npvCurrency());
+    if (discountCurve.empty())
+        return false;
+
+    std::set<Size> tradeCurves;
+    Size discountId = curveId(discountCurve);
+    tradeCurves.insert(discountId);
+
+    for (Size l = 0; l < trade->legs().size(); ++l) {
+        Real weight = (trade->legPayers()[l] ? -1.0 : 1.0) * wrapper->multiplier();
+        for (auto const& cf : trade->legs()[l]) {
+            FlowType type = FlowType::Fixed;
+            Real amount = 0.0, gearing = 0.0, spread = 0.0, tau = 0.0;
+            Size forwardId = Null<Size>();
+            Date fixingDate, startDate, endDate;
+            if (auto ibor = boost::dynamic_pointer_cast<IborCoupon>(cf)) {
+                // the index estimation period as in IborCoupon, see also AnalyticLgmSwaptionEngine
+                auto index = ibor->iborIndex();
+                type = FlowType::Ibor;
+                fixingDate = ibor->fixingDate();
+                startDate = index->fixingCalendar().advance(fixingDate, index->fixingDays(), Days);
+                if (IborCoupon::Settings::instance().usingAtParCoupons()) {
+                    Date nextFixingDate = index->fixingCalendar().advance(
+                        ibor->accrualEndDate(), -static_cast<Integer>(ibor->fixingDays()), Days);
+                    endDate = index->fixingCalendar().advance(nextFixingDate, index->fixingDays(), Days);
+                    endDate = std::max(endDate, startDate + 1);
+                } else {
+                    endDate = index->maturityDate(startDate);
+                }
+                tau = index->dayCounter().yearFraction(startDate, endDate);
+                amount = ibor->nominal() * ibor->accrualPeriod();
+                gearing = ibor->gearing();
+                spread = ibor->spread();
+                forwardId = curveId(index->forwardingTermStructure());
+            } else if (auto on = boost::dynamic_pointer_cast<QuantExt::OvernightIndexedCoupon>(cf)) {
+                // the compounded rate is estimated from the discount factors at the first and last value date
+                type = FlowType::Overnight;
+                fixingDate = on->fixingDates().front();
+                startDate = on->valueDates().front();
+                endDate = on->valueDates().back();
+                tau = on->dayCounter().yearFraction(startDate, endDate);
+                amount = on->nominal() * on->accrualPeriod();
+                gearing = on->gearing();
+                spread = on->spread();
+                forwardId = curveId(on->overnightIndex()->forwardingTermStructure());
+            } else {
+                amount = cf->amount();
+            }
+            if (forwardId != Null<Size>()) {
+                curveDates_[forwardId].insert(startDate);
+                curveDates_[forwardId].insert(endDate);
+                tradeCurves.insert(forwardId);
+            }
+            curveDates_[discountId].insert(cf->date());
+
+            flowType_.push_back(type);
+            flowPayDate_.push_back(cf->date());
+            flowFixingDate_.push_back(fixingDate);
+            flowWeight_.push_back(weight);
+            flowAmount_.push_back(amount);
+            flowGearing_.push_back(gearing);
+            flowSpread_.push_back(spread);
+            flowTau_.push_back(tau);
+            flowDiscountCurve_.push_back(discountId);
+            flowForwardCurve_.push_back(forwardId);
+            flowStartDate_.push_back(startDate);
+            flowEndDate_.push_back(endDate);
+            flowCashflow_.push_back(cf);
+        }
+    }
+
+    tradeBegin_.push_back(flowType_.size());
+    tradeCurves_.push_back(std::vector<Size>(tradeCurves.begin(), tradeCurves.end()));
+    return true;
+}
+
+Size LinearBookNPVCalculator::curveId(const Handle<YieldTermStructure>& curve) {
+    for (Size k = 0; k < curves_.size(); ++k) {
+        if (curves_[k].currentLink() == curve.currentLink())
+            return k;
+    }
+    curves_.push_back(curve);
+    curveDates_.push_back(std::set<Date>());
+    return curves_.size() - 1;
+}
+
+void LinearBookNPVCalculator::buildPoints() {
+    curveBegin_.assign(1, 0);
+    pointDate_.clear();
+    for (auto const& dates : curveDates_) {
+        pointDate_.insert(pointDate_.end(), dates.begin(), dates.end());
+        curveBegin_.push_back(pointDate_.size());
+    }
+    pointDiscount_.assign(pointDate_.size(), Null<Real>());
+    curveReferenceDate_.assign(curves_.size(), Date());
+    curveUpToDate_.assign(curves_.size(), false);
+
+    // the discount factors of these curves are read with one call per scenario
+    batchedCurves_.clear();
+    for (auto const& c : curves_)
+        batchedCurves_.push_back(boost::dynamic_pointer_cast<QuantExt::InterpolatedDiscountCurve>(c.currentLink()));
+    batchedPositions_.assign(curves_.size(), {});
+
+    auto point = [this](const Size curve, const Date& d) {
+        auto begin = pointDate_.begin() + curveBegin_[curve], end = pointDate_.begin() + curveBegin_[curve + 1];
+        return static_cast<Size>(std::lower_bound(begin, end, d) - pointDate_.begin());
+    };
+
+    Size n = flowType_.size();
+    flowDiscountPoint_.resize(n);
+    flowStartPoint_.assign(n, Null<Size>());
+    flowEndPoint_.assign(n, Null<Size>());
+    for (Size f = 0; f < n; ++f) {
+        flowDiscountPoint_[f] = point(flowDiscountCurve_[f], flowPayDate_[f]);
+        if (flowForwardCurve_[f] != Null<Size>()) {
+            flowStartPoint_[f] = point(flowForwardCurve_[f], flowStartDate_[f]);
+            flowEndPoint_[f] = point(flowForwardCurve_[f], flowEndDate_[f]);
+        }
+    }
+}
+
+void LinearBookNPVCalculator::updateCurve(Size curve) {
+    const Handle<YieldTermStructure>& ts = curves_[curve];
+    Date referenceDate = ts->referenceDate();
+    Size first = std::lower_bound(pointDate_.begin() + curveBegin_[curve], pointDate_.begin() + curveBegin_[curve + 1],
+                                  referenceDate) -
+                 pointDate_.begin();
+    Size last = curveBegin_[curve + 1];
+    std::fill(pointDiscount_.begin() + curveBegin_[curve], pointDiscount_.begin() + first, Null<Real>());
+    if (batchedCurves_[curve]) {
+        // the point times only depend on the reference date, which is the same in each sample, so the
+        // interpolation pillars and weights are computed once per curve and reference date
+        auto pos = batchedPositions_[curve].find(referenceDate);
+        if (pos == batchedPositions_[curve].end()) {
+            pointTimes_.resize(last - first);
+            for (Size p = first; p < last; ++p)
+                pointTimes_[p - first] = ts->timeFromReference(pointDate_[p]);
+            pos = batchedPositions_[curve].emplace(referenceDate, batchedCurves_[curve]->positions(pointTimes_)).first;
+        }
+        batchedCurves_[curve]->discounts(pos->second, pointDiscount_.data() + first);
+    } else {
+        for (Size p = first; p < last; ++p)
+            pointDiscount_[p] = ts->discount(pointDate_[p]);
+    }
+    curveReferenceDate_[curve] = referenceDate;
+    curveUpToDate_[curve] = true;
+}
+
+Real LinearBookNPVCalculator::compiledNpv(Size compiledIndex, Real* gross) {
+    for (Size k : tradeCurves_[compiledIndex]) {
+        if (!curveUpToDate_[k])
+            updateCurve(k);
+    }
+    Real npv = 0.0;
+    for (Size f = tradeBegin_[compiledIndex]; f < tradeBegin_[compiledIndex + 1]; ++f) {
+        // flows before the reference date of the discount curve are skipped as in the DiscountingSwapEngine
+        const Date& referenceDate = curveReferenceDate_[flowDiscountCurve_[f]];
+        if (flowPayDate_[f] < referenceDate ||
+            (flowPayDate_[f] == referenceDate &&
+             flowCashflow_[f]->hasOccurred(referenceDate, includeReferenceDateEvents_)))
+            continue;
+        Real amount;
+        if (flowType_[f] == FlowType::Fixed) {
+            amount = flowAmount_[f];
+        } else {
+            Real start = pointDiscount_[flowStartPoint_[f]], end = pointDiscount_[flowEndPoint_[f]];
+            if (flowFixingDate_[f] > today_ && start != Null<Real>() && end != Null<Real>()) {
+                Real fixing = (start / end - 1.0) / flowTau_[f];
+                amount = flowAmount_[f] * (flowGearing_[f] * fixing + flowSpread_[f]);
+            } else {
+                // (partly) fixed coupon
+                amount = flowCashflow_[f]->amount();
+            }
+        }
+        Real pv = flowWeight_[f] * amount * pointDiscount_[flowDiscountPoint_[f]];
+        npv += pv;
+        if (gross)
+            *gross += std::fabs(pv);
+    }
+    return npv;
+}
+
+} // namespace analytics
+} // namespace ore
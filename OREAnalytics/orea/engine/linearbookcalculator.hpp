@@ -0,0 +1,118 @@
+/*
+ Copyright (C) 2023 Quaternion Risk Management Ltd
+ All rights reserved.
+
+ This file is part of ORE, a free-software/open-source library
+ for transparent pricing and risk analysis - http://opensourcerisk.org
+
+ ORE is free software: you can redistribute it and/or modify it
+ under the terms of the Modified BSD License.  You should have received a
+ copy of the license along with this program.
+ The license is also available online at <http://opensourcerisk.org>
+
+ This program is distributed on the basis that it will form a useful
+ contribution to risk analytics and model standardisation, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ FITNESS FOR A PARTICULAR PURPOSE. See the license for more details.
+*/
+
+/*! \file engine/linearbookcalculator.hpp
+    \brief NPV calculator pricing linear trades from compiled cashflow tables
+    \ingroup simulation
+*/
+
+#pragma once
+
+#include <orea/engine/valuationcalculator.hpp>
+
+#include <qle/termstructures/interpolateddiscountcurve.hpp>
+
+#include <ql/cashflow.hpp>
+#include <ql/handle.hpp>
+#include <ql/termstructures/yieldtermstructure.hpp>
+
+#include <map>
+#include <set>
+
+namespace ore {
+namespace analytics {
+
+//! LinearBookNPVCalculator
+/*! An NPVCalculator that prices single currency swaps with fixed, Ibor and compounded overnight coupons without going
+    through the QuantLib instrument and pricing engine.
+
+    In init() the cashflows of all eligible trades are flattened into a table with one column per cashflow property
+    (payment date, amount or nominal times accrual, gearing, spread, index estimation period). All payment and index
+    estimation dates are collected in one sorted list of dates per curve, so that the discount factors needed by the
+    whole book are read once per scenario and curve. The trade NPV is then a sum over the trade's rows of the table.
+
+    The first NPV of each compiled trade (usually the T0 NPV) is taken from the instrument and compared to the compiled
+    NPV. Trades for which the two differ, for example because the pricing engine does not discount on the
+    currency's discount curve of the simulation market, are priced by the instrument from then on. Coupons with a
+    fixing on or before the evaluation date are valued via their amount() in all cases.
+
+    \ingroup simulation
+*/
+class LinearBookNPVCalculator : public NPVCalculator {
+public:
+    //! base ccy and index to write to
+    LinearBookNPVCalculator(const std::string& baseCcyCode, Size index = 0) : NPVCalculator(baseCcyCode, index) {}
+
+    Real npv(Size tradeIndex, const boost::shared_ptr<Trade>& trade,
+             const boost::shared_ptr<SimMarket>& simMarket) override;
+
+    void init(const boost::shared_ptr<Portfolio>& portfolio, const boost::shared_ptr<SimMarket>& simMarket) override;
+    void initScenario() override;
+
+    //! Number of trades priced from the compiled cashflow tables
+    Size compiledTrades() const;
+
+private:
+    enum class FlowType : unsigned char { Fixed, Ibor, Overnight };
+    enum class TradeState : unsigned char { None, Unchecked, Compiled };
+
+    // compile the legs of a trade, returns false if the trade is not eligible
+    bool compile(const boost::shared_ptr<Trade>& trade, const boost::shared_ptr<SimMarket>& simMarket);
+    // the id of a curve, the curve is added if it is not known yet
+    Size curveId(const Handle<YieldTermStructure>& curve);
+    // resolve the curve dates to point indices after all trades are compiled
+    void buildPoints();
+    // read the discount factors of a curve for the current scenario
+    void updateCurve(Size curve);
+    // the NPV of a compiled trade in trade currency, optionally adds the sum of the absolute flow PVs to gross
+    Real compiledNpv(Size compiledIndex, Real* gross = nullptr);
+
+    std::vector<TradeState> tradeState_;
+    std::vector<Size> compiledIndex_;
+
+    // rows [tradeBegin_[c], tradeBegin_[c + 1]) belong to the compiled trade c
+    std::vector<Size> tradeBegin_;
+    std::vector<std::vector<Size>> tradeCurves_;
+
+    // cashflow table, the index estimation dates are only used for Ibor and overnight coupons
+    std::vector<FlowType> flowType_;
+    std::vector<Date> flowPayDate_, flowFixingDate_;
+    std::vector<Real> flowWeight_, flowAmount_, flowGearing_, flowSpread_, flowTau_;
+    std::vector<Size> flowDiscountCurve_, flowForwardCurve_;
+    std::vector<Date> flowStartDate_, flowEndDate_;
+    std::vector<Size> flowDiscountPoint_, flowStartPoint_, flowEndPoint_;
+    std::vector<boost::shared_ptr<QuantLib::CashFlow>> flowCashflow_;
+
+    // curves and their dates, the points of curve k are [curveBegin_[k], curveBegin_[k + 1])
+    std::vector<Handle<YieldTermStructure>> curves_;
+    std::vector<std::set<Date>> curveDates_;
+    std::vector<Size> curveBegin_;
+    std::vector<Date> pointDate_;
+    std::vector<Real> pointDiscount_;
+    std::vector<Date> curveReferenceDate_;
+    std::vector<bool> curveUpToDate_;
+    std::vector<boost::shared_ptr<QuantExt::InterpolatedDiscountCurve>> batchedCurves_;
+    std::vector<std::map<Date, QuantExt::InterpolatedDiscountCurve::Positions>> batchedPositions_;
+    std::vector<Time> pointTimes_;
+
+    Date today_;
+    bool includeReferenceDateEvents_ = false;
+};
+
+} // namespace analytics
+} // namespace ore
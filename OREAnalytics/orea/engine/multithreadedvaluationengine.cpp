@@ -0,0 +1,175 @@
+/*
+ Copyright (C) 2023 Quaternion Risk Management Ltd
+ All rights reserved.
+
+ This file is part of ORE, a free-software/open-source library
+ for transparent pricing and risk analysis - http://opensourcerisk.org
+
+ ORE is free software: you can redistribute it and/or modify it
+ under the terms of the Modified BSD License.  You should have received a
+ copy of the license along with this program.
+ The license is also available online at <http://opensourcerisk.org>
+
+ This program is distributed on the basis that it will form a useful
+ contribution to risk analytics and model standardisation, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ FITNESS FOR A PARTICULAR PURPOSE. See the license for more details.
+*/
+
+#include <orea/cube/cubemerge.hpp>
+#include <orea/cube/samplerangecube.hpp>
+#include <orea/engine/multithreadedvaluationengine.hpp>
+#include <orea/engine/observationmode.hpp>
+#include <orea/engine/valuationengine.hpp>
+#include <orea/scenario/scenariogenerator.hpp>
+#include <ored/utilities/log.hpp>
+
+#include <ql/settings.hpp>
+
+#include <boost/timer/timer.hpp>
+
+#include <algorithm>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+using namespace QuantLib;
+using namespace ore::data;
+
+namespace ore {
+namespace analytics {
+
+MultiThreadedValuationEngine::MultiThreadedValuationEngine(const Size nThreads, const Date& today,
+                                                           const boost::shared_ptr<DateGrid>& dg,
+                                                           const WorkerContextBuilder& workerContextBuilder)
+    : nThreads_(nThreads), today_(today), dg_(dg), workerContextBuilder_(workerContextBuilder) {
+    QL_REQUIRE(nThreads_ > 0, "MultiThreadedValuationEngine: nThreads must be > 0");
+    QL_REQUIRE(workerContextBuilder_, "MultiThreadedValuationEngine: no worker context builder given");
+#ifndef QL_ENABLE_SESSIONS
+    QL_REQUIRE(nThreads_ == 1, "MultiThreadedValuationEngine: nThreads = "
+                                   << nThreads_ << " requires a build with QL_ENABLE_SESSIONS = ON");
+#endif
+}
+
+void MultiThreadedValuationEngine::buildCube(const boost::shared_ptr<NPVCube>& outputCube, bool mporStickyDate,
+                                             const boost::shared_ptr<NPVCube>& outputCubeNettingSet,
+                                             const boost::shared_ptr<NPVCube>& outputCptyCube,
+                                             const boost::shared_ptr<AggregationScenarioData>& scenarioData) {
+
+    boost::timer::cpu_timer timer;
+
+    // split the samples into contiguous ranges, the first (samples % nThreads) ranges get one extra sample
+
+    Size samples = outputCube->samples();
+    Size nThreads = std::min(nThreads_, samples);
+    std::vector<Size> sampleStart(nThreads + 1, 0);
+    for (Size t = 0; t < nThreads; ++t)
+        sampleStart[t + 1] = sampleStart[t] + samples / nThreads + (t < samples % nThreads ? 1 : 0);
+
+    LOG("MultiThreadedValuationEngine: build cube for " << samples << " samples on " << nThreads << " threads");
+
+    ObservationMode::Mode om = ObservationMode::instance().mode();
+
+    std::vector<boost::shared_ptr<SampleRangeCube>> cubes(nThreads), nettingSetCubes(nThreads), cptyCubes(nThreads);
+    std::vector<boost::shared_ptr<AggregationScenarioData>> workerScenarioData(nThreads);
+    std::vector<std::set<std::string>> erroneousTrades(nThreads);
+    std::vector<std::exception_ptr> exceptions(nThreads);
+    std::vector<unsigned long> progress(nThreads, 0);
+    std::mutex progressMutex;
+
+    auto worker = [&](const Size t) {
+        try {
+            // session dependent singletons are thread local, initialise them for this thread
+            Settings::instance().evaluationDate() = today_;
+            ObservationMode::instance().setMode(om);
+
+            WorkerContext context = workerContextBuilder_();
+            QL_REQUIRE(context.simMarket, "worker " << t << ": no sim market built");
+            QL_REQUIRE(context.portfolio, "worker " << t << ": no portfolio built");
+            QL_REQUIRE(context.portfolio->ids() == outputCube->ids(),
+                       "worker " << t << ": portfolio trade ids (" << context.portfolio->size()
+                                 << ") do not match output cube ids (" << outputCube->numIds() << ")");
+
+            Size n = sampleStart[t + 1] - sampleStart[t];
+            cubes[t] = boost::make_shared<SampleRangeCube>(outputCube, sampleStart[t], sampleStart[t + 1]);
+            if (outputCubeNettingSet)
+                nettingSetCubes[t] =
+                    boost::make_shared<SampleRangeCube>(outputCubeNettingSet, sampleStart[t], sampleStart[t + 1]);
+            if (outputCptyCube)
+                cptyCubes[t] = boost::make_shared<SampleRangeCube>(outputCptyCube, sampleStart[t], sampleStart[t + 1]);
+            if (scenarioData) {
+                workerScenarioData[t] =
+                    boost::make_shared<InMemoryAggregationScenarioData>(scenarioData->dimDates(), n);
+                context.simMarket->aggregationScenarioData() = workerScenarioData[t];
+            }
+
+            skipScenarioPaths(context.simMarket->scenarioGenerator(), dg_->dates(), sampleStart[t]);
+
+            ValuationEngine engine(today_, dg_, context.simMarket, context.modelBuilders);
+            engine.registerProgressIndicator(
+                boost::make_shared<WorkerProgressIndicator>(this, progressMutex, progress, samples, t));
+            engine.buildCube(context.portfolio, cubes[t], context.calculators, mporStickyDate, nettingSetCubes[t],
+                             cptyCubes[t], context.cptyCalculators);
+            erroneousTrades[t] = engine.erroneousTrades();
+        } catch (...) {
+            exceptions[t] = std::current_exception();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (Size t = 0; t < nThreads; ++t)
+        threads.emplace_back(worker, t);
+    for (auto& th : threads)
+        th.join();
+
+    for (Size t = 0; t < nThreads; ++t) {
+        if (exceptions[t]) {
+            try {
+                std::rethrow_exception(exceptions[t]);
+            } catch (const std::exception& e) {
+                QL_FAIL("MultiThreadedValuationEngine: worker " << t << " failed: " << e.what());
+            }
+        }
+    }
+
+    // T0 values are identical for all workers, take them from the first one
+
+    cubes.front()->copyT0();
+    if (outputCubeNettingSet)
+        nettingSetCubes.front()->copyT0();
+    if (outputCptyCube)
+        cptyCubes.front()->copyT0();
+
+    // copy the aggregation scenario data in sample order
+
+    if (scenarioData)
+        mergeAggregationScenarioData(workerScenarioData, scenarioData);
+
+    // a trade with an error on any worker is set to zero on all samples, as in the single threaded run
+
+    erroneousTrades_.clear();
+    for (auto const& e : erroneousTrades)
+        erroneousTrades_.insert(e.begin(), e.end());
+    for (auto const& tradeId : erroneousTrades_) {
+        auto it = std::find(outputCube->ids().begin(), outputCube->ids().end(), tradeId);
+        QL_REQUIRE(it != outputCube->ids().end(), "MultiThreadedValuationEngine: unknown trade id " << tradeId);
+        Size i = std::distance(outputCube->ids().begin(), it);
+        ALOG("setting all results in output cube to zero for trade '"
+             << tradeId << "' since there was at least one error during simulation");
+        for (Size index = 0; index < outputCube->depth(); ++index) {
+            outputCube->setT0(0.0, i, index);
+            for (Size dateIndex = 0; dateIndex < outputCube->numDates(); ++dateIndex) {
+                for (Size sample = 0; sample < outputCube->samples(); ++sample) {
+                    outputCube->set(0.0, i, dateIndex, sample, index);
+                }
+            }
+        }
+    }
+
+    updateProgress(samples, samples);
+    timer.stop();
+    LOG("MultiThreadedValuationEngine completed in " << timer.format(2, "%w") << " sec");
+}
+
+} // namespace analytics
+} // namespace ore
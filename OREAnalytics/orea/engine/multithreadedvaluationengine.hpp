@@ -0,0 +1,106 @@
+/*
+ Copyright (C) 2023 Quaternion Risk Management Ltd
+ All rights reserved.
+
+ This file is part of ORE, a free-software/open-source library
+ for transparent pricing and risk analysis - http://opensourcerisk.org
+
+ ORE is free software: you can redistribute it and/or modify it
+ under the terms of the Modified BSD License.  You should have received a
+ copy of the license along with this program.
+ The license is also available online at <http://opensourcerisk.org>
+
+ This program is distributed on the basis that it will form a useful
+ contribution to risk analytics and model standardisation, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ FITNESS FOR A PARTICULAR PURPOSE. See the license for more details.
+*/
+
+/*! \file engine/multithreadedvaluationengine.hpp
+    \brief The cube valuation core, parallelised over samples
+    \ingroup simulation
+*/
+
+#pragma once
+
+#include <orea/cube/npvcube.hpp>
+#include <orea/engine/cptycalculator.hpp>
+#include <orea/engine/valuationcalculator.hpp>
+#include <orea/scenario/aggregationscenariodata.hpp>
+#include <orea/scenario/scenariosimmarket.hpp>
+#include <ored/model/modelbuilder.hpp>
+#include <ored/portfolio/portfolio.hpp>
+#include <ored/utilities/dategrid.hpp>
+#include <ored/utilities/progressbar.hpp>
+
+#include <functional>
+#include <set>
+
+namespace ore {
+namespace analytics {
+
+//! Multi-threaded Valuation Engine
+/*! The engine splits the samples of the output cube into nThreads contiguous ranges and runs a
+    ValuationEngine for each range on a separate thread.
+
+    QuantLib's session dependent singletons (evaluation date, index fixings, observation mode etc.) have to be
+    thread local for this to work, i.e. nThreads > 1 requires a build with QL_ENABLE_SESSIONS. The session id
+    required by such a build is defined in QuantExt (qle/utilities/sessionid.cpp) and identifies a session with a
+    thread. Each worker therefore builds its own market, simulation market, scenario generator and portfolio on its
+    own thread via the WorkerContextBuilder. The scenario generator of worker i is advanced to the first sample of its range
+    before the valuation starts, so that the resulting cube is identical to the one produced by a single
+    ValuationEngine with the same seed.
+
+    The workers write into disjoint sample ranges of the shared output cubes. Aggregation scenario data is
+    collected per worker and copied to the shared instance after all workers have finished.
+
+    \ingroup simulation
+*/
+class MultiThreadedValuationEngine : public ore::data::ProgressReporter {
+public:
+    //! Everything a single worker needs to run a ValuationEngine, built on the worker thread
+    struct WorkerContext {
+        boost::shared_ptr<ScenarioSimMarket> simMarket;
+        boost::shared_ptr<ore::data::Portfolio> portfolio;
+        std::set<std::pair<std::string, boost::shared_ptr<ore::data::ModelBuilder>>> modelBuilders;
+        std::vector<boost::shared_ptr<ValuationCalculator>> calculators;
+        std::vector<boost::shared_ptr<CounterpartyCalculator>> cptyCalculators;
+    };
+    using WorkerContextBuilder = std::function<WorkerContext()>;
+
+    MultiThreadedValuationEngine(
+        //! Number of worker threads
+        const Size nThreads,
+        //! Valuation date
+        const QuantLib::Date& today,
+        //! Simulation date grid
+        const boost::shared_ptr<ore::data::DateGrid>& dg,
+        //! Builds the worker context, called once on each worker thread
+        const WorkerContextBuilder& workerContextBuilder);
+
+    //! Build NPV cube
+    void buildCube(
+        //! Object for storing the results at trade level, the ids must match the worker portfolios
+        const boost::shared_ptr<analytics::NPVCube>& outputCube,
+        //! Use sticky date in MPOR evaluation?
+        bool mporStickyDate = true,
+        //! Output cube for netting set-level results
+        const boost::shared_ptr<analytics::NPVCube>& outputCubeNettingSet = nullptr,
+        //! Output cube for storing counterparty-level survival probabilities
+        const boost::shared_ptr<analytics::NPVCube>& outputCptyCube = nullptr,
+        //! Aggregation scenario data to be filled
+        const boost::shared_ptr<AggregationScenarioData>& scenarioData = nullptr);
+
+    //! Ids of the trades with an error on any worker in the last buildCube() call, their results are set to zero
+    const std::set<std::string>& erroneousTrades() const { return erroneousTrades_; }
+
+private:
+    Size nThreads_;
+    QuantLib::Date today_;
+    boost::shared_ptr<ore::data::DateGrid> dg_;
+    WorkerContextBuilder workerContextBuilder_;
+    std::set<std::string> erroneousTrades_;
+};
+
+} // namespace analytics
+} // namespace ore
@@ -16,8 +16,10 @@
  FITNESS FOR A PARTICULAR PURPOSE. See the license for more details.
 */
 
+#include <orea/cube/cubemerge.hpp>
 #include <orea/cube/cubewriter.hpp>
 #include <orea/cube/sensicube.hpp>
+#include <orea/engine/observationmode.hpp>
 #include <orea/engine/sensitivityanalysis.hpp>
 #include <orea/engine/valuationengine.hpp>
 #include <orea/scenario/clonescenariofactory.hpp>
@@ -45,6 +47,10 @@
 #include <qle/pricingengines/depositengine.hpp>
 #include <qle/pricingengines/discountingfxforwardengine.hpp>
 
+#include <exception>
+#include <mutex>
+#include <thread>
+
 using namespace QuantLib;
 using namespace QuantExt;
 using namespace std;
@@ -71,7 +77,21 @@ SensitivityAnalysis::SensitivityAnalysis(
       nonShiftedBaseCurrencyConversion_(nonShiftedBaseCurrencyConversion), extraEngineBuilders_(extraEngineBuilders),
       extraLegBuilders_(extraLegBuilders), referenceData_(referenceData), iborFallbackConfig_(iborFallbackConfig),
       continueOnError_(continueOnError), engineData_(engineData), portfolio_(portfolio),
-      analyticFxSensis_(analyticFxSensis), dryRun_(dryRun), initialized_(false), computed_(false) {}
+      analyticFxSensis_(analyticFxSensis), dryRun_(dryRun), initialized_(false), computed_(false), nThreads_(1) {}
+
+void SensitivityAnalysis::setParallel(const Size nThreads, const MarketBuilder& marketBuilder,
+                                      const PortfolioLoader& portfolioLoader) {
+    QL_REQUIRE(nThreads > 0, "SensitivityAnalysis::setParallel(): nThreads must be > 0");
+#ifndef QL_ENABLE_SESSIONS
+    QL_REQUIRE(nThreads == 1, "SensitivityAnalysis::setParallel(): nThreads = "
+                                  << nThreads << " requires a build with QL_ENABLE_SESSIONS = ON");
+#endif
+    QL_REQUIRE(nThreads == 1 || (marketBuilder && portfolioLoader),
+               "SensitivityAnalysis::setParallel(): market builder and portfolio loader required for nThreads > 1");
+    nThreads_ = nThreads;
+    marketBuilder_ = marketBuilder;
+    portfolioLoader_ = portfolioLoader;
+}
 
 std::vector<boost::shared_ptr<ValuationCalculator>> SensitivityAnalysis::buildValuationCalculators() const {
     vector<boost::shared_ptr<ValuationCalculator>> calculators;
@@ -113,13 +133,18 @@ void SensitivityAnalysis::generateSensitivities(boost::shared_ptr<NPVSensiCube>
     // initialize the helper member objects
     initialize(cube);
     QL_REQUIRE(initialized_, "SensitivitiesAnalysis member objects not correctly initialized");
-    boost::shared_ptr<DateGrid> dg = boost::make_shared<DateGrid>("1,0W", NullCalendar());
-    vector<boost::shared_ptr<ValuationCalculator>> calculators = buildValuationCalculators();
-    ValuationEngine engine(asof_, dg, simMarket_, modelBuilders_);
-    for (auto const& i : this->progressIndicators())
-        engine.registerProgressIndicator(i);
-    LOG("Run Sensitivity Scenarios");
-    engine.buildCube(portfolio_, cube, calculators, true, nullptr, nullptr, {}, dryRun_);
+    // a dry run only prices the base scenario, this is done sequentially
+    if (nThreads_ > 1 && !dryRun_) {
+        generateSensitivitiesParallel(cube);
+    } else {
+        boost::shared_ptr<DateGrid> dg = boost::make_shared<DateGrid>("1,0W", NullCalendar());
+        vector<boost::shared_ptr<ValuationCalculator>> calculators = buildValuationCalculators();
+        ValuationEngine engine(asof_, dg, simMarket_, modelBuilders_);
+        for (auto const& i : this->progressIndicators())
+            engine.registerProgressIndicator(i);
+        LOG("Run Sensitivity Scenarios");
+        engine.buildCube(portfolio_, cube, calculators, true, nullptr, nullptr, {}, dryRun_);
+    }
 
     addAnalyticFxSensitivities();
 
@@ -128,6 +153,101 @@ void SensitivityAnalysis::generateSensitivities(boost::shared_ptr<NPVSensiCube>
     LOG("Sensitivity analysis completed");
 }
 
+void SensitivityAnalysis::generateSensitivitiesParallel(const boost::shared_ptr<NPVSensiCube>& cube) {
+
+    // split the scenarios into contiguous ranges, the first (samples % nThreads) ranges get one extra scenario
+
+    Size samples = cube->samples();
+    Size nThreads = std::min(nThreads_, samples);
+    std::vector<Size> sampleStart(nThreads + 1, 0);
+    for (Size t = 0; t < nThreads; ++t)
+        sampleStart[t + 1] = sampleStart[t] + samples / nThreads + (t < samples % nThreads ? 1 : 0);
+
+    LOG("Run " << samples << " Sensitivity Scenarios on " << nThreads << " threads");
+
+    boost::shared_ptr<DateGrid> dg = boost::make_shared<DateGrid>("1,0W", NullCalendar());
+    ObservationMode::Mode om = ObservationMode::instance().mode();
+
+    std::vector<boost::shared_ptr<NPVSensiCube>> cubes(nThreads);
+    std::vector<std::set<std::string>> erroneousTrades(nThreads);
+    std::vector<std::exception_ptr> exceptions(nThreads);
+    std::vector<unsigned long> progress(nThreads, 0);
+    std::mutex progressMutex;
+
+    auto worker = [&](const Size t) {
+        try {
+            // session dependent singletons are thread local, initialise them for this thread
+            Settings::instance().evaluationDate() = asof_;
+            ObservationMode::instance().setMode(om);
+
+            // build the worker's sim market, scenario generator and portfolio with the same configuration
+            SensitivityAnalysis sa(portfolioLoader_(), marketBuilder_(), marketConfiguration_, engineData_,
+                                   simMarketData_, sensitivityData_, recalibrateModels_, curveConfigs_,
+                                   todaysMarketParams_, nonShiftedBaseCurrencyConversion_, extraEngineBuilders_,
+                                   extraLegBuilders_, referenceData_, iborFallbackConfig_, continueOnError_, false,
+                                   dryRun_);
+            sa.overrideTenors(overrideTenors_);
+            sa.initializeSimMarket();
+            boost::shared_ptr<EngineFactory> factory = sa.buildFactory(extraEngineBuilders_, extraLegBuilders_);
+            sa.resetPortfolio(factory);
+            if (recalibrateModels_)
+                sa.modelBuilders_ = factory->modelBuilders();
+            QL_REQUIRE(sa.portfolio_->ids() == cube->ids(),
+                       "worker " << t << ": portfolio trade ids (" << sa.portfolio_->size()
+                                 << ") do not match sensi cube ids (" << cube->numIds() << ")");
+            QL_REQUIRE(sa.scenarioGenerator_->samples() == samples,
+                       "worker " << t << ": number of scenarios (" << sa.scenarioGenerator_->samples()
+                                 << ") does not match sensi cube samples (" << samples << ")");
+
+            Size n = sampleStart[t + 1] - sampleStart[t];
+            cubes[t] = boost::make_shared<DoublePrecisionSensiCube>(cube->ids(), asof_, n);
+            skipScenarioPaths(sa.scenarioGenerator_, dg->dates(), sampleStart[t]);
+
+            ValuationEngine engine(asof_, dg, sa.simMarket_, sa.modelBuilders_);
+            engine.registerProgressIndicator(
+                boost::make_shared<WorkerProgressIndicator>(this, progressMutex, progress, samples, t));
+            engine.buildCube(sa.portfolio_, cubes[t], sa.buildValuationCalculators(), true);
+            erroneousTrades[t] = engine.erroneousTrades();
+        } catch (...) {
+            exceptions[t] = std::current_exception();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (Size t = 0; t < nThreads; ++t)
+        threads.emplace_back(worker, t);
+    for (auto& th : threads)
+        th.join();
+
+    for (Size t = 0; t < nThreads; ++t) {
+        if (exceptions[t]) {
+            try {
+                std::rethrow_exception(exceptions[t]);
+            } catch (const std::exception& e) {
+                QL_FAIL("SensitivityAnalysis: worker " << t << " failed: " << e.what());
+            }
+        }
+    }
+
+    mergeSensiCubes(cubes, cube);
+
+    // a trade with an error on any worker is set to zero, as in the sequential run
+
+    std::set<std::string> errors;
+    for (auto const& e : erroneousTrades)
+        errors.insert(e.begin(), e.end());
+    for (auto const& tradeId : errors) {
+        Size i = cube->getTradeIndex(tradeId);
+        ALOG("setting all results in sensi cube to zero for trade '"
+             << tradeId << "' since there was at least one error during the sensitivity run");
+        cube->setT0(0.0, i);
+        for (Size sample = 0; sample < samples; ++sample)
+            cube->set(0.0, i, sample);
+    }
+
+    updateProgress(samples, samples);
+}
+
 void SensitivityAnalysis::initializeSimMarket(boost::shared_ptr<ScenarioFactory> scenFact) {
 
     LOG("Initialise sim market for sensitivity analysis (continueOnError=" << std::boolalpha << continueOnError_
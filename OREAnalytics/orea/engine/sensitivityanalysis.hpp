@@ -35,6 +35,7 @@
 #include <ored/report/report.hpp>
 #include <ored/utilities/progressbar.hpp>
 
+#include <functional>
 #include <map>
 #include <set>
 #include <tuple>
@@ -56,6 +57,11 @@ class ValuationCalculator;
   - compile first and second order sensitivities for all factors and all trades
   - fill result structures that can be queried
 
+  If setParallel() is called with nThreads > 1, the sensitivity scenarios are split into nThreads contiguous ranges
+  that are processed on separate threads. Each worker builds its own market, simulation market, scenario generator
+  and portfolio and fills its own NPVSensiCube, the partial cubes are merged into the result cube afterwards. This
+  requires a build with QL_ENABLE_SESSIONS. The resulting cube is identical to the one of the sequential run.
+
   \ingroup simulation
 */
 
@@ -78,6 +84,14 @@ public:
 
     virtual ~SensitivityAnalysis() {}
 
+    //! Builds the market for a worker in the parallel mode, called on the worker thread
+    using MarketBuilder = std::function<boost::shared_ptr<ore::data::Market>()>;
+    //! Loads a new instance of the (not yet built) portfolio for a worker in the parallel mode
+    using PortfolioLoader = std::function<boost::shared_ptr<ore::data::Portfolio>()>;
+
+    //! Process the sensitivity scenarios on nThreads parallel workers
+    void setParallel(const Size nThreads, const MarketBuilder& marketBuilder, const PortfolioLoader& portfolioLoader);
+
     //! Generate the Sensitivities
     virtual void generateSensitivities(boost::shared_ptr<NPVSensiCube> cube = boost::shared_ptr<NPVSensiCube>());
 
@@ -131,6 +145,9 @@ protected:
     //! Overwrite FX sensitivities in the cube with first order analytical values where possible.
     virtual void addAnalyticFxSensitivities();
 
+    //! run the sensitivity scenarios on parallel workers and merge the results into the given cube
+    void generateSensitivitiesParallel(const boost::shared_ptr<NPVSensiCube>& cube);
+
     boost::shared_ptr<ore::data::Market> market_;
     std::string marketConfiguration_;
     Date asof_;
@@ -168,6 +185,10 @@ protected:
     std::set<std::pair<string, boost::shared_ptr<ModelBuilder>>> modelBuilders_;
     //! sensitivityCube
     boost::shared_ptr<SensitivityCube> sensiCube_;
+    //! parallel mode
+    Size nThreads_;
+    MarketBuilder marketBuilder_;
+    PortfolioLoader portfolioLoader_;
 };
 
 /*! Returns the absolute shift size corresponding to a particular risk factor \p key
@@ -273,8 +273,10 @@ void ValuationEngine::buildCube(const boost::shared_ptr<data::Portfolio>& portfo
 
     // for trades with errors set all output cube values to zero
 
+    erroneousTrades_.clear();
     for (Size i = 0; i < trades.size(); ++i) {
         if (tradeHasError[i]) {
+            erroneousTrades_.insert(trades[i]->id());
             ALOG("setting all results in output cube to zero for trade '"
                  << trades[i]->id() << "' since there was at least one error during simulation");
             for (Size index = 0; index < outputCube->depth(); ++index) {
@@ -88,6 +88,9 @@ public:
         //! Limit samples to one and fill the rest of the cube with random values
         bool dryRun = false);
 
+    //! Ids of the trades that had an error during the last buildCube() call, their results are set to zero
+    const std::set<std::string>& erroneousTrades() const { return erroneousTrades_; }
+
 private:
     void recalibrateModels();
     void runCalculators(bool isCloseOutDate, const std::vector<boost::shared_ptr<Trade>>& trades,
@@ -105,6 +108,7 @@ private:
     boost::shared_ptr<DateGrid> dg_;
     boost::shared_ptr<analytics::SimMarket> simMarket_;
     set<std::pair<string, boost::shared_ptr<data::ModelBuilder>>> modelBuilders_;
+    std::set<std::string> erroneousTrades_;
 };
 } // namespace analytics
 } // namespace ore
@@ -6,6 +6,7 @@
 #endif
 
 #include <orea/aggregation/collateralaccount.hpp>
+#include <orea/aggregation/collateralbalances.hpp>
 #include <orea/aggregation/collatexposurehelper.hpp>
 #include <orea/aggregation/cvaspreadsensitivitycalculator.hpp>
 #include <orea/aggregation/dimcalculator.hpp>
@@ -15,6 +16,7 @@
 #include <orea/aggregation/exposurecalculator.hpp>
 #include <orea/aggregation/nettedexposurecalculator.hpp>
 #include <orea/aggregation/postprocess.hpp>
+#include <orea/aggregation/quantileestimator.hpp>
 #include <orea/aggregation/staticcreditxvacalculator.hpp>
 #include <orea/aggregation/xvacalculator.hpp>
 #include <orea/app/oreapp.hpp>
@@ -25,17 +27,23 @@
 #include <orea/app/structuredanalyticswarning.hpp>
 #include <orea/app/xvarunner.hpp>
 #include <orea/cube/cubeinterpretation.hpp>
+#include <orea/cube/cubemerge.hpp>
 #include <orea/cube/cubewriter.hpp>
+#include <orea/cube/flatinmemorycube.hpp>
 #include <orea/cube/inmemorycube.hpp>
+#include <orea/cube/memorymappedcube.hpp>
 #include <orea/cube/npvcube.hpp>
 #include <orea/cube/npvsensicube.hpp>
+#include <orea/cube/samplerangecube.hpp>
 #include <orea/cube/sensicube.hpp>
 #include <orea/cube/sensitivitycube.hpp>
 #include <orea/engine/amcvaluationengine.hpp>
 #include <orea/engine/bufferedsensitivitystream.hpp>
 #include <orea/engine/cptycalculator.hpp>
 #include <orea/engine/filteredsensitivitystream.hpp>
+#include <orea/engine/linearbookcalculator.hpp>
 #include <orea/engine/mporcalculator.hpp>
+#include <orea/engine/multithreadedvaluationengine.hpp>
 #include <orea/engine/npvrecord.hpp>
 #include <orea/engine/observationmode.hpp>
 #include <orea/engine/parametricvar.hpp>
@@ -27,12 +27,17 @@
 #include <ql/types.hpp>
 
 #include <boost/archive/binary_iarchive.hpp>
-#include <boost/archive/binary_oarchive.hpp>
 #include <boost/serialization/map.hpp>
+#include <boost/serialization/string.hpp>
+#include <boost/serialization/utility.hpp>
 #include <boost/serialization/vector.hpp>
 
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
 #include <fstream>
 #include <map>
+#include <ostream>
 #include <vector>
 
 namespace ore {
@@ -45,10 +50,28 @@ using std::vector;
 
 enum class AggregationScenarioDataType { IndexFixing, FXSpot, Numeraire, Generic };
 
+inline std::ostream& operator<<(std::ostream& out, const AggregationScenarioDataType& t) {
+    switch (t) {
+    case AggregationScenarioDataType::IndexFixing:
+        return out << "IndexFixing";
+    case AggregationScenarioDataType::FXSpot:
+        return out << "FXSpot";
+    case AggregationScenarioDataType::Numeraire:
+        return out << "Numeraire";
+    case AggregationScenarioDataType::Generic:
+        return out << "Generic";
+    default:
+        return out << "Unknown aggregation scenario data type";
+    }
+}
+
 //! Container for storing simulated market data
 /*! The indexes for dates and samples are (by convention) the
     same as in the npv cube
 
+    Each series (type, qualifier) can be resolved to a handle once via handle() or add(), the handle based
+    accessors avoid the lookup of the series on each access.
+
         \ingroup scenario
 */
 class AggregationScenarioData {
@@ -75,6 +98,17 @@ public:
     virtual void set(Size dateIndex, Size sampleIndex, Real value, const AggregationScenarioDataType& type,
                      const string& qualifier = "") = 0;
 
+    //! Return the handle of an existing series, throws if there is no data for the given type
+    virtual Size handle(const AggregationScenarioDataType& type, const string& qualifier = "") const = 0;
+    //! Return the handle of a series, the series is added if it does not exist yet
+    virtual Size add(const AggregationScenarioDataType& type, const string& qualifier = "") = 0;
+    //! Get a value from the cube for a series handle
+    virtual Real get(Size dateIndex, Size sampleIndex, Size handle) const = 0;
+    //! Set a value in the cube for a series handle
+    virtual void set(Size dateIndex, Size sampleIndex, Real value, Size handle) = 0;
+    //! Return the dimSamples() contiguous values of all samples of a series on a date
+    virtual const Real* samples(Size dateIndex, Size handle) const = 0;
+
     // Get available keys (type, qualifier)
     virtual std::vector<std::pair<AggregationScenarioDataType, std::string>> keys() const = 0;
 
@@ -101,8 +135,40 @@ private:
     Size dIndex_, sIndex_;
 };
 
+//! Fixed size header at the start of an aggregation scenario data file
+/*! The file layout is
+    - the header (64 bytes)
+    - the keys, each as the type (std::uint64_t), the length of the qualifier (std::uint64_t) and its characters
+    - padding up to dataOffset, which is a multiple of 64
+    - the values of the series in the order of the keys, each as dimDates x dimSamples doubles, i.e. the samples
+      of one date are contiguous
+
+    The values can therefore be used in place when the file is mapped into memory. All numbers are stored in the
+    byte order of the machine that wrote the file.
+
+    \ingroup scenario
+*/
+struct AggregationScenarioDataHeader {
+    char magic[8];         // "OREASD" followed by two null characters
+    std::uint32_t version; // file format version
+    std::uint32_t unused;
+    std::uint64_t dimDates, dimSamples, numSeries;
+    std::uint64_t dataOffset; // byte offset of the values from the start of the file
+    std::uint64_t reserved[2];
+};
+
+namespace detail {
+constexpr char aggregationScenarioDataMagic[8] = {'O', 'R', 'E', 'A', 'S', 'D', '\0', '\0'};
+constexpr std::uint32_t aggregationScenarioDataVersion = 1;
+static_assert(sizeof(AggregationScenarioDataHeader) == 64,
+              "AggregationScenarioDataHeader is expected to have 64 bytes");
+} // namespace detail
+
 //! A concrete in memory implementation of AggregationScenarioData
-/*! \ingroup scenario
+/*! The values of each series are stored in one contiguous buffer of dimDates x dimSamples values, the samples of
+    one date being contiguous. The handle of a series is its position in the order in which the series were added.
+
+    \ingroup scenario
  */
 class InMemoryAggregationScenarioData : public AggregationScenarioData {
 public:
@@ -113,82 +179,178 @@ public:
     Size dimSamples() const override { return dimSamples_; }
 
     bool has(const AggregationScenarioDataType& type, const string& qualifier = "") const override {
-        return data_.find(std::make_pair(type, qualifier)) != data_.end();
+        return index_.find(std::make_pair(type, qualifier)) != index_.end();
     }
 
-    /*! might throw (the underlying's container exception),
-      if type is not known */
     Real get(Size dateIndex, Size sampleIndex, const AggregationScenarioDataType& type,
              const string& qualifier = "") const override {
-        check(dateIndex, sampleIndex, type, qualifier);
-        return data_.at(std::make_pair(type, qualifier))[dateIndex][sampleIndex];
+        check(dateIndex, sampleIndex);
+        return data_[handle(type, qualifier)][dateIndex * dimSamples_ + sampleIndex];
+    }
+
+    void set(Size dateIndex, Size sampleIndex, Real value, const AggregationScenarioDataType& type,
+             const string& qualifier = "") override {
+        check(dateIndex, sampleIndex);
+        data_[add(type, qualifier)][dateIndex * dimSamples_ + sampleIndex] = value;
+    }
+
+    Size handle(const AggregationScenarioDataType& type, const string& qualifier = "") const override {
+        auto it = index_.find(std::make_pair(type, qualifier));
+        QL_REQUIRE(it != index_.end(), "AggregationScenarioData: no data for type " << type << ", qualifier '"
+                                                                                     << qualifier << "'");
+        return it->second;
+    }
+
+    Size add(const AggregationScenarioDataType& type, const string& qualifier = "") override {
+        auto key = std::make_pair(type, qualifier);
+        auto it = index_.find(key);
+        if (it != index_.end())
+            return it->second;
+        index_[key] = keys_.size();
+        keys_.push_back(key);
+        data_.push_back(vector<Real>(dimDates_ * dimSamples_, 0.0));
+        return keys_.size() - 1;
+    }
+
+    Real get(Size dateIndex, Size sampleIndex, Size handle) const override {
+        check(dateIndex, sampleIndex, handle);
+        return data_[handle][dateIndex * dimSamples_ + sampleIndex];
+    }
+
+    void set(Size dateIndex, Size sampleIndex, Real value, Size handle) override {
+        check(dateIndex, sampleIndex, handle);
+        data_[handle][dateIndex * dimSamples_ + sampleIndex] = value;
     }
 
+    const Real* samples(Size dateIndex, Size handle) const override {
+        QL_REQUIRE(dateIndex < dimDates_, "dateIndex (" << dateIndex << ") out of range 0..." << dimDates_ - 1);
+        check(handle);
+        return data_[handle].data() + dateIndex * dimSamples_;
+    }
+
+    //! keys in the order of (type, qualifier)
     std::vector<std::pair<AggregationScenarioDataType, std::string>> keys() const override {
         std::vector<std::pair<AggregationScenarioDataType, std::string>> res;
-        for (auto const& k : data_)
+        for (auto const& k : index_)
             res.push_back(k.first);
         return res;
     }
 
-    void set(Size dateIndex, Size sampleIndex, Real value, const AggregationScenarioDataType& type,
-             const string& qualifier = "") override {
-        check(dateIndex, sampleIndex, type, qualifier);
-        auto key = std::make_pair(type, qualifier);
-        auto it = data_.find(key);
-        if (it == data_.end()) {
-            data_.insert(make_pair(key, vector<vector<Real>>(dimDates_, vector<Real>(dimSamples_, 0.0))));
-        }
-        data_[key][dateIndex][sampleIndex] = value;
-    }
-
+    /*! reads files written by save(), and for backwards compatibility files written as a boost binary archive
+        by earlier versions */
     void load(const std::string& fileName) override {
         std::ifstream ifs(fileName.c_str(), std::fstream::binary);
         QL_REQUIRE(ifs.is_open(), "error opening file " << fileName);
-        boost::archive::binary_iarchive ia(ifs);
-        ia&* this;
+        AggregationScenarioDataHeader header;
+        ifs.read(reinterpret_cast<char*>(&header), sizeof(header));
+        if (!ifs.good() ||
+            std::memcmp(header.magic, detail::aggregationScenarioDataMagic, sizeof(header.magic)) != 0) {
+            ifs.clear();
+            ifs.seekg(0);
+            loadArchive(ifs);
+            return;
+        }
+        QL_REQUIRE(header.version == detail::aggregationScenarioDataVersion,
+                   "AggregationScenarioData: file version " << header.version << " in " << fileName
+                                                            << " not supported, expected "
+                                                            << detail::aggregationScenarioDataVersion);
+        dimDates_ = header.dimDates;
+        dimSamples_ = header.dimSamples;
+        keys_.resize(header.numSeries);
+        index_.clear();
+        for (Size i = 0; i < keys_.size(); ++i) {
+            std::uint64_t type, length;
+            ifs.read(reinterpret_cast<char*>(&type), sizeof(type));
+            ifs.read(reinterpret_cast<char*>(&length), sizeof(length));
+            keys_[i].first = static_cast<AggregationScenarioDataType>(type);
+            keys_[i].second.resize(length);
+            ifs.read(&keys_[i].second[0], length);
+            index_[keys_[i]] = i;
+        }
+        QL_REQUIRE(ifs.good(), "AggregationScenarioData: error reading keys from " << fileName);
+        ifs.seekg(header.dataOffset);
+        data_.resize(keys_.size());
+        for (auto& d : data_) {
+            d.resize(dimDates_ * dimSamples_);
+            ifs.read(reinterpret_cast<char*>(d.data()), d.size() * sizeof(Real));
+        }
+        QL_REQUIRE(ifs.good(), "AggregationScenarioData: error reading values from " << fileName);
     }
 
+    //! writes the series in the layout described in AggregationScenarioDataHeader
     void save(const std::string& fileName) const override {
-        std::ofstream ofs(fileName.c_str(), std::fstream::binary);
+        static_assert(sizeof(Real) == sizeof(double), "AggregationScenarioData::save() requires Real = double");
+        AggregationScenarioDataHeader header;
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, detail::aggregationScenarioDataMagic, sizeof(header.magic));
+        header.version = detail::aggregationScenarioDataVersion;
+        header.dimDates = dimDates_;
+        header.dimSamples = dimSamples_;
+        header.numSeries = keys_.size();
+        std::uint64_t offset = sizeof(header);
+        for (auto const& k : keys_)
+            offset += 2 * sizeof(std::uint64_t) + k.second.size();
+        header.dataOffset = (offset + 63) / 64 * 64;
+        std::ofstream ofs(fileName.c_str(), std::fstream::binary | std::fstream::trunc);
         QL_REQUIRE(ofs.is_open(), "error opening file " << fileName);
-        boost::archive::binary_oarchive oa(ofs);
-        oa&* this;
+        ofs.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        for (auto const& k : keys_) {
+            std::uint64_t type = static_cast<std::uint64_t>(k.first), length = k.second.size();
+            ofs.write(reinterpret_cast<const char*>(&type), sizeof(type));
+            ofs.write(reinterpret_cast<const char*>(&length), sizeof(length));
+            ofs.write(k.second.data(), length);
+        }
+        const char padding[64] = {};
+        ofs.write(padding, header.dataOffset - offset);
+        for (auto const& d : data_)
+            ofs.write(reinterpret_cast<const char*>(d.data()), d.size() * sizeof(Real));
+        QL_REQUIRE(ofs.good(), "AggregationScenarioData: error writing " << fileName);
     }
 
 private:
+    void loadArchive(std::istream& is) {
+        boost::archive::binary_iarchive ia(is);
+        ia&* this;
+    }
+
+    // only used to read files written as a boost binary archive by earlier versions
     friend class boost::serialization::access;
     template <class Archive> void serialize(Archive& ar, const unsigned int) {
+        map<std::pair<AggregationScenarioDataType, string>, vector<vector<Real>>> data;
         ar& dimDates_;
         ar& dimSamples_;
-        ar& data_;
+        ar& data;
+        keys_.clear();
+        index_.clear();
+        data_.clear();
+        for (auto const& d : data) {
+            Size h = add(d.first.first, d.first.second);
+            for (Size i = 0; i < std::min<Size>(d.second.size(), dimDates_); ++i)
+                std::copy(d.second[i].begin(), d.second[i].begin() + std::min(d.second[i].size(), dimSamples_),
+                          data_[h].begin() + i * dimSamples_);
+        }
     }
 
-    void check(Size dateIndex, Size sampleIndex, const AggregationScenarioDataType& type,
-               const string& qualifier) const {
+    void check(Size dateIndex, Size sampleIndex) const {
         QL_REQUIRE(dateIndex < dimDates_, "dateIndex (" << dateIndex << ") out of range 0..." << dimDates_ - 1);
         QL_REQUIRE(sampleIndex < dimSamples_,
                    "sampleIndex (" << sampleIndex << ") out of range 0..." << dimSamples_ - 1);
-        return;
     }
-    Size dimDates_, dimSamples_;
-    map<std::pair<AggregationScenarioDataType, string>, vector<vector<Real>>> data_;
-};
 
-inline std::ostream& operator<<(std::ostream& out, const AggregationScenarioDataType& t) {
-    switch (t) {
-    case AggregationScenarioDataType::IndexFixing:
-        return out << "IndexFixing";
-    case AggregationScenarioDataType::FXSpot:
-        return out << "FXSpot";
-    case AggregationScenarioDataType::Numeraire:
-        return out << "Numeraire";
-    case AggregationScenarioDataType::Generic:
-        return out << "Generic";
-    default:
-        return out << "Unknown aggregation scenario data type";
+    void check(Size handle) const {
+        QL_REQUIRE(handle < data_.size(), "handle (" << handle << ") out of range 0..." << data_.size() - 1);
     }
-}
+
+    void check(Size dateIndex, Size sampleIndex, Size handle) const {
+        check(dateIndex, sampleIndex);
+        check(handle);
+    }
+
+    Size dimDates_, dimSamples_;
+    vector<std::pair<AggregationScenarioDataType, string>> keys_;
+    map<std::pair<AggregationScenarioDataType, string>, Size> index_;
+    vector<vector<Real>> data_;
+};
 
 } // namespace analytics
 } // namespace ore
@@ -36,8 +36,9 @@ CrossAssetModelScenarioGenerator::CrossAssetModelScenarioGenerator(
     Date today, boost::shared_ptr<DateGrid> grid, boost::shared_ptr<ore::data::Market> initMarket,
     const std::string& configuration)
     : ScenarioPathGenerator(today, grid->dates(), grid->timeGrid()), model_(model), pathGenerator_(pathGenerator),
-      scenarioFactory_(scenarioFactory), simMarketConfig_(simMarketConfig), initMarket_(initMarket),
-      configuration_(configuration) {
+      scenarioFactory_(scenarioFactory),
+      simpleScenarioFactory_(boost::dynamic_pointer_cast<SimpleScenarioFactory>(scenarioFactory)),
+      simMarketConfig_(simMarketConfig), initMarket_(initMarket), configuration_(configuration) {
 
     LOG("CrossAssetModelScenarioGenerator ctor called");
     
@@ -330,7 +331,10 @@ std::vector<boost::shared_ptr<Scenario>> CrossAssetModelScenarioGenerator::nextP
     for (Size i = 0; i < dates_.size(); i++) {
         Real t = timeGrid_[i + 1]; // recall: time grid has inserted t=0
 
-        scenarios[i] = scenarioFactory_->buildScenario(dates_[i]);
+        if (simpleScenarioFactory_ && sharedKeys_)
+            scenarios[i] = simpleScenarioFactory_->buildScenario(dates_[i], sharedKeys_);
+        else
+            scenarios[i] = scenarioFactory_->buildScenario(dates_[i]);
 
         // populate IR states
         copyPathToArray(sample.value, i + 1, model_->pIdx(CrossAssetModel::AssetType::IR, 0), ir_state[0]);
@@ -542,6 +546,12 @@ std::vector<boost::shared_ptr<Scenario>> CrossAssetModelScenarioGenerator::nextP
                 scenarios[i]->add(commodityCurveKeys_[j * ten_com_[j].size() + k], price);
             }
         }
+
+        // the keys of the first scenario are used for all subsequent scenarios
+        if (simpleScenarioFactory_ && !sharedKeys_) {
+            if (auto s = boost::dynamic_pointer_cast<SimpleScenario>(scenarios[i]))
+                sharedKeys_ = s->sharedData();
+        }
     }
     return scenarios;
 }
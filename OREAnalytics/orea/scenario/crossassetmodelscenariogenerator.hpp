@@ -27,6 +27,7 @@
 #include <orea/scenario/scenariogenerator.hpp>
 #include <orea/scenario/scenariosimmarket.hpp>
 #include <orea/scenario/scenariosimmarketparameters.hpp>
+#include <orea/scenario/simplescenariofactory.hpp>
 #include <ored/marketdata/market.hpp>
 #include <ored/utilities/dategrid.hpp>
 
@@ -76,11 +77,18 @@ public:
     ~CrossAssetModelScenarioGenerator(){};
     std::vector<boost::shared_ptr<Scenario>> nextPath() override;
     void reset() override { pathGenerator_->reset(); }
+    void skipPaths(Size n) override {
+        for (Size i = 0; i < n; ++i)
+            pathGenerator_->next();
+    }
 
 private:
     boost::shared_ptr<QuantExt::CrossAssetModel> model_;
     boost::shared_ptr<QuantExt::MultiPathGeneratorBase> pathGenerator_;
     boost::shared_ptr<ScenarioFactory> scenarioFactory_;
+    // if the factory builds simple scenarios, all scenarios share the key table of the first one
+    boost::shared_ptr<SimpleScenarioFactory> simpleScenarioFactory_;
+    boost::shared_ptr<SimpleScenario::SharedData> sharedKeys_;
     boost::shared_ptr<ScenarioSimMarketParameters> simMarketConfig_;
     boost::shared_ptr<ore::data::Market> initMarket_;
     const std::string configuration_;
@@ -79,6 +79,14 @@ public:
         return path_[pathStep_++]; // post increment
     }
 
+    //! Skip the next n paths, e.g. to position the generator at the start of a sample range
+    /*! The default implementation generates and discards the paths, derived classes can provide a
+        cheaper implementation that only advances the underlying random numbers. */
+    virtual void skipPaths(Size n) {
+        for (Size i = 0; i < n; ++i)
+            nextPath();
+    }
+
 protected:
     virtual std::vector<boost::shared_ptr<Scenario>> nextPath() = 0;
 
@@ -89,5 +97,24 @@ protected:
     TimeGrid timeGrid_;
     std::vector<boost::shared_ptr<Scenario>> path_;
 };
+
+//! Advance a scenario generator by n paths on the given simulation dates
+/*! Uses ScenarioPathGenerator::skipPaths() if the generator is a path generator, otherwise the scenarios are
+    generated and discarded.
+
+    \ingroup scenario
+*/
+inline void skipScenarioPaths(const boost::shared_ptr<ScenarioGenerator>& generator, const vector<Date>& dates,
+                              Size n) {
+    if (n == 0)
+        return;
+    if (auto pathGenerator = boost::dynamic_pointer_cast<ScenarioPathGenerator>(generator)) {
+        pathGenerator->skipPaths(n);
+    } else {
+        for (Size i = 0; i < n; ++i)
+            for (auto const& d : dates)
+                generator->next(d);
+    }
+}
 } // namespace analytics
 } // namespace ore
@@ -2693,6 +2693,7 @@ void ScenarioSimMarket::reset() {
     // delete the sim data cache
     cachedSimData_.clear();
     cachedSimDataActive_.clear();
+    cachedSimDataKeys_.reset();
     // reset term structures
     applyScenario(baseScenario_);
     // see the comment in update() for why this is necessary...
@@ -2708,45 +2709,73 @@ void ScenarioSimMarket::reset() {
 
 void ScenarioSimMarket::applyScenario(const boost::shared_ptr<Scenario>& scenario) {
 
+    // in batch mode the sim data quotes are updated with deferred notifications, so that each observer of the quotes
+    // is notified once per scenario instead of once per quote update
+
+    if (ObservationMode::instance().mode() == ObservationMode::Mode::Batch &&
+        ObservableSettings::instance().updatesEnabled()) {
+        ObservableSettings::instance().disableUpdates(true);
+        try {
+            applyScenarioValues(scenario);
+        } catch (...) {
+            ObservableSettings::instance().enableUpdates();
+            throw;
+        }
+        ObservableSettings::instance().enableUpdates();
+    } else {
+        applyScenarioValues(scenario);
+    }
+}
+
+void ScenarioSimMarket::applyScenarioValues(const boost::shared_ptr<Scenario>& scenario) {
+
     // apply scenario based on cached indices for simData_ for a SimpleScenario
-    // this assumes that all scenarios have an identical key structure in their data map
+    // the cache is built for the key table of the scenario and reused for all scenarios sharing this table or
+    // having identical keys
 
     if (cacheSimData_) {
         if (auto s = boost::dynamic_pointer_cast<SimpleScenario>(scenario)) {
 
             // fill cache
 
-            if (cachedSimData_.empty()) {
-                Size count = 0;
-                for (auto const& d : s->data()) {
-                    auto it = simData_.find(d.first);
-                    if (it == simData_.end()) {
-                        ALOG("simulation data point missing for key " << d.first);
-                        cachedSimData_.push_back(boost::shared_ptr<SimpleQuote>());
-                        cachedSimDataActive_.push_back(false);
-                    } else {
-                        ++count;
-                        cachedSimData_.push_back(it->second);
-                        cachedSimDataActive_.push_back(filter_->allow(d.first));
+            if (s->sharedData() != cachedSimDataKeys_ || s->data().size() != cachedSimData_.size()) {
+                if (!cachedSimDataKeys_ || cachedSimDataKeys_->keys != s->keys()) {
+                    cachedSimData_.clear();
+                    cachedSimDataActive_.clear();
+                    Size count = 0;
+                    for (auto const& key : s->keys()) {
+                        auto it = simData_.find(key);
+                        if (it == simData_.end()) {
+                            ALOG("simulation data point missing for key " << key);
+                            cachedSimData_.push_back(boost::shared_ptr<SimpleQuote>());
+                            cachedSimDataActive_.push_back(false);
+                        } else {
+                            ++count;
+                            cachedSimData_.push_back(it->second);
+                            cachedSimDataActive_.push_back(filter_->allow(key));
+                        }
                     }
-                }
-                if (count != simData_.size() && !allowPartialScenarios_) {
-                    ALOG("mismatch between scenario and sim data size, " << count << " vs " << simData_.size());
-                    for (auto it : simData_) {
-                        if (!scenario->has(it.first))
-                            WLOG("Key " << it.first << " missing in scenario");
+                    if (count != simData_.size() && !allowPartialScenarios_) {
+                        ALOG("mismatch between scenario and sim data size, " << count << " vs " << simData_.size());
+                        for (auto it : simData_) {
+                            if (!scenario->has(it.first))
+                                WLOG("Key " << it.first << " missing in scenario");
+                        }
+                        cachedSimDataKeys_.reset();
+                        QL_FAIL("mismatch between scenario and sim data size, exit.");
                     }
-                    QL_FAIL("mismatch between scenario and sim data size, exit.");
                 }
+                cachedSimDataKeys_ = s->sharedData();
             }
 
-            // apply scenario data according to cached indices
+            // apply scenario data by index
 
-            Size i = 0;
-            for (auto const& q : s->data()) {
-                if (cachedSimDataActive_[i])
-                    cachedSimData_[i]->setValue(q.second);
-                ++i;
+            const vector<Real>& data = s->data();
+            for (Size i = 0; i < data.size(); ++i) {
+                if (cachedSimDataActive_[i]) {
+                    QL_REQUIRE(data[i] != Null<Real>(), "Scenario does not provide data for key " << s->keys()[i]);
+                    cachedSimData_[i]->setValue(data[i]);
+                }
             }
 
             return;
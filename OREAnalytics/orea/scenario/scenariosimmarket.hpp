@@ -26,6 +26,7 @@
 #include <orea/scenario/scenario.hpp>
 #include <orea/scenario/scenariogenerator.hpp>
 #include <orea/scenario/scenariosimmarketparameters.hpp>
+#include <orea/scenario/simplescenario.hpp>
 #include <orea/simulation/simmarket.hpp>
 #include <ored/configuration/conventions.hpp>
 #include <ored/configuration/curveconfigurations.hpp>
@@ -110,8 +111,8 @@ public:
 /*! If useSpreadedTermStructures is true, spreaded term structures over the initMarket for supported risk factors will
   be generated. This is used by the SensitivityScenarioGenerator.
 
-  If cacheSimData is true, the scenario application is optimised. This requires that all scenarios are SimpleScenario
-  instances with identical key structure in their data.
+  If cacheSimData is true, the scenario application is optimised for SimpleScenario instances: the sim data quotes
+  are looked up once per key table and the scenario values are then applied by index.
 
   If allowPartialScenarios is true, the check that all simData_ is touched by a scenario is disabled.
  */
@@ -186,6 +187,8 @@ public:
 
 protected:
     virtual void applyScenario(const boost::shared_ptr<Scenario>& scenario);
+    //! write the scenario values to the sim data quotes
+    void applyScenarioValues(const boost::shared_ptr<Scenario>& scenario);
 
     void writeSimData(std::map<RiskFactorKey, boost::shared_ptr<SimpleQuote>>& simDataTmp,
                       std::map<RiskFactorKey, Real>& absoluteSimDataTmp);
@@ -217,6 +220,7 @@ protected:
 
     std::vector<boost::shared_ptr<SimpleQuote>> cachedSimData_;
     std::vector<bool> cachedSimDataActive_;
+    boost::shared_ptr<SimpleScenario::SharedData> cachedSimDataKeys_;
 
     std::set<RiskFactorKey::KeyType> nonSimulatedFactors_;
 
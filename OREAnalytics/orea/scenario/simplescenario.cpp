@@ -20,24 +20,55 @@
 #include <orea/scenario/simplescenario.hpp>
 #include <ored/utilities/log.hpp>
 #include <ql/errors.hpp>
+#include <ql/utilities/null.hpp>
 
 namespace ore {
 namespace analytics {
 
 // Simple Scenario class
 
-bool SimpleScenario::has(const RiskFactorKey& key) const { return data_.find(key) != data_.end(); }
+SimpleScenario::SimpleScenario(Date asof, const std::string& label, Real numeraire,
+                               const boost::shared_ptr<SharedData>& sharedData)
+    : asof_(asof), numeraire_(numeraire), sharedData_(sharedData), label_(label), nextIndex_(0) {
+    // keys of the table that are not added to this scenario are marked as missing by a null value
+    if (sharedData_)
+        data_.resize(sharedData_->keys.size(), QuantLib::Null<Real>());
+    else
+        sharedData_ = boost::make_shared<SharedData>();
+}
+
+bool SimpleScenario::has(const RiskFactorKey& key) const {
+    auto it = sharedData_->keyIndex.find(key);
+    return it != sharedData_->keyIndex.end() && data_[it->second] != QuantLib::Null<Real>();
+}
 
 void SimpleScenario::add(const RiskFactorKey& key, Real value) {
-    data_[key] = value; // key might already exist, so we cannot use insert/emplace
-    if (std::find(keys_.begin(), keys_.end(), key) == keys_.end())
-        keys_.emplace_back(key);
+    // fast path: keys are added in the order of the key table
+    if (nextIndex_ < data_.size() && sharedData_->keys[nextIndex_] == key) {
+        data_[nextIndex_++] = value;
+        return;
+    }
+    auto it = sharedData_->keyIndex.find(key);
+    if (it != sharedData_->keyIndex.end()) {
+        // key might already exist, overwrite the value
+        data_[it->second] = value;
+        nextIndex_ = it->second + 1;
+        return;
+    }
+    // new key, do not modify a key table that is shared with other scenarios
+    if (sharedData_.use_count() > 1)
+        sharedData_ = boost::make_shared<SharedData>(*sharedData_);
+    sharedData_->keyIndex[key] = data_.size();
+    sharedData_->keys.push_back(key);
+    data_.push_back(value);
+    nextIndex_ = data_.size();
 }
 
 Real SimpleScenario::get(const RiskFactorKey& key) const {
-    auto it = data_.find(key);
-    QL_REQUIRE(it != data_.end(), "Scenario does not provide data for key " << key);
-    return it->second;
+    auto it = sharedData_->keyIndex.find(key);
+    QL_REQUIRE(it != sharedData_->keyIndex.end() && data_[it->second] != QuantLib::Null<Real>(),
+               "Scenario does not provide data for key " << key);
+    return data_[it->second];
 }
 
 boost::shared_ptr<Scenario> SimpleScenario::clone() const { return boost::make_shared<SimpleScenario>(*this); }
@@ -25,8 +25,10 @@
 
 #include <orea/scenario/scenario.hpp>
 
+#include <boost/make_shared.hpp>
 #include <boost/serialization/export.hpp>
 #include <boost/serialization/map.hpp>
+#include <boost/serialization/shared_ptr.hpp>
 #include <boost/serialization/vector.hpp>
 
 namespace ore {
@@ -35,19 +37,40 @@ using std::string;
 
 //-----------------------------------------------------------------------------------------------
 //! Simple Scenario class
-/*! This implementation stores the data in several maps within in each scenario class instance.
-  This contains redundant information (keys) across scenario instances which can cause issues
-  when many scenario instances are managed in memory.
+/*! This implementation stores the values in a dense vector in the order of keys(). The keys and the key to index
+  map are held in a SharedData instance which can be shared by many scenario instances with identical keys, so that
+  the memory footprint of a scenario is essentially one Real per key.
+
+  A shared key table is never modified: if a key that is not in the table is added to a scenario, the scenario
+  continues with a private copy of the table. A scenario constructed with a given key table lists all keys of this
+  table in keys(), but has() and get() only accept the keys that were added to the scenario. The values of the
+  other keys are Null<Real>() in data().
+
+  Keys are expected to be added in the same order for all scenarios sharing a table, in this case add() writes
+  the values by index without a lookup in the key map.
 
   \ingroup scenario
 */
 class SimpleScenario : public Scenario {
 public:
+    //! Key table shared between scenarios with identical keys
+    struct SharedData {
+        std::vector<RiskFactorKey> keys;
+        std::map<RiskFactorKey, Size> keyIndex;
+
+    private:
+        friend class boost::serialization::access;
+        template <class Archive> void serialize(Archive& ar, const unsigned int) {
+            ar& keys;
+            ar& keyIndex;
+        }
+    };
+
     //! Constructor
-    SimpleScenario() {}
+    SimpleScenario() : numeraire_(0.0), sharedData_(boost::make_shared<SharedData>()), nextIndex_(0) {}
     //! Constructor
-    SimpleScenario(Date asof, const std::string& label = "", Real numeraire = 0)
-        : asof_(asof), numeraire_(numeraire), label_(label) {}
+    SimpleScenario(Date asof, const std::string& label = "", Real numeraire = 0,
+                   const boost::shared_ptr<SharedData>& sharedData = nullptr);
 
     //! Return the scenario asof date
     const Date& asof() const override { return asof_; }
@@ -64,14 +87,16 @@ public:
 
     //! Check, get, add a single market point
     bool has(const RiskFactorKey& key) const override;
-    const std::vector<RiskFactorKey>& keys() const override { return keys_; }
+    const std::vector<RiskFactorKey>& keys() const override { return sharedData_->keys; }
     void add(const RiskFactorKey& key, Real value) override;
     Real get(const RiskFactorKey& key) const override;
 
     boost::shared_ptr<Scenario> clone() const override;
 
-    //! get data map
-    const std::map<RiskFactorKey, Real> data() const { return data_; }
+    //! get the values in the order of keys()
+    const std::vector<Real>& data() const { return data_; }
+    //! get the key table, which may be shared with other scenarios
+    const boost::shared_ptr<SharedData>& sharedData() const { return sharedData_; }
 
 private:
     friend class boost::serialization::access;
@@ -79,15 +104,17 @@ private:
         ar& boost::serialization::base_object<Scenario>(*this);
         ar& asof_;
         ar& numeraire_;
+        ar& sharedData_;
         ar& data_;
-        ar& keys_;
         ar& label_;
     }
     Date asof_;
     Real numeraire_;
-    std::map<RiskFactorKey, Real> data_;
-    std::vector<RiskFactorKey> keys_;
+    boost::shared_ptr<SharedData> sharedData_;
+    std::vector<Real> data_;
     std::string label_;
+    // position of the next key expected by add(), if keys are added in table order
+    Size nextIndex_;
 };
 } // namespace analytics
 } // namespace ore
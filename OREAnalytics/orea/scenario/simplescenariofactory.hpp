@@ -39,6 +39,12 @@ public:
                                                     Real numeraire = 0.0) const override {
         return boost::make_shared<SimpleScenario>(asof, label, numeraire);
     }
+    //! Build a scenario instance that shares the given key table
+    const boost::shared_ptr<SimpleScenario> buildScenario(Date asof,
+                                                          const boost::shared_ptr<SimpleScenario::SharedData>& sharedData,
+                                                          const std::string& label = "", Real numeraire = 0.0) const {
+        return boost::make_shared<SimpleScenario>(asof, label, numeraire, sharedData);
+    }
 };
 
 } // namespace analytics
@@ -21,6 +21,8 @@
 #include <oret/toplevelfixture.hpp>
 #include <test/oreatoplevelfixture.hpp>
 
+#include <cstdio>
+
 using namespace ore::analytics;
 using namespace boost::unit_test_framework;
 
@@ -65,6 +67,64 @@ BOOST_AUTO_TEST_CASE(testInMemoryAggregationScenarioData) {
     }
 }
 
+BOOST_AUTO_TEST_CASE(testAggregationScenarioDataHandles) {
+    InMemoryAggregationScenarioData data(3, 5);
+
+    BOOST_CHECK_THROW(data.handle(AggregationScenarioDataType::Numeraire), std::exception);
+    Size numeraire = data.add(AggregationScenarioDataType::Numeraire);
+    Size fx = data.add(AggregationScenarioDataType::FXSpot, "USD");
+    BOOST_CHECK_EQUAL(data.add(AggregationScenarioDataType::Numeraire), numeraire);
+    BOOST_CHECK_EQUAL(data.handle(AggregationScenarioDataType::FXSpot, "USD"), fx);
+    BOOST_CHECK_THROW(data.set(0, 0, 1.0, fx + 1), std::exception);
+    BOOST_CHECK_THROW(data.set(3, 0, 1.0, fx), std::exception);
+
+    for (Size i = 0; i < 3; ++i) {
+        for (Size j = 0; j < 5; ++j) {
+            data.set(i, j, 1.0 + i + 0.1 * j, numeraire);
+            data.set(i, j, 2.0 + i + 0.1 * j, AggregationScenarioDataType::FXSpot, "USD");
+        }
+    }
+
+    Real tol = 1.0E-12;
+    for (Size i = 0; i < 3; ++i) {
+        const Real* n = data.samples(i, numeraire);
+        const Real* f = data.samples(i, fx);
+        for (Size j = 0; j < 5; ++j) {
+            BOOST_CHECK_CLOSE(n[j], 1.0 + i + 0.1 * j, tol);
+            BOOST_CHECK_CLOSE(f[j], 2.0 + i + 0.1 * j, tol);
+            BOOST_CHECK_CLOSE(data.get(i, j, fx), 2.0 + i + 0.1 * j, tol);
+            BOOST_CHECK_CLOSE(data.get(i, j, AggregationScenarioDataType::Numeraire), 1.0 + i + 0.1 * j, tol);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(testAggregationScenarioDataSaveLoad) {
+    InMemoryAggregationScenarioData data(4, 7);
+    for (Size i = 0; i < 4; ++i) {
+        for (Size j = 0; j < 7; ++j) {
+            data.set(i, j, 1.0 + 0.01 * i + 0.001 * j, AggregationScenarioDataType::Numeraire);
+            data.set(i, j, 0.01 * i - 0.002 * j, AggregationScenarioDataType::IndexFixing, "EUR-EONIA");
+            data.set(i, j, 1.1 + 0.1 * i * j, AggregationScenarioDataType::FXSpot, "USD");
+        }
+    }
+
+    std::string filename = "aggregationscenariodata.dat";
+    data.save(filename);
+    InMemoryAggregationScenarioData data2;
+    data2.load(filename);
+    std::remove(filename.c_str());
+
+    BOOST_REQUIRE_EQUAL(data2.dimDates(), 4);
+    BOOST_REQUIRE_EQUAL(data2.dimSamples(), 7);
+    BOOST_REQUIRE(data2.keys() == data.keys());
+    for (auto const& k : data.keys()) {
+        for (Size i = 0; i < 4; ++i) {
+            for (Size j = 0; j < 7; ++j)
+                BOOST_CHECK_EQUAL(data2.get(i, j, k.first, k.second), data.get(i, j, k.first, k.second));
+        }
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 BOOST_AUTO_TEST_SUITE_END()
@@ -677,6 +677,36 @@ BOOST_DATA_TEST_CASE(testBermudanSwaptionExposure, boost::unit_test::data::make(
         }
     }
 
+    // the multi-threaded amc valuation of two copies of the trade must reproduce the single-threaded cube
+    boost::shared_ptr<Instrument> swaption2;
+    if (testCase.isAmortising)
+        swaption2 = boost::make_shared<NonstandardSwaption>(underlyingNs, exercise, settlementType, settlementMethod);
+    else
+        swaption2 = boost::make_shared<Swaption>(underlying, exercise, settlementType, settlementMethod);
+    swaption2->setPricingEngine(engineMc);
+    auto trade2 = boost::make_shared<TestTrade>("BermudanSwaption", testCase.inBaseCcy ? "EUR" : "USD",
+                                                boost::make_shared<VanillaInstrument>(swaption2));
+    trade2->id() = "DummyTradeId2";
+    auto portfolioMt = boost::make_shared<Portfolio>();
+    portfolioMt->add(trade);
+    portfolioMt->add(trade2);
+    AMCValuationEngine amcValEngineMt(model, sgd, boost::shared_ptr<Market>(), std::vector<string>(),
+                                      std::vector<string>(), 2);
+    boost::shared_ptr<NPVCube> outputCubeMt = boost::make_shared<DoublePrecisionInMemoryCube>(
+        referenceDate, std::vector<string>{"DummyTradeId", "DummyTradeId2"}, grid->dates(), testCase.samples);
+    amcValEngineMt.buildCube(portfolioMt, outputCubeMt);
+    Size mismatches = 0;
+    for (Size t = 0; t < 2; ++t) {
+        BOOST_CHECK_EQUAL(outputCubeMt->getT0(t, 0), outputCube->getT0(0, 0));
+        for (Size j = 0; j < grid->dates().size(); ++j) {
+            for (Size i = 0; i < testCase.samples; ++i) {
+                if (outputCubeMt->get(t, j, i, 0) != outputCube->get(0, j, i, 0))
+                    ++mismatches;
+            }
+        }
+    }
+    BOOST_CHECK_EQUAL(mismatches, 0);
+
     Real fx = 1.0;
     if (!testCase.inBaseCcy)
         fx = simMarket->fxRate("USDEUR")->value();
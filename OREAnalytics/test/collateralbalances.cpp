@@ -0,0 +1,108 @@
+/*
+ Copyright (C) 2023 Quaternion Risk Management Ltd
+ All rights reserved.
+
+ This file is part of ORE, a free-software/open-source library
+ for transparent pricing and risk analysis - http://opensourcerisk.org
+
+ ORE is free software: you can redistribute it and/or modify it
+ under the terms of the Modified BSD License.  You should have received a
+ copy of the license along with this program.
+ The license is also available online at <http://opensourcerisk.org>
+
+ This program is distributed on the basis that it will form a useful
+ contribution to risk analytics and model standardisation, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ FITNESS FOR A PARTICULAR PURPOSE. See the license for more details.
+*/
+
+#include <boost/test/unit_test.hpp>
+#include <orea/aggregation/collatexposurehelper.hpp>
+#include <oret/toplevelfixture.hpp>
+#include <test/oreatoplevelfixture.hpp>
+
+#include <ql/math/randomnumbers/mt19937uniformrng.hpp>
+
+using namespace ore::analytics;
+using namespace ore::data;
+using namespace QuantLib;
+using namespace boost::unit_test_framework;
+
+BOOST_FIXTURE_TEST_SUITE(OREAnalyticsTestSuite, ore::test::OreaTopLevelFixture)
+
+BOOST_AUTO_TEST_SUITE(CollateralBalancesTest)
+
+BOOST_AUTO_TEST_CASE(testCollateralBalancesAgainstCollateralAccounts) {
+
+    BOOST_TEST_MESSAGE("Testing collateral balances against collateral account paths...");
+
+    Date today(15, March, 2023);
+
+    // irregular exposure grid, including a few dates between the margining dates
+    vector<Date> dateGrid;
+    Date d = today;
+    for (Size i = 0; i < 40; ++i) {
+        d += (i % 4 == 0 ? 3 : (i % 3 == 0 ? 14 : 30)) * Days;
+        dateGrid.push_back(d);
+    }
+
+    // random netting set values, csa fx rates and collateral rates
+    Size samples = 50;
+    MersenneTwisterUniformRng rng(42);
+    vector<vector<Real>> values(dateGrid.size(), vector<Real>(samples));
+    vector<vector<Real>> fxRates(dateGrid.size(), vector<Real>(samples));
+    vector<vector<Real>> rates(dateGrid.size(), vector<Real>(samples));
+    for (Size k = 0; k < samples; ++k) {
+        Real v = 1.0E5;
+        for (Size j = 0; j < dateGrid.size(); ++j) {
+            v += 3.0E5 * (rng.nextReal() - 0.5);
+            values[j][k] = v;
+            fxRates[j][k] = 1.1 + 0.1 * (rng.nextReal() - 0.5);
+            rates[j][k] = 0.01 + 0.02 * (rng.nextReal() - 0.5);
+        }
+    }
+
+    struct TestCsa {
+        Real thresholdPay, thresholdRcv, mtaPay, mtaRcv, ia;
+        string callFreq, postFreq, mpr;
+        Date maturity;
+    };
+    vector<TestCsa> csas = {{0.0, 0.0, 0.0, 0.0, 0.0, "1D", "1D", "2W", dateGrid.back()},
+                            {1.0E5, 2.0E5, 5.0E4, 1.0E4, 0.0, "1W", "3W", "10D", dateGrid[25]},
+                            {0.0, 0.0, 5.0E4, 1.0E4, 3.0E4, "2W", "1W", "0D", dateGrid.back()},
+                            {1.0E5, 0.0, 0.0, 0.0, 0.0, "1D", "1W", "2W", dateGrid[25]}};
+
+    vector<CollateralExposureHelper::CalculationType> calcTypes = {
+        CollateralExposureHelper::Symmetric, CollateralExposureHelper::AsymmetricCVA,
+        CollateralExposureHelper::AsymmetricDVA, CollateralExposureHelper::NoLag};
+
+    Real tol = 1.0E-6;
+    for (auto const& c : csas) {
+        auto netting = boost::make_shared<NettingSetDefinition>(
+            "NS", "Bilateral", "EUR", "EUR-EONIA", c.thresholdPay, c.thresholdRcv, c.mtaPay, c.mtaRcv, c.ia, "FIXED",
+            c.callFreq, c.postFreq, c.mpr, 0.001, -0.002, vector<string>(1, "EUR"));
+        for (auto calcType : calcTypes) {
+            auto accounts = CollateralExposureHelper::collateralBalancePaths(
+                netting, 1.0E5, today, values, c.maturity, dateGrid, 1.1, fxRates, 0.01, rates, calcType);
+            auto balances = CollateralExposureHelper::collateralBalances(
+                netting, 1.0E5, today, values, c.maturity, dateGrid, 1.1, fxRates, 0.01, rates, calcType);
+            BOOST_REQUIRE_EQUAL(accounts->size(), samples);
+            BOOST_REQUIRE_EQUAL(balances->samples(), samples);
+            for (Size j = 0; j < dateGrid.size(); ++j) {
+                for (Size k = 0; k < samples; ++k) {
+                    Real expected = accounts->at(k)->accountBalance(dateGrid[j]);
+                    if (std::fabs(balances->balance(j, k) - expected) > tol) {
+                        BOOST_ERROR("collateral balance mismatch for calculation type "
+                                    << static_cast<int>(calcType) << ", margin frequencies " << c.callFreq << "/"
+                                    << c.postFreq << ", mpor " << c.mpr << ", date " << dateGrid[j] << ", sample "
+                                    << k << ": " << balances->balance(j, k) << ", expected " << expected);
+                    }
+                }
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE_END()
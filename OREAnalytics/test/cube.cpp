@@ -18,7 +18,12 @@
 
 #include <boost/filesystem.hpp>
 #include <boost/test/unit_test.hpp>
+#include <orea/cube/cubemerge.hpp>
+#include <orea/cube/flatinmemorycube.hpp>
 #include <orea/cube/inmemorycube.hpp>
+#include <orea/cube/memorymappedcube.hpp>
+#include <orea/cube/samplerangecube.hpp>
+#include <orea/cube/sensicube.hpp>
 #include <oret/toplevelfixture.hpp>
 #include <test/oreatoplevelfixture.hpp>
 
@@ -130,6 +135,50 @@ void testCubeGetSetbyDateID(NPVCube& cube, Real tolerance) {
     }
 }
 
+void testBulkAccess(NPVCube& cube, const std::string& cubeName, Real tolerance) {
+    BOOST_TEST_MESSAGE("Testing bulk access on cube " << cubeName);
+
+    initCube(cube);
+
+    // read back via getSamples() and getSlab()
+    vector<Real> samples(cube.samples()), slab(cube.numDates() * cube.samples());
+    for (Size i = 0; i < cube.numIds(); ++i) {
+        for (Size d = 0; d < cube.depth(); ++d) {
+            cube.getSlab(slab.data(), i, d);
+            for (Size j = 0; j < cube.numDates(); ++j) {
+                cube.getSamples(samples.data(), i, j, d);
+                for (Size k = 0; k < cube.samples(); ++k) {
+                    BOOST_CHECK_CLOSE(samples[k], cube.get(i, j, k, d), tolerance);
+                    BOOST_CHECK_CLOSE(slab[j * cube.samples() + k], cube.get(i, j, k, d), tolerance);
+                }
+            }
+        }
+    }
+    BOOST_CHECK_THROW(cube.getSamples(samples.data(), cube.numIds(), 0), std::exception);
+    BOOST_CHECK_THROW(cube.getSamples(samples.data(), 0, cube.numDates()), std::exception);
+    BOOST_CHECK_THROW(cube.getSlab(slab.data(), 0, cube.depth()), std::exception);
+
+    // write negated values via setSlab() and setSamples() and check them with get()
+    for (Size i = 0; i < cube.numIds(); ++i) {
+        for (Size d = 0; d < cube.depth(); ++d) {
+            cube.getSlab(slab.data(), i, d);
+            for (auto& v : slab)
+                v = -v;
+            if (i % 2 == 0) {
+                cube.setSlab(slab.data(), i, d);
+            } else {
+                for (Size j = 0; j < cube.numDates(); ++j)
+                    cube.setSamples(slab.data() + j * cube.samples(), i, j, d);
+            }
+        }
+    }
+    for (Size i = 0; i < cube.numIds(); ++i)
+        for (Size j = 0; j < cube.numDates(); ++j)
+            for (Size k = 0; k < cube.samples(); ++k)
+                for (Size d = 0; d < cube.depth(); ++d)
+                    BOOST_CHECK_CLOSE(-cube.get(i, j, k, d), i * 1000000.0 + j + k / 1000000.0 + d * 3, tolerance);
+}
+
 } // namespace
 
 BOOST_FIXTURE_TEST_SUITE(OREAnalyticsTestSuite, ore::test::OreaTopLevelFixture)
@@ -200,6 +249,256 @@ BOOST_AUTO_TEST_CASE(testInMemoryCubeGetSetbyDateID) {
     testCubeGetSetbyDateID(cube, 1e-14);
 }
 
+BOOST_AUTO_TEST_CASE(testFlatInMemoryCube) {
+    vector<string> ids(100, string("id"));
+    vector<Date> dates(50, Date());
+    Size samples = 200;
+    Size depth = 3;
+    for (auto layout : {NPVCubeLayout::IdDateSample, NPVCubeLayout::DateSampleId}) {
+        SinglePrecisionFlatInMemoryCube c(Date(), ids, dates, samples, depth, layout);
+        BOOST_CHECK_THROW(c.set(1.0, 0, 0, 0, depth), std::exception);
+        BOOST_CHECK_THROW(c.get(0, 0, 0, depth), std::exception);
+        testCube(c, "SinglePrecisionFlatInMemoryCube", 1e-5);
+        DoublePrecisionFlatInMemoryCube d(Date(), ids, dates, samples, depth, layout);
+        testCube(d, "DoublePrecisionFlatInMemoryCube", 1e-14);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(testFlatInMemoryCubeFileIO) {
+    vector<string> ids(100, string("id"));
+    Date d(1, QuantLib::Jan, 2016);
+    vector<Date> dates(50, d);
+    Size samples = 200;
+    Size depth = 2;
+    for (auto layout : {NPVCubeLayout::IdDateSample, NPVCubeLayout::DateSampleId}) {
+        DoublePrecisionFlatInMemoryCube c(d, ids, dates, samples, depth, layout);
+        testCubeFileIO<DoublePrecisionFlatInMemoryCube>(c, "DoublePrecisionFlatInMemoryCube", 1e-14);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(testMemoryMappedCube) {
+    vector<string> ids = {"id1", "id2", "id3"};
+    Date d(1, QuantLib::Jan, 2016);
+    vector<Date> dates(20, d);
+    Size samples = 100;
+    Size depth = 2;
+    string filename = boost::filesystem::unique_path().string();
+    {
+        DoublePrecisionMemoryMappedCube c(filename, d, ids, dates, samples, depth);
+        testCube(c, "DoublePrecisionMemoryMappedCube", 1e-14);
+        c.setT0(42.0, 1, 1);
+        c.save(filename);
+    }
+
+    // reopen read-only, the precision is taken from the file header
+    boost::shared_ptr<NPVCube> c2 = openMemoryMappedCube(filename);
+    BOOST_CHECK(boost::dynamic_pointer_cast<DoublePrecisionMemoryMappedCube>(c2));
+    BOOST_CHECK_EQUAL(c2->asof(), d);
+    BOOST_CHECK(c2->ids() == ids);
+    BOOST_CHECK_EQUAL(c2->samples(), samples);
+    BOOST_CHECK_EQUAL(c2->depth(), depth);
+    BOOST_CHECK_CLOSE(c2->getT0(1, 1), 42.0, 1e-14);
+    checkCube(*c2, 1e-14);
+    BOOST_CHECK_THROW(c2->set(1.0, 0, 0, 0, 0), std::exception);
+    BOOST_CHECK_THROW(SinglePrecisionMemoryMappedCube c3(filename), std::exception);
+    c2.reset();
+
+    boost::filesystem::remove(filename);
+}
+
+BOOST_AUTO_TEST_CASE(testCubeBulkAccess) {
+    vector<string> ids(10, string("id"));
+    Date d(1, QuantLib::Jan, 2016);
+    vector<Date> dates(20, d);
+    Size samples = 50;
+    Size depth = 3;
+    DoublePrecisionInMemoryCube c1(d, ids, dates, samples);
+    testBulkAccess(c1, "DoublePrecisionInMemoryCube", 1e-14);
+    DoublePrecisionInMemoryCubeN c2(d, ids, dates, samples, depth);
+    testBulkAccess(c2, "DoublePrecisionInMemoryCubeN", 1e-14);
+    for (auto layout : {NPVCubeLayout::IdDateSample, NPVCubeLayout::DateSampleId}) {
+        DoublePrecisionFlatInMemoryCube c3(d, ids, dates, samples, depth, layout);
+        testBulkAccess(c3, "DoublePrecisionFlatInMemoryCube", 1e-14);
+    }
+    string filename = boost::filesystem::unique_path().string();
+    {
+        DoublePrecisionMemoryMappedCube c4(filename, d, ids, dates, samples, depth);
+        testBulkAccess(c4, "DoublePrecisionMemoryMappedCube", 1e-14);
+    }
+    boost::filesystem::remove(filename);
+    // default implementation in NPVCube
+    auto c5 = boost::make_shared<DoublePrecisionInMemoryCubeN>(d, ids, dates, 2 * samples, depth);
+    SampleRangeCube c6(c5, samples / 2, samples / 2 + samples);
+    testBulkAccess(c6, "SampleRangeCube", 1e-14);
+}
+
+BOOST_AUTO_TEST_CASE(testSampleRangeCube) {
+    vector<string> ids(10, string("id"));
+    vector<Date> dates(20, Date());
+    Size samples = 100;
+    Size depth = 3;
+    auto cube = boost::make_shared<DoublePrecisionInMemoryCubeN>(Date(), ids, dates, samples, depth);
+
+    // fill the underlying cube through three views on disjoint sample ranges
+    vector<Size> start = {0, 34, 67, 100};
+    vector<boost::shared_ptr<SampleRangeCube>> views;
+    for (Size t = 0; t < 3; ++t) {
+        views.push_back(boost::make_shared<SampleRangeCube>(cube, start[t], start[t + 1]));
+        BOOST_CHECK_EQUAL(views.back()->samples(), start[t + 1] - start[t]);
+        for (Size i = 0; i < cube->numIds(); ++i)
+            for (Size j = 0; j < cube->numDates(); ++j)
+                for (Size k = 0; k < views.back()->samples(); ++k)
+                    for (Size d = 0; d < cube->depth(); ++d)
+                        views.back()->set(i * 1000000.0 + j + (start[t] + k) / 1000000.0 + d * 3, i, j, k, d);
+        BOOST_CHECK_THROW(views.back()->set(1.0, 0, 0, views.back()->samples()), std::exception);
+    }
+    checkCube(*cube, 1e-14);
+
+    // T0 values are kept in the view until they are copied explicitly
+    views.front()->setT0(42.0, 1, 2);
+    BOOST_CHECK_CLOSE(views.front()->getT0(1, 2), 42.0, 1e-14);
+    BOOST_CHECK_SMALL(cube->getT0(1, 2), 1e-14);
+    views.front()->copyT0();
+    BOOST_CHECK_CLOSE(cube->getT0(1, 2), 42.0, 1e-14);
+
+    BOOST_CHECK_THROW(SampleRangeCube(cube, 50, 101), std::exception);
+}
+
+BOOST_AUTO_TEST_CASE(testMergeCubes) {
+    vector<string> ids(10, string("id"));
+    vector<Date> dates(20, Date());
+    Size depth = 2;
+    vector<Size> start = {0, 30, 31, 80};
+
+    // partial cubes holding consecutive sample ranges of the cube initialised by initCube()
+    vector<boost::shared_ptr<NPVCube>> cubes;
+    vector<boost::shared_ptr<AggregationScenarioData>> data;
+    for (Size t = 0; t < 3; ++t) {
+        Size n = start[t + 1] - start[t];
+        auto c = boost::make_shared<DoublePrecisionInMemoryCubeN>(Date(), ids, dates, n, depth);
+        auto a = boost::make_shared<InMemoryAggregationScenarioData>(dates.size(), n);
+        for (Size i = 0; i < ids.size(); ++i) {
+            c->setT0(t + i, i, 1);
+            for (Size j = 0; j < dates.size(); ++j)
+                for (Size k = 0; k < n; ++k)
+                    for (Size d = 0; d < depth; ++d)
+                        c->set(i * 1000000.0 + j + (start[t] + k) / 1000000.0 + d * 3, i, j, k, d);
+        }
+        for (Size j = 0; j < dates.size(); ++j)
+            for (Size k = 0; k < n; ++k)
+                a->set(j, k, j + (start[t] + k) / 1000.0, AggregationScenarioDataType::Numeraire);
+        cubes.push_back(c);
+        data.push_back(a);
+    }
+
+    auto cube = boost::make_shared<DoublePrecisionInMemoryCubeN>(Date(), ids, dates, start.back(), depth);
+    mergeCubes(cubes, cube);
+    checkCube(*cube, 1e-14);
+    for (Size i = 0; i < ids.size(); ++i)
+        BOOST_CHECK_CLOSE(cube->getT0(i, 1), static_cast<Real>(i), 1e-14);
+
+    auto asd = boost::make_shared<InMemoryAggregationScenarioData>(dates.size(), start.back());
+    mergeAggregationScenarioData(data, asd);
+    for (Size j = 0; j < dates.size(); ++j)
+        for (Size k = 0; k < start.back(); ++k)
+            BOOST_CHECK_CLOSE(asd->get(j, k, AggregationScenarioDataType::Numeraire), j + k / 1000.0, 1e-14);
+
+    // sample counts must add up
+    auto tooLarge = boost::make_shared<DoublePrecisionInMemoryCubeN>(Date(), ids, dates, start.back() + 1, depth);
+    BOOST_CHECK_THROW(mergeCubes(cubes, tooLarge), std::exception);
+}
+
+BOOST_AUTO_TEST_CASE(testMergeSensiCubes) {
+    vector<string> ids = {"trade1", "trade2", "trade3"};
+    vector<Size> start = {0, 4, 5, 11};
+
+    // reference cube and partial cubes holding consecutive scenario ranges, only some scenarios move the npv
+    boost::shared_ptr<NPVSensiCube> reference =
+        boost::make_shared<DoublePrecisionSensiCube>(ids, Date(), start.back());
+    vector<boost::shared_ptr<NPVSensiCube>> cubes;
+    for (Size t = 0; t < 3; ++t)
+        cubes.push_back(boost::make_shared<DoublePrecisionSensiCube>(ids, Date(), start[t + 1] - start[t]));
+    for (Size i = 0; i < ids.size(); ++i) {
+        reference->setT0(100.0 + i, i);
+        for (auto const& c : cubes)
+            c->setT0(100.0 + i, i);
+        for (Size t = 0; t < 3; ++t) {
+            for (Size k = start[t]; k < start[t + 1]; ++k) {
+                Real v = (k + i) % 3 == 0 ? 100.0 + i : 100.0 + i + k * 0.5 - 1.0;
+                reference->set(v, i, k);
+                cubes[t]->set(v, i, k - start[t]);
+            }
+        }
+    }
+
+    boost::shared_ptr<NPVSensiCube> cube = boost::make_shared<DoublePrecisionSensiCube>(ids, Date(), start.back());
+    mergeSensiCubes(cubes, cube);
+    BOOST_CHECK(cube->relevantScenarios() == reference->relevantScenarios());
+    for (Size i = 0; i < ids.size(); ++i) {
+        BOOST_CHECK_EQUAL(cube->getT0(i), reference->getT0(i));
+        BOOST_CHECK(cube->getTradeNPVs(i) == reference->getTradeNPVs(i));
+        for (Size k = 0; k < start.back(); ++k)
+            BOOST_CHECK_EQUAL(cube->get(i, k), reference->get(i, k));
+    }
+
+    // sample counts must add up
+    boost::shared_ptr<NPVSensiCube> tooLarge =
+        boost::make_shared<DoublePrecisionSensiCube>(ids, Date(), start.back() + 1);
+    BOOST_CHECK_THROW(mergeSensiCubes(cubes, tooLarge), std::exception);
+}
+
+BOOST_AUTO_TEST_CASE(testSensiCube) {
+    vector<string> ids = {"trade1", "trade2"};
+    boost::shared_ptr<NPVSensiCube> cube = boost::make_shared<DoublePrecisionSensiCube>(ids, Date(), 10);
+    cube->setT0(100.0, 0);
+    cube->setT0(200.0, 1);
+
+    // scenarios in increasing order, base values are not stored
+    cube->set(101.0, 0, 2);
+    cube->set(100.0, 0, 3);
+    cube->set(105.0, 0, 7);
+    // out of order insertion, overwrite and reset to the base value
+    cube->set(99.0, 0, 1);
+    cube->set(104.0, 0, 5);
+    cube->set(106.0, 0, 7);
+    cube->set(100.0, 0, 5);
+    cube->set(201.0, 1, 9);
+
+    std::map<Size, Real> expected = {{1, 99.0}, {2, 101.0}, {7, 106.0}};
+    BOOST_CHECK(cube->getTradeNPVs(0) == expected);
+    vector<std::pair<Size, Real>> visited;
+    cube->forEachTradeNPV(0, [&visited](Size k, Real v) { visited.push_back(std::make_pair(k, v)); });
+    vector<std::pair<Size, Real>> expectedVisited(expected.begin(), expected.end());
+    BOOST_CHECK(visited == expectedVisited);
+    for (Size k = 0; k < cube->samples(); ++k) {
+        auto e = expected.find(k);
+        BOOST_CHECK_EQUAL(cube->get(0, k), e == expected.end() ? 100.0 : e->second);
+    }
+    BOOST_CHECK_EQUAL(cube->get(1, 9), 201.0);
+    BOOST_CHECK_EQUAL(cube->get(1, 2), 200.0);
+    Size scenarios[] = {7, 3, 1};
+    Real npvs[3];
+    BOOST_CHECK_EQUAL(cube->getNPVs(0, 3, scenarios, npvs), 100.0);
+    BOOST_CHECK_EQUAL(npvs[0], 106.0);
+    BOOST_CHECK_EQUAL(npvs[1], 100.0);
+    BOOST_CHECK_EQUAL(npvs[2], 99.0);
+    std::set<Size> expectedScenarios = {1, 2, 5, 7, 9};
+    BOOST_CHECK(cube->relevantScenarios() == expectedScenarios);
+    BOOST_CHECK_THROW(cube->set(1.0, 0, 10), std::exception);
+
+    // write to and read from file
+    string filename = boost::filesystem::unique_path().string();
+    cube->save(filename);
+    boost::shared_ptr<NPVSensiCube> cube2 = boost::make_shared<DoublePrecisionSensiCube>(ids, Date(), 10);
+    cube2->load(filename);
+    boost::filesystem::remove(filename);
+    BOOST_CHECK(cube2->relevantScenarios() == cube->relevantScenarios());
+    for (Size i = 0; i < ids.size(); ++i) {
+        BOOST_CHECK_EQUAL(cube2->getT0(i), cube->getT0(i));
+        BOOST_CHECK(cube2->getTradeNPVs(i) == cube->getTradeNPVs(i));
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 BOOST_AUTO_TEST_SUITE_END()
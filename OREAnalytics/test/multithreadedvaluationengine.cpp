@@ -0,0 +1,209 @@
+/*
+ Copyright (C) 2023 Quaternion Risk Management Ltd
+ All rights reserved.
+
+ This file is part of ORE, a free-software/open-source library
+ for transparent pricing and risk analysis - http://opensourcerisk.org
+
+ ORE is free software: you can redistribute it and/or modify it
+ under the terms of the Modified BSD License.  You should have received a
+ copy of the license along with this program.
+ The license is also available online at <http://opensourcerisk.org>
+
+ This program is distributed on the basis that it will form a useful
+ contribution to risk analytics and model standardisation, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ FITNESS FOR A PARTICULAR PURPOSE. See the license for more details.
+*/
+
+#include <boost/test/unit_test.hpp>
+#include <orea/cube/inmemorycube.hpp>
+#include <orea/engine/multithreadedvaluationengine.hpp>
+#include <orea/engine/valuationcalculator.hpp>
+#include <orea/engine/valuationengine.hpp>
+#include <orea/scenario/aggregationscenariodata.hpp>
+#include <orea/scenario/crossassetmodelscenariogenerator.hpp>
+#include <orea/scenario/scenariosimmarket.hpp>
+#include <orea/scenario/scenariosimmarketparameters.hpp>
+#include <orea/scenario/simplescenariofactory.hpp>
+#include <ored/configuration/conventions.hpp>
+#include <ored/model/crossassetmodelbuilder.hpp>
+#include <ored/model/fxbsdata.hpp>
+#include <ored/model/irlgmdata.hpp>
+#include <ored/portfolio/builders/swap.hpp>
+#include <ored/portfolio/portfolio.hpp>
+#include <ored/portfolio/swap.hpp>
+#include <ored/utilities/to_string.hpp>
+#include <oret/toplevelfixture.hpp>
+#include <ql/indexes/indexmanager.hpp>
+#include <ql/math/comparison.hpp>
+#include <ql/quotes/simplequote.hpp>
+#include <ql/time/calendars/target.hpp>
+#include <qle/methods/multipathgeneratorbase.hpp>
+#include <test/oreatoplevelfixture.hpp>
+#include <test/testmarket.hpp>
+
+using namespace std;
+using namespace QuantLib;
+using namespace QuantExt;
+using namespace ore::data;
+using namespace ore::analytics;
+
+using testsuite::TestMarket;
+
+namespace {
+
+boost::shared_ptr<Portfolio> buildPortfolio(const boost::shared_ptr<EngineFactory>& factory) {
+    boost::shared_ptr<Portfolio> portfolio = boost::make_shared<Portfolio>();
+    Date today = Settings::instance().evaluationDate();
+    Calendar cal = TARGET();
+    vector<tuple<string, string, string, Size, Real>> swaps = {{"EUR", "EUR-EURIBOR-6M", "6M", 10, 0.02},
+                                                               {"EUR", "EUR-EURIBOR-6M", "6M", 3, 0.01},
+                                                               {"USD", "USD-LIBOR-3M", "3M", 7, 0.025}};
+    for (Size i = 0; i < swaps.size(); ++i) {
+        auto [ccy, index, floatFreq, term, fixedRate] = swaps[i];
+        Date startDate = cal.adjust(today + 1 * Months);
+        string start = to_string(startDate);
+        string end = to_string(cal.adjust(startDate + term * Years));
+        ScheduleData floatSchedule(ScheduleRules(start, end, floatFreq, "TARGET", "MF", "MF", "Forward"));
+        ScheduleData fixedSchedule(ScheduleRules(start, end, "1Y", "TARGET", "MF", "MF", "Forward"));
+        bool isPayer = i % 2 == 0;
+        LegData fixedLeg(boost::make_shared<FixedLegData>(vector<double>(1, fixedRate)), isPayer, ccy, fixedSchedule,
+                         "30/360", vector<double>(1, 1000000));
+        LegData floatingLeg(boost::make_shared<FloatingLegData>(index, 2, false, vector<double>(1, 0.0)), !isPayer,
+                            ccy, floatSchedule, "ACT/360", vector<double>(1, 1000000));
+        boost::shared_ptr<Trade> swap = boost::make_shared<ore::data::Swap>(Envelope("CP"), floatingLeg, fixedLeg);
+        swap->id() = "SWAP_" + to_string(i);
+        portfolio->add(swap);
+    }
+    portfolio->build(factory);
+    return portfolio;
+}
+
+// builds market, simulation market, scenario generator and portfolio on the calling thread
+MultiThreadedValuationEngine::WorkerContext buildContext(const Date& today, const boost::shared_ptr<DateGrid>& dg) {
+    boost::shared_ptr<Market> initMarket = boost::make_shared<TestMarket>(today);
+
+    auto parameters = boost::make_shared<ScenarioSimMarketParameters>();
+    parameters->baseCcy() = "EUR";
+    parameters->setDiscountCurveNames({"EUR", "USD"});
+    parameters->setYieldCurveTenors("", {1 * Months, 6 * Months, 1 * Years, 2 * Years, 5 * Years, 10 * Years});
+    parameters->setIndices({"EUR-EURIBOR-6M", "USD-LIBOR-3M"});
+    parameters->interpolation() = "LogLinear";
+    parameters->setSimulateSwapVols(false);
+    parameters->setSimulateFXVols(false);
+    parameters->setFxCcyPairs({"USDEUR"});
+    parameters->additionalScenarioDataIndices() = {"EUR-EURIBOR-6M", "USD-LIBOR-3M"};
+    parameters->additionalScenarioDataCcys() = {"EUR", "USD"};
+
+    vector<string> swaptionExpiries = {"1Y", "2Y", "3Y", "5Y", "7Y", "10Y"};
+    vector<string> swaptionTerms(swaptionExpiries.size(), "5Y");
+    vector<string> swaptionStrikes(swaptionExpiries.size(), "ATM");
+    vector<boost::shared_ptr<IrModelData>> irConfigs;
+    for (auto const& [ccy, h, a] : vector<tuple<string, Real, Real>>{{"EUR", 0.02, 0.008}, {"USD", 0.03, 0.009}}) {
+        irConfigs.push_back(boost::make_shared<IrLgmData>(
+            ccy, CalibrationType::Bootstrap, LgmData::ReversionType::HullWhite, LgmData::VolatilityType::Hagan, false,
+            ParamType::Constant, vector<Time>(), vector<Real>(1, h), true, ParamType::Piecewise, vector<Time>(),
+            vector<Real>(1, a), 0.0, 1.0, swaptionExpiries, swaptionTerms, swaptionStrikes));
+    }
+    vector<string> optionExpiries = {"1Y", "2Y", "3Y", "5Y", "7Y", "10Y"};
+    vector<boost::shared_ptr<FxBsData>> fxConfigs = {boost::make_shared<FxBsData>(
+        "USD", "EUR", CalibrationType::Bootstrap, true, ParamType::Piecewise, vector<Time>(), vector<Real>(1, 0.15),
+        optionExpiries, vector<string>(optionExpiries.size(), "ATMF"))};
+    map<CorrelationKey, Handle<Quote>> corr;
+    corr[make_pair(CorrelationFactor{CrossAssetModel::AssetType::IR, "EUR", 0},
+                   CorrelationFactor{CrossAssetModel::AssetType::IR, "USD", 0})] =
+        Handle<Quote>(boost::make_shared<SimpleQuote>(0.6));
+    auto config = boost::make_shared<CrossAssetModelData>(irConfigs, fxConfigs, corr);
+    boost::shared_ptr<CrossAssetModel> model = *CrossAssetModelBuilder(initMarket, config).model();
+
+    auto pathGen = boost::make_shared<MultiPathGeneratorMersenneTwister>(model->stateProcess(), dg->timeGrid(), 42);
+
+    MultiThreadedValuationEngine::WorkerContext context;
+    context.simMarket = boost::make_shared<ScenarioSimMarket>(initMarket, parameters);
+    context.simMarket->scenarioGenerator() = boost::make_shared<CrossAssetModelScenarioGenerator>(
+        model, pathGen, boost::make_shared<SimpleScenarioFactory>(), parameters, today, dg, initMarket);
+
+    auto data = boost::make_shared<EngineData>();
+    data->model("Swap") = "DiscountedCashflows";
+    data->engine("Swap") = "DiscountingSwapEngine";
+    auto factory = boost::make_shared<EngineFactory>(data, context.simMarket);
+    factory->registerBuilder(boost::make_shared<SwapEngineBuilder>());
+    context.portfolio = buildPortfolio(factory);
+    context.calculators.push_back(boost::make_shared<NPVCalculator>("EUR"));
+    return context;
+}
+
+} // namespace
+
+BOOST_FIXTURE_TEST_SUITE(OREAnalyticsTestSuite, ore::test::OreaTopLevelFixture)
+
+BOOST_AUTO_TEST_SUITE(MultiThreadedValuationEngineTest)
+
+BOOST_AUTO_TEST_CASE(testAgainstSingleThreadedValuationEngine) {
+
+    BOOST_TEST_MESSAGE("Testing multi-threaded valuation engine against single-threaded valuation engine...");
+
+    SavedSettings backup;
+    Date today(14, April, 2016);
+    Settings::instance().evaluationDate() = today;
+
+    auto conventions = boost::make_shared<Conventions>();
+    conventions->add(boost::make_shared<IRSwapConvention>("EUR-6M-SWAP-CONVENTIONS", "TARGET", "Annual", "MF",
+                                                          "30/360", "EUR-EURIBOR-6M"));
+    InstrumentConventions::instance().setConventions(conventions);
+
+    auto dg = boost::make_shared<DateGrid>("10,1Y");
+    Size samples = 20;
+
+    // reference cube and scenario data from the single-threaded engine
+    auto reference = buildContext(today, dg);
+    auto referenceCube =
+        boost::make_shared<DoublePrecisionInMemoryCube>(today, reference.portfolio->ids(), dg->dates(), samples);
+    auto referenceData = boost::make_shared<InMemoryAggregationScenarioData>(dg->size(), samples);
+    reference.simMarket->aggregationScenarioData() = referenceData;
+    ValuationEngine(today, dg, reference.simMarket)
+        .buildCube(reference.portfolio, referenceCube, reference.calculators);
+
+    auto builder = [&today, &dg]() { return buildContext(today, dg); };
+    for (Size nThreads : {1, 3}) {
+#ifndef QL_ENABLE_SESSIONS
+        if (nThreads > 1) {
+            BOOST_CHECK_THROW(MultiThreadedValuationEngine(nThreads, today, dg, builder), QuantLib::Error);
+            continue;
+        }
+#endif
+        auto cube =
+            boost::make_shared<DoublePrecisionInMemoryCube>(today, reference.portfolio->ids(), dg->dates(), samples);
+        auto scenarioData = boost::make_shared<InMemoryAggregationScenarioData>(dg->size(), samples);
+        MultiThreadedValuationEngine(nThreads, today, dg, builder)
+            .buildCube(cube, true, nullptr, nullptr, scenarioData);
+
+        // each sample is valued by the same code on the same scenario, so the results must be identical
+        for (Size i = 0; i < cube->numIds(); ++i) {
+            BOOST_CHECK_EQUAL(cube->getT0(i), referenceCube->getT0(i));
+            for (Size j = 0; j < cube->numDates(); ++j) {
+                for (Size k = 0; k < samples; ++k) {
+                    if (cube->get(i, j, k) != referenceCube->get(i, j, k))
+                        BOOST_ERROR("cube value mismatch for " << nThreads << " threads, trade " << i << ", date "
+                                                               << j << ", sample " << k << ": " << cube->get(i, j, k)
+                                                               << ", expected " << referenceCube->get(i, j, k));
+                }
+            }
+        }
+        for (Size j = 0; j < dg->size(); ++j) {
+            for (Size k = 0; k < samples; ++k) {
+                BOOST_CHECK_EQUAL(scenarioData->get(j, k, AggregationScenarioDataType::IndexFixing, "EUR-EURIBOR-6M"),
+                                  referenceData->get(j, k, AggregationScenarioDataType::IndexFixing, "EUR-EURIBOR-6M"));
+                BOOST_CHECK_EQUAL(scenarioData->get(j, k, AggregationScenarioDataType::FXSpot, "USD"),
+                                  referenceData->get(j, k, AggregationScenarioDataType::FXSpot, "USD"));
+            }
+        }
+    }
+
+    IndexManager::instance().clearHistories();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE_END()
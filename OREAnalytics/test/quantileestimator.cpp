@@ -0,0 +1,74 @@
+/*
+ Copyright (C) 2023 Quaternion Risk Management Ltd
+ All rights reserved.
+
+ This file is part of ORE, a free-software/open-source library
+ for transparent pricing and risk analysis - http://opensourcerisk.org
+
+ ORE is free software: you can redistribute it and/or modify it
+ under the terms of the Modified BSD License.  You should have received a
+ copy of the license along with this program.
+ The license is also available online at <http://opensourcerisk.org>
+
+ This program is distributed on the basis that it will form a useful
+ contribution to risk analytics and model standardisation, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ FITNESS FOR A PARTICULAR PURPOSE. See the license for more details.
+*/
+
+#include <boost/test/unit_test.hpp>
+#include <orea/aggregation/quantileestimator.hpp>
+#include <oret/toplevelfixture.hpp>
+#include <test/oreatoplevelfixture.hpp>
+
+#include <ql/math/randomnumbers/mt19937uniformrng.hpp>
+
+#include <algorithm>
+
+using namespace ore::analytics;
+using namespace QuantLib;
+using namespace boost::unit_test_framework;
+using std::vector;
+
+BOOST_FIXTURE_TEST_SUITE(OREAnalyticsTestSuite, ore::test::OreaTopLevelFixture)
+
+BOOST_AUTO_TEST_SUITE(QuantileEstimatorTest)
+
+BOOST_AUTO_TEST_CASE(testExactQuantile) {
+
+    BOOST_TEST_MESSAGE("Testing exact quantile against sorted samples...");
+
+    MersenneTwisterUniformRng rng(42);
+    for (Size samples : {1, 2, 7, 100, 1000}) {
+        for (Real quantile : {0.0, 0.5, 0.95, 0.99, 1.0}) {
+            QuantileEstimator estimator(quantile, samples);
+            // the estimator is reused for several distributions
+            for (Size n = 0; n < 3; ++n) {
+                vector<Real> values(samples);
+                for (Size k = 0; k < samples; ++k)
+                    values[k] = rng.nextReal() - 0.5;
+                vector<Real> sorted(values);
+                std::sort(sorted.begin(), sorted.end());
+                Real expected = sorted[Size(std::floor(quantile * (samples - 1) + 0.5))];
+                BOOST_CHECK_EQUAL(estimator.value(values), expected);
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(testSampleCount) {
+
+    BOOST_TEST_MESSAGE("Testing quantile estimator sample count checks...");
+
+    QuantileEstimator estimator(0.95, 3);
+    vector<Real> distribution = {3.0, 1.0, 2.0};
+    BOOST_CHECK_EQUAL(estimator.value(distribution), 3.0);
+    vector<Real> tooSmall = {1.0, 2.0};
+    BOOST_CHECK_THROW(estimator.value(tooSmall), QuantLib::Error);
+    BOOST_CHECK_THROW(QuantileEstimator(1.5, 3), QuantLib::Error);
+    BOOST_CHECK_THROW(QuantileEstimator(0.95, 0), QuantLib::Error);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE_END()
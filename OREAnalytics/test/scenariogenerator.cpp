@@ -1264,6 +1264,68 @@ BOOST_AUTO_TEST_CASE(testCpiSwapExposure) {
                                                     << capNpv << "), tolerance is " << tol);
 }
 
+BOOST_AUTO_TEST_CASE(testSimpleScenarioSharedKeys) {
+    BOOST_TEST_MESSAGE("Testing SimpleScenario with a shared key table...");
+
+    Date today(15, February, 2023);
+    std::vector<RiskFactorKey> keys = {RiskFactorKey(RiskFactorKey::KeyType::DiscountCurve, "EUR", 0),
+                                       RiskFactorKey(RiskFactorKey::KeyType::DiscountCurve, "EUR", 1),
+                                       RiskFactorKey(RiskFactorKey::KeyType::FXSpot, "USDEUR", 0)};
+
+    // the first scenario builds the key table
+    auto s1 = boost::make_shared<SimpleScenario>(today);
+    for (Size i = 0; i < keys.size(); ++i)
+        s1->add(keys[i], 1.0 + i);
+    BOOST_REQUIRE_EQUAL(s1->keys().size(), keys.size());
+    for (Size i = 0; i < keys.size(); ++i) {
+        BOOST_CHECK(s1->keys()[i] == keys[i]);
+        BOOST_CHECK_EQUAL(s1->data()[i], 1.0 + i);
+    }
+
+    // further scenarios share the key table, keys may be added in a different order
+    SimpleScenarioFactory factory;
+    auto s2 = factory.buildScenario(today, s1->sharedData());
+    BOOST_CHECK(s2->sharedData() == s1->sharedData());
+    for (Size i = keys.size(); i > 0; --i)
+        s2->add(keys[i - 1], 10.0 + i - 1);
+    BOOST_CHECK(s2->sharedData() == s1->sharedData());
+    for (Size i = 0; i < keys.size(); ++i) {
+        BOOST_CHECK(s2->has(keys[i]));
+        BOOST_CHECK_EQUAL(s2->get(keys[i]), 10.0 + i);
+        BOOST_CHECK_EQUAL(s1->get(keys[i]), 1.0 + i);
+    }
+
+    // adding a new key must not modify the shared table
+    RiskFactorKey newKey(RiskFactorKey::KeyType::FXSpot, "GBPEUR", 0);
+    s2->add(newKey, 42.0);
+    BOOST_CHECK(s2->sharedData() != s1->sharedData());
+    BOOST_CHECK(s2->has(newKey));
+    BOOST_CHECK_EQUAL(s2->get(newKey), 42.0);
+    BOOST_CHECK(!s1->has(newKey));
+    BOOST_CHECK_EQUAL(s1->keys().size(), keys.size());
+    BOOST_CHECK_EQUAL(s2->keys().size(), keys.size() + 1);
+
+    // a clone shares the key table and has its own values
+    auto s3 = boost::dynamic_pointer_cast<SimpleScenario>(s1->clone());
+    BOOST_REQUIRE(s3);
+    BOOST_CHECK(s3->sharedData() == s1->sharedData());
+    s3->add(keys[0], -1.0);
+    BOOST_CHECK_EQUAL(s3->get(keys[0]), -1.0);
+    BOOST_CHECK_EQUAL(s1->get(keys[0]), 1.0);
+    BOOST_CHECK_THROW(s3->get(newKey), QuantLib::Error);
+
+    // keys of the table that are not added to a scenario are not provided by it
+    auto s4 = factory.buildScenario(today, s1->sharedData());
+    s4->add(keys[0], 5.0);
+    BOOST_CHECK(s4->sharedData() == s1->sharedData());
+    BOOST_CHECK(s4->has(keys[0]));
+    BOOST_CHECK_EQUAL(s4->get(keys[0]), 5.0);
+    for (Size i = 1; i < keys.size(); ++i) {
+        BOOST_CHECK(!s4->has(keys[i]));
+        BOOST_CHECK_THROW(s4->get(keys[i]), QuantLib::Error);
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 BOOST_AUTO_TEST_SUITE_END()
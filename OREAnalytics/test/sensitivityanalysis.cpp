@@ -2012,6 +2012,88 @@ BOOST_AUTO_TEST_CASE(testCrossGamma) {
     IndexManager::instance().clearHistories();
 }
 
+BOOST_AUTO_TEST_CASE(testParallelSensitivityAnalysis) {
+
+    BOOST_TEST_MESSAGE("Testing sensitivity analysis on several threads against the sequential run...");
+
+    SavedSettings backup;
+
+    ObservationMode::Mode backupMode = ObservationMode::instance().mode();
+    ObservationMode::instance().setMode(ObservationMode::Mode::None);
+
+    Date today = Date(14, April, 2016);
+    Settings::instance().evaluationDate() = today;
+
+    boost::shared_ptr<analytics::ScenarioSimMarketParameters> simMarketData =
+        TestConfigurationObjects::setupSimMarketData5();
+    boost::shared_ptr<SensitivityScenarioData> sensiData = TestConfigurationObjects::setupSensitivityScenarioData5();
+
+    boost::shared_ptr<EngineData> data = boost::make_shared<EngineData>();
+    data->model("Swap") = "DiscountedCashflows";
+    data->engine("Swap") = "DiscountingSwapEngine";
+    data->model("EuropeanSwaption") = "BlackBachelier";
+    data->engine("EuropeanSwaption") = "BlackBachelierSwaptionEngine";
+    data->model("FxOption") = "GarmanKohlhagen";
+    data->engine("FxOption") = "AnalyticEuropeanEngine";
+
+    // each worker builds its own market and loads its own (unbuilt) portfolio
+    auto marketBuilder = [today]() -> boost::shared_ptr<Market> { return boost::make_shared<TestMarket>(today); };
+    auto portfolioLoader = []() {
+        boost::shared_ptr<Portfolio> portfolio(new Portfolio());
+        portfolio->add(buildSwap("1_Swap_EUR", "EUR", true, 10000000.0, 0, 10, 0.03, 0.00, "1Y", "30/360", "6M",
+                                 "A360", "EUR-EURIBOR-6M"));
+        portfolio->add(buildSwap("2_Swap_USD", "USD", true, 10000000.0, 0, 15, 0.02, 0.00, "6M", "30/360", "3M",
+                                 "A360", "USD-LIBOR-3M"));
+        portfolio->add(buildEuropeanSwaption("3_Swaption_EUR", "Long", "EUR", true, 1000000.0, 10, 10, 0.02, 0.00,
+                                             "1Y", "30/360", "6M", "A360", "EUR-EURIBOR-6M", "Physical"));
+        portfolio->add(buildFxOption("4_FxOption_EUR_USD", "Long", "Call", 3, "EUR", 10000000.0, "USD", 11000000.0));
+        return portfolio;
+    };
+
+    auto reference = boost::make_shared<SensitivityAnalysis>(portfolioLoader(), marketBuilder(),
+                                                             Market::defaultConfiguration, data, simMarketData,
+                                                             sensiData, false);
+    reference->generateSensitivities();
+    const boost::shared_ptr<NPVSensiCube>& referenceCube = reference->sensiCube()->npvCube();
+
+    for (Size nThreads : {1, 3}) {
+        auto sa = boost::make_shared<SensitivityAnalysis>(portfolioLoader(), marketBuilder(),
+                                                          Market::defaultConfiguration, data, simMarketData,
+                                                          sensiData, false);
+#ifndef QL_ENABLE_SESSIONS
+        if (nThreads > 1) {
+            BOOST_CHECK_THROW(sa->setParallel(nThreads, marketBuilder, portfolioLoader), QuantLib::Error);
+            continue;
+        }
+#endif
+        sa->setParallel(nThreads, marketBuilder, portfolioLoader);
+        sa->generateSensitivities();
+
+        // each scenario is valued by the same code on the same market, so the results must be identical
+        const boost::shared_ptr<NPVSensiCube>& cube = sa->sensiCube()->npvCube();
+        BOOST_REQUIRE(cube->ids() == referenceCube->ids());
+        BOOST_REQUIRE_EQUAL(cube->samples(), referenceCube->samples());
+        for (Size i = 0; i < cube->numIds(); ++i) {
+            BOOST_CHECK_EQUAL(cube->getT0(i), referenceCube->getT0(i));
+            for (Size k = 0; k < cube->samples(); ++k) {
+                if (cube->get(i, 0, k) != referenceCube->get(i, 0, k))
+                    BOOST_ERROR("sensi cube value mismatch for " << nThreads << " threads, trade " << i
+                                                                 << ", scenario " << k << ": " << cube->get(i, 0, k)
+                                                                 << ", expected " << referenceCube->get(i, 0, k));
+            }
+        }
+        for (auto const& t : reference->portfolio()->trades()) {
+            for (auto const& f : reference->sensiCube()->factors()) {
+                BOOST_CHECK_EQUAL(sa->sensiCube()->delta(t->id(), f), reference->sensiCube()->delta(t->id(), f));
+                BOOST_CHECK_EQUAL(sa->sensiCube()->gamma(t->id(), f), reference->sensiCube()->gamma(t->id(), f));
+            }
+        }
+    }
+
+    ObservationMode::instance().setMode(backupMode);
+    IndexManager::instance().clearHistories();
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 BOOST_AUTO_TEST_SUITE_END()
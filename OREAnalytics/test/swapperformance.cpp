@@ -21,6 +21,7 @@
 #include <orea/cube/inmemorycube.hpp>
 #include <orea/cube/npvcube.hpp>
 #include <orea/engine/filteredsensitivitystream.hpp>
+#include <orea/engine/linearbookcalculator.hpp>
 #include <orea/engine/observationmode.hpp>
 #include <orea/engine/parametricvar.hpp>
 #include <orea/engine/riskfilter.hpp>
@@ -52,6 +53,7 @@
 #include <ql/time/date.hpp>
 #include <ql/time/daycounters/actualactual.hpp>
 #include <qle/methods/multipathgeneratorbase.hpp>
+#include <qle/pricingengines/discountingswapenginemulticurve.hpp>
 #include <test/oreatoplevelfixture.hpp>
 #include <test/testmarket.hpp>
 
@@ -243,8 +245,10 @@ boost::shared_ptr<Portfolio> buildPortfolio(Size portfolioSize, boost::shared_pt
 }
 
 void test_performance(Size portfolioSize, ObservationMode::Mode om, double nonZeroPVRatio, vector<Real>& epe_archived,
-                      vector<Real>& ene_archived) {
-    BOOST_TEST_MESSAGE("Testing Swap Exposure Performance size=" << portfolioSize << "...");
+                      vector<Real>& ene_archived, bool linearBook = false) {
+    BOOST_TEST_MESSAGE("Testing Swap Exposure Performance size=" << portfolioSize
+                                                                 << (linearBook ? " with linear book calculator" : "")
+                                                                 << "...");
 
     SavedSettings backup;
     ObservationMode::Mode backupOm = ObservationMode::instance().mode();
@@ -421,7 +425,13 @@ void test_performance(Size portfolioSize, ObservationMode::Mode om, double nonZe
     boost::shared_ptr<NPVCube> cube =
         boost::make_shared<DoublePrecisionInMemoryCube>(today, portfolio->ids(), dg->dates(), samples);
     vector<boost::shared_ptr<ValuationCalculator>> calculators;
-    calculators.push_back(boost::make_shared<NPVCalculator>(baseCcy));
+    boost::shared_ptr<LinearBookNPVCalculator> linearBookCalculator;
+    if (linearBook) {
+        linearBookCalculator = boost::make_shared<LinearBookNPVCalculator>(baseCcy);
+        calculators.push_back(linearBookCalculator);
+    } else {
+        calculators.push_back(boost::make_shared<NPVCalculator>(baseCcy));
+    }
     valEngine.buildCube(portfolio, cube, calculators);
     t.stop();
     double elapsed = t.elapsed().wall * 1e-9;
@@ -473,6 +483,8 @@ void test_performance(Size portfolioSize, ObservationMode::Mode om, double nonZe
     IndexManager::instance().clearHistories();
 
     // check results
+    if (linearBook)
+        BOOST_CHECK_EQUAL(linearBookCalculator->compiledTrades(), portfolio->size());
     BOOST_CHECK_CLOSE(nonZeroPVRatio, nonZeroPerc, 0.005);
 
     for (Size i = 0; i < epe_archived.size(); ++i) {
@@ -563,6 +575,71 @@ BOOST_AUTO_TEST_CASE(testSingleSwapPerformanceUnregisterObs) {
     test_performance(1, ObservationMode::Mode::None, 98.75, single_swap_epe_archived, single_swap_ene_archived);
 }
 
+BOOST_AUTO_TEST_CASE(testSwapEngineStaticDataCachePerformance) {
+    BOOST_TEST_MESSAGE("Testing swap engine performance with and without cached static leg data...");
+
+    SavedSettings backup;
+    Date today = Date(14, April, 2016);
+    Settings::instance().evaluationDate() = today;
+
+    convs();
+    boost::shared_ptr<Market> market = boost::make_shared<TestMarket>(today);
+    boost::shared_ptr<EngineData> data = boost::make_shared<EngineData>();
+    data->model("Swap") = "DiscountedCashflows";
+    data->engine("Swap") = "DiscountingSwapEngineOptimised";
+    boost::shared_ptr<EngineFactory> factory = boost::make_shared<EngineFactory>(data, market);
+    factory->registerBuilder(boost::make_shared<SwapEngineBuilderOptimised>());
+    boost::shared_ptr<Portfolio> portfolio = buildPortfolio(100, factory);
+
+    // reprice the portfolio as often as in a small simulation, first without, then with the cache
+    Size repetitions = 1000;
+    vector<Real> npvs[2];
+    double elapsed[2];
+    for (Size c = 0; c < 2; ++c) {
+        map<string, boost::shared_ptr<PricingEngine>> engines;
+        for (auto const& t : portfolio->trades()) {
+            auto& engine = engines[t->npvCurrency()];
+            if (!engine)
+                engine = boost::make_shared<QuantExt::DiscountingSwapEngineMultiCurve>(
+                    market->discountCurve(t->npvCurrency()), true, boost::none, Date(), Date(), c == 1);
+            t->instrument()->qlInstrument()->setPricingEngine(engine);
+        }
+        boost::timer::cpu_timer timer;
+        for (Size r = 0; r < repetitions; ++r) {
+            for (auto const& t : portfolio->trades()) {
+                t->instrument()->qlInstrument()->recalculate();
+                npvs[c].push_back(t->instrument()->NPV());
+            }
+        }
+        elapsed[c] = timer.elapsed().wall * 1e-9;
+    }
+
+    Size n = repetitions * portfolio->size();
+    BOOST_TEST_MESSAGE("Avg pricing time without cache = " << elapsed[0] * 1.0E6 / n << " microseconds");
+    BOOST_TEST_MESSAGE("Avg pricing time with cache    = " << elapsed[1] * 1.0E6 / n << " microseconds");
+    BOOST_TEST_MESSAGE("Speed up                       = " << elapsed[0] / elapsed[1]);
+
+    BOOST_REQUIRE_EQUAL(npvs[0].size(), n);
+    BOOST_REQUIRE_EQUAL(npvs[1].size(), n);
+    for (Size i = 0; i < n; ++i)
+        BOOST_CHECK_CLOSE(npvs[0][i], npvs[1][i], 1.0E-10);
+}
+
+BOOST_AUTO_TEST_CASE(testSwapPerformanceLinearBook) {
+    BOOST_TEST_MESSAGE("Testing Swap Performance (linear book calculator)");
+    test_performance(100, ObservationMode::Mode::None, 70.5875, swap_epe_archived, swap_ene_archived, true);
+}
+
+BOOST_AUTO_TEST_CASE(testSwapPerformanceLinearBookDisableObs) {
+    BOOST_TEST_MESSAGE("Testing Swap Performance (linear book calculator, Disable observation mode)");
+    test_performance(100, ObservationMode::Mode::Disable, 70.5875, swap_epe_archived, swap_ene_archived, true);
+}
+
+BOOST_AUTO_TEST_CASE(testSwapPerformanceLinearBookUnregisterObs) {
+    BOOST_TEST_MESSAGE("Testing Swap Performance (linear book calculator, Unregister observation mode)");
+    test_performance(100, ObservationMode::Mode::Unregister, 70.5875, swap_epe_archived, swap_ene_archived, true);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 BOOST_AUTO_TEST_SUITE_END()
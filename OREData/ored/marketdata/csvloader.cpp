@@ -22,28 +22,119 @@
 */
 
 #include <algorithm>
-#include <boost/algorithm/string.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <charconv>
+#include <cmath>
+#include <exception>
 #include <fstream>
+#include <limits>
 #include <map>
 #include <ored/marketdata/csvloader.hpp>
 #include <ored/marketdata/marketdatumparser.hpp>
 #include <ored/utilities/log.hpp>
+#include <ored/utilities/parallelfor.hpp>
 #include <ored/utilities/parsers.hpp>
+#include <string_view>
 
 using namespace std;
 
 namespace ore {
 namespace data {
 
-CSVLoader::CSVLoader(const string& marketFilename, const string& fixingFilename, bool implyTodaysFixings)
-    : CSVLoader(marketFilename, fixingFilename, "", implyTodaysFixings) {}
+namespace {
 
-CSVLoader::CSVLoader(const vector<string>& marketFiles, const vector<string>& fixingFiles, bool implyTodaysFixings)
-    : CSVLoader(marketFiles, fixingFiles, {}, implyTodaysFixings) {}
+// the characters removed by boost::trim()
+bool isSpace(const char c) { return c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' || c == '\r'; }
+
+bool isDelimiter(const char c) { return c == ',' || c == ';' || c == '\t' || c == ' '; }
+
+/* split a line into tokens like boost::split(tokens, line, boost::is_any_of(",;\t "), boost::token_compress_on), but
+   stop after max tokens, returns the number of tokens found */
+Size tokenise(const string_view& line, string_view* tokens, const Size max) {
+    Size n = 0;
+    Size pos = 0;
+    while (n < max) {
+        Size end = pos;
+        while (end < line.size() && !isDelimiter(line[end]))
+            ++end;
+        tokens[n++] = line.substr(pos, end - pos);
+        if (end == line.size())
+            break;
+        pos = end;
+        while (pos < line.size() && isDelimiter(line[pos]))
+            ++pos;
+        if (pos == line.size()) {
+            if (n < max)
+                tokens[n++] = string_view();
+            break;
+        }
+    }
+    return n;
+}
+
+// the value of the digits s[pos], ..., s[pos + n - 1] or -1 if one of them is not a digit
+int digits(const string_view& s, const Size pos, const Size n) {
+    int result = 0;
+    for (Size i = pos; i < pos + n; ++i) {
+        if (s[i] < '0' || s[i] > '9')
+            return -1;
+        result = 10 * result + (s[i] - '0');
+    }
+    return result;
+}
+
+// parseDate() with a fast path for YYYY-MM-DD and YYYYMMDD
+Date parseCsvDate(const string_view& s) {
+    int y = -1, m = -1, d = -1;
+    if (s.size() == 10 && s[4] == '-' && s[7] == '-') {
+        y = digits(s, 0, 4);
+        m = digits(s, 5, 2);
+        d = digits(s, 8, 2);
+    } else if (s.size() == 8) {
+        y = digits(s, 0, 4);
+        m = digits(s, 4, 2);
+        d = digits(s, 6, 2);
+    }
+    if (y >= 0 && m >= 0 && d >= 0)
+        return Date(d, Month(m), y);
+    return parseDate(string(s));
+}
+
+/* parseReal() with a fast path for numbers that from_chars() reads completely, subnormal results are left to
+   parseReal(), since std::stod() throws an out of range error for them */
+Real parseCsvReal(const string_view& s) {
+#ifdef __cpp_lib_to_chars
+    Real result;
+    auto [ptr, ec] = std::from_chars(s.data(), s.data() + s.size(), result);
+    if (ec == std::errc() && ptr == s.data() + s.size() &&
+        (result == 0.0 || std::fabs(result) >= std::numeric_limits<Real>::min()))
+        return result;
+#endif
+    return parseReal(string(s));
+}
+
+// a parsed line of a file, the key points into the mapped file
+struct CsvLine {
+    Date date;
+    string_view key;
+    Real value;
+    boost::shared_ptr<MarketDatum> datum;
+};
+
+} // namespace
+
+CSVLoader::CSVLoader(const string& marketFilename, const string& fixingFilename, bool implyTodaysFixings,
+                     Size nThreads)
+    : CSVLoader(marketFilename, fixingFilename, "", implyTodaysFixings, nThreads) {}
+
+CSVLoader::CSVLoader(const vector<string>& marketFiles, const vector<string>& fixingFiles, bool implyTodaysFixings,
+                     Size nThreads)
+    : CSVLoader(marketFiles, fixingFiles, {}, implyTodaysFixings, nThreads) {}
 
 CSVLoader::CSVLoader(const string& marketFilename, const string& fixingFilename, const string& dividendFilename,
-                     bool implyTodaysFixings)
-    : implyTodaysFixings_(implyTodaysFixings) {
+                     bool implyTodaysFixings, Size nThreads)
+    : implyTodaysFixings_(implyTodaysFixings), nThreads_(nThreads) {
 
     // load market data
     loadFile(marketFilename, DataType::Market);
@@ -66,8 +157,8 @@ CSVLoader::CSVLoader(const string& marketFilename, const string& fixingFilename,
 }
 
 CSVLoader::CSVLoader(const vector<string>& marketFiles, const vector<string>& fixingFiles,
-                     const vector<string>& dividendFiles, bool implyTodaysFixings)
-    : implyTodaysFixings_(implyTodaysFixings) {
+                     const vector<string>& dividendFiles, bool implyTodaysFixings, Size nThreads)
+    : implyTodaysFixings_(implyTodaysFixings), nThreads_(nThreads) {
 
     for (auto marketFile : marketFiles)
         // load market data
@@ -95,60 +186,109 @@ void CSVLoader::loadFile(const string& filename, DataType dataType) {
 
     Date today = QuantLib::Settings::instance().evaluationDate();
 
-    ifstream file;
-    file.open(filename.c_str());
-    QL_REQUIRE(file.is_open(), "error opening file " << filename);
+    // map the file into memory, an empty file can not be mapped and has no lines
+
+    Size size;
+    {
+        ifstream file(filename.c_str(), ios::binary | ios::ate);
+        QL_REQUIRE(file.is_open(), "error opening file " << filename);
+        size = static_cast<Size>(file.tellg());
+    }
+    boost::interprocess::mapped_region region;
+    if (size > 0) {
+        try {
+            boost::interprocess::file_mapping mapping(filename.c_str(), boost::interprocess::read_only);
+            region = boost::interprocess::mapped_region(mapping, boost::interprocess::read_only, 0, size);
+        } catch (const std::exception& e) {
+            QL_FAIL("error mapping file " << filename << ": " << e.what());
+        }
+    }
+    string_view content(static_cast<const char*>(region.get_address()), size);
+
+    // split the file into chunks of whole lines
 
-    while (!file.eof()) {
-        string line;
-        getline(file, line);
-        boost::trim(line);
-        // skip blank and comment lines
-        if (line.size() > 0 && line[0] != '#') {
+    Size nChunks = nThreads_ > 1 ? 8 * nThreads_ : 1;
+    vector<Size> chunkStart(1, 0);
+    for (Size c = 1; c < nChunks; ++c) {
+        Size pos = std::max(chunkStart.back(), c * size / nChunks);
+        pos = content.find('\n', pos);
+        if (pos == string_view::npos)
+            break;
+        chunkStart.push_back(pos + 1);
+    }
+    chunkStart.push_back(size);
+    nChunks = chunkStart.size() - 1;
 
-            vector<string> tokens;
-            boost::trim(line);
-            boost::split(tokens, line, boost::is_any_of(",;\t "), boost::token_compress_on);
+    // parse the chunks, an error stops the parsing of a chunk, the error of the first chunk is rethrown below
 
-            // TODO: should we try, catch and log any invalid lines?
-            QL_REQUIRE(tokens.size() == 3, "Invalid CSVLoader line, 3 tokens expected " << line);
-            Date date = parseDate(tokens[0]);
-            const string& key = tokens[1];
-            Real value = parseReal(tokens[2]);
+    vector<vector<CsvLine>> lines(nChunks);
+    vector<std::exception_ptr> errors(nChunks);
+    parallelFor(nChunks, nThreads_, [&](const Size c) {
+        try {
+            Size pos = chunkStart[c];
+            while (pos < chunkStart[c + 1]) {
+                Size next = content.find('\n', pos);
+                if (next == string_view::npos || next > chunkStart[c + 1])
+                    next = chunkStart[c + 1];
+                string_view line = content.substr(pos, next - pos);
+                pos = next + 1;
+                while (!line.empty() && isSpace(line.front()))
+                    line.remove_prefix(1);
+                while (!line.empty() && isSpace(line.back()))
+                    line.remove_suffix(1);
+                // skip blank and comment lines
+                if (line.empty() || line[0] == '#')
+                    continue;
 
-            if (dataType == DataType::Market) {
-                // process market
-                // build market datum and add to map
-                try {
-                    boost::shared_ptr<MarketDatum> md;
+                string_view tokens[4];
+                // TODO: should we try, catch and log any invalid lines?
+                QL_REQUIRE(tokenise(line, tokens, 4) == 3, "Invalid CSVLoader line, 3 tokens expected " << line);
+                CsvLine l;
+                l.date = parseCsvDate(tokens[0]);
+                l.key = tokens[1];
+                l.value = parseCsvReal(tokens[2]);
+
+                if (dataType == DataType::Market) {
+                    // build market datum
                     try {
-                        md = parseMarketDatum(date, key, value);
+                        l.datum = parseMarketDatum(l.date, string(l.key), l.value);
                     } catch (std::exception& e) {
-                        WLOG("Failed to parse MarketDatum " << key << ": " << e.what());
+                        WLOG("Failed to parse MarketDatum " << l.key << ": " << e.what());
                     }
-                    if (md != nullptr) {
-                        if (data_[date].insert(md).second) {
-                            TLOG("Added MarketDatum " << key);
-                        } else {
-                            WLOG("Skipped MarketDatum " << key << " - this is already present.");
-                        }
+                }
+                lines[c].push_back(l);
+            }
+        } catch (...) {
+            errors[c] = std::current_exception();
+        }
+    });
+
+    // add the lines in the order of the file, up to the first error
+
+    for (Size c = 0; c < nChunks; ++c) {
+        for (auto const& l : lines[c]) {
+            if (dataType == DataType::Market) {
+                // add market datum to map
+                if (l.datum != nullptr) {
+                    if (data_[l.date].insert(l.datum).second) {
+                        TLOG("Added MarketDatum " << l.key);
+                    } else {
+                        WLOG("Skipped MarketDatum " << l.key << " - this is already present.");
                     }
-                } catch (std::exception& e) {
-                    WLOG("Failed to parse MarketDatum " << key << ": " << e.what());
                 }
             } else if (dataType == DataType::Fixing) {
                 // process fixings
-                if (date < today || (date == today && !implyTodaysFixings_)) {
-                    if(!fixings_.insert(Fixing(date, key, value)).second) {
-                        WLOG("Skipped Fixing " << key << "@" << QuantLib::io::iso_date(date)
+                if (l.date < today || (l.date == today && !implyTodaysFixings_)) {
+                    if (!fixings_.insert(Fixing(l.date, string(l.key), l.value)).second) {
+                        WLOG("Skipped Fixing " << l.key << "@" << QuantLib::io::iso_date(l.date)
                                                << " - this is already present.");
                     }
                 }
             } else if (dataType == DataType::Dividend) {
                 // process dividends
-                if (date <= today) {
-                    if(!dividends_.insert(Fixing(date, key, value)).second) {
-                        WLOG("Skipped Dividend " << key << "@" << QuantLib::io::iso_date(date)
+                if (l.date <= today) {
+                    if (!dividends_.insert(Fixing(l.date, string(l.key), l.value)).second) {
+                        WLOG("Skipped Dividend " << l.key << "@" << QuantLib::io::iso_date(l.date)
                                                  << " - this is already present.");
                     }
                 }
@@ -156,8 +296,10 @@ void CSVLoader::loadFile(const string& filename, DataType dataType) {
                 QL_FAIL("unknown data type");
             }
         }
+        if (errors[c])
+            std::rethrow_exception(errors[c]);
     }
-    file.close();
+
     LOG("CSVLoader completed processing " << filename);
 }
 
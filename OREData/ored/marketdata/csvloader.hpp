@@ -34,6 +34,11 @@ namespace data {
   Data is loaded with the call to the constructor.
   Inspectors can be called to then retrieve quotes and fixings.
 
+  The files are memory mapped and tokenised in place. Numbers and dates in the formats YYYY-MM-DD and YYYYMMDD are
+  parsed directly from the mapped data, other formats are handled by parseReal() and parseDate(). With nThreads > 1
+  the lines of a file are split into chunks which are parsed in parallel. The parsed lines are added in the order of
+  the file in all cases, so that the loaded data does not depend on the number of threads.
+
   \ingroup marketdata
  */
 class CSVLoader : public Loader {
@@ -46,14 +51,18 @@ public:
         //! Fixing file name
         const string& fixingFilename,
         //! Enable/disable implying today's fixings
-        bool implyTodaysFixings = false);
+        bool implyTodaysFixings = false,
+        //! Number of threads used to parse a file
+        Size nThreads = 1);
 
     CSVLoader( //! Quote file name
         const vector<string>& marketFiles,
         //! Fixing file name
         const vector<string>& fixingFiles,
         //! Enable/disable implying today's fixings
-        bool implyTodaysFixings = false);
+        bool implyTodaysFixings = false,
+        //! Number of threads used to parse a file
+        Size nThreads = 1);
 
     CSVLoader( //! Quote file name
         const string& marketFilename,
@@ -62,7 +71,9 @@ public:
         //! Dividend file name
         const string& dividendFilename,
         //! Enable/disable implying today's fixings
-        bool implyTodaysFixings = false);
+        bool implyTodaysFixings = false,
+        //! Number of threads used to parse a file
+        Size nThreads = 1);
 
     CSVLoader( //! Quote file name
         const vector<string>& marketFiles,
@@ -71,7 +82,9 @@ public:
         //! Dividend file name
         const vector<string>& dividendFiles,
         //! Enable/disable implying today's fixings
-        bool implyTodaysFixings = false);
+        bool implyTodaysFixings = false,
+        //! Number of threads used to parse a file
+        Size nThreads = 1);
 
     //! \name Inspectors
     //@{
@@ -95,6 +108,7 @@ private:
     void loadFile(const string&, DataType);
 
     bool implyTodaysFixings_;
+    Size nThreads_ = 1;
     std::map<QuantLib::Date, std::set<boost::shared_ptr<MarketDatum>, SharedPtrMarketDatumComparator>> data_;
     std::set<Fixing> fixings_;
     std::set<Fixing> dividends_;
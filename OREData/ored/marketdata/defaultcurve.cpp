@@ -694,6 +694,9 @@ void DefaultCurve::buildMultiSectionCurve(const std::string& curveID, const Defa
         Handle<DefaultProbabilityTermStructure>(boost::make_shared<QuantExt::MultiSectionDefaultCurve>(
             curves, recoveryRates, switchDates, recoveryRate, config.dayCounter(), config.extrapolation())));
 
+    // Force bootstrap so that errors are thrown during the build, not later
+    curve_->curve()->survivalProbability(QL_EPSILON);
+
     LOG("Finished building default curve of type MultiSection for curve " << curveID);
 }
 
@@ -113,8 +113,11 @@ Handle<Quote> FXTriangulation::getQuote(const std::string& pair) const {
 
     // do we have a cached result?
 
-    if (auto it = quoteCache_.find(pair); it != quoteCache_.end())
-        return it->second;
+    {
+        boost::shared_lock<boost::shared_mutex> lock(*cacheMutex_);
+        if (auto it = quoteCache_.find(pair); it != quoteCache_.end())
+            return it->second;
+    }
 
     // we need to construct the quote from the input quotes
 
@@ -156,18 +159,22 @@ Handle<Quote> FXTriangulation::getQuote(const std::string& pair) const {
         result = Handle<Quote>(boost::make_shared<CompositeVectorQuote<decltype(f)>>(quotes, f));
     }
 
-    // add the result to the lookup cache and return it
+    /* add the result to the lookup cache and return it, if another thread has added a quote for the pair in the
+       meantime, we return that one, so that all callers share the same quote */
 
-    quoteCache_[pair] = result;
-    return result;
+    boost::unique_lock<boost::shared_mutex> lock(*cacheMutex_);
+    return quoteCache_.insert(std::make_pair(pair, result)).first->second;
 }
 
 Handle<FxIndex> FXTriangulation::getIndex(const std::string& indexOrPair, const Market* market) const {
 
     // do we have a cached result?
 
-    if (auto it = indexCache_.find(indexOrPair); it != indexCache_.end()) {
-        return it->second;
+    {
+        boost::shared_lock<boost::shared_mutex> lock(*cacheMutex_);
+        if (auto it = indexCache_.find(indexOrPair); it != indexCache_.end()) {
+            return it->second;
+        }
     }
 
     // otherwise we need to construct the index
@@ -249,10 +256,10 @@ Handle<FxIndex> FXTriangulation::getIndex(const std::string& indexOrPair, const
                                                              sourceYts, targetYts));
     }
 
-    // add the result to the lookup cache and return it
+    // add the result to the lookup cache and return it, see getQuote()
 
-    indexCache_[indexOrPair] = result;
-    return result;
+    boost::unique_lock<boost::shared_mutex> lock(*cacheMutex_);
+    return indexCache_.insert(std::make_pair(indexOrPair, result)).first->second;
 }
 
 std::vector<std::string> FXTriangulation::getPath(const std::string& forCcy, const std::string& domCcy) const {
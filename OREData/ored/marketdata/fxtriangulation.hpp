@@ -31,11 +31,16 @@
 #include <ql/quote.hpp>
 #include <ql/types.hpp>
 
+#include <boost/make_shared.hpp>
+#include <boost/thread/shared_mutex.hpp>
+
 #include <vector>
 
 namespace ore {
 namespace data {
 
+/*! The lookups getQuote() and getIndex() can be called from several threads concurrently, e.g. by curve builders
+    running in parallel. */
 class FXTriangulation {
 public:
     /*! Set up empty repository */
@@ -74,6 +79,8 @@ private:
     // caches to improve perfomance
     mutable std::map<std::string, QuantLib::Handle<QuantLib::Quote>> quoteCache_;
     mutable std::map<std::string, QuantLib::Handle<QuantExt::FxIndex>> indexCache_;
+    // guards the caches, copies of this instance share the mutex
+    mutable boost::shared_ptr<boost::shared_mutex> cacheMutex_ = boost::make_shared<boost::shared_mutex>();
 
     // internal data structure to represent the undirected graph of currencies
     std::vector<std::string> nodeToCcy_;
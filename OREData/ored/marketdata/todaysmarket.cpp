@@ -43,6 +43,8 @@
 #include <ored/utilities/indexparser.hpp>
 #include <ored/utilities/indexnametranslator.hpp>
 #include <ored/utilities/log.hpp>
+#include <ored/utilities/parallelfor.hpp>
+#include <ored/utilities/parsers.hpp>
 #include <ored/utilities/to_string.hpp>
 #include <qle/indexes/equityindex.hpp>
 #include <qle/indexes/fallbackiborindex.hpp>
@@ -52,11 +54,20 @@
 #include <qle/termstructures/blackvolsurfacewithatm.hpp>
 #include <qle/termstructures/pricetermstructureadapter.hpp>
 
+#include <ql/indexes/indexmanager.hpp>
+#include <ql/settings.hpp>
+
 #include <boost/graph/topological_sort.hpp>
 #include <boost/range/adaptor/map.hpp>
 #include <boost/range/adaptor/reversed.hpp>
 #include <boost/timer/timer.hpp>
 
+#include <algorithm>
+#include <exception>
+#include <functional>
+#include <set>
+#include <thread>
+
 using namespace std;
 using namespace QuantLib;
 
@@ -75,14 +86,20 @@ TodaysMarket::TodaysMarket(const Date& asof, const boost::shared_ptr<TodaysMarke
                            const bool loadFixings, const bool lazyBuild,
                            const boost::shared_ptr<ReferenceDataManager>& referenceData,
                            const bool preserveQuoteLinkage, const IborFallbackConfig& iborFallbackConfig,
-                           const bool buildCalibrationInfo, const bool handlePseudoCurrencies)
+                           const bool buildCalibrationInfo, const bool handlePseudoCurrencies, const Size nThreads)
     : MarketImpl(handlePseudoCurrencies), params_(params), loader_(loader), curveConfigs_(curveConfigs),
       continueOnError_(continueOnError), loadFixings_(loadFixings), lazyBuild_(lazyBuild),
       preserveQuoteLinkage_(preserveQuoteLinkage), referenceData_(referenceData),
-      iborFallbackConfig_(iborFallbackConfig), buildCalibrationInfo_(buildCalibrationInfo) {
+      iborFallbackConfig_(iborFallbackConfig), buildCalibrationInfo_(buildCalibrationInfo), nThreads_(nThreads) {
     QL_REQUIRE(params_, "TodaysMarket: TodaysMarketParameters are null");
     QL_REQUIRE(loader_, "TodaysMarket: Loader is null");
     QL_REQUIRE(curveConfigs_, "TodaysMarket: CurveConfigurations are null");
+    QL_REQUIRE(nThreads_ > 0, "TodaysMarket: nThreads must be > 0");
+#ifndef QL_ENABLE_THREAD_SAFE_OBSERVER_PATTERN
+    QL_REQUIRE(nThreads_ == 1, "TodaysMarket: nThreads = " << nThreads_
+                                                           << " requires a build with "
+                                                              "QL_ENABLE_THREAD_SAFE_OBSERVER_PATTERN = ON");
+#endif
     initialise(asof);
 }
 
@@ -91,6 +108,155 @@ struct Count {
     void inc() { ++count; }
     std::size_t count = 0;
 };
+
+/* node types whose curve object only depends on the cached curve objects of the nodes it depends on and whose
+   indices are known before the build (see createIndexManagerEntries()). Their builders also bootstrap the curve
+   eagerly, so that the builders of the next level only read the curves of the lower levels and never trigger a
+   lazy calculation of a shared curve from several threads. Commodity curves are excluded since they create future
+   indices for expiries that are only known during the build, the volatility and base correlation builders since
+   their term structures are calculated lazily on first use. */
+bool buildInParallel(const DependencyGraph::Node& node) {
+    if (node.curveSpec == nullptr)
+        return false;
+    switch (node.curveSpec->baseType()) {
+    case CurveSpec::CurveType::Yield:
+    case CurveSpec::CurveType::Default:
+    case CurveSpec::CurveType::Inflation:
+    case CurveSpec::CurveType::Equity:
+    case CurveSpec::CurveType::Security:
+        return true;
+    default:
+        return false;
+    }
+}
+
+/* Indices register with their IndexManager entry on construction, which inserts the entry into the IndexManager's
+   global map if it does not exist yet. We create the entries of the indices the curve builders running in parallel
+   construct here, so that the builders only look up existing entries. These are the indices of the index curves,
+   the conventions, the ibor fallback and fitted bond segments and the index based deposit quotes of the yield
+   curves, the zero and yoy inflation indices of the inflation curves and the equity curves. */
+void createIndexManagerEntries(const DependencyGraph::Graph& g, const std::vector<DependencyGraph::Vertex>& order,
+                               const CurveConfigurations& curveConfigs, const IborFallbackConfig& iborFallbackConfig) {
+    std::set<std::string> iborIndices, inflationIndices, equityIndices;
+    auto create = [](const std::function<void()>& f) {
+        try {
+            f();
+        } catch (...) {
+            // the builder reports invalid indices
+        }
+    };
+
+    auto conventions = InstrumentConventions::instance().conventions();
+    for (auto const& c : conventions->get(Convention::Type::Future))
+        create([&c]() { boost::static_pointer_cast<FutureConvention>(c)->index(); });
+    for (auto const& c : conventions->get(Convention::Type::FRA))
+        iborIndices.insert(boost::static_pointer_cast<FraConvention>(c)->indexName());
+    for (auto const& c : conventions->get(Convention::Type::OIS))
+        iborIndices.insert(boost::static_pointer_cast<OisConvention>(c)->indexName());
+    for (auto const& c : conventions->get(Convention::Type::Swap))
+        iborIndices.insert(boost::static_pointer_cast<IRSwapConvention>(c)->indexName());
+    for (auto const& c : conventions->get(Convention::Type::AverageOIS))
+        iborIndices.insert(boost::static_pointer_cast<AverageOisConvention>(c)->indexName());
+    for (auto const& c : conventions->get(Convention::Type::TenorBasisSwap)) {
+        iborIndices.insert(boost::static_pointer_cast<TenorBasisSwapConvention>(c)->longIndexName());
+        iborIndices.insert(boost::static_pointer_cast<TenorBasisSwapConvention>(c)->shortIndexName());
+    }
+    for (auto const& c : conventions->get(Convention::Type::TenorBasisTwoSwap)) {
+        create([&c]() { boost::static_pointer_cast<TenorBasisTwoSwapConvention>(c)->longIndex(); });
+        create([&c]() { boost::static_pointer_cast<TenorBasisTwoSwapConvention>(c)->shortIndex(); });
+    }
+    for (auto const& c : conventions->get(Convention::Type::BMABasisSwap)) {
+        iborIndices.insert(boost::static_pointer_cast<BMABasisSwapConvention>(c)->liborIndexName());
+        create([&c]() { boost::static_pointer_cast<BMABasisSwapConvention>(c)->bmaIndex(); });
+    }
+    for (auto const& c : conventions->get(Convention::Type::CrossCcyBasis)) {
+        iborIndices.insert(boost::static_pointer_cast<CrossCcyBasisSwapConvention>(c)->flatIndexName());
+        iborIndices.insert(boost::static_pointer_cast<CrossCcyBasisSwapConvention>(c)->spreadIndexName());
+    }
+    for (auto const& c : conventions->get(Convention::Type::IborIndex))
+        iborIndices.insert(c->id());
+    for (auto const& c : conventions->get(Convention::Type::OvernightIndex))
+        iborIndices.insert(c->id());
+    for (auto const& c : conventions->get(Convention::Type::InflationSwap))
+        inflationIndices.insert(boost::static_pointer_cast<InflationSwapConvention>(c)->indexName());
+    for (auto const& c : conventions->get(Convention::Type::ZeroInflationIndex))
+        inflationIndices.insert(c->id());
+
+    for (auto const& m : order) {
+        if (g[m].obj == MarketObject::IndexCurve)
+            iborIndices.insert(g[m].name);
+        if (!buildInParallel(g[m]))
+            continue;
+        const std::string& id = g[m].curveSpec->curveConfigID();
+        switch (g[m].curveSpec->baseType()) {
+        case CurveSpec::CurveType::Yield:
+            if (!curveConfigs.hasYieldCurveConfig(id))
+                break;
+            for (auto const& s : curveConfigs.yieldCurveConfig(id)->curveSegments()) {
+                if (auto f = boost::dynamic_pointer_cast<IborFallbackCurveSegment>(s)) {
+                    iborIndices.insert(f->iborIndex());
+                    if (f->rfrIndex())
+                        iborIndices.insert(*f->rfrIndex());
+                    else if (iborFallbackConfig.isIndexReplaced(f->iborIndex()))
+                        iborIndices.insert(iborFallbackConfig.fallbackData(f->iborIndex()).rfrIndex);
+                } else if (auto b = boost::dynamic_pointer_cast<FittedBondYieldCurveSegment>(s)) {
+                    for (auto const& c : b->iborIndexCurves())
+                        iborIndices.insert(c.first);
+                } else if (conventions->has(s->conventionsID(), Convention::Type::Deposit)) {
+                    auto d = boost::static_pointer_cast<DepositConvention>(conventions->get(s->conventionsID()));
+                    if (!d->indexBased())
+                        continue;
+                    if (isOvernightIndex(d->index())) {
+                        iborIndices.insert(d->index());
+                        continue;
+                    }
+                    // the index tenor is the deposit term, i.e. the last token of the quote
+                    for (auto const& q : s->quotes()) {
+                        create([&iborIndices, &d, &q]() {
+                            Period term = parsePeriod(q.first.substr(q.first.find_last_of('/') + 1));
+                            iborIndices.insert(d->index() + "-" + ore::data::to_string(io::short_period(term)));
+                        });
+                    }
+                }
+            }
+            break;
+        case CurveSpec::CurveType::Equity:
+            equityIndices.insert("EQ-" + id);
+            break;
+        default:
+            break;
+        }
+    }
+
+    for (auto const& i : iborIndices) {
+        boost::shared_ptr<IborIndex> tmp;
+        tryParseIborIndex(i, tmp);
+    }
+    // the yoy curve builder wraps the zero inflation indices, the wrapper registers with the entry of its own name,
+    // so we create both entries
+    for (auto const& i : inflationIndices)
+        create([&i]() { boost::make_shared<QuantExt::YoYInflationIndexWrapper>(parseZeroInflationIndex(i), false); });
+    for (auto const& i : equityIndices)
+        create([&i]() { parseEquityIndex(i); });
+}
+
+/* group the vertices given in topological order (dependencies first) into levels, such that each vertex only depends
+   on vertices of lower levels, the vertices of one level keep their topological order */
+std::vector<std::vector<DependencyGraph::Vertex>> dependencyLevels(const DependencyGraph::Graph& g,
+                                                                   const std::vector<DependencyGraph::Vertex>& order) {
+    auto index = boost::get(boost::vertex_index, g);
+    std::vector<std::size_t> level(boost::num_vertices(g), 0);
+    std::vector<std::vector<DependencyGraph::Vertex>> levels;
+    for (auto const& m : order) {
+        boost::graph_traits<DependencyGraph::Graph>::out_edge_iterator e, eend;
+        for (std::tie(e, eend) = boost::out_edges(m, g); e != eend; ++e)
+            level[index[m]] = std::max(level[index[m]], level[index[boost::target(*e, g)]] + 1);
+        if (level[index[m]] >= levels.size())
+            levels.resize(level[index[m]] + 1);
+        levels[level[index[m]]].push_back(m);
+    }
+    return levels;
+}
 } // namespace
 
 void TodaysMarket::initialise(const Date& asof) {
@@ -199,12 +365,19 @@ void TodaysMarket::initialise(const Date& asof) {
             // Build the objects in the graph in topological order
 
             Size countSuccess = 0, countError = 0;
-            for (auto const& m : order) {
+            std::vector<std::pair<boost::timer::nanosecond_type, Vertex>> nodeTimings;
+
+            // build a node, curveTime is the time spent on building the curve object of the node on a worker thread
+            auto build = [&](const Vertex& m, const boost::timer::nanosecond_type curveTime,
+                             const std::function<void()>& addCurve, const std::exception_ptr& curveError) {
                 timer.start();
                 try {
+                    if (curveError)
+                        std::rethrow_exception(curveError);
+                    if (addCurve)
+                        addCurve();
                     buildNode(configuration.first, g[m]);
                     ++countSuccess;
-                    DLOG("built node " << g[m] << " in configuration " << configuration.first);
                 } catch (const std::exception& e) {
                     if (g[m].curveSpec)
                         buildErrors[g[m].curveSpec->name()] = e.what();
@@ -214,11 +387,107 @@ void TodaysMarket::initialise(const Date& asof) {
                     ALOG("error while building node " << g[m] << " in configuration " << configuration.first << ": "
                                                       << e.what());
                 }
-                timings["6 build " + ore::data::to_string(g[m].obj)] += timer.elapsed().wall;
+                boost::timer::nanosecond_type t = timer.elapsed().wall + curveTime;
+                if (g[m].built) {
+                    DLOG("built node " << g[m] << " in configuration " << configuration.first << " ("
+                                       << static_cast<double>(t) / 1.0E6 << " ms)");
+                }
+                nodeTimings.push_back(std::make_pair(t, m));
+                timings["6 build " + ore::data::to_string(g[m].obj)] += t;
                 counts["6 build " + ore::data::to_string(g[m].obj)].inc();
+            };
+
+            if (nThreads_ == 1) {
+                for (auto const& m : order)
+                    build(m, 0, {}, nullptr);
+            } else {
+                boost::timer::cpu_timer wallTimer;
+
+                createIndexManagerEntries(g, order, *curveConfigs_, iborFallbackConfig_);
+
+#ifdef QL_ENABLE_SESSIONS
+                // session dependent singletons are thread local, take a copy of the state of the calling thread
+                std::thread::id callingThread = std::this_thread::get_id();
+                Date today = Settings::instance().evaluationDate();
+                bool includeReferenceDateEvents = Settings::instance().includeReferenceDateEvents();
+                boost::optional<bool> includeTodaysCashFlows = Settings::instance().includeTodaysCashFlows();
+                bool enforcesTodaysHistoricFixings = Settings::instance().enforcesTodaysHistoricFixings();
+                std::vector<std::pair<std::string, TimeSeries<Real>>> fixings;
+                for (auto const& name : IndexManager::instance().histories())
+                    fixings.push_back(std::make_pair(name, IndexManager::instance().getHistory(name)));
+                auto initialiseSession = [&]() {
+                    static thread_local bool initialised = false;
+                    if (initialised || std::this_thread::get_id() == callingThread)
+                        return;
+                    Settings::instance().evaluationDate() = today;
+                    Settings::instance().includeReferenceDateEvents() = includeReferenceDateEvents;
+                    Settings::instance().includeTodaysCashFlows() = includeTodaysCashFlows;
+                    Settings::instance().enforcesTodaysHistoricFixings() = enforcesTodaysHistoricFixings;
+                    for (auto const& f : fixings)
+                        IndexManager::instance().setHistory(f.first, f.second);
+                    initialised = true;
+                };
+#endif
+
+                for (auto const& level : dependencyLevels(g, order)) {
+
+                    // build the curve objects of this level in parallel, one per curve spec
+
+                    std::vector<Vertex> curveNodes;
+                    std::set<std::string> curveSpecs;
+                    for (auto const& m : level) {
+                        if (!g[m].built && buildInParallel(g[m]) && curveSpecs.insert(g[m].curveSpec->name()).second)
+                            curveNodes.push_back(m);
+                    }
+
+                    std::vector<std::function<void()>> addCurve(curveNodes.size());
+                    std::vector<std::exception_ptr> curveError(curveNodes.size());
+                    std::vector<boost::timer::nanosecond_type> curveTime(curveNodes.size(), 0);
+                    parallelFor(curveNodes.size(), nThreads_, [&](const Size i) {
+                        boost::timer::cpu_timer curveTimer;
+                        try {
+#ifdef QL_ENABLE_SESSIONS
+                            // initialise the session dependent singletons of the build threads once per thread
+                            initialiseSession();
+#endif
+                            addCurve[i] = buildCurve(g[curveNodes[i]]);
+                        } catch (...) {
+                            curveError[i] = std::current_exception();
+                        }
+                        curveTime[i] = curveTimer.elapsed().wall;
+                    });
+
+                    // add the curve objects and build the market objects of this level on this thread
+
+                    Size c = 0;
+                    for (auto const& m : level) {
+                        if (c < curveNodes.size() && curveNodes[c] == m) {
+                            build(m, curveTime[c], addCurve[c], curveError[c]);
+                            ++c;
+                        } else {
+                            build(m, 0, {}, nullptr);
+                        }
+                    }
+                }
+                LOG("Built " << order.size() << " nodes of configuration " << configuration.first << " on "
+                             << nThreads_ << " threads in " << static_cast<double>(wallTimer.elapsed().wall) / 1.0E6
+                             << " ms");
             }
 
             LOG("Loaded CurvesSpecs: success: " << countSuccess << ", error: " << countError);
+
+            // report the nodes with the longest build times
+
+            Size nSlowest = std::min<Size>(10, nodeTimings.size());
+            std::partial_sort(nodeTimings.begin(), nodeTimings.begin() + nSlowest, nodeTimings.end(),
+                              [](const std::pair<boost::timer::nanosecond_type, Vertex>& x,
+                                 const std::pair<boost::timer::nanosecond_type, Vertex>& y) {
+                                  return x.first > y.first;
+                              });
+            for (Size i = 0; i < nSlowest; ++i) {
+                LOG("slowest node #" << i + 1 << ": " << g[nodeTimings[i].second] << " ("
+                                     << static_cast<double>(nodeTimings[i].first) / 1.0E6 << " ms)");
+            }
         }
 
     } else {
@@ -291,17 +560,8 @@ void TodaysMarket::buildNode(const std::string& configuration, Node& node) const
 
             auto itr = requiredYieldCurves_.find(ycspec->name());
             if (itr == requiredYieldCurves_.end()) {
-                DLOG("Building YieldCurve for asof " << asof_);
-                boost::shared_ptr<YieldCurve> yieldCurve = boost::make_shared<YieldCurve>(
-                    asof_, *ycspec, *curveConfigs_, *loader_, requiredYieldCurves_, requiredDefaultCurves_, *fx_,
-                    referenceData_, iborFallbackConfig_, preserveQuoteLinkage_, buildCalibrationInfo_, this);
-                calibrationInfo_->yieldCurveCalibrationInfo[ycspec->name()] = yieldCurve->calibrationInfo();
-                itr = requiredYieldCurves_.insert(make_pair(ycspec->name(), yieldCurve)).first;
-                DLOG("Added YieldCurve \"" << ycspec->name() << "\" to requiredYieldCurves map");
-                if (itr->second->currency().code() != ycspec->ccy()) {
-                    WLOG("Warning: YieldCurve has ccy " << itr->second->currency() << " but spec has ccy "
-                                                        << ycspec->ccy());
-                }
+                buildCurve(node)();
+                itr = requiredYieldCurves_.find(ycspec->name());
             }
 
             if (node.obj == MarketObject::DiscountCurve) {
@@ -373,12 +633,8 @@ void TodaysMarket::buildNode(const std::string& configuration, Node& node) const
             // have we built the curve already ?
             auto itr = requiredFxVolCurves_.find(fxvolspec->name());
             if (itr == requiredFxVolCurves_.end()) {
-                DLOG("Building FXVolatility for asof " << asof_);
-                boost::shared_ptr<FXVolCurve> fxVolCurve = boost::make_shared<FXVolCurve>(
-                    asof_, *fxvolspec, *loader_, *curveConfigs_, *fx_, requiredYieldCurves_, requiredFxVolCurves_,
-                    requiredCorrelationCurves_, buildCalibrationInfo_);
-                calibrationInfo_->fxVolCalibrationInfo[fxvolspec->name()] = fxVolCurve->calibrationInfo();
-                itr = requiredFxVolCurves_.insert(make_pair(fxvolspec->name(), fxVolCurve)).first;
+                buildCurve(node)();
+                itr = requiredFxVolCurves_.find(fxvolspec->name());
             }
 
             DLOG("Adding FXVol (" << node.name << ") with spec " << *fxvolspec << " to configuration "
@@ -425,11 +681,8 @@ void TodaysMarket::buildNode(const std::string& configuration, Node& node) const
             QL_REQUIRE(ydvolspec, "Failed to convert spec " << *spec);
             auto itr = requiredGenericYieldVolCurves_.find(ydvolspec->name());
             if (itr == requiredGenericYieldVolCurves_.end()) {
-                DLOG("Building Yield Volatility for asof " << asof_);
-                boost::shared_ptr<YieldVolCurve> yieldVolCurve = boost::make_shared<YieldVolCurve>(
-                    asof_, *ydvolspec, *loader_, *curveConfigs_, buildCalibrationInfo_);
-                calibrationInfo_->irVolCalibrationInfo[ydvolspec->name()] = yieldVolCurve->calibrationInfo();
-                itr = requiredGenericYieldVolCurves_.insert(make_pair(ydvolspec->name(), yieldVolCurve)).first;
+                buildCurve(node)();
+                itr = requiredGenericYieldVolCurves_.find(ydvolspec->name());
             }
             DLOG("Adding YieldVol (" << node.name << ") with spec " << *ydvolspec << " to configuration "
                                      << configuration);
@@ -503,11 +756,8 @@ void TodaysMarket::buildNode(const std::string& configuration, Node& node) const
             QL_REQUIRE(defaultspec, "Failed to convert spec " << *spec);
             auto itr = requiredDefaultCurves_.find(defaultspec->name());
             if (itr == requiredDefaultCurves_.end()) {
-                // build the curve
-                DLOG("Building DefaultCurve for asof " << asof_);
-                boost::shared_ptr<DefaultCurve> defaultCurve = boost::make_shared<DefaultCurve>(
-                    asof_, *defaultspec, *loader_, *curveConfigs_, requiredYieldCurves_, requiredDefaultCurves_);
-                itr = requiredDefaultCurves_.insert(make_pair(defaultspec->name(), defaultCurve)).first;
+                buildCurve(node)();
+                itr = requiredDefaultCurves_.find(defaultspec->name());
             }
             DLOG("Adding DefaultCurve (" << node.name << ") with spec " << *defaultspec << " to configuration "
                                          << configuration);
@@ -525,10 +775,8 @@ void TodaysMarket::buildNode(const std::string& configuration, Node& node) const
             QL_REQUIRE(cdsvolspec, "Failed to convert spec " << *spec);
             auto itr = requiredCDSVolCurves_.find(cdsvolspec->name());
             if (itr == requiredCDSVolCurves_.end()) {
-                DLOG("Building CDSVol for asof " << asof_);
-                boost::shared_ptr<CDSVolCurve> cdsVolCurve = boost::make_shared<CDSVolCurve>(
-                    asof_, *cdsvolspec, *loader_, *curveConfigs_, requiredCDSVolCurves_, requiredDefaultCurves_);
-                itr = requiredCDSVolCurves_.insert(make_pair(cdsvolspec->name(), cdsVolCurve)).first;
+                buildCurve(node)();
+                itr = requiredCDSVolCurves_.find(cdsvolspec->name());
             }
             DLOG("Adding CDSVol (" << node.name << ") with spec " << *cdsvolspec << " to configuration "
                                    << configuration);
@@ -544,12 +792,8 @@ void TodaysMarket::buildNode(const std::string& configuration, Node& node) const
             QL_REQUIRE(baseCorrelationSpec, "Failed to convert spec " << *spec);
             auto itr = requiredBaseCorrelationCurves_.find(baseCorrelationSpec->name());
             if (itr == requiredBaseCorrelationCurves_.end()) {
-                DLOG("Building BaseCorrelation for asof " << asof_);
-                boost::shared_ptr<BaseCorrelationCurve> baseCorrelationCurve = boost::make_shared<BaseCorrelationCurve>(
-                    asof_, *baseCorrelationSpec, *loader_, *curveConfigs_, referenceData_);
-                itr =
-                    requiredBaseCorrelationCurves_.insert(make_pair(baseCorrelationSpec->name(), baseCorrelationCurve))
-                        .first;
+                buildCurve(node)();
+                itr = requiredBaseCorrelationCurves_.find(baseCorrelationSpec->name());
             }
 
             DLOG("Adding Base Correlation (" << node.name << ") with spec " << *baseCorrelationSpec
@@ -566,12 +810,8 @@ void TodaysMarket::buildNode(const std::string& configuration, Node& node) const
             QL_REQUIRE(inflationspec, "Failed to convert spec " << *spec << " to inflation curve spec");
             auto itr = requiredInflationCurves_.find(inflationspec->name());
             if (itr == requiredInflationCurves_.end()) {
-                DLOG("Building InflationCurve " << inflationspec->name() << " for asof " << asof_);
-                boost::shared_ptr<InflationCurve> inflationCurve = boost::make_shared<InflationCurve>(
-                    asof_, *inflationspec, *loader_, *curveConfigs_, requiredYieldCurves_, buildCalibrationInfo_);
-                itr = requiredInflationCurves_.insert(make_pair(inflationspec->name(), inflationCurve)).first;
-                calibrationInfo_->inflationCurveCalibrationInfo[inflationspec->name()] =
-                    inflationCurve->calibrationInfo();
+                buildCurve(node)();
+                itr = requiredInflationCurves_.find(inflationspec->name());
             }
 
             if (node.obj == MarketObject::ZeroInflationCurve) {
@@ -608,13 +848,8 @@ void TodaysMarket::buildNode(const std::string& configuration, Node& node) const
             QL_REQUIRE(infcapfloorspec, "Failed to convert spec " << *spec << " to inf cap floor spec");
             auto itr = requiredInflationCapFloorVolCurves_.find(infcapfloorspec->name());
             if (itr == requiredInflationCapFloorVolCurves_.end()) {
-                DLOG("Building InflationCapFloorVolatilitySurface for asof " << asof_);
-                boost::shared_ptr<InflationCapFloorVolCurve> inflationCapFloorVolCurve =
-                    boost::make_shared<InflationCapFloorVolCurve>(asof_, *infcapfloorspec, *loader_, *curveConfigs_,
-                                                                  requiredYieldCurves_, requiredInflationCurves_);
-                itr = requiredInflationCapFloorVolCurves_
-                          .insert(make_pair(infcapfloorspec->name(), inflationCapFloorVolCurve))
-                          .first;
+                buildCurve(node)();
+                itr = requiredInflationCapFloorVolCurves_.find(infcapfloorspec->name());
             }
 
             if (node.obj == MarketObject::ZeroInflationCapFloorVol) {
@@ -639,11 +874,8 @@ void TodaysMarket::buildNode(const std::string& configuration, Node& node) const
             QL_REQUIRE(equityspec, "Failed to convert spec " << *spec);
             auto itr = requiredEquityCurves_.find(equityspec->name());
             if (itr == requiredEquityCurves_.end()) {
-                DLOG("Building EquityCurve for asof " << asof_);
-                boost::shared_ptr<EquityCurve> equityCurve = boost::make_shared<EquityCurve>(
-                    asof_, *equityspec, *loader_, *curveConfigs_, requiredYieldCurves_, buildCalibrationInfo_);
-                itr = requiredEquityCurves_.insert(make_pair(equityspec->name(), equityCurve)).first;
-                calibrationInfo_->dividendCurveCalibrationInfo[equityspec->name()] = equityCurve->calibrationInfo();
+                buildCurve(node)();
+                itr = requiredEquityCurves_.find(equityspec->name());
             }
 
             DLOG("Adding EquityCurve (" << node.name << ") with spec " << *equityspec << " to configuration "
@@ -706,10 +938,8 @@ void TodaysMarket::buildNode(const std::string& configuration, Node& node) const
             QL_REQUIRE(securityspec, "Failed to convert spec " << *spec << " to security spec");
             auto itr = requiredSecurities_.find(securityspec->securityID());
             if (itr == requiredSecurities_.end()) {
-                DLOG("Building Securities for asof " << asof_);
-                boost::shared_ptr<Security> security =
-                    boost::make_shared<Security>(asof_, *securityspec, *loader_, *curveConfigs_);
-                itr = requiredSecurities_.insert(make_pair(securityspec->securityID(), security)).first;
+                buildCurve(node)();
+                itr = requiredSecurities_.find(securityspec->securityID());
             }
             DLOG("Adding Security (" << node.name << ") with spec " << *securityspec << " to configuration "
                                      << configuration);
@@ -729,11 +959,8 @@ void TodaysMarket::buildNode(const std::string& configuration, Node& node) const
             QL_REQUIRE(commodityCurveSpec, "Failed to convert spec, " << *spec << ", to CommodityCurveSpec");
             auto itr = requiredCommodityCurves_.find(commodityCurveSpec->name());
             if (itr == requiredCommodityCurves_.end()) {
-                DLOG("Building CommodityCurve " << commodityCurveSpec->name() << " for asof " << asof_);
-                boost::shared_ptr<CommodityCurve> commodityCurve =
-                    boost::make_shared<CommodityCurve>(asof_, *commodityCurveSpec, *loader_, *curveConfigs_, *fx_,
-                                                       requiredYieldCurves_, requiredCommodityCurves_, buildCalibrationInfo_);
-                itr = requiredCommodityCurves_.insert(make_pair(commodityCurveSpec->name(), commodityCurve)).first;
+                buildCurve(node)();
+                itr = requiredCommodityCurves_.find(commodityCurveSpec->name());
             }
 
             DLOG("Adding CommodityCurve, " << node.name << ", with spec " << *commodityCurveSpec << " to configuration "
@@ -807,6 +1034,195 @@ void TodaysMarket::buildNode(const std::string& configuration, Node& node) const
     node.built = true;
 } // TodaysMarket::buildNode()
 
+std::function<void()> TodaysMarket::buildCurve(const Node& node) const {
+
+    QL_REQUIRE(node.curveSpec, "market object '" << node.obj << "' (" << node.name << ") without curve spec, can not "
+                                                 << "build curve object.");
+    auto spec = node.curveSpec;
+
+    switch (spec->baseType()) {
+
+    // Yield
+    case CurveSpec::CurveType::Yield: {
+        boost::shared_ptr<YieldCurveSpec> ycspec = boost::dynamic_pointer_cast<YieldCurveSpec>(spec);
+        QL_REQUIRE(ycspec, "Failed to convert spec " << *spec << " to yield curve spec");
+        if (requiredYieldCurves_.find(ycspec->name()) != requiredYieldCurves_.end())
+            return {};
+        DLOG("Building YieldCurve for asof " << asof_);
+        boost::shared_ptr<YieldCurve> yieldCurve = boost::make_shared<YieldCurve>(
+            asof_, *ycspec, *curveConfigs_, *loader_, requiredYieldCurves_, requiredDefaultCurves_, *fx_,
+            referenceData_, iborFallbackConfig_, preserveQuoteLinkage_, buildCalibrationInfo_, this);
+        return [this, ycspec, yieldCurve]() {
+            calibrationInfo_->yieldCurveCalibrationInfo[ycspec->name()] = yieldCurve->calibrationInfo();
+            requiredYieldCurves_.insert(make_pair(ycspec->name(), yieldCurve));
+            DLOG("Added YieldCurve \"" << ycspec->name() << "\" to requiredYieldCurves map");
+            if (yieldCurve->currency().code() != ycspec->ccy()) {
+                WLOG("Warning: YieldCurve has ccy " << yieldCurve->currency() << " but spec has ccy "
+                                                    << ycspec->ccy());
+            }
+        };
+    }
+
+    // FX Vol
+    case CurveSpec::CurveType::FXVolatility: {
+        boost::shared_ptr<FXVolatilityCurveSpec> fxvolspec = boost::dynamic_pointer_cast<FXVolatilityCurveSpec>(spec);
+        QL_REQUIRE(fxvolspec, "Failed to convert spec " << *spec);
+        if (requiredFxVolCurves_.find(fxvolspec->name()) != requiredFxVolCurves_.end())
+            return {};
+        DLOG("Building FXVolatility for asof " << asof_);
+        boost::shared_ptr<FXVolCurve> fxVolCurve = boost::make_shared<FXVolCurve>(
+            asof_, *fxvolspec, *loader_, *curveConfigs_, *fx_, requiredYieldCurves_, requiredFxVolCurves_,
+            requiredCorrelationCurves_, buildCalibrationInfo_);
+        return [this, fxvolspec, fxVolCurve]() {
+            calibrationInfo_->fxVolCalibrationInfo[fxvolspec->name()] = fxVolCurve->calibrationInfo();
+            requiredFxVolCurves_.insert(make_pair(fxvolspec->name(), fxVolCurve));
+        };
+    }
+
+    // Yield Vol
+    case CurveSpec::CurveType::YieldVolatility: {
+        boost::shared_ptr<YieldVolatilityCurveSpec> ydvolspec =
+            boost::dynamic_pointer_cast<YieldVolatilityCurveSpec>(spec);
+        QL_REQUIRE(ydvolspec, "Failed to convert spec " << *spec);
+        if (requiredGenericYieldVolCurves_.find(ydvolspec->name()) != requiredGenericYieldVolCurves_.end())
+            return {};
+        DLOG("Building Yield Volatility for asof " << asof_);
+        boost::shared_ptr<YieldVolCurve> yieldVolCurve =
+            boost::make_shared<YieldVolCurve>(asof_, *ydvolspec, *loader_, *curveConfigs_, buildCalibrationInfo_);
+        return [this, ydvolspec, yieldVolCurve]() {
+            calibrationInfo_->irVolCalibrationInfo[ydvolspec->name()] = yieldVolCurve->calibrationInfo();
+            requiredGenericYieldVolCurves_.insert(make_pair(ydvolspec->name(), yieldVolCurve));
+        };
+    }
+
+    // Default Curve
+    case CurveSpec::CurveType::Default: {
+        boost::shared_ptr<DefaultCurveSpec> defaultspec = boost::dynamic_pointer_cast<DefaultCurveSpec>(spec);
+        QL_REQUIRE(defaultspec, "Failed to convert spec " << *spec);
+        if (requiredDefaultCurves_.find(defaultspec->name()) != requiredDefaultCurves_.end())
+            return {};
+        DLOG("Building DefaultCurve for asof " << asof_);
+        boost::shared_ptr<DefaultCurve> defaultCurve = boost::make_shared<DefaultCurve>(
+            asof_, *defaultspec, *loader_, *curveConfigs_, requiredYieldCurves_, requiredDefaultCurves_);
+        return [this, defaultspec, defaultCurve]() {
+            requiredDefaultCurves_.insert(make_pair(defaultspec->name(), defaultCurve));
+        };
+    }
+
+    // CDS Vol
+    case CurveSpec::CurveType::CDSVolatility: {
+        boost::shared_ptr<CDSVolatilityCurveSpec> cdsvolspec =
+            boost::dynamic_pointer_cast<CDSVolatilityCurveSpec>(spec);
+        QL_REQUIRE(cdsvolspec, "Failed to convert spec " << *spec);
+        if (requiredCDSVolCurves_.find(cdsvolspec->name()) != requiredCDSVolCurves_.end())
+            return {};
+        DLOG("Building CDSVol for asof " << asof_);
+        boost::shared_ptr<CDSVolCurve> cdsVolCurve = boost::make_shared<CDSVolCurve>(
+            asof_, *cdsvolspec, *loader_, *curveConfigs_, requiredCDSVolCurves_, requiredDefaultCurves_);
+        return [this, cdsvolspec, cdsVolCurve]() {
+            requiredCDSVolCurves_.insert(make_pair(cdsvolspec->name(), cdsVolCurve));
+        };
+    }
+
+    // Base Correlation
+    case CurveSpec::CurveType::BaseCorrelation: {
+        boost::shared_ptr<BaseCorrelationCurveSpec> baseCorrelationSpec =
+            boost::dynamic_pointer_cast<BaseCorrelationCurveSpec>(spec);
+        QL_REQUIRE(baseCorrelationSpec, "Failed to convert spec " << *spec);
+        if (requiredBaseCorrelationCurves_.find(baseCorrelationSpec->name()) != requiredBaseCorrelationCurves_.end())
+            return {};
+        DLOG("Building BaseCorrelation for asof " << asof_);
+        boost::shared_ptr<BaseCorrelationCurve> baseCorrelationCurve = boost::make_shared<BaseCorrelationCurve>(
+            asof_, *baseCorrelationSpec, *loader_, *curveConfigs_, referenceData_);
+        return [this, baseCorrelationSpec, baseCorrelationCurve]() {
+            requiredBaseCorrelationCurves_.insert(make_pair(baseCorrelationSpec->name(), baseCorrelationCurve));
+        };
+    }
+
+    // Inflation Curve
+    case CurveSpec::CurveType::Inflation: {
+        boost::shared_ptr<InflationCurveSpec> inflationspec = boost::dynamic_pointer_cast<InflationCurveSpec>(spec);
+        QL_REQUIRE(inflationspec, "Failed to convert spec " << *spec << " to inflation curve spec");
+        if (requiredInflationCurves_.find(inflationspec->name()) != requiredInflationCurves_.end())
+            return {};
+        DLOG("Building InflationCurve " << inflationspec->name() << " for asof " << asof_);
+        boost::shared_ptr<InflationCurve> inflationCurve = boost::make_shared<InflationCurve>(
+            asof_, *inflationspec, *loader_, *curveConfigs_, requiredYieldCurves_, buildCalibrationInfo_);
+        return [this, inflationspec, inflationCurve]() {
+            requiredInflationCurves_.insert(make_pair(inflationspec->name(), inflationCurve));
+            calibrationInfo_->inflationCurveCalibrationInfo[inflationspec->name()] = inflationCurve->calibrationInfo();
+        };
+    }
+
+    // Inflation Cap Floor Vol
+    case CurveSpec::CurveType::InflationCapFloorVolatility: {
+        boost::shared_ptr<InflationCapFloorVolatilityCurveSpec> infcapfloorspec =
+            boost::dynamic_pointer_cast<InflationCapFloorVolatilityCurveSpec>(spec);
+        QL_REQUIRE(infcapfloorspec, "Failed to convert spec " << *spec << " to inf cap floor spec");
+        if (requiredInflationCapFloorVolCurves_.find(infcapfloorspec->name()) !=
+            requiredInflationCapFloorVolCurves_.end())
+            return {};
+        DLOG("Building InflationCapFloorVolatilitySurface for asof " << asof_);
+        boost::shared_ptr<InflationCapFloorVolCurve> inflationCapFloorVolCurve =
+            boost::make_shared<InflationCapFloorVolCurve>(asof_, *infcapfloorspec, *loader_, *curveConfigs_,
+                                                          requiredYieldCurves_, requiredInflationCurves_);
+        return [this, infcapfloorspec, inflationCapFloorVolCurve]() {
+            requiredInflationCapFloorVolCurves_.insert(make_pair(infcapfloorspec->name(), inflationCapFloorVolCurve));
+        };
+    }
+
+    // Equity Spot
+    case CurveSpec::CurveType::Equity: {
+        boost::shared_ptr<EquityCurveSpec> equityspec = boost::dynamic_pointer_cast<EquityCurveSpec>(spec);
+        QL_REQUIRE(equityspec, "Failed to convert spec " << *spec);
+        if (requiredEquityCurves_.find(equityspec->name()) != requiredEquityCurves_.end())
+            return {};
+        DLOG("Building EquityCurve for asof " << asof_);
+        boost::shared_ptr<EquityCurve> equityCurve = boost::make_shared<EquityCurve>(
+            asof_, *equityspec, *loader_, *curveConfigs_, requiredYieldCurves_, buildCalibrationInfo_);
+        return [this, equityspec, equityCurve]() {
+            requiredEquityCurves_.insert(make_pair(equityspec->name(), equityCurve));
+            calibrationInfo_->dividendCurveCalibrationInfo[equityspec->name()] = equityCurve->calibrationInfo();
+        };
+    }
+
+    // Security spread, rr, cpr
+    case CurveSpec::CurveType::Security: {
+        boost::shared_ptr<SecuritySpec> securityspec = boost::dynamic_pointer_cast<SecuritySpec>(spec);
+        QL_REQUIRE(securityspec, "Failed to convert spec " << *spec << " to security spec");
+        if (requiredSecurities_.find(securityspec->securityID()) != requiredSecurities_.end())
+            return {};
+        DLOG("Building Securities for asof " << asof_);
+        boost::shared_ptr<Security> security =
+            boost::make_shared<Security>(asof_, *securityspec, *loader_, *curveConfigs_);
+        return [this, securityspec, security]() {
+            requiredSecurities_.insert(make_pair(securityspec->securityID(), security));
+        };
+    }
+
+    // Commodity curve
+    case CurveSpec::CurveType::Commodity: {
+        boost::shared_ptr<CommodityCurveSpec> commodityCurveSpec =
+            boost::dynamic_pointer_cast<CommodityCurveSpec>(spec);
+        QL_REQUIRE(commodityCurveSpec, "Failed to convert spec, " << *spec << ", to CommodityCurveSpec");
+        if (requiredCommodityCurves_.find(commodityCurveSpec->name()) != requiredCommodityCurves_.end())
+            return {};
+        DLOG("Building CommodityCurve " << commodityCurveSpec->name() << " for asof " << asof_);
+        boost::shared_ptr<CommodityCurve> commodityCurve =
+            boost::make_shared<CommodityCurve>(asof_, *commodityCurveSpec, *loader_, *curveConfigs_, *fx_,
+                                               requiredYieldCurves_, requiredCommodityCurves_, buildCalibrationInfo_);
+        return [this, commodityCurveSpec, commodityCurve]() {
+            requiredCommodityCurves_.insert(make_pair(commodityCurveSpec->name(), commodityCurve));
+        };
+    }
+
+    default: {
+        QL_FAIL("Unhandled spec " << *spec << ", the curve object can only be built together with the market object.");
+    }
+
+    } // switch(specName)
+} // TodaysMarket::buildCurve()
+
 void TodaysMarket::require(const MarketObject o, const string& name, const string& configuration,
                            const bool forceBuild) const {
 
@@ -38,6 +38,7 @@
 #include <boost/shared_ptr.hpp>
 #include <boost/enable_shared_from_this.hpp>
 
+#include <functional>
 #include <map>
 
 namespace ore {
@@ -75,6 +76,17 @@ class CorrelationCurve;
   Today's market's purpose is t0 pricing, the Simulation Market's purpose is
   pricing under future scenarios.
 
+  If the market is not built lazily, the curves that only depend on other market objects via the dependency graph and
+  that are bootstrapped during their build (yield, default, inflation and equity curves and securities) can be built
+  on nThreads threads. The nodes of the graph are grouped into levels such that each node only depends on nodes of
+  lower levels. The curve objects of one level are built in parallel and then added to the market on the calling
+  thread in the order of the serial build, so that the resulting market is the same as for nThreads = 1. All other
+  market objects are built on the calling thread. The curve builders share the observers of the market quotes, therefore
+  nThreads > 1 requires a QuantLib build with QL_ENABLE_THREAD_SAFE_OBSERVER_PATTERN. The IndexManager entries of
+  the indices used by these builders are created on the calling thread before the parallel build. With
+  QL_ENABLE_SESSIONS the Settings and the fixing histories of the IndexManager of the calling thread are copied to
+  the build threads.
+
   \ingroup marketdata
  */
 class TodaysMarket : public MarketImpl {
@@ -103,7 +115,9 @@ public:
         //! build calibration info?
         const bool buildCalibrationInfo = true,
         //! support pseudo currencies
-        const bool handlePseudoCurrencies = true);
+        const bool handlePseudoCurrencies = true,
+        //! number of threads used to build the market objects, only used if lazyBuild is false
+        const Size nThreads = 1);
 
     boost::shared_ptr<TodaysMarketCalibrationInfo> calibrationInfo() const { return calibrationInfo_; }
 
@@ -125,6 +139,7 @@ private:
     const boost::shared_ptr<ReferenceDataManager> referenceData_;
     const IborFallbackConfig iborFallbackConfig_;
     const bool buildCalibrationInfo_;
+    const Size nThreads_;
 
     // initialise market
     void initialise(const Date& asof);
@@ -142,6 +157,11 @@ private:
     // build a single market object
     void buildNode(const std::string& configuration, Node& node) const;
 
+    /* build the curve object of a spec-based node without changing the market and return a function that adds it to
+       the cached market objects, the function is empty if the curve is built already, only supported for the node
+       types that can be built in parallel */
+    std::function<void()> buildCurve(const Node& node) const;
+
     // calibration results
     boost::shared_ptr<TodaysMarketCalibrationInfo> calibrationInfo_;
 
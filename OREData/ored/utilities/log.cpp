@@ -22,6 +22,9 @@
 */
 
 #include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/make_shared.hpp>
+#include <algorithm>
+#include <chrono>
 #include <iomanip>
 #include <ored/utilities/log.hpp>
 #include <ql/errors.hpp>
@@ -71,13 +74,86 @@ void FileLogger::log(unsigned, const string& msg) {
         fout_ << msg << endl;
 }
 
+// -- Queue for asynchronous logging
+
+namespace detail {
+
+/* A bounded single producer single consumer ring buffer. The producer is the thread owning the queue, the consumer
+   is the background thread of the Log. */
+class LogQueue {
+public:
+    struct Record {
+        unsigned mask;
+        const char* filename;
+        int lineNo;
+        string msg;
+    };
+
+    explicit LogQueue(std::size_t capacity) : slots_(capacity), head_(0), tail_(0), orphaned_(false) {}
+
+    // leaves r untouched if the queue is full
+    bool push(Record& r) {
+        std::size_t t = tail_.load(std::memory_order_relaxed);
+        if (t - head_.load(std::memory_order_acquire) == slots_.size())
+            return false;
+        slots_[t % slots_.size()] = std::move(r);
+        tail_.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(Record& r) {
+        std::size_t h = head_.load(std::memory_order_relaxed);
+        if (h == tail_.load(std::memory_order_acquire))
+            return false;
+        r = std::move(slots_[h % slots_.size()]);
+        head_.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool empty() const { return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire); }
+
+    // set when the owning thread no longer uses the queue, it is then removed once it is empty
+    void setOrphaned() { orphaned_.store(true, std::memory_order_release); }
+    bool orphaned() const { return orphaned_.load(std::memory_order_acquire); }
+
+private:
+    vector<Record> slots_;
+    std::atomic<std::size_t> head_, tail_;
+    std::atomic<bool> orphaned_;
+};
+
+} // namespace detail
+
+namespace {
+
+// the queue of a thread together with the generation of the asynchronous mode it was created for
+struct ThreadLogQueue {
+    boost::shared_ptr<detail::LogQueue> queue;
+    std::size_t generation = 0;
+    ~ThreadLogQueue() {
+        if (queue)
+            queue->setOrphaned();
+    }
+};
+
+thread_local ThreadLogQueue threadLogQueue;
+
+// the number of distinct structured messages counted for the repeat limit, the counts are reset beyond this
+constexpr std::size_t maxStructuredMessageCounts = 100000;
+
+} // namespace
+
 // The Log itself
-Log::Log() : loggers_(), enabled_(false), mask_(255), ls_() {
+Log::Log()
+    : loggers_(), enabled_(false), mask_(255), activeMask_(0), ls_(), async_(false), stopping_(false), generation_(0),
+      enqueued_(0), processed_(0), dropped_(0) {
 
     ls_.setf(ios::fixed, ios::floatfield);
     ls_.setf(ios::showpoint);
 }
 
+Log::~Log() { stopAsync(); }
+
 void Log::registerLogger(const boost::shared_ptr<Logger>& logger) {
     boost::unique_lock<boost::shared_mutex> lock(mutex_);
     QL_REQUIRE(loggers_.find(logger->name()) == loggers_.end(),
@@ -92,6 +168,7 @@ boost::shared_ptr<Logger>& Log::logger(const string& name) {
 }
 
 void Log::removeLogger(const string& name) {
+    flush();
     boost::unique_lock<boost::shared_mutex> lock(mutex_);
     map<string, boost::shared_ptr<Logger>>::iterator it = loggers_.find(name);
     QL_REQUIRE(it != loggers_.end(), "No logger found with name " << name);
@@ -99,6 +176,7 @@ void Log::removeLogger(const string& name) {
 }
 
 void Log::removeAllLoggers() {
+    flush();
     boost::unique_lock<boost::shared_mutex> lock(mutex_);
     loggers_.clear();
 }
@@ -108,39 +186,44 @@ void Log::header(unsigned m, const char* filename, int lineNo) {
     ls_.str(string());
     ls_.clear();
 
+    formatHeader(ls_, m, filename, lineNo);
+    updateStatistics(filename, lineNo);
+}
+
+void Log::formatHeader(std::ostream& os, unsigned m, const char* filename, int lineNo) const {
     // Write the header to the stream
     // TYPE [Time Stamp] (file:line)
     switch (m) {
     case ORE_ALERT:
-        ls_ << "ALERT    ";
+        os << "ALERT    ";
         break;
     case ORE_CRITICAL:
-        ls_ << "CRITICAL ";
+        os << "CRITICAL ";
         break;
     case ORE_ERROR:
-        ls_ << "ERROR    ";
+        os << "ERROR    ";
         break;
     case ORE_WARNING:
-        ls_ << "WARNING  ";
+        os << "WARNING  ";
         break;
     case ORE_NOTICE:
-        ls_ << "NOTICE   ";
+        os << "NOTICE   ";
         break;
     case ORE_DEBUG:
-        ls_ << "DEBUG    ";
+        os << "DEBUG    ";
         break;
     case ORE_DATA:
-        ls_ << "DATA     ";
+        os << "DATA     ";
         break;
     case ORE_MEMORY:
-        ls_ << "MEMORY   ";
+        os << "MEMORY   ";
         break;
     }
 
     // Timestamp
     // Use boost::posix_time microsecond clock to get better precision (when available).
     // format is "2014-Apr-04 11:10:16.179347"
-    ls_ << '[' << to_simple_string(microsec_clock::local_time()) << ']';
+    os << '[' << to_simple_string(microsec_clock::local_time()) << ']';
 
     // Filename & line no
     // format is " (file:line)"
@@ -149,23 +232,24 @@ void Log::header(unsigned m, const char* filename, int lineNo) {
 
     int maxLen = 30; // gives about 23 chars for the filename
     if (len <= maxLen) {
-        ls_ << " (" << filename << ':' << lineNo << ')';
+        os << " (" << filename << ':' << lineNo << ')';
         // pad out spaces
-        ls_ << string(maxLen - len, ' ');
+        os << string(maxLen - len, ' ');
     } else {
         // need to trim the filename to fit into maxLen chars
         // need to remove (len - maxLen) chars + 3 for the "..."
-        ls_ << " (..." << string(filename).substr(3 + len - maxLen) << ':' << lineNo << ')';
+        os << " (..." << string(filename).substr(3 + len - maxLen) << ':' << lineNo << ')';
     }
 
-    ls_ << " : ";
+    os << " : ";
 
     // log pid if given
     if (pid_ > 0)
-        ls_ << " [" << pid_ << "] ";
+        os << " [" << pid_ << "] ";
+}
 
-    // update statistics
-    if(lastLineNo_ == lineNo && lastFileName_ == filename) {
+void Log::updateStatistics(const char* filename, int lineNo) {
+    if (lastLineNo_ == lineNo && lastFileName_ == filename) {
         ++sameSourceLocationSince_;
     } else {
         lastFileName_ = filename;
@@ -173,12 +257,34 @@ void Log::header(unsigned m, const char* filename, int lineNo) {
         sameSourceLocationSince_ = 0;
         writeSuppressedMessagesHint_ = true;
     }
-
 }
 
-void Log::log(unsigned m) {
-    string msg = ls_.str();
-    map<string, boost::shared_ptr<Logger>>::iterator it;
+void Log::log(unsigned m) { dispatch(m, ls_.str()); }
+
+void Log::dispatch(unsigned m, const string& msg) {
+    if (structuredMessageRepeatLimit_ > 0) {
+        auto pos = msg.find(StructuredMessage::name);
+        if (pos != string::npos) {
+            // the key excludes the header, which contains the time stamp
+            string key = msg.substr(pos);
+            auto c = structuredMessageCount_.find(key);
+            if (c == structuredMessageCount_.end()) {
+                if (structuredMessageCount_.size() >= maxStructuredMessageCounts)
+                    structuredMessageCount_.clear();
+                c = structuredMessageCount_.emplace(std::move(key), 0).first;
+            }
+            std::size_t count = ++c->second;
+            if (count > structuredMessageRepeatLimit_) {
+                if (count == structuredMessageRepeatLimit_ + 1) {
+                    string hint = msg.substr(0, pos) + "suppressing further identical structured messages (limit = " +
+                                  std::to_string(structuredMessageRepeatLimit_) + ")";
+                    for (auto& l : loggers_)
+                        l.second->log(m, hint);
+                }
+                return;
+            }
+        }
+    }
     if (sameSourceLocationSince_ <= sameSourceLocationCutoff_) {
         for (auto& l : loggers_) {
             l.second->log(m, msg);
@@ -196,6 +302,148 @@ void Log::log(unsigned m) {
     }
 }
 
+void Log::write(unsigned m, const char* filename, int lineNo, const string& text) {
+    if (async()) {
+        std::ostringstream os;
+        os.setf(ios::fixed, ios::floatfield);
+        os.setf(ios::showpoint);
+        formatHeader(os, m, filename, lineNo);
+        os << text;
+        enqueue(m, filename, lineNo, os.str());
+        return;
+    }
+    boost::unique_lock<boost::shared_mutex> lock(mutex_);
+    header(m, filename, lineNo);
+    ls_ << text;
+    log(m);
+}
+
+void Log::setStructuredMessageRepeatLimit(std::size_t limit) {
+    boost::unique_lock<boost::shared_mutex> lock(mutex_);
+    structuredMessageRepeatLimit_ = limit;
+    structuredMessageCount_.clear();
+}
+
+void Log::startAsync(std::size_t queueSize, QueueFullPolicy policy) {
+    QL_REQUIRE(queueSize > 0, "Log::startAsync(): queue size must be positive");
+    stopAsync();
+    queueSize_ = queueSize;
+    queueFullPolicy_ = policy;
+    stopping_ = false;
+    // invalidates the queues of all threads, they create new ones on their next message
+    ++generation_;
+    drainThread_ = std::thread(&Log::drain, this);
+    async_.store(true, std::memory_order_release);
+}
+
+void Log::stopAsync() {
+    if (!drainThread_.joinable())
+        return;
+    async_.store(false, std::memory_order_release);
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex_);
+        stopping_ = true;
+    }
+    wake_.notify_one();
+    drainThread_.join();
+    {
+        // wake up threads waiting in flush(), all messages are written now
+        std::lock_guard<std::mutex> lock(wakeMutex_);
+        processedCv_.notify_all();
+    }
+    std::lock_guard<std::mutex> lock(queuesMutex_);
+    queues_.clear();
+}
+
+void Log::flush() {
+    if (!async())
+        return;
+    std::size_t target = enqueued_.load();
+    wake_.notify_one();
+    std::unique_lock<std::mutex> lock(wakeMutex_);
+    // messages counted in target that are dropped later are removed from enqueued_ again
+    processedCv_.wait(lock, [this, target]() {
+        return processed_.load() >= std::min(target, enqueued_.load()) || !async();
+    });
+}
+
+void Log::enqueue(unsigned m, const char* filename, int lineNo, string&& msg) {
+    ThreadLogQueue& q = threadLogQueue;
+    std::size_t generation = generation_.load(std::memory_order_acquire);
+    if (!q.queue || q.generation != generation) {
+        if (q.queue)
+            q.queue->setOrphaned();
+        q.queue = boost::make_shared<detail::LogQueue>(queueSize_);
+        q.generation = generation;
+        std::lock_guard<std::mutex> lock(queuesMutex_);
+        queues_.push_back(q.queue);
+    }
+    detail::LogQueue::Record r{m, filename, lineNo, std::move(msg)};
+    // count the message before it is pushed, so that a flush() after this call waits for it, even if the drain thread
+    // writes it before we return from push()
+    ++enqueued_;
+    while (!q.queue->push(r)) {
+        if (queueFullPolicy_ == QueueFullPolicy::Drop) {
+            ++dropped_;
+            {
+                std::lock_guard<std::mutex> lock(wakeMutex_);
+                --enqueued_;
+            }
+            processedCv_.notify_all();
+            return;
+        }
+        wake_.notify_one();
+        std::this_thread::yield();
+    }
+}
+
+void Log::drain() {
+    vector<boost::shared_ptr<detail::LogQueue>> queues;
+    detail::LogQueue::Record r;
+    while (true) {
+        // read the stop flag before draining, so that messages queued before stopAsync() are written
+        bool stopping = stopping_.load();
+        {
+            std::lock_guard<std::mutex> lock(queuesMutex_);
+            queues_.erase(std::remove_if(queues_.begin(), queues_.end(),
+                                         [](const boost::shared_ptr<detail::LogQueue>& q) {
+                                             return q->orphaned() && q->empty();
+                                         }),
+                          queues_.end());
+            queues = queues_;
+        }
+        std::size_t n = 0;
+        {
+            boost::unique_lock<boost::shared_mutex> lock(mutex_);
+            for (auto const& q : queues) {
+                while (q->pop(r)) {
+                    updateStatistics(r.filename, r.lineNo);
+                    dispatch(r.mask, r.msg);
+                    ++n;
+                }
+            }
+            if (std::size_t dropped = dropped_.exchange(0)) {
+                std::ostringstream os;
+                formatHeader(os, ORE_WARNING, __FILE__, __LINE__);
+                os << dropped << " log messages dropped, the asynchronous log queue was full";
+                for (auto& l : loggers_)
+                    l.second->log(ORE_WARNING, os.str());
+            }
+        }
+        if (n > 0) {
+            // taking the lock ensures that a flushing thread is either waiting or sees the new count
+            std::lock_guard<std::mutex> lock(wakeMutex_);
+            processed_ += n;
+            processedCv_.notify_all();
+        } else {
+            if (stopping)
+                break;
+            std::unique_lock<std::mutex> lock(wakeMutex_);
+            wake_.wait_for(lock, std::chrono::milliseconds(5), [this]() { return stopping_.load(); });
+        }
+    }
+}
+
 // --------
 
 LoggerStream::LoggerStream(unsigned mask, const char* filename, unsigned lineNo)
@@ -209,12 +457,8 @@ LoggerStream::~LoggerStream() {
     string text;
     while (getline(ss_, text)) {
         // we expand the MLOG macro here so we can overwrite __FILE__ and __LINE__
-        if (ore::data::Log::instance().enabled() && ore::data::Log::instance().filter(mask_)) {
-            boost::unique_lock<boost::shared_mutex> lock(ore::data::Log::instance().mutex());
-            ore::data::Log::instance().header(mask_, filename_, lineNo_);
-            ore::data::Log::instance().logStream() << text;
-            ore::data::Log::instance().log(mask_);
-        }
+        if (ore::data::Log::instance().enabled(mask_))
+            ore::data::Log::instance().write(mask_, filename_, lineNo_, text);
     }
 }
 
@@ -48,10 +48,16 @@
 #include <unistd.h>
 #endif
 
+#include <atomic>
+#include <condition_variable>
 #include <iomanip>
+#include <mutex>
 #include <ored/utilities/osutils.hpp>
 #include <ql/patterns/singleton.hpp>
 #include <sstream>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 
 #include <boost/thread/shared_mutex.hpp>
 #include <boost/thread/lock_types.hpp>
@@ -194,13 +200,27 @@ private:
     unsigned minLevel_;
 };
 
+namespace detail {
+class LogQueue;
+}
+
 //! Global static Log class
 /*!
   The Global Log class gets registered with individual loggers and receives application log messages.
   Once a message is received, it is immediately dispatched to each of the registered loggers, the order in which
   the loggers are called is not guaranteed.
 
-  Logging is done by the calling thread and the LOG call blocks until all the loggers have returned.
+  Logging is done by the calling thread and the LOG call blocks until all the loggers have returned, unless
+  asynchronous logging is switched on with startAsync(). In this case each thread formats its messages and puts them
+  into its own bounded queue, a background thread takes the messages from the queues and passes them to the loggers.
+  The messages of one thread keep their order, messages of different threads may be interleaved differently from
+  the order in which they were produced. If a queue is full, the calling thread either waits until the background
+  thread has made room or the message is dropped, depending on the QueueFullPolicy. Call flush() to wait until all
+  queued messages are written and stopAsync() to write the remaining messages and return to synchronous logging.
+
+  Repeated identical structured messages, e.g. the same StructuredTradeErrorMessage for a trade on each sample,
+  can be limited with setStructuredMessageRepeatLimit(). The repetitions are counted for up to 100000 distinct
+  messages, beyond that the counts are reset.
 
   At start up, the Log class has no loggers and so will ignore any LOG() messages until it is configured.
 
@@ -266,46 +286,80 @@ public:
     std::ostream& logStream() { return ls_; }
     //! macro utility function - do not use directly
     void log(unsigned m);
+    //! macro utility function - do not use directly, writes a message with header either directly or via the queue
+    void write(unsigned m, const char* filename, int lineNo, const string& text);
 
     //! mutex to acquire locks
     boost::shared_mutex& mutex() { return mutex_; }
 
+    /* The mask and the enabled flag are read without taking the mutex, so that the check in the logging macros
+       reduces to a load and a branch when a level is switched off. */
+
     // Avoid a large number of warnings in VS by adding 0 !=
-    bool filter(unsigned mask) {
-        boost::shared_lock<boost::shared_mutex> lock(mutex());
-        return 0 != (mask & mask_);
-    }
-    unsigned mask() {
-        boost::shared_lock<boost::shared_mutex> lock(mutex());
-        return mask_;
-    }
+    bool filter(unsigned mask) const { return 0 != (mask & mask_.load(std::memory_order_relaxed)); }
+    unsigned mask() const { return mask_.load(std::memory_order_relaxed); }
     void setMask(unsigned mask) {
         boost::unique_lock<boost::shared_mutex> lock(mutex());
         mask_ = mask;
+        updateActiveMask();
     }
 
-    bool enabled() {
-        boost::shared_lock<boost::shared_mutex> lock(mutex());
-        return enabled_;
-    }
+    bool enabled() const { return enabled_.load(std::memory_order_relaxed); }
+    //! true if the log is switched on and the mask passes the filter
+    bool enabled(unsigned mask) const { return 0 != (mask & activeMask_.load(std::memory_order_relaxed)); }
     void switchOn() {
         boost::unique_lock<boost::shared_mutex> lock(mutex());
         enabled_ = true;
+        updateActiveMask();
     }
     void switchOff() {
         boost::unique_lock<boost::shared_mutex> lock(mutex());
         enabled_ = false;
+        updateActiveMask();
     }
 
     //! if a PID is set for the logger, messages are tagged with [1234] if pid = 1234
     void setPid(const int pid) { pid_ = pid; }
 
+    //! What a thread does when its queue is full in asynchronous mode
+    enum class QueueFullPolicy { Block, Drop };
+
+    //! Switch to asynchronous logging, with a queue holding up to queueSize messages per thread
+    /*! Must not be called while other threads are logging. */
+    void startAsync(std::size_t queueSize = 4096, QueueFullPolicy policy = QueueFullPolicy::Block);
+    //! Write all queued messages and switch back to synchronous logging
+    /*! Must not be called while other threads are logging. */
+    void stopAsync();
+    //! true if asynchronous logging is switched on
+    bool async() const { return async_.load(std::memory_order_acquire); }
+    //! Wait until all messages queued so far are passed to the loggers, does nothing in synchronous mode
+    void flush();
+
+    //! Write at most limit identical structured messages, further repetitions are suppressed, 0 means no limit
+    void setStructuredMessageRepeatLimit(std::size_t limit);
+
+    ~Log();
+
 private:
     Log();
 
+    // writes the level, time stamp and source location of a message
+    void formatHeader(std::ostream& os, unsigned m, const char* filename, int lineNo) const;
+    // updates the statistics to suppress messages from the same source location, called with the mutex locked
+    void updateStatistics(const char* filename, int lineNo);
+    // passes a message to the loggers, called with the mutex locked
+    void dispatch(unsigned m, const string& msg);
+    // puts a message into the queue of the calling thread
+    void enqueue(unsigned m, const char* filename, int lineNo, string&& msg);
+    // the loop of the background thread in asynchronous mode
+    void drain();
+
+    // the mask if the log is switched on, zero otherwise, to be called with the mutex locked
+    void updateActiveMask() { activeMask_ = enabled_ ? mask_.load() : 0u; }
+
     std::map<string, boost::shared_ptr<Logger>> loggers_;
-    bool enabled_;
-    unsigned mask_;
+    std::atomic<bool> enabled_;
+    std::atomic<unsigned> mask_, activeMask_;
     std::ostringstream ls_;
 
     std::size_t sameSourceLocationSince_ = 0;
@@ -316,6 +370,19 @@ private:
 
     int pid_ = 0;
 
+    std::size_t structuredMessageRepeatLimit_ = 0;
+    std::unordered_map<string, std::size_t> structuredMessageCount_;
+
+    // asynchronous mode
+    std::atomic<bool> async_, stopping_;
+    std::size_t queueSize_ = 4096;
+    QueueFullPolicy queueFullPolicy_ = QueueFullPolicy::Block;
+    std::atomic<std::size_t> generation_, enqueued_, processed_, dropped_;
+    std::vector<boost::shared_ptr<detail::LogQueue>> queues_;
+    std::mutex queuesMutex_, wakeMutex_;
+    std::condition_variable wake_, processedCv_;
+    std::thread drainThread_;
+
     mutable boost::shared_mutex mutex_;
 };
 
@@ -324,13 +391,10 @@ private:
  */
 #define MLOG(mask, text)                                                                                               \
     {                                                                                                                  \
-        if (ore::data::Log::instance().enabled() && ore::data::Log::instance().filter(mask)) {                         \
+        if (ore::data::Log::instance().enabled(mask)) {                                                                \
             std::ostringstream __ore_mlog_tmp_stringstream__;                                                          \
             __ore_mlog_tmp_stringstream__ << text;                                                                     \
-            boost::unique_lock<boost::shared_mutex> lock(ore::data::Log::instance().mutex());                          \
-            ore::data::Log::instance().header(mask, __FILE__, __LINE__);                                               \
-            ore::data::Log::instance().logStream() << __ore_mlog_tmp_stringstream__.str();                             \
-            ore::data::Log::instance().log(mask);                                                                      \
+            ore::data::Log::instance().write(mask, __FILE__, __LINE__, __ore_mlog_tmp_stringstream__.str());           \
         }                                                                                                              \
     }
 
@@ -354,12 +418,10 @@ private:
 
 #define MEM_LOG_USING_LEVEL(LEVEL)                                                                                     \
     {                                                                                                                  \
-        if (ore::data::Log::instance().enabled() && ore::data::Log::instance().filter(LEVEL)) {                        \
-            boost::unique_lock<boost::shared_mutex> lock(ore::data::Log::instance().mutex());                          \
-            ore::data::Log::instance().header(LEVEL, __FILE__, __LINE__);                                              \
-            ore::data::Log::instance().logStream() << std::to_string(ore::data::os::getPeakMemoryUsageBytes()) << "|"; \
-            ore::data::Log::instance().logStream() << std::to_string(ore::data::os::getMemoryUsageBytes());            \
-            ore::data::Log::instance().log(LEVEL);                                                                     \
+        if (ore::data::Log::instance().enabled(LEVEL)) {                                                               \
+            ore::data::Log::instance().write(LEVEL, __FILE__, __LINE__,                                                \
+                                             std::to_string(ore::data::os::getPeakMemoryUsageBytes()) + "|" +          \
+                                                 std::to_string(ore::data::os::getMemoryUsageBytes()));                \
         }                                                                                                              \
     }
 
@@ -414,7 +476,7 @@ private:
 };
 
 #define CHECKED_LOGGERSTREAM(LEVEL, text)                                                                              \
-    if (ore::data::Log::instance().enabled() && ore::data::Log::instance().filter(LEVEL)) {                            \
+    if (ore::data::Log::instance().enabled(LEVEL)) {                                                                   \
         (std::ostream&)ore::data::LoggerStream(LEVEL, __FILE__, __LINE__) << text;                              \
     }
 
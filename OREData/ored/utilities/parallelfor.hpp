@@ -0,0 +1,79 @@
+/*
+ Copyright (C) 2023 Quaternion Risk Management Ltd
+ All rights reserved.
+
+ This file is part of ORE, a free-software/open-source library
+ for transparent pricing and risk analysis - http://opensourcerisk.org
+
+ ORE is free software: you can redistribute it and/or modify it
+ under the terms of the Modified BSD License.  You should have received a
+ copy of the license along with this program.
+ The license is also available online at <http://opensourcerisk.org>
+
+ This program is distributed on the basis that it will form a useful
+ contribution to risk analytics and model standardisation, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ FITNESS FOR A PARTICULAR PURPOSE. See the license for more details.
+*/
+
+/*! \file ored/utilities/parallelfor.hpp
+    \brief Distribute independent loop iterations over several threads
+    \ingroup utilities
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <thread>
+#include <vector>
+
+namespace ore {
+namespace data {
+
+//! Call f(i) for i = 0, ..., n - 1 on up to nThreads threads
+/*! Each thread picks the next index that is not yet processed, so the order in which the indices are processed
+    is unspecified and f must only write to data owned by index i. Results that are to be combined should be stored
+    per index and reduced on the calling thread afterwards, which keeps the results independent of the number of
+    threads.
+
+    An exception thrown by f stops the thread that threw it. It is rethrown on the calling thread once all threads
+    are finished; if several threads fail, the exception of the thread with the lowest number is rethrown.
+
+    With nThreads <= 1 or n <= 1 the loop runs on the calling thread.
+
+    \ingroup utilities
+*/
+template <class F> void parallelFor(const std::size_t n, const std::size_t nThreads, F f) {
+    std::size_t threads = std::max<std::size_t>(std::min(nThreads, n), 1);
+    std::atomic<std::size_t> next(0);
+    std::vector<std::exception_ptr> exceptions(threads);
+
+    auto worker = [&](const std::size_t t) {
+        try {
+            std::size_t i;
+            while ((i = next++) < n)
+                f(i);
+        } catch (...) {
+            exceptions[t] = std::current_exception();
+        }
+    };
+
+    if (threads == 1) {
+        worker(0);
+    } else {
+        std::vector<std::thread> workers;
+        for (std::size_t t = 0; t < threads; ++t)
+            workers.emplace_back(worker, t);
+        for (auto& w : workers)
+            w.join();
+    }
+    for (auto const& e : exceptions) {
+        if (e)
+            std::rethrow_exception(e);
+    }
+}
+
+} // namespace data
+} // namespace ore
@@ -102,6 +102,20 @@ void ProgressLog::updateProgress(const unsigned long progress, const unsigned lo
 
 void ProgressLog::reset() { messageCounter_ = 0; }
 
+WorkerProgressIndicator::WorkerProgressIndicator(ProgressReporter* reporter, std::mutex& mutex,
+                                                 std::vector<unsigned long>& progress, const unsigned long total,
+                                                 const QuantLib::Size worker)
+    : reporter_(reporter), mutex_(mutex), progress_(progress), total_(total), worker_(worker) {}
+
+void WorkerProgressIndicator::updateProgress(const unsigned long progress, const unsigned long) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    progress_[worker_] = progress;
+    unsigned long sum = 0;
+    for (auto const p : progress_)
+        sum += p;
+    reporter_->updateProgress(sum, total_);
+}
+
 NoProgressBar::NoProgressBar(const std::string& message, const unsigned int messageWidth) {
     std::cout << std::setw(messageWidth) << message << std::flush;
 }
@@ -28,7 +28,9 @@
 #include <boost/shared_ptr.hpp>
 #include <boost/unordered_set.hpp>
 
+#include <mutex>
 #include <string>
+#include <vector>
 
 namespace ore {
 namespace data {
@@ -108,6 +110,29 @@ private:
     unsigned int numberOfMessages_, messageCounter_;
 };
 
+//! Progress Indicator for one of several workers that run in parallel
+/*! The indicator stores the progress of its worker in a vector shared by all workers and forwards the sum over all
+    workers to the given reporter. The reporter, mutex and progress vector must outlive the indicator.
+
+    \ingroup utilities
+*/
+class WorkerProgressIndicator : public ProgressIndicator {
+public:
+    WorkerProgressIndicator(ProgressReporter* reporter, std::mutex& mutex, std::vector<unsigned long>& progress,
+                            const unsigned long total, const QuantLib::Size worker);
+
+    //! ProgressIndicator interface
+    void updateProgress(const unsigned long progress, const unsigned long total) override;
+    void reset() override {}
+
+private:
+    ProgressReporter* reporter_;
+    std::mutex& mutex_;
+    std::vector<unsigned long>& progress_;
+    unsigned long total_;
+    QuantLib::Size worker_;
+};
+
 /*! Progress Bar just writes the given message and flushes */
 class NoProgressBar : public ProgressIndicator {
 public:
@@ -0,0 +1,161 @@
+/*
+ Copyright (C) 2023 Quaternion Risk Management Ltd
+ All rights reserved.
+
+ This file is part of ORE, a free-software/open-source library
+ for transparent pricing and risk analysis - http://opensourcerisk.org
+
+ ORE is free software: you can redistribute it and/or modify it
+ under the terms of the Modified BSD License.  You should have received a
+ copy of the license along with this program.
+ The license is also available online at <http://opensourcerisk.org>
+
+ This program is distributed on the basis that it will form a useful
+ contribution to risk analytics and model standardisation, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ FITNESS FOR A PARTICULAR PURPOSE. See the license for more details.
+*/
+
+#include <boost/test/unit_test.hpp>
+#include <fstream>
+#include <map>
+#include <ored/marketdata/csvloader.hpp>
+#include <oret/datapaths.hpp>
+#include <oret/toplevelfixture.hpp>
+#include <ql/settings.hpp>
+#include <sstream>
+
+using namespace QuantLib;
+using namespace ore::data;
+using namespace std;
+
+namespace {
+
+string writeFile(const string& name, const string& content) {
+    string filename = TEST_OUTPUT_FILE(name);
+    ofstream file(filename.c_str(), ios::binary);
+    file << content;
+    return filename;
+}
+
+void checkSameData(const CSVLoader& loader, const CSVLoader& expected, const vector<Date>& dates) {
+    for (auto const& d : dates) {
+        auto quotes = loader.loadQuotes(d);
+        auto expectedQuotes = expected.loadQuotes(d);
+        BOOST_REQUIRE_EQUAL(quotes.size(), expectedQuotes.size());
+        for (Size i = 0; i < quotes.size(); ++i) {
+            BOOST_CHECK_EQUAL(quotes[i]->asofDate(), expectedQuotes[i]->asofDate());
+            BOOST_CHECK_EQUAL(quotes[i]->name(), expectedQuotes[i]->name());
+            BOOST_CHECK_EQUAL(quotes[i]->quote()->value(), expectedQuotes[i]->quote()->value());
+        }
+    }
+    for (auto const& [fixings, expectedFixings] :
+         {make_pair(loader.loadFixings(), expected.loadFixings()),
+          make_pair(loader.loadDividends(), expected.loadDividends())}) {
+        BOOST_REQUIRE_EQUAL(fixings.size(), expectedFixings.size());
+        for (auto f = fixings.begin(), e = expectedFixings.begin(); f != fixings.end(); ++f, ++e) {
+            BOOST_CHECK_EQUAL(f->date, e->date);
+            BOOST_CHECK_EQUAL(f->name, e->name);
+            BOOST_CHECK_EQUAL(f->fixing, e->fixing);
+        }
+    }
+}
+
+} // namespace
+
+BOOST_FIXTURE_TEST_SUITE(OREDataTestSuite, ore::test::TopLevelFixture)
+
+BOOST_AUTO_TEST_SUITE(CSVLoaderTests)
+
+BOOST_AUTO_TEST_CASE(testLineFormats) {
+
+    BOOST_TEST_MESSAGE("Testing CSVLoader line formats...");
+
+    Date today(5, February, 2016);
+    Settings::instance().evaluationDate() = today;
+
+    string market = writeFile("market.txt", "# comment line\n"
+                                            "\n"
+                                            "2016-02-05 FX/RATE/EUR/USD 1.1\n"
+                                            "  20160205,MM/RATE/EUR/0D/1D,-0.0035\r\n"
+                                            "2016-02-05;\tMM/RATE/EUR/1D/1D;+.5e-2 \n"
+                                            "05-02-2016 FX/RATE/EUR/GBP 0.75\n"
+                                            "2016-02-05 FX/RATE/EUR/USD 1.2\n"
+                                            "2016-02-05 UNKNOWN/DATUM 1.0\n"
+                                            "2016-02-04 FX/RATE/EUR/USD 1.05");
+    string fixings = writeFile("fixings.txt", "2016-02-04 EUR-EURIBOR-6M 0.01\n"
+                                              "2016-02-04 EUR-EURIBOR-6M 0.02\n"
+                                              "2016-02-05 EUR-EURIBOR-6M 0.03\n"
+                                              "2016-02-06 EUR-EURIBOR-6M 0.04\n");
+    string dividends = writeFile("dividends.txt", "2016-02-05,SP5,2.5\n2016-02-08,SP5,3.5\n");
+
+    for (Size nThreads : {1, 4}) {
+        CSVLoader loader(market, fixings, dividends, false, nThreads);
+
+        auto quotes = loader.loadQuotes(today);
+        BOOST_REQUIRE_EQUAL(quotes.size(), 4);
+        map<string, Real> values;
+        for (auto const& q : quotes)
+            values[q->name()] = q->quote()->value();
+        // the first of two duplicate quotes is kept
+        BOOST_CHECK_EQUAL(values["FX/RATE/EUR/USD"], 1.1);
+        BOOST_CHECK_EQUAL(values["FX/RATE/EUR/GBP"], 0.75);
+        BOOST_CHECK_EQUAL(values["MM/RATE/EUR/0D/1D"], -0.0035);
+        BOOST_CHECK_EQUAL(values["MM/RATE/EUR/1D/1D"], 0.005);
+        BOOST_CHECK_EQUAL(loader.loadQuotes(Date(4, February, 2016)).size(), 1);
+
+        // fixings after today are skipped, so are fixings for today if todays fixings are implied
+        auto loadedFixings = loader.loadFixings();
+        BOOST_REQUIRE_EQUAL(loadedFixings.size(), 2);
+        BOOST_CHECK_EQUAL(loadedFixings.begin()->date, Date(4, February, 2016));
+        BOOST_CHECK_EQUAL(loadedFixings.begin()->fixing, 0.01);
+        BOOST_CHECK_EQUAL(loadedFixings.rbegin()->date, today);
+        BOOST_CHECK_EQUAL(loadedFixings.rbegin()->fixing, 0.03);
+        BOOST_CHECK_EQUAL(CSVLoader(market, fixings, dividends, true, nThreads).loadFixings().size(), 1);
+        BOOST_REQUIRE_EQUAL(loader.loadDividends().size(), 1);
+        BOOST_CHECK_EQUAL(loader.loadDividends().begin()->fixing, 2.5);
+    }
+
+    string invalid = writeFile("invalid.txt", "2016-02-05 FX/RATE/EUR/USD 1.1\n2016-02-05 FX/RATE/EUR/GBP 0.75 1\n");
+    BOOST_CHECK_THROW(CSVLoader(invalid, fixings, false, 4), QuantLib::Error);
+    string invalidValue = writeFile("invalidvalue.txt", "2016-02-05 FX/RATE/EUR/USD abc\n");
+    BOOST_CHECK_THROW(CSVLoader(invalidValue, fixings, false), QuantLib::Error);
+    BOOST_CHECK_THROW(CSVLoader(TEST_OUTPUT_FILE("missing.txt"), fixings, false), QuantLib::Error);
+}
+
+BOOST_AUTO_TEST_CASE(testParallelParsing) {
+
+    BOOST_TEST_MESSAGE("Testing CSVLoader with several threads...");
+
+    Date today(5, February, 2016);
+    Settings::instance().evaluationDate() = today;
+
+    // a few thousand quotes and fixings on a few dates, including duplicates and comment lines
+    vector<Date> dates = {today - 2, today - 1, today};
+    vector<string> currencies = {"USD", "GBP", "CHF", "JPY", "SEK", "NOK", "DKK", "CAD"};
+    ostringstream market, fixings;
+    for (Size i = 0; i < 3000; ++i) {
+        Date d = dates[i % dates.size()];
+        string date = (i % 2 == 0) ? to_string(d.year() * 10000 + d.month() * 100 + d.dayOfMonth())
+                                   : to_string(d.year()) + "-" + (d.month() < 10 ? "0" : "") + to_string(d.month()) +
+                                         "-" + (d.dayOfMonth() < 10 ? "0" : "") + to_string(d.dayOfMonth());
+        market << date << (i % 3 == 0 ? "," : " ") << "FX/RATE/EUR/" << currencies[(i / 3) % currencies.size()]
+               << " " << 1.0 + i * 1.0E-4 << "\n";
+        market << date << " MM/RATE/EUR/0D/" << (i / 3) % 50 + 1 << "D " << -0.001 * i << "\n";
+        fixings << date << "\tINDEX" << i % 100 << "\t" << 0.0001 * i << "\n";
+        if (i % 500 == 0)
+            market << "# comment\n\n";
+    }
+    string marketFile = writeFile("parallel_market.txt", market.str());
+    string fixingFile = writeFile("parallel_fixings.txt", fixings.str());
+
+    CSVLoader expected(marketFile, fixingFile, fixingFile, false, 1);
+    for (Size nThreads : {2, 4, 7}) {
+        CSVLoader loader(marketFile, fixingFile, fixingFile, false, nThreads);
+        checkSameData(loader, expected, dates);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,267 @@
+/*
+ Copyright (C) 2023 Quaternion Risk Management Ltd
+ All rights reserved.
+
+ This file is part of ORE, a free-software/open-source library
+ for transparent pricing and risk analysis - http://opensourcerisk.org
+
+ ORE is free software: you can redistribute it and/or modify it
+ under the terms of the Modified BSD License.  You should have received a
+ copy of the license along with this program.
+ The license is also available online at <http://opensourcerisk.org>
+
+ This program is distributed on the basis that it will form a useful
+ contribution to risk analytics and model standardisation, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ FITNESS FOR A PARTICULAR PURPOSE. See the license for more details.
+*/
+
+#include <boost/make_shared.hpp>
+#include <boost/test/unit_test.hpp>
+#include <boost/timer/timer.hpp>
+#include <ored/portfolio/structuredtradeerror.hpp>
+#include <ored/utilities/log.hpp>
+#include <ored/utilities/parallelfor.hpp>
+#include <oret/toplevelfixture.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <set>
+
+using namespace QuantLib;
+using namespace ore::data;
+using namespace std;
+
+namespace {
+
+// collects the messages of all threads, can be read while messages are written
+class SetLogger : public Logger {
+public:
+    SetLogger() : Logger("SetLogger") {}
+    void log(unsigned, const string& msg) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        messages_.insert(msg);
+    }
+    bool contains(const string& text) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return std::any_of(messages_.begin(), messages_.end(),
+                           [&text](const string& m) { return m.find(text) != string::npos; });
+    }
+
+private:
+    std::mutex mutex_;
+    std::set<string> messages_;
+};
+
+// registers a BufferLogger and restores the state of the log on destruction
+class BufferLoggerFixture {
+public:
+    BufferLoggerFixture()
+        : logger(boost::make_shared<BufferLogger>()), enabled_(Log::instance().enabled()),
+          mask_(Log::instance().mask()) {
+        Log::instance().registerLogger(logger);
+    }
+    ~BufferLoggerFixture() {
+        Log::instance().stopAsync();
+        Log::instance().setStructuredMessageRepeatLimit(0);
+        Log::instance().removeLogger(BufferLogger::name);
+        Log::instance().setMask(mask_);
+        if (enabled_)
+            Log::instance().switchOn();
+        else
+            Log::instance().switchOff();
+    }
+
+    Size messages() {
+        Size n = 0;
+        while (logger->hasNext()) {
+            logger->next();
+            ++n;
+        }
+        return n;
+    }
+
+    boost::shared_ptr<BufferLogger> logger;
+
+private:
+    bool enabled_;
+    unsigned mask_;
+};
+
+} // namespace
+
+BOOST_FIXTURE_TEST_SUITE(OREDataTestSuite, ore::test::TopLevelFixture)
+
+BOOST_FIXTURE_TEST_SUITE(LogTests, BufferLoggerFixture)
+
+BOOST_AUTO_TEST_CASE(testLogMaskAndSwitch) {
+
+    BOOST_TEST_MESSAGE("Testing log mask and switch...");
+
+    Log::instance().setMask(ORE_ALERT | ORE_CRITICAL | ORE_ERROR | ORE_WARNING | ORE_NOTICE);
+    Log::instance().switchOff();
+    LOG("switched off");
+    BOOST_CHECK(!Log::instance().enabled(ORE_NOTICE));
+    BOOST_CHECK_EQUAL(messages(), 0);
+
+    Log::instance().switchOn();
+    BOOST_CHECK(Log::instance().enabled(ORE_NOTICE));
+    BOOST_CHECK(!Log::instance().enabled(ORE_DEBUG));
+    LOG("notice");
+    DLOG("debug");
+    WLOG("warning");
+    BOOST_CHECK_EQUAL(messages(), 2);
+
+    Log::instance().setMask(Log::instance().mask() | ORE_DEBUG);
+    BOOST_CHECK(Log::instance().enabled(ORE_DEBUG));
+    DLOG("debug");
+    BOOST_CHECK_EQUAL(messages(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(testLogFromSeveralThreads) {
+
+    BOOST_TEST_MESSAGE("Testing logging from several threads...");
+
+    Log::instance().setMask(ORE_ALERT | ORE_CRITICAL | ORE_ERROR | ORE_WARNING | ORE_NOTICE);
+    Log::instance().switchOn();
+    parallelFor(1000, 4, [](const Size i) {
+        LOG("message " << i);
+        DLOG("filtered message " << i);
+    });
+    BOOST_CHECK_EQUAL(messages(), 1000);
+}
+
+BOOST_AUTO_TEST_CASE(testDisabledLogPerformance) {
+
+    BOOST_TEST_MESSAGE("Testing performance of disabled log statements...");
+
+    Log::instance().setMask(ORE_ALERT | ORE_CRITICAL | ORE_ERROR | ORE_WARNING | ORE_NOTICE);
+    Log::instance().switchOn();
+
+    const Size n = 10000000;
+    volatile Size sink = 0;
+
+    boost::timer::cpu_timer timer;
+    for (Size i = 0; i < n; ++i)
+        sink = sink + i;
+    double reference = timer.elapsed().wall * 1e-9;
+
+    for (Size nThreads : {1, 4}) {
+        timer.start();
+        parallelFor(nThreads, nThreads, [n](const Size) {
+            volatile Size threadSink = 0;
+            for (Size i = 0; i < n; ++i) {
+                DLOG("disabled message " << i);
+                threadSink = threadSink + i;
+            }
+        });
+        double elapsed = timer.elapsed().wall * 1e-9;
+        BOOST_TEST_MESSAGE("Disabled DLOG on " << nThreads << " thread(s): " << elapsed / n * 1e9
+                                               << " ns per statement, reference loop " << reference / n * 1e9
+                                               << " ns per iteration");
+    }
+
+    BOOST_CHECK_EQUAL(messages(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(testAsyncLogging) {
+
+    BOOST_TEST_MESSAGE("Testing asynchronous logging from several threads...");
+
+    Log::instance().setMask(ORE_ALERT | ORE_CRITICAL | ORE_ERROR | ORE_WARNING | ORE_NOTICE);
+    Log::instance().switchOn();
+    Log::instance().startAsync(16);
+    BOOST_CHECK(Log::instance().async());
+    parallelFor(4, 4, [](const Size t) {
+        for (Size i = 0; i < 200; ++i) {
+            LOG("thread " << t << " message " << i);
+            DLOG("filtered message " << i);
+        }
+    });
+    Log::instance().flush();
+    BOOST_CHECK_EQUAL(messages(), 800);
+
+    // messages of one thread keep their order
+    for (Size i = 0; i < 10; ++i)
+        LOG("ordered message " << i);
+    Log::instance().stopAsync();
+    BOOST_CHECK(!Log::instance().async());
+    for (Size i = 0; i < 10; ++i) {
+        BOOST_REQUIRE(logger->hasNext());
+        string msg = logger->next();
+        BOOST_CHECK_MESSAGE(msg.find("ordered message " + std::to_string(i)) != string::npos,
+                            "unexpected message " << msg << ", expected ordered message " << i);
+    }
+    BOOST_CHECK_EQUAL(messages(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(testAsyncLoggingFlushFromSeveralThreads) {
+
+    BOOST_TEST_MESSAGE("Testing flush of the asynchronous log from several threads...");
+
+    auto setLogger = boost::make_shared<SetLogger>();
+    Log::instance().registerLogger(setLogger);
+    Log::instance().setMask(ORE_ALERT | ORE_CRITICAL | ORE_ERROR | ORE_WARNING | ORE_NOTICE);
+    Log::instance().switchOn();
+    Log::instance().startAsync(16);
+    // each thread flushes after each message, its own message must have reached the logger when flush() returns
+    std::atomic<Size> missing(0);
+    parallelFor(4, 4, [&missing, &setLogger](const Size t) {
+        for (Size i = 0; i < 200; ++i) {
+            string text = "thread " + std::to_string(t) + " message " + std::to_string(i) + ";";
+            LOG(text);
+            Log::instance().flush();
+            if (!setLogger->contains(text))
+                ++missing;
+        }
+    });
+    Log::instance().stopAsync();
+    Log::instance().removeLogger("SetLogger");
+    BOOST_CHECK_EQUAL(missing.load(), 0);
+    BOOST_CHECK_EQUAL(messages(), 800);
+}
+
+BOOST_AUTO_TEST_CASE(testAsyncLoggingDropsMessagesIfQueueIsFull) {
+
+    BOOST_TEST_MESSAGE("Testing asynchronous logging with a full queue...");
+
+    Log::instance().setMask(ORE_ALERT | ORE_CRITICAL | ORE_ERROR | ORE_WARNING | ORE_NOTICE);
+    Log::instance().switchOn();
+    Log::instance().startAsync(4, Log::QueueFullPolicy::Drop);
+    {
+        // the background thread can not write messages while we hold the lock, so the queue fills up
+        boost::shared_lock<boost::shared_mutex> lock(Log::instance().mutex());
+        for (Size i = 0; i < 10; ++i)
+            LOG("message " << i);
+    }
+    Log::instance().flush();
+    // the four queued messages and a warning about the six dropped messages
+    BOOST_CHECK_EQUAL(messages(), 5);
+}
+
+BOOST_AUTO_TEST_CASE(testStructuredMessageRepeatLimit) {
+
+    BOOST_TEST_MESSAGE("Testing the repeat limit for structured messages...");
+
+    Log::instance().setMask(ORE_ALERT | ORE_CRITICAL | ORE_ERROR | ORE_WARNING | ORE_NOTICE);
+    Log::instance().switchOn();
+    Log::instance().setStructuredMessageRepeatLimit(2);
+
+    for (bool async : {false, true}) {
+        if (async)
+            Log::instance().startAsync();
+        for (Size i = 0; i < 5; ++i) {
+            ALOG(StructuredTradeErrorMessage("trade1", "Swap", "ScenarioValuation", "failed"));
+            ALOG(StructuredTradeErrorMessage("trade2", "Swap", "ScenarioValuation", "failed"));
+        }
+        Log::instance().flush();
+        /* two messages and one hint about the suppressed messages per trade, the counts are kept when switching
+           to asynchronous mode, so that all further messages are suppressed */
+        BOOST_CHECK_EQUAL(messages(), async ? 0 : 6);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,64 @@
+/*
+ Copyright (C) 2023 Quaternion Risk Management Ltd
+ All rights reserved.
+
+ This file is part of ORE, a free-software/open-source library
+ for transparent pricing and risk analysis - http://opensourcerisk.org
+
+ ORE is free software: you can redistribute it and/or modify it
+ under the terms of the Modified BSD License.  You should have received a
+ copy of the license along with this program.
+ The license is also available online at <http://opensourcerisk.org>
+
+ This program is distributed on the basis that it will form a useful
+ contribution to risk analytics and model standardisation, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ FITNESS FOR A PARTICULAR PURPOSE. See the license for more details.
+*/
+
+#include <boost/test/unit_test.hpp>
+#include <ored/utilities/parallelfor.hpp>
+#include <oret/toplevelfixture.hpp>
+
+#include <ql/errors.hpp>
+
+using namespace QuantLib;
+using namespace ore::data;
+using namespace std;
+
+BOOST_FIXTURE_TEST_SUITE(OREDataTestSuite, ore::test::TopLevelFixture)
+
+BOOST_AUTO_TEST_SUITE(ParallelForTests)
+
+BOOST_AUTO_TEST_CASE(testAllIndicesProcessedOnce) {
+
+    BOOST_TEST_MESSAGE("Testing that parallelFor processes each index exactly once...");
+
+    for (Size n : {0, 1, 7, 1000}) {
+        for (Size nThreads : {0, 1, 2, 4, 16}) {
+            vector<Size> counts(n, 0);
+            parallelFor(n, nThreads, [&counts](const Size i) { counts[i]++; });
+            for (Size i = 0; i < n; ++i)
+                BOOST_CHECK_MESSAGE(counts[i] == 1, "index " << i << " of " << n << " processed " << counts[i]
+                                                               << " times with " << nThreads << " threads");
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(testExceptionPropagation) {
+
+    BOOST_TEST_MESSAGE("Testing that parallelFor rethrows exceptions on the calling thread...");
+
+    for (Size nThreads : {1, 4}) {
+        BOOST_CHECK_THROW(parallelFor(100, nThreads,
+                                      [](const Size i) {
+                                          if (i == 42)
+                                              QL_FAIL("failure at index " << i);
+                                      }),
+                          QuantLib::Error);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE_END()
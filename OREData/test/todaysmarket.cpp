@@ -58,6 +58,9 @@ public:
     void addFixing(QuantLib::Date date, const string& name, QuantLib::Real value) {}
     void addDividend(QuantLib::Date date, const string& name, QuantLib::Real value) {}
 
+protected:
+    void addQuotes(const vector<string>& data);
+
 private:
     std::map<QuantLib::Date, std::vector<boost::shared_ptr<MarketDatum>>> data_;
     std::set<Fixing> fixings_;
@@ -404,6 +407,10 @@ MarketDataLoader::MarketDataLoader() {
         ("20160226 CORRELATION/PRICE/USD-CMS-10Y/USD-CMS-2Y/2Y/ATM 0.0105279");
     // clang-format on
 
+    addQuotes(data);
+}
+
+void MarketDataLoader::addQuotes(const vector<string>& data) {
     for (auto s : data) {
         vector<string> tokens;
         boost::trim(s);
@@ -793,6 +800,125 @@ public:
     }
 };
 
+// Loader for the parallel build test, adds the EUHICPXT yoy inflation quotes to the common market data
+class ParallelBuildMarketDataLoader : public MarketDataLoader {
+public:
+    ParallelBuildMarketDataLoader() {
+        // clang-format off
+        vector<string> data = boost::assign::list_of
+            // EUHICPXT yoy inflation swap quotes
+            ("20160226 YY_INFLATIONSWAP/RATE/EUHICPXT/1Y 0.01165")
+            ("20160226 YY_INFLATIONSWAP/RATE/EUHICPXT/2Y 0.0123214")
+            ("20160226 YY_INFLATIONSWAP/RATE/EUHICPXT/3Y 0.012869")
+            ("20160226 YY_INFLATIONSWAP/RATE/EUHICPXT/5Y 0.01363")
+            ("20160226 YY_INFLATIONSWAP/RATE/EUHICPXT/7Y 0.0142376")
+            ("20160226 YY_INFLATIONSWAP/RATE/EUHICPXT/10Y 0.0151359")
+            // EUHICPXT yoy inflation normal capfloor quotes
+            ("20160226 YY_INFLATIONCAPFLOOR/RATE_NVOL/EUHICPXT/2Y/C/-0.01 0.0078")
+            ("20160226 YY_INFLATIONCAPFLOOR/RATE_NVOL/EUHICPXT/5Y/C/-0.01 0.0071")
+            ("20160226 YY_INFLATIONCAPFLOOR/RATE_NVOL/EUHICPXT/7Y/C/-0.01 0.0063")
+            ("20160226 YY_INFLATIONCAPFLOOR/RATE_NVOL/EUHICPXT/10Y/C/-0.01 0.0068")
+            ("20160226 YY_INFLATIONCAPFLOOR/RATE_NVOL/EUHICPXT/2Y/C/0 0.0067")
+            ("20160226 YY_INFLATIONCAPFLOOR/RATE_NVOL/EUHICPXT/5Y/C/0 0.0061")
+            ("20160226 YY_INFLATIONCAPFLOOR/RATE_NVOL/EUHICPXT/7Y/C/0 0.006")
+            ("20160226 YY_INFLATIONCAPFLOOR/RATE_NVOL/EUHICPXT/10Y/C/0 0.0062")
+            ("20160226 YY_INFLATIONCAPFLOOR/RATE_NVOL/EUHICPXT/2Y/C/0.01 0.0067")
+            ("20160226 YY_INFLATIONCAPFLOOR/RATE_NVOL/EUHICPXT/5Y/C/0.01 0.0059")
+            ("20160226 YY_INFLATIONCAPFLOOR/RATE_NVOL/EUHICPXT/7Y/C/0.01 0.0057")
+            ("20160226 YY_INFLATIONCAPFLOOR/RATE_NVOL/EUHICPXT/10Y/C/0.01 0.0056")
+            ("20160226 YY_INFLATIONCAPFLOOR/RATE_NVOL/EUHICPXT/2Y/C/0.02 0.0068")
+            ("20160226 YY_INFLATIONCAPFLOOR/RATE_NVOL/EUHICPXT/5Y/C/0.02 0.0059")
+            ("20160226 YY_INFLATIONCAPFLOOR/RATE_NVOL/EUHICPXT/7Y/C/0.02 0.0056")
+            ("20160226 YY_INFLATIONCAPFLOOR/RATE_NVOL/EUHICPXT/10Y/C/0.02 0.0054");
+        // clang-format on
+
+        addQuotes(data);
+    }
+};
+
+boost::shared_ptr<TodaysMarketParameters> parallelBuildMarketParameters() {
+
+    boost::shared_ptr<TodaysMarketParameters> parameters = marketParameters();
+
+    parameters->addMarketObject(MarketObject::YoYInflationCurve, "ois",
+                                {{"EUHICPXT", "Inflation/EUHICPXT/EUHICPXT_YY_Swaps"}});
+    parameters->addMarketObject(MarketObject::YoYInflationCapFloorVol, "ois",
+                                {{"EUHICPXT", "InflationCapFloorVolatility/EUHICPXT/EUHICPXT_YY_CF_N"}});
+
+    // added to the existing default configuration
+    MarketConfiguration config;
+    config.setId(MarketObject::YoYInflationCurve, "ois");
+    config.setId(MarketObject::YoYInflationCapFloorVol, "ois");
+    parameters->addConfiguration("default", config);
+
+    return parameters;
+}
+
+boost::shared_ptr<Conventions> parallelBuildConventions() {
+
+    boost::shared_ptr<Conventions> convs = conventions();
+
+    // EUHICPXT inflation swap conventions
+    convs->add(boost::make_shared<InflationSwapConvention>("EUHICPXT_INFLATIONSWAP", "TARGET", "MF", "30/360",
+                                                           "EUHICPXT", "false", "3M", "false", "TARGET", "MF"));
+
+    return convs;
+}
+
+boost::shared_ptr<CurveConfigurations> parallelBuildCurveConfigurations() {
+
+    boost::shared_ptr<CurveConfigurations> configs = curveConfigurations();
+    bool extrapolate = true;
+
+    // clang-format off
+    vector<string> yoyQuotes{
+        "YY_INFLATIONSWAP/RATE/EUHICPXT/1Y",
+        "YY_INFLATIONSWAP/RATE/EUHICPXT/2Y",
+        "YY_INFLATIONSWAP/RATE/EUHICPXT/3Y",
+        "YY_INFLATIONSWAP/RATE/EUHICPXT/5Y",
+        "YY_INFLATIONSWAP/RATE/EUHICPXT/7Y",
+        "YY_INFLATIONSWAP/RATE/EUHICPXT/10Y"
+    };
+    // clang-format on
+
+    configs->inflationCurveConfig("EUHICPXT_YY_Swaps") = boost::make_shared<InflationCurveConfig>(
+        "EUHICPXT_YY_Swaps", "", "Yield/EUR/EUR1D", InflationCurveConfig::Type::YY, yoyQuotes,
+        "EUHICPXT_INFLATIONSWAP", extrapolate, TARGET(), Actual365Fixed(), 3 * Months, Monthly, Null<Real>(), 1E-12,
+        false, Null<Date>(), Monthly, vector<string>());
+
+    vector<string> yoyCapTenors{"2Y", "5Y", "7Y", "10Y"};
+    vector<string> yoyCapStrikes{"-0.01", "0", "0.01", "0.02"};
+    configs->inflationCapFloorVolCurveConfig("EUHICPXT_YY_CF_N") =
+        boost::make_shared<InflationCapFloorVolatilityCurveConfig>(
+            "EUHICPXT_YY_CF_N", "", InflationCapFloorVolatilityCurveConfig::Type::YY,
+            InflationCapFloorVolatilityCurveConfig::QuoteType::Volatility,
+            InflationCapFloorVolatilityCurveConfig::VolatilityType::Normal, extrapolate, yoyCapTenors,
+            vector<string>(), vector<string>(), yoyCapStrikes, Actual365Fixed(), 0, TARGET(), Following, "EUHICPXT",
+            "Inflation/EUHICPXT/EUHICPXT_YY_Swaps", "Yield/EUR/EUR1D", 3 * Months);
+
+    return configs;
+}
+
+// Fixture for the parallel build test, builds the reference market on a single thread from the extended inputs
+class ParallelBuildF : public TopLevelFixture {
+public:
+    boost::shared_ptr<TodaysMarket> market;
+
+    ParallelBuildF() {
+        Date asof(26, February, 2016);
+        Settings::instance().evaluationDate() = asof;
+        ore::data::InstrumentConventions::instance().setConventions(parallelBuildConventions());
+        market = build(1);
+    }
+
+    boost::shared_ptr<TodaysMarket> build(const Size nThreads) const {
+        return boost::make_shared<TodaysMarket>(Settings::instance().evaluationDate(), parallelBuildMarketParameters(),
+                                                boost::make_shared<ParallelBuildMarketDataLoader>(),
+                                                parallelBuildCurveConfigurations(), false, true, false, nullptr, false,
+                                                IborFallbackConfig::defaultConfig(), true, true, nThreads);
+    }
+};
+
 } // namespace
 
 BOOST_FIXTURE_TEST_SUITE(OREDataTestSuite, TopLevelFixture)
@@ -1038,6 +1164,47 @@ BOOST_AUTO_TEST_CASE(testCorrelationCurve) {
     BOOST_CHECK_SMALL(npvCash - expectedNpv2Y, 0.000001);
 }
 
+BOOST_FIXTURE_TEST_CASE(testParallelBuild, ParallelBuildF) {
+
+    BOOST_TEST_MESSAGE("Testing market build on several threads...");
+
+    Date asof = market->asofDate();
+
+#ifdef QL_ENABLE_THREAD_SAFE_OBSERVER_PATTERN
+    boost::shared_ptr<TodaysMarket> parallelMarket = build(4);
+
+    vector<pair<Handle<YieldTermStructure>, Handle<YieldTermStructure>>> curves = {
+        {market->discountCurve("EUR"), parallelMarket->discountCurve("EUR")},
+        {market->discountCurve("USD"), parallelMarket->discountCurve("USD")},
+        {market->yieldCurve("EUR_LEND"), parallelMarket->yieldCurve("EUR_LEND")},
+        {market->yieldCurve("EUR_BORROW"), parallelMarket->yieldCurve("EUR_BORROW")},
+        {market->iborIndex("USD-LIBOR-3M")->forwardingTermStructure(),
+         parallelMarket->iborIndex("USD-LIBOR-3M")->forwardingTermStructure()},
+        {market->equityDividendCurve("SP5"), parallelMarket->equityDividendCurve("SP5")}};
+    for (Size i = 1; i <= 120; ++i) {
+        Date d = asof + i * Months;
+        for (auto const& c : curves)
+            BOOST_CHECK_EQUAL(c.first->discount(d), c.second->discount(d));
+        BOOST_CHECK_EQUAL(market->commodityPriceCurve("COMDTY_GOLD_USD")->price(d),
+                          parallelMarket->commodityPriceCurve("COMDTY_GOLD_USD")->price(d));
+    }
+    for (Size i = 2; i <= 10; ++i) {
+        Date d = asof + i * Years;
+        BOOST_CHECK_EQUAL(market->yoyInflationIndex("EUHICPXT")->yoyInflationTermStructure()->yoyRate(d),
+                          parallelMarket->yoyInflationIndex("EUHICPXT")->yoyInflationTermStructure()->yoyRate(d));
+        BOOST_CHECK_EQUAL(market->yoyCapFloorVol("EUHICPXT")->volatility(d, 0.01),
+                          parallelMarket->yoyCapFloorVol("EUHICPXT")->volatility(d, 0.01));
+    }
+    BOOST_CHECK_EQUAL(market->equitySpot("SP5")->value(), parallelMarket->equitySpot("SP5")->value());
+    BOOST_CHECK_EQUAL(market->capFloorVol("USD")->volatility(5 * Years, 0.02),
+                      parallelMarket->capFloorVol("USD")->volatility(5 * Years, 0.02));
+    BOOST_CHECK_EQUAL(market->equityVol("SP5")->blackVol(1.0, 1500.0),
+                      parallelMarket->equityVol("SP5")->blackVol(1.0, 1500.0));
+#else
+    BOOST_CHECK_THROW(build(4), QuantLib::Error);
+#endif
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,221 @@
+/*
+ Copyright (C) 2023 Quaternion Risk Management Ltd
+ All rights reserved.
+
+ This file is part of ORE, a free-software/open-source library
+ for transparent pricing and risk analysis - http://opensourcerisk.org
+
+ ORE is free software: you can redistribute it and/or modify it
+ under the terms of the Modified BSD License.  You should have received a
+ copy of the license along with this program.
+ The license is also available online at <http://opensourcerisk.org>
+
+ This program is distributed on the basis that it will form a useful
+ contribution to risk analytics and model standardisation, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ FITNESS FOR A PARTICULAR PURPOSE. See the license for more details.
+*/
+
+#include <qle/math/leastsquaresregression.hpp>
+
+#include <ql/math/matrixutilities/svd.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+namespace QuantExt {
+
+namespace {
+
+// number of samples processed per block, such that the block of all basis functions stays in the cache
+constexpr Size blockSize = 512;
+
+// dot products with four partial sums, this allows the compiler to vectorise the loop without reassociation
+Real dot(const Real* a, const Real* b, const Size n) {
+    Real s0 = 0.0, s1 = 0.0, s2 = 0.0, s3 = 0.0;
+    Size i = 0;
+    for (; i + 4 <= n; i += 4) {
+        s0 += a[i] * b[i];
+        s1 += a[i + 1] * b[i + 1];
+        s2 += a[i + 2] * b[i + 2];
+        s3 += a[i + 3] * b[i + 3];
+    }
+    for (; i < n; ++i)
+        s0 += a[i] * b[i];
+    return (s0 + s1) + (s2 + s3);
+}
+
+Real dot(const Real* a, const Real* b, const Real* w, const Size n) {
+    Real s0 = 0.0, s1 = 0.0, s2 = 0.0, s3 = 0.0;
+    Size i = 0;
+    for (; i + 4 <= n; i += 4) {
+        s0 += a[i] * b[i] * w[i];
+        s1 += a[i + 1] * b[i + 1] * w[i + 1];
+        s2 += a[i + 2] * b[i + 2] * w[i + 2];
+        s3 += a[i + 3] * b[i + 3] * w[i + 3];
+    }
+    for (; i < n; ++i)
+        s0 += a[i] * b[i] * w[i];
+    return (s0 + s1) + (s2 + s3);
+}
+
+} // namespace
+
+LeastSquaresRegression::LeastSquaresRegression(const Size n, const std::vector<const Real*>& basis,
+                                               const Real* weights, const Real choleskyThreshold,
+                                               const Real svdThreshold)
+    : n_(n), basis_(basis), weights_(weights), choleskyThreshold_(choleskyThreshold), svdThreshold_(svdThreshold) {
+    for (Size j = 0; j < basis_.size(); ++j) {
+        QL_REQUIRE(n_ == 0 || basis_[j] != nullptr, "LeastSquaresRegression: basis function #" << j << " is null");
+    }
+}
+
+LeastSquaresRegression::Solver LeastSquaresRegression::solver() const {
+    factorise();
+    return solver_;
+}
+
+void LeastSquaresRegression::factorise() const {
+    if (factorised_)
+        return;
+
+    Size m = basis_.size();
+
+    // accumulate the lower triangle of X'X
+
+    Matrix xtx(m, m, 0.0);
+    for (Size start = 0; start < n_; start += blockSize) {
+        Size len = std::min(blockSize, n_ - start);
+        for (Size j = 0; j < m; ++j) {
+            for (Size k = 0; k <= j; ++k) {
+                xtx[j][k] += weights_ ? dot(basis_[j] + start, basis_[k] + start, weights_ + start, len)
+                                      : dot(basis_[j] + start, basis_[k] + start, len);
+            }
+        }
+    }
+
+    // scale to unit diagonal
+
+    scale_ = Array(m);
+    for (Size j = 0; j < m; ++j)
+        scale_[j] = xtx[j][j] > 0.0 ? 1.0 / std::sqrt(xtx[j][j]) : 1.0;
+    for (Size j = 0; j < m; ++j) {
+        for (Size k = 0; k <= j; ++k) {
+            xtx[j][k] *= scale_[j] * scale_[k];
+            xtx[k][j] = xtx[j][k];
+        }
+    }
+
+    // try the cholesky decomposition first
+
+    factor_ = Matrix(m, m, 0.0);
+    solver_ = Solver::Cholesky;
+    for (Size j = 0; j < m && solver_ == Solver::Cholesky; ++j) {
+        Real d = xtx[j][j];
+        for (Size k = 0; k < j; ++k)
+            d -= factor_[j][k] * factor_[j][k];
+        if (d <= choleskyThreshold_) {
+            solver_ = Solver::SVD;
+            break;
+        }
+        factor_[j][j] = std::sqrt(d);
+        for (Size i = j + 1; i < m; ++i) {
+            Real s = xtx[i][j];
+            for (Size k = 0; k < j; ++k)
+                s -= factor_[i][k] * factor_[j][k];
+            factor_[i][j] = s / factor_[j][j];
+        }
+    }
+
+    // fall back to the pseudo inverse from a singular value decomposition
+
+    if (solver_ == Solver::SVD) {
+        SVD svd(xtx);
+        const Matrix& U = svd.U();
+        const Matrix& V = svd.V();
+        const Array& s = svd.singularValues();
+        Real threshold = svdThreshold_ * (s.empty() ? 0.0 : s[0]);
+        factor_ = Matrix(m, m, 0.0);
+        for (Size l = 0; l < s.size(); ++l) {
+            if (s[l] <= threshold)
+                continue;
+            for (Size i = 0; i < m; ++i) {
+                for (Size k = 0; k < m; ++k)
+                    factor_[i][k] += V[i][l] * U[k][l] / s[l];
+            }
+        }
+    }
+
+    factorised_ = true;
+}
+
+Array LeastSquaresRegression::coefficients(const Real* y) const {
+    factorise();
+
+    Size m = basis_.size();
+
+    // accumulate X'y
+
+    Array b(m, 0.0);
+    for (Size start = 0; start < n_; start += blockSize) {
+        Size len = std::min(blockSize, n_ - start);
+        for (Size j = 0; j < m; ++j) {
+            b[j] += weights_ ? dot(basis_[j] + start, y + start, weights_ + start, len)
+                             : dot(basis_[j] + start, y + start, len);
+        }
+    }
+    for (Size j = 0; j < m; ++j)
+        b[j] *= scale_[j];
+
+    // solve the scaled normal equations
+
+    Array x(m, 0.0);
+    if (solver_ == Solver::Cholesky) {
+        for (Size j = 0; j < m; ++j) {
+            Real s = b[j];
+            for (Size k = 0; k < j; ++k)
+                s -= factor_[j][k] * x[k];
+            x[j] = s / factor_[j][j];
+        }
+        for (Size j = m; j > 0; --j) {
+            Real s = x[j - 1];
+            for (Size k = j; k < m; ++k)
+                s -= factor_[k][j - 1] * x[k];
+            x[j - 1] = s / factor_[j - 1][j - 1];
+        }
+    } else {
+        for (Size i = 0; i < m; ++i) {
+            for (Size k = 0; k < m; ++k)
+                x[i] += factor_[i][k] * b[k];
+        }
+    }
+
+    for (Size j = 0; j < m; ++j)
+        x[j] *= scale_[j];
+    return x;
+}
+
+void LeastSquaresRegression::fittedValues(const Array& c, Real* result) const {
+    QL_REQUIRE(c.size() == basis_.size(), "LeastSquaresRegression::fittedValues(): coefficients size ("
+                                              << c.size() << ") does not match number of basis functions ("
+                                              << basis_.size() << ")");
+    std::fill(result, result + n_, 0.0);
+    for (Size j = 0; j < basis_.size(); ++j) {
+        Real cj = c[j];
+        const Real* x = basis_[j];
+        for (Size i = 0; i < n_; ++i)
+            result[i] += cj * x[i];
+    }
+}
+
+Real LeastSquaresRegression::fittedValue(const Array& c, const Size i) const {
+    QL_REQUIRE(c.size() == basis_.size(), "LeastSquaresRegression::fittedValue(): coefficients size ("
+                                              << c.size() << ") does not match number of basis functions ("
+                                              << basis_.size() << ")");
+    Real result = 0.0;
+    for (Size j = 0; j < basis_.size(); ++j)
+        result += c[j] * basis_[j][i];
+    return result;
+}
+
+} // namespace QuantExt
@@ -0,0 +1,89 @@
+/*
+ Copyright (C) 2023 Quaternion Risk Management Ltd
+ All rights reserved.
+
+ This file is part of ORE, a free-software/open-source library
+ for transparent pricing and risk analysis - http://opensourcerisk.org
+
+ ORE is free software: you can redistribute it and/or modify it
+ under the terms of the Modified BSD License.  You should have received a
+ copy of the license along with this program.
+ The license is also available online at <http://opensourcerisk.org>
+
+ This program is distributed on the basis that it will form a useful
+ contribution to risk analytics and model standardisation, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ FITNESS FOR A PARTICULAR PURPOSE. See the license for more details.
+*/
+
+/*! \file qle/math/leastsquaresregression.hpp
+    \brief linear least squares regression via the normal equations on precomputed basis function values
+    \ingroup math
+*/
+
+#pragma once
+
+#include <ql/math/array.hpp>
+#include <ql/math/matrix.hpp>
+
+#include <vector>
+
+namespace QuantExt {
+using namespace QuantLib;
+
+//! Linear least squares regression via the normal equations
+/*! The basis function values are given column-wise, basis[j] points to the values of basis function j on the n
+    samples. They are evaluated once by the caller and can be reused for several regressands. The buffers are not
+    copied and must outlive the regression object.
+
+    X'X is accumulated in one pass over the samples (in blocks fitting into the cache) when the first coefficients
+    are requested. The normal equations are scaled to unit diagonal and solved by a Cholesky decomposition. If X'X
+    is numerically singular (a pivot below the cholesky threshold), the solver falls back to a singular value
+    decomposition of X'X, discarding singular values below the svd threshold relative to the largest one. In the
+    rank deficient case this yields the minimum norm solution.
+
+    Optional weights multiply the contribution of each sample. A filter is represented by weights 0 and 1, so that
+    excluded samples do not need to be removed from the basis and regressand buffers.
+
+    \ingroup math
+*/
+class LeastSquaresRegression {
+public:
+    enum class Solver { Cholesky, SVD };
+
+    LeastSquaresRegression(const Size n, const std::vector<const Real*>& basis, const Real* weights = nullptr,
+                           const Real choleskyThreshold = 1.0E-10, const Real svdThreshold = 1.0E-12);
+
+    //! regression coefficients for the regressand y given by its n sample values
+    Array coefficients(const Real* y) const;
+
+    //! writes the regression function sum_j c_j basis_j evaluated on all n samples to result
+    void fittedValues(const Array& c, Real* result) const;
+
+    //! regression function evaluated on sample i
+    Real fittedValue(const Array& c, const Size i) const;
+
+    //! number of samples
+    Size size() const { return n_; }
+    //! number of basis functions
+    Size dimension() const { return basis_.size(); }
+    //! the solver used for the normal equations, triggers the factorisation
+    Solver solver() const;
+
+private:
+    void factorise() const;
+
+    Size n_;
+    std::vector<const Real*> basis_;
+    const Real* weights_;
+    Real choleskyThreshold_, svdThreshold_;
+
+    mutable bool factorised_ = false;
+    mutable Solver solver_ = Solver::Cholesky;
+    // scaling of the normal equations to unit diagonal
+    mutable Array scale_;
+    // lower triangular cholesky factor or pseudo inverse of the scaled X'X
+    mutable Matrix factor_;
+};
+
+} // namespace QuantExt
@@ -18,14 +18,179 @@
 
 #include <qle/math/randomvariable.hpp>
 
+#include <qle/math/leastsquaresregression.hpp>
+
 #include <ql/math/comparison.hpp>
-#include <ql/math/generallinearleastsquares.hpp>
-#include <ql/math/matrixutilities/qrdecomposition.hpp>
 
+#include <boost/align/aligned_alloc.hpp>
 #include <boost/math/distributions/normal.hpp>
 
+#include <atomic>
+#include <new>
+#include <unordered_map>
+
 namespace QuantExt {
 
+namespace {
+
+/* Kernels for the element wise binary operations on non-deterministic random variables. The loops run over raw
+   pointers without branches, so that the compiler can vectorise them. With gcc on x86-64 Linux clones for AVX-512
+   and AVX2 are generated in addition to the default (SSE2) version, the best version supported by the cpu is
+   selected when the library is loaded. */
+
+#if defined(__GNUC__) && !defined(__clang__) && defined(__x86_64__) && defined(__linux__)
+#define QLE_RANDOMVARIABLE_KERNEL __attribute__((target_clones("avx512f", "avx2", "default")))
+#else
+#define QLE_RANDOMVARIABLE_KERNEL
+#endif
+
+// x[i] = op(x[i], y[i]) and x[i] = op(x[i], y) for a scalar y
+#define QLE_RANDOMVARIABLE_BINARY_KERNEL(name, op)                                                                     \
+    QLE_RANDOMVARIABLE_KERNEL void name(Real* __restrict x, const Real* __restrict y, const Size n) {                  \
+        for (Size i = 0; i < n; ++i) {                                                                                 \
+            const Real a = x[i], b = y[i];                                                                             \
+            x[i] = (op);                                                                                               \
+        }                                                                                                              \
+    }                                                                                                                  \
+    QLE_RANDOMVARIABLE_KERNEL void name##Scalar(Real* __restrict x, const Real b, const Size n) {                      \
+        for (Size i = 0; i < n; ++i) {                                                                                 \
+            const Real a = x[i];                                                                                       \
+            x[i] = (op);                                                                                               \
+        }                                                                                                              \
+    }
+
+QLE_RANDOMVARIABLE_BINARY_KERNEL(addKernel, a + b)
+QLE_RANDOMVARIABLE_BINARY_KERNEL(subtractKernel, a - b)
+QLE_RANDOMVARIABLE_BINARY_KERNEL(multiplyKernel, a* b)
+QLE_RANDOMVARIABLE_BINARY_KERNEL(divideKernel, a / b)
+QLE_RANDOMVARIABLE_BINARY_KERNEL(maxKernel, a < b ? b : a)
+QLE_RANDOMVARIABLE_BINARY_KERNEL(minKernel, b < a ? b : a)
+
+#undef QLE_RANDOMVARIABLE_BINARY_KERNEL
+
+// z[i] = x[i] * y[i] + z[i], x or y can be scalars (stride 0)
+QLE_RANDOMVARIABLE_KERNEL void multiplyAddKernel(Real* __restrict z, const Real* x, const Size strideX, const Real* y,
+                                                 const Size strideY, const Size n) {
+    if (strideX == 1 && strideY == 1) {
+        for (Size i = 0; i < n; ++i)
+            z[i] = x[i] * y[i] + z[i];
+    } else if (strideX == 1) {
+        const Real b = *y;
+        for (Size i = 0; i < n; ++i)
+            z[i] = x[i] * b + z[i];
+    } else if (strideY == 1) {
+        const Real a = *x;
+        for (Size i = 0; i < n; ++i)
+            z[i] = a * y[i] + z[i];
+    } else {
+        const Real ab = *x * *y;
+        for (Size i = 0; i < n; ++i)
+            z[i] = ab + z[i];
+    }
+}
+
+struct BufferPool {
+    ~BufferPool();
+    std::unordered_map<Size, std::vector<void*>> buffers;
+    RandomVariableBufferPool::Statistics statistics;
+};
+
+// set when the pool of a thread is destroyed, buffers released afterwards (e.g. by static objects) are freed directly
+thread_local bool bufferPoolDestroyed = false;
+
+std::atomic<Size> maxCachedBufferBytes(256 * 1024 * 1024);
+
+BufferPool& bufferPool() {
+    thread_local BufferPool pool;
+    return pool;
+}
+
+void* allocateAligned(const Size bytes) {
+    void* p = boost::alignment::aligned_alloc(RandomVariableBufferPool::alignment, bytes);
+    if (p == nullptr)
+        throw std::bad_alloc();
+    return p;
+}
+
+void freeBuffers(BufferPool& pool) {
+    for (auto& b : pool.buffers) {
+        for (auto p : b.second)
+            boost::alignment::aligned_free(p);
+    }
+    pool.buffers.clear();
+    pool.statistics.bytesCached = 0;
+}
+
+BufferPool::~BufferPool() {
+    freeBuffers(*this);
+    bufferPoolDestroyed = true;
+}
+
+} // namespace
+
+void* RandomVariableBufferPool::acquire(const Size bytes) {
+    if (bytes < minPooledBytes || bufferPoolDestroyed)
+        return allocateAligned(bytes);
+    BufferPool& pool = bufferPool();
+    void* p;
+    auto b = pool.buffers.find(bytes);
+    if (b != pool.buffers.end() && !b->second.empty()) {
+        p = b->second.back();
+        b->second.pop_back();
+        pool.statistics.bytesCached -= bytes;
+        ++pool.statistics.hits;
+    } else {
+        p = allocateAligned(bytes);
+        ++pool.statistics.misses;
+    }
+    pool.statistics.bytesInUse += bytes;
+    pool.statistics.peakBytesInUse = std::max(pool.statistics.peakBytesInUse, pool.statistics.bytesInUse);
+    return p;
+}
+
+void RandomVariableBufferPool::release(void* p, const Size bytes) noexcept {
+    if (p == nullptr)
+        return;
+    if (bytes < minPooledBytes || bufferPoolDestroyed) {
+        boost::alignment::aligned_free(p);
+        return;
+    }
+    BufferPool& pool = bufferPool();
+    // the buffer might have been acquired on another thread
+    pool.statistics.bytesInUse -= std::min(bytes, pool.statistics.bytesInUse);
+    if (pool.statistics.bytesCached + bytes > maxCachedBufferBytes) {
+        boost::alignment::aligned_free(p);
+        return;
+    }
+    try {
+        pool.buffers[bytes].push_back(p);
+        pool.statistics.bytesCached += bytes;
+    } catch (...) {
+        boost::alignment::aligned_free(p);
+    }
+}
+
+RandomVariableBufferPool::Statistics RandomVariableBufferPool::statistics() {
+    return bufferPoolDestroyed ? Statistics() : bufferPool().statistics;
+}
+
+void RandomVariableBufferPool::resetStatistics() {
+    if (bufferPoolDestroyed)
+        return;
+    Statistics& s = bufferPool().statistics;
+    s.hits = s.misses = 0;
+    s.peakBytesInUse = s.bytesInUse;
+}
+
+void RandomVariableBufferPool::clear() {
+    if (!bufferPoolDestroyed)
+        freeBuffers(bufferPool());
+}
+
+Size RandomVariableBufferPool::maxCachedBytes() { return maxCachedBufferBytes; }
+
+void RandomVariableBufferPool::setMaxCachedBytes(const Size bytes) { maxCachedBufferBytes = bytes; }
+
 void Filter::clear() {
     n_ = 0;
     data_.clear();
@@ -173,7 +338,7 @@ RandomVariable::RandomVariable(const QuantLib::Array& array, const Real time) {
     n_ = array.size();
     deterministic_ = false;
     time_ = time;
-    data_ = std::vector<Real>(array.begin(), array.end());
+    data_.assign(array.begin(), array.end());
 }
 
 void RandomVariable::copyToMatrixCol(QuantLib::Matrix& m, const Size j) const {
@@ -220,10 +385,21 @@ void RandomVariable::set(const Size i, const Real v) {
 }
 
 void RandomVariable::setAll(const Real v) {
-    data_ = std::vector<Real>(1, v);
+    // release a full buffer to the pool
+    decltype(data_)(1, v).swap(data_);
     deterministic_ = true;
 }
 
+Real* RandomVariable::data() {
+    expand();
+    return data_.data();
+}
+
+const Real* RandomVariable::data() const {
+    QL_REQUIRE(!deterministic_, "RandomVariable::data(): no sample buffer for deterministic variable");
+    return data_.data();
+}
+
 Real RandomVariable::operator[](const Size i) const {
     if (deterministic_)
         return data_.front();
@@ -285,6 +461,9 @@ bool operator==(const RandomVariable& a, const RandomVariable& b) {
 }
 
 RandomVariable& RandomVariable::operator+=(const RandomVariable& y) {
+    // the kernels require distinct buffers
+    if (&y == this)
+        return *this += RandomVariable(y);
     if (!y.initialised())
         clear();
     if (!initialised())
@@ -296,13 +475,17 @@ RandomVariable& RandomVariable::operator+=(const RandomVariable& y) {
         expand();
     else if (QuantLib::close_enough(y.data_.front(), 0.0))
         return *this;
-    for (Size i = 0; i < data_.size(); ++i) {
-        data_[i] += y[i];
-    }
+    if (y.deterministic_)
+        addKernelScalar(data_.data(), y.data_.front(), data_.size());
+    else
+        addKernel(data_.data(), y.data_.data(), data_.size());
     return *this;
 }
 
 RandomVariable& RandomVariable::operator-=(const RandomVariable& y) {
+    // the kernels require distinct buffers
+    if (&y == this)
+        return *this -= RandomVariable(y);
     if (!y.initialised())
         clear();
     if (!initialised())
@@ -314,13 +497,17 @@ RandomVariable& RandomVariable::operator-=(const RandomVariable& y) {
         expand();
     else if (QuantLib::close_enough(y.data_.front(), 0.0))
         return *this;
-    for (Size i = 0; i < data_.size(); ++i) {
-        data_[i] -= y[i];
-    }
+    if (y.deterministic_)
+        subtractKernelScalar(data_.data(), y.data_.front(), data_.size());
+    else
+        subtractKernel(data_.data(), y.data_.data(), data_.size());
     return *this;
 }
 
 RandomVariable& RandomVariable::operator*=(const RandomVariable& y) {
+    // the kernels require distinct buffers
+    if (&y == this)
+        return *this *= RandomVariable(y);
     if (!y.initialised())
         clear();
     if (!initialised())
@@ -332,13 +519,17 @@ RandomVariable& RandomVariable::operator*=(const RandomVariable& y) {
         expand();
     else if (QuantLib::close_enough(y.data_.front(), 1.0))
         return *this;
-    for (Size i = 0; i < data_.size(); ++i) {
-        data_[i] *= y[i];
-    }
+    if (y.deterministic_)
+        multiplyKernelScalar(data_.data(), y.data_.front(), data_.size());
+    else
+        multiplyKernel(data_.data(), y.data_.data(), data_.size());
     return *this;
 }
 
 RandomVariable& RandomVariable::operator/=(const RandomVariable& y) {
+    // the kernels require distinct buffers
+    if (&y == this)
+        return *this /= RandomVariable(y);
     if (!y.initialised())
         clear();
     if (!initialised())
@@ -350,9 +541,10 @@ RandomVariable& RandomVariable::operator/=(const RandomVariable& y) {
         expand();
     else if (QuantLib::close_enough(y.data_.front(), 1.0))
         return *this;
-    for (Size i = 0; i < data_.size(); ++i) {
-        data_[i] /= y[i];
-    }
+    if (y.deterministic_)
+        divideKernelScalar(data_.data(), y.data_.front(), data_.size());
+    else
+        divideKernel(data_.data(), y.data_.data(), data_.size());
     return *this;
 }
 
@@ -384,6 +576,43 @@ RandomVariable operator/(RandomVariable x, const RandomVariable& y) {
     return x;
 }
 
+RandomVariable operator+(const RandomVariable& x, RandomVariable&& y) {
+    if (!x.initialised() || !y.initialised())
+        return RandomVariable();
+    Real t = x.time();
+    y += x;
+    // the time of the left hand side takes precedence as in x + y with an lvalue y
+    if (t != Null<Real>())
+        y.time_ = t;
+    return std::move(y);
+}
+
+RandomVariable operator*(const RandomVariable& x, RandomVariable&& y) {
+    if (!x.initialised() || !y.initialised())
+        return RandomVariable();
+    Real t = x.time();
+    y *= x;
+    if (t != Null<Real>())
+        y.time_ = t;
+    return std::move(y);
+}
+
+RandomVariable multiplyAdd(const RandomVariable& a, const RandomVariable& b, RandomVariable c) {
+    if (!a.initialised() || !b.initialised() || !c.initialised())
+        return RandomVariable();
+    QL_REQUIRE(a.size() == c.size() && b.size() == c.size(), "RandomVariable: multiplyAdd(a,b,c): a size ("
+                                                                 << a.size() << "), b size (" << b.size()
+                                                                 << ") and c size (" << c.size()
+                                                                 << ") must be equal");
+    c.checkTimeConsistencyAndUpdate(a.time());
+    c.checkTimeConsistencyAndUpdate(b.time());
+    if (!a.deterministic_ || !b.deterministic_)
+        c.expand();
+    multiplyAddKernel(c.data_.data(), a.data_.data(), a.deterministic_ ? 0 : 1, b.data_.data(),
+                      b.deterministic_ ? 0 : 1, c.data_.size());
+    return c;
+}
+
 RandomVariable max(RandomVariable x, const RandomVariable& y) {
     if (!x.initialised() || !y.initialised())
         return RandomVariable();
@@ -392,9 +621,10 @@ RandomVariable max(RandomVariable x, const RandomVariable& y) {
     x.checkTimeConsistencyAndUpdate(y.time());
     if (!y.deterministic_)
         x.expand();
-    for (Size i = 0; i < x.data_.size(); ++i) {
-        x.data_[i] = std::max(x.data_[i], y[i]);
-    }
+    if (y.deterministic_)
+        maxKernelScalar(x.data_.data(), y.data_.front(), x.data_.size());
+    else
+        maxKernel(x.data_.data(), y.data_.data(), x.data_.size());
     return x;
 }
 
@@ -406,9 +636,10 @@ RandomVariable min(RandomVariable x, const RandomVariable& y) {
     x.checkTimeConsistencyAndUpdate(y.time());
     if (!y.deterministic_)
         x.expand();
-    for (Size i = 0; i < x.data_.size(); ++i) {
-        x.data_[i] = std::min(x.data_[i], y[i]);
-    }
+    if (y.deterministic_)
+        minKernelScalar(x.data_.data(), y.data_.front(), x.data_.size());
+    else
+        minKernel(x.data_.data(), y.data_.data(), x.data_.size());
     return x;
 }
 
@@ -442,6 +673,10 @@ RandomVariable abs(RandomVariable x) {
     return x;
 }
 
+/* The transcendental functions below call the std / boost implementations element by element. They are not run
+   through the vectorised kernels, since vectorised approximations would change the results in the last digits.
+   Replacing them (and fusing payoffs like max(x - k, 0) * df) is left for a separate change. */
+
 RandomVariable exp(RandomVariable x) {
     for (Size i = 0; i < x.data_.size(); ++i) {
         x.data_[i] = std::exp(x.data_[i]);
@@ -697,6 +932,44 @@ RandomVariable applyInverseFilter(RandomVariable x, const Filter& f) {
     return x;
 }
 
+namespace {
+
+// evaluate the basis functions once, deterministic values are expanded so that each of them provides a sample buffer
+std::vector<RandomVariable>
+evalBasis(const std::vector<const RandomVariable*>& regressor,
+          const std::vector<std::function<RandomVariable(const std::vector<const RandomVariable*>&)>>& basisFn,
+          const Size n) {
+    std::vector<RandomVariable> basis;
+    basis.reserve(basisFn.size());
+    for (auto const& f : basisFn) {
+        basis.push_back(f(regressor));
+        QL_REQUIRE(basis.back().size() == n, "basis function value size (" << basis.back().size()
+                                                                           << ") must match regressand size (" << n
+                                                                           << ")");
+        basis.back().expand();
+    }
+    return basis;
+}
+
+std::vector<const Real*> basisPointers(std::vector<RandomVariable>& basis) {
+    std::vector<const Real*> res(basis.size());
+    for (Size j = 0; j < basis.size(); ++j)
+        res[j] = basis[j].data();
+    return res;
+}
+
+// the filter as weights 0 and 1, an empty result means that all samples are used
+std::vector<Real> filterWeights(const Filter& filter, const Size n) {
+    if (!filter.initialised() || (filter.deterministic() && filter[0]))
+        return std::vector<Real>();
+    std::vector<Real> w(n);
+    for (Size i = 0; i < n; ++i)
+        w[i] = filter[i] ? 1.0 : 0.0;
+    return w;
+}
+
+} // namespace
+
 Array regressionCoefficients(
     RandomVariable r, const std::vector<const RandomVariable*>& regressor,
     const std::vector<std::function<RandomVariable(const std::vector<const RandomVariable*>&)>>& basisFn,
@@ -707,28 +980,10 @@ Array regressionCoefficients(
     }
     QL_REQUIRE(filter.size() == 0 || filter.size() == r.size(),
                "filter size (" << filter.size() << ") must match regressand size (" << r.size() << ")");
-    Matrix A(r.size(), basisFn.size());
-    for (Size j = 0; j < basisFn.size(); ++j) {
-        RandomVariable a = basisFn[j](regressor);
-        if (filter.initialised()) {
-            a = applyFilter(a, filter);
-        }
-        if (a.deterministic())
-            std::fill(A.column_begin(j), A.column_end(j), a[0]);
-        else
-            a.copyToMatrixCol(A, j);
-    }
-
-    if (filter.size() > 0) {
-        r = applyFilter(r, filter);
-    }
-    Array b(r.size());
-    if (r.deterministic())
-        std::fill(b.begin(), b.end(), r[0]);
-    else
-        r.copyToArray(b);
-    Array res = qrSolve(A, b);
-    return res;
+    std::vector<RandomVariable> basis = evalBasis(regressor, basisFn, r.size());
+    std::vector<Real> weights = filterWeights(filter, r.size());
+    LeastSquaresRegression ls(r.size(), basisPointers(basis), weights.empty() ? nullptr : weights.data());
+    return ls.coefficients(r.data());
 }
 
 RandomVariable conditionalExpectation(
@@ -745,7 +1000,7 @@ RandomVariable conditionalExpectation(
                "basisFn size (" << basisFn.size() << ") must match coefficients size (" << coefficients.size() << ")");
     RandomVariable r(n, 0.0);
     for (Size i = 0; i < coefficients.size(); ++i) {
-        r = r + RandomVariable(n, coefficients[i]) * basisFn[i](regressor);
+        r = multiplyAdd(RandomVariable(n, coefficients[i]), basisFn[i](regressor), std::move(r));
     }
     return r;
 }
@@ -756,8 +1011,20 @@ RandomVariable conditionalExpectation(
     const Filter& filter) {
     if (r.deterministic())
         return r;
-    auto coeff = regressionCoefficients(r, regressor, basisFn, filter);
-    return conditionalExpectation(regressor, basisFn, coeff);
+    for (auto const reg : regressor) {
+        QL_REQUIRE(reg->size() == r.size(),
+                   "regressor size (" << reg->size() << ") must match regressand size (" << r.size() << ")");
+    }
+    QL_REQUIRE(filter.size() == 0 || filter.size() == r.size(),
+               "filter size (" << filter.size() << ") must match regressand size (" << r.size() << ")");
+    // the basis function values are shared between the regression and the evaluation of the regression function
+    std::vector<RandomVariable> basis = evalBasis(regressor, basisFn, r.size());
+    std::vector<Real> weights = filterWeights(filter, r.size());
+    LeastSquaresRegression ls(r.size(), basisPointers(basis), weights.empty() ? nullptr : weights.data());
+    Array coeff = ls.coefficients(r.data());
+    RandomVariable result(r.size());
+    ls.fittedValues(coeff, result.data());
+    return result;
 }
 
 RandomVariable expectation(const RandomVariable& r) {
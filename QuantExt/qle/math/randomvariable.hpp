@@ -74,6 +74,65 @@ Filter operator||(Filter, const Filter&);
 Filter equal(Filter, const Filter&);
 Filter operator!(Filter);
 
+// buffer pool for random variable data
+
+/*! Per thread pool of the buffers holding the data of random variables, bucketed by buffer size. A buffer released
+    by a random variable is kept in the pool of the releasing thread and handed out again to the next random variable
+    of the same size allocated on that thread, so that chains of arithmetic operations on random variables of the
+    same size do not hit the system allocator after the first few operations.
+
+    Buffers smaller than minPooledBytes are not pooled. The buffers cached per thread are limited by maxCachedBytes(),
+    buffers released beyond this limit are freed. All buffers are aligned to the given alignment. */
+class RandomVariableBufferPool {
+public:
+    static constexpr Size alignment = 64;
+    static constexpr Size minPooledBytes = 512;
+
+    struct Statistics {
+        //! number of pooled buffer requests served from the pool / by the system allocator
+        Size hits = 0, misses = 0;
+        //! bytes of pooled buffers handed out and not yet released on this thread, and the peak of this
+        Size bytesInUse = 0, peakBytesInUse = 0;
+        //! bytes of buffers currently cached in the pool
+        Size bytesCached = 0;
+    };
+
+    static void* acquire(const Size bytes);
+    static void release(void* p, const Size bytes) noexcept;
+
+    //! statistics of the pool of the calling thread
+    static Statistics statistics();
+    //! reset the counters of the pool of the calling thread, the cached bytes are kept
+    static void resetStatistics();
+    //! free the buffers cached in the pool of the calling thread
+    static void clear();
+
+    //! limit for the bytes cached per thread, applies to all threads
+    static Size maxCachedBytes();
+    static void setMaxCachedBytes(const Size bytes);
+};
+
+template <class T> struct RandomVariableAllocator {
+    typedef T value_type;
+    RandomVariableAllocator() noexcept {}
+    template <class U> RandomVariableAllocator(const RandomVariableAllocator<U>&) noexcept {}
+    template <class U> struct rebind {
+        typedef RandomVariableAllocator<U> other;
+    };
+    T* allocate(const std::size_t n) { return static_cast<T*>(RandomVariableBufferPool::acquire(n * sizeof(T))); }
+    void deallocate(T* p, const std::size_t n) noexcept { RandomVariableBufferPool::release(p, n * sizeof(T)); }
+};
+
+template <class T, class U>
+bool operator==(const RandomVariableAllocator<T>&, const RandomVariableAllocator<U>&) noexcept {
+    return true;
+}
+
+template <class T, class U>
+bool operator!=(const RandomVariableAllocator<T>&, const RandomVariableAllocator<U>&) noexcept {
+    return false;
+}
+
 // random variable class
 
 struct RandomVariable {
@@ -94,6 +153,10 @@ struct RandomVariable {
     void setTime(const Real time) { time_ = std::max(time, 0.0); }
 
     void setAll(const Real v);
+    // raw access to the sample buffer, e.g. for batched path generation, a deterministic variable is expanded first
+    Real* data();
+    // raw read access to the sample buffer, throws for a deterministic variable
+    const Real* data() const;
     // inspectors
     // true => det., but false => non-det. only after updateDeterministic()
     bool deterministic() const { return deterministic_; }
@@ -111,6 +174,9 @@ struct RandomVariable {
     friend RandomVariable operator-(RandomVariable, const RandomVariable&);
     friend RandomVariable operator*(RandomVariable, const RandomVariable&);
     friend RandomVariable operator/(RandomVariable, const RandomVariable&);
+    friend RandomVariable operator+(const RandomVariable&, RandomVariable&&);
+    friend RandomVariable operator*(const RandomVariable&, RandomVariable&&);
+    friend RandomVariable multiplyAdd(const RandomVariable&, const RandomVariable&, RandomVariable);
     friend RandomVariable max(RandomVariable, const RandomVariable&);
     friend RandomVariable min(RandomVariable, const RandomVariable&);
     friend RandomVariable pow(RandomVariable, const RandomVariable&);
@@ -143,7 +209,9 @@ struct RandomVariable {
 private:
     void checkTimeConsistencyAndUpdate(const Real t);
     Size n_;
-    std::vector<Real> data_;
+    // cache line aligned, so that the element wise kernels can use aligned vector loads and stores, and drawn from
+    // the per thread buffer pool
+    std::vector<Real, RandomVariableAllocator<Real>> data_;
     bool deterministic_;
     Real time_;
 };
@@ -154,6 +222,11 @@ RandomVariable operator+(RandomVariable, const RandomVariable&);
 RandomVariable operator-(RandomVariable, const RandomVariable&);
 RandomVariable operator*(RandomVariable, const RandomVariable&);
 RandomVariable operator/(RandomVariable, const RandomVariable&);
+// overloads reusing the buffer of a temporary right hand side for the commutative operations
+RandomVariable operator+(const RandomVariable&, RandomVariable&&);
+RandomVariable operator*(const RandomVariable&, RandomVariable&&);
+// fused a * b + c, computed in one pass over the buffer of c
+RandomVariable multiplyAdd(const RandomVariable& a, const RandomVariable& b, RandomVariable c);
 RandomVariable max(RandomVariable, const RandomVariable&);
 RandomVariable min(RandomVariable, const RandomVariable&);
 RandomVariable pow(RandomVariable, const RandomVariable&);
@@ -0,0 +1,201 @@
+/*
+ Copyright (C) 2023 Quaternion Risk Management Ltd
+ All rights reserved.
+
+ This file is part of ORE, a free-software/open-source library
+ for transparent pricing and risk analysis - http://opensourcerisk.org
+
+ ORE is free software: you can redistribute it and/or modify it
+ under the terms of the Modified BSD License.  You should have received a
+ copy of the license along with this program.
+ The license is also available online at <http://opensourcerisk.org>
+
+ This program is distributed on the basis that it will form a useful
+ contribution to risk analytics and model standardisation, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ FITNESS FOR A PARTICULAR PURPOSE. See the license for more details.
+*/
+
+#include <qle/methods/batchedmultipathgenerator.hpp>
+#include <qle/processes/crossassetstateprocess.hpp>
+
+#include <boost/make_shared.hpp>
+
+namespace QuantExt {
+
+namespace {
+
+// the affine update requires the exact discretization with one Brownian increment per state
+bool hasAffineStep(const boost::shared_ptr<CrossAssetStateProcess>& process, const TimeGrid& timeGrid) {
+    if (process == nullptr || timeGrid.size() < 2)
+        return false;
+    Array m;
+    Matrix A, D;
+    return process->exactStepCoefficients(timeGrid[0], timeGrid.dt(0), m, A, D) &&
+           D.columns() == process->factors() && process->factors() <= process->size();
+}
+
+void initPaths(const Size n, const Size steps, const Size dim, std::vector<std::vector<RandomVariable>>& paths) {
+    paths.resize(steps);
+    for (auto& p : paths) {
+        p.resize(dim);
+        for (auto& r : p) {
+            if (r.size() != n)
+                r = RandomVariable(n);
+            r.expand();
+        }
+    }
+}
+
+} // namespace
+
+BatchedMultiPathGenerator::BatchedMultiPathGenerator(const boost::shared_ptr<StochasticProcess>& process,
+                                                     const TimeGrid& timeGrid, const SequenceType s,
+                                                     const BigNatural seed,
+                                                     const SobolBrownianGenerator::Ordering ordering,
+                                                     const SobolRsg::DirectionIntegers directionIntegers)
+    : stochasticProcess_(process), timeGrid_(timeGrid) {
+    QL_REQUIRE(stochasticProcess_, "BatchedMultiPathGenerator: process is null");
+    QL_REQUIRE(timeGrid_.size() > 0, "BatchedMultiPathGenerator: empty time grid given");
+    auto cam = boost::dynamic_pointer_cast<CrossAssetStateProcess>(process);
+    if (hasAffineStep(cam, timeGrid_))
+        process_ = cam;
+    variateGenerator_ =
+        makeMultiPathVariateGenerator(s, process->factors(), timeGrid_, seed, ordering, directionIntegers);
+}
+
+void BatchedMultiPathGenerator::next(const Size n, std::vector<std::vector<RandomVariable>>& paths) const {
+    QL_REQUIRE(n > 0, "BatchedMultiPathGenerator::next(): at least one sample required");
+    initPaths(n, timeGrid_.size() - 1, stochasticProcess_->size(), paths);
+    if (process_)
+        nextBatched(n, paths);
+    else
+        nextPathwise(n, paths);
+}
+
+void BatchedMultiPathGenerator::reset() { variateGenerator_->reset(); }
+
+void BatchedMultiPathGenerator::nextBatched(const Size n, std::vector<std::vector<RandomVariable>>& paths) const {
+
+    Size steps = timeGrid_.size() - 1;
+    Size dim = process_->size();
+    Size f = process_->factors();
+
+    /* the variates have to be drawn sample by sample, we store the increments of step i in the target buffers
+       paths[i][0...f-1] and evolve the states of step i in place after copying the increments aside */
+
+    for (Size s = 0; s < n; ++s) {
+        const std::vector<Array>& v = variateGenerator_->next().value;
+        for (Size i = 0; i < steps; ++i) {
+            for (Size j = 0; j < f; ++j)
+                paths[i][j].data()[s] = v[i][j];
+        }
+    }
+
+    Array x0 = process_->initialValues(), m;
+    Matrix A, D;
+    dw_.resize(f * n);
+
+    for (Size i = 0; i < steps; ++i) {
+        process_->exactStepCoefficients(timeGrid_[i], timeGrid_.dt(i), m, A, D);
+        for (Size j = 0; j < f; ++j)
+            std::copy(paths[i][j].data(), paths[i][j].data() + n, &dw_[j * n]);
+        for (Size r = 0; r < dim; ++r) {
+            Real* y = paths[i][r].data();
+            Real c = m[r];
+            // on the first step the state is the same for all samples
+            if (i == 0) {
+                for (Size k = 0; k < dim; ++k)
+                    c += A[r][k] * x0[k];
+            }
+            std::fill(y, y + n, c);
+            if (i > 0) {
+                for (Size k = 0; k < dim; ++k) {
+                    Real a = A[r][k];
+                    if (a == 0.0)
+                        continue;
+                    const Real* x = paths[i - 1][k].data();
+                    for (Size s = 0; s < n; ++s)
+                        y[s] += a * x[s];
+                }
+            }
+            for (Size j = 0; j < f; ++j) {
+                Real d = D[r][j];
+                if (d == 0.0)
+                    continue;
+                const Real* w = &dw_[j * n];
+                for (Size s = 0; s < n; ++s)
+                    y[s] += d * w[s];
+            }
+        }
+    }
+}
+
+void BatchedMultiPathGenerator::nextPathwise(const Size n, std::vector<std::vector<RandomVariable>>& paths) const {
+
+    Size steps = timeGrid_.size() - 1;
+    Size dim = stochasticProcess_->size();
+
+    std::vector<Real*> target(steps * dim);
+    for (Size i = 0; i < steps; ++i) {
+        for (Size k = 0; k < dim; ++k)
+            target[i * dim + k] = paths[i][k].data();
+    }
+
+    Array x0 = stochasticProcess_->initialValues();
+    for (Size s = 0; s < n; ++s) {
+        const std::vector<Array>& v = variateGenerator_->next().value;
+        Array x = x0;
+        for (Size i = 0; i < steps; ++i) {
+            x = stochasticProcess_->evolve(timeGrid_[i], x, timeGrid_.dt(i), v[i]);
+            for (Size k = 0; k < dim; ++k)
+                target[i * dim + k][s] = x[k];
+        }
+    }
+}
+
+MultiPathGeneratorBatched::MultiPathGeneratorBatched(const boost::shared_ptr<StochasticProcess>& process,
+                                                     const TimeGrid& timeGrid, const SequenceType s,
+                                                     const BigNatural seed,
+                                                     const SobolBrownianGenerator::Ordering ordering,
+                                                     const SobolRsg::DirectionIntegers directionIntegers,
+                                                     const Size batchSize)
+    : generator_(process, timeGrid, s, seed, ordering, directionIntegers), batchSize_(batchSize),
+      initialValues_(process->initialValues()), current_(batchSize),
+      next_(MultiPath(process->size(), timeGrid), 1.0) {
+    QL_REQUIRE(batchSize_ > 0, "MultiPathGeneratorBatched: batch size must be positive");
+}
+
+const Sample<MultiPath>& MultiPathGeneratorBatched::next() const {
+    if (current_ == batchSize_) {
+        generator_.next(batchSize_, batch_);
+        current_ = 0;
+    }
+    MultiPath& path = next_.value;
+    for (Size k = 0; k < path.assetNumber(); ++k) {
+        Path& p = path[k];
+        p[0] = initialValues_[k];
+        for (Size i = 0; i < batch_.size(); ++i)
+            p[i + 1] = batch_[i][k][current_];
+    }
+    ++current_;
+    return next_;
+}
+
+void MultiPathGeneratorBatched::reset() {
+    generator_.reset();
+    current_ = batchSize_;
+}
+
+boost::shared_ptr<MultiPathGeneratorBase>
+makeBatchedMultiPathGenerator(const SequenceType s, const boost::shared_ptr<StochasticProcess>& process,
+                              const TimeGrid& timeGrid, const BigNatural seed,
+                              const SobolBrownianGenerator::Ordering ordering,
+                              const SobolRsg::DirectionIntegers directionIntegers, const Size batchSize) {
+    if (hasAffineStep(boost::dynamic_pointer_cast<CrossAssetStateProcess>(process), timeGrid))
+        return boost::make_shared<MultiPathGeneratorBatched>(process, timeGrid, s, seed, ordering, directionIntegers,
+                                                             batchSize);
+    return makeMultiPathGenerator(s, process, timeGrid, seed, ordering, directionIntegers);
+}
+
+} // namespace QuantExt
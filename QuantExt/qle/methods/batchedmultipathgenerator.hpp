@@ -0,0 +1,105 @@
+/*
+ Copyright (C) 2023 Quaternion Risk Management Ltd
+ All rights reserved.
+
+ This file is part of ORE, a free-software/open-source library
+ for transparent pricing and risk analysis - http://opensourcerisk.org
+
+ ORE is free software: you can redistribute it and/or modify it
+ under the terms of the Modified BSD License.  You should have received a
+ copy of the license along with this program.
+ The license is also available online at <http://opensourcerisk.org>
+
+ This program is distributed on the basis that it will form a useful
+ contribution to risk analytics and model standardisation, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ FITNESS FOR A PARTICULAR PURPOSE. See the license for more details.
+*/
+
+/*! \file batchedmultipathgenerator.hpp
+    \brief multi path generator evolving a batch of samples per time step in sample-contiguous buffers
+    \ingroup methods
+*/
+
+#pragma once
+
+#include <qle/math/randomvariable.hpp>
+#include <qle/methods/multipathgeneratorbase.hpp>
+#include <qle/methods/multipathvariategenerator.hpp>
+
+namespace QuantExt {
+
+class CrossAssetStateProcess;
+
+//! Batched multi path generator
+/*! Generates a batch of samples at once. The state k at grid time i + 1 is written to paths[i][k], a random variable
+    holding all samples of the batch in one contiguous buffer, the initial state (grid time 0) is not stored.
+
+    The variates are drawn from the MultiPathVariateGenerator corresponding to the sequence type, so that the paths
+    coincide with those of the generator returned by makeMultiPathGenerator() for the same parameters, up to rounding
+    differences.
+
+    If the process is a CrossAssetStateProcess using the exact discretization, the evolution over a time step is the
+    affine map x1 = m + A x0 + D dw, which is applied to all samples of the batch at once. For all other processes
+    the samples are evolved one by one using StochasticProcess::evolve().
+
+    \ingroup methods
+*/
+class BatchedMultiPathGenerator {
+public:
+    BatchedMultiPathGenerator(const boost::shared_ptr<StochasticProcess>& process, const TimeGrid& timeGrid,
+                              const SequenceType s, const BigNatural seed,
+                              const SobolBrownianGenerator::Ordering ordering = SobolBrownianGenerator::Steps,
+                              const SobolRsg::DirectionIntegers directionIntegers = SobolRsg::JoeKuoD7);
+
+    //! generate the next n samples
+    void next(const Size n, std::vector<std::vector<RandomVariable>>& paths) const;
+    void reset();
+
+    //! true if the samples are evolved using the affine update of the exact discretization
+    bool batched() const { return process_ != nullptr; }
+
+private:
+    void nextBatched(const Size n, std::vector<std::vector<RandomVariable>>& paths) const;
+    void nextPathwise(const Size n, std::vector<std::vector<RandomVariable>>& paths) const;
+
+    boost::shared_ptr<StochasticProcess> stochasticProcess_;
+    boost::shared_ptr<CrossAssetStateProcess> process_;
+    TimeGrid timeGrid_;
+    boost::shared_ptr<MultiPathVariateGeneratorBase> variateGenerator_;
+    mutable std::vector<Real> dw_;
+};
+
+//! MultiPathGeneratorBase implementation serving paths from batches generated by a BatchedMultiPathGenerator
+/*! \ingroup methods
+ */
+class MultiPathGeneratorBatched : public MultiPathGeneratorBase {
+public:
+    MultiPathGeneratorBatched(const boost::shared_ptr<StochasticProcess>& process, const TimeGrid& timeGrid,
+                              const SequenceType s, const BigNatural seed,
+                              const SobolBrownianGenerator::Ordering ordering = SobolBrownianGenerator::Steps,
+                              const SobolRsg::DirectionIntegers directionIntegers = SobolRsg::JoeKuoD7,
+                              const Size batchSize = 1024);
+    const Sample<MultiPath>& next() const override;
+    void reset() override;
+
+private:
+    BatchedMultiPathGenerator generator_;
+    Size batchSize_;
+    Array initialValues_;
+    mutable std::vector<std::vector<RandomVariable>> batch_;
+    mutable Size current_;
+    mutable Sample<MultiPath> next_;
+};
+
+/*! Returns a MultiPathGeneratorBatched if the process is a CrossAssetStateProcess using the exact discretization
+    and the result of makeMultiPathGenerator() otherwise. The generator holds one batch of paths at a time, if fewer
+    samples than the batch size are drawn, the number of samples should be used as the batch size. */
+boost::shared_ptr<MultiPathGeneratorBase>
+makeBatchedMultiPathGenerator(const SequenceType s, const boost::shared_ptr<StochasticProcess>& process,
+                              const TimeGrid& timeGrid, const BigNatural seed,
+                              const SobolBrownianGenerator::Ordering ordering = SobolBrownianGenerator::Steps,
+                              const SobolRsg::DirectionIntegers directionIntegers = SobolRsg::JoeKuoD7,
+                              const Size batchSize = 1024);
+
+} // namespace QuantExt
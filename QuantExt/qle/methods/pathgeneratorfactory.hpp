@@ -23,6 +23,7 @@
 
 #pragma once
 
+#include <qle/methods/batchedmultipathgenerator.hpp>
 #include <qle/methods/multipathgeneratorbase.hpp>
 
 namespace QuantExt {
@@ -39,6 +40,7 @@ public:
 };
 
 //! Standard implementation for path generator factory
+/*! Cross asset state processes using the exact discretization are served by a MultiPathGeneratorBatched */
 class MultiPathGeneratorFactory : public PathGeneratorFactory {
 public:
     boost::shared_ptr<MultiPathGeneratorBase> build(const SequenceType s,
@@ -46,7 +48,7 @@ public:
                                                     const TimeGrid& timeGrid, const BigNatural seed,
                                                     const SobolBrownianGenerator::Ordering ordering,
                                                     const SobolRsg::DirectionIntegers directionIntegers) override {
-        return makeMultiPathGenerator(s, process, timeGrid, seed, ordering, directionIntegers);
+        return makeBatchedMultiPathGenerator(s, process, timeGrid, seed, ordering, directionIntegers);
     }
 };
 
@@ -24,6 +24,11 @@
 #include <ql/cashflows/simplecashflow.hpp>
 #include <ql/utilities/dataformatters.hpp>
 
+#include <boost/weak_ptr.hpp>
+
+#include <algorithm>
+#include <unordered_map>
+
 #include <qle/pricingengines/discountingswapenginemulticurve.hpp>
 
 namespace QuantExt {
@@ -108,20 +113,126 @@ void AdditionalAmountGetter::visit(IborCoupon& c) {
     AmountGetter::visit(c);
     bpsFactor_ = c.accrualPeriod() * c.nominal();
 }
+
+/* Scenario independent data of a cashflow, i.e. everything the AmountGetters above compute from the cashflow except
+   the forwarding curve discount factors. */
+struct CashFlowData {
+    bool isIborCoupon = false;
+    Real bpsFactor = 0.0;
+    Date accrualStartDate, accrualEndDate;
+    Handle<YieldTermStructure> forwardingCurve;
+    Real gearing = 0.0, spreadTimesAccrual = 0.0, nominal = 0.0, accrualPeriod = 0.0;
+    // Null if index and coupon day counter coincide
+    Real indexDcf = Null<Real>();
+
+    // the amount as computed by AmountGetter::visit(IborCoupon&) with callAmount = false
+    Real iborAmount() const {
+        QL_REQUIRE(!forwardingCurve.empty(), "Forwarding curve is empty.");
+        DiscountFactor discAccStart = forwardingCurve->discount(accrualStartDate);
+        DiscountFactor discAccEnd = forwardingCurve->discount(accrualEndDate);
+        Real fixingTimesDcf = indexDcf == Null<Real>() ? (discAccStart / discAccEnd - 1)
+                                                       : (discAccStart / discAccEnd - 1) / indexDcf * accrualPeriod;
+        return (gearing * fixingTimesDcf + spreadTimesAccrual) * nominal;
+    }
+};
+
+// fills CashFlowData, the visit() methods are dispatched in the same way as for the AmountGetters
+class CashFlowDataBuilder : public AcyclicVisitor,
+                            public Visitor<CashFlow>,
+                            public Visitor<Coupon>,
+                            public Visitor<IborCoupon> {
+public:
+    explicit CashFlowDataBuilder(CashFlowData& data) : data_(data) {}
+
+    void visit(CashFlow&) override {}
+    void visit(Coupon& c) override { data_.bpsFactor = c.accrualPeriod() * c.nominal(); }
+    void visit(IborCoupon& c) override {
+        visit(static_cast<Coupon&>(c));
+        data_.isIborCoupon = true;
+        data_.accrualStartDate = c.accrualStartDate();
+        data_.accrualEndDate = c.accrualEndDate();
+        data_.forwardingCurve = c.iborIndex()->forwardingTermStructure();
+        data_.gearing = c.gearing();
+        data_.nominal = c.nominal();
+        data_.accrualPeriod = c.accrualPeriod();
+        data_.spreadTimesAccrual = c.spread() * c.accrualPeriod();
+        DayCounter indexBasis = c.iborIndex()->dayCounter();
+        if (indexBasis != c.dayCounter())
+            data_.indexDcf = indexBasis.yearFraction(c.accrualStartDate(), c.accrualEndDate());
+    }
+
+private:
+    CashFlowData& data_;
+};
+
 } // namespace
 
 class DiscountingSwapEngineMultiCurve::AmountImpl {
 public:
     boost::shared_ptr<AmountGetter> amountGetter_;
+
+    /* The static data of a leg, keyed by its first cashflow. The entry holds weak pointers to all cashflows of the
+       leg, so that it is only used for the leg it was built for: a leg that shares the first cashflow with another
+       leg, or a new leg whose cashflows reuse the addresses of a destroyed leg, is not matched. */
+    struct LegData {
+        std::vector<const CashFlow*> cashflows;
+        std::vector<boost::weak_ptr<CashFlow>> alive;
+        std::vector<CashFlowData> data;
+        bool matches(const Leg& leg) const {
+            if (cashflows.size() != leg.size())
+                return false;
+            for (Size j = 0; j < leg.size(); ++j) {
+                if (cashflows[j] != leg[j].get() || alive[j].expired())
+                    return false;
+            }
+            return true;
+        }
+        bool expired() const {
+            return std::any_of(alive.begin(), alive.end(),
+                               [](const boost::weak_ptr<CashFlow>& c) { return c.expired(); });
+        }
+    };
+    std::unordered_map<const CashFlow*, LegData> legData_;
+    // size of the cache above which the entries of destroyed legs are evicted on the next miss
+    Size evictionSize_ = 64;
+
+    const std::vector<CashFlowData>& legData(const Leg& leg) {
+        auto it = legData_.find(leg.front().get());
+        if (it != legData_.end() && it->second.matches(leg))
+            return it->second.data;
+        // on a miss drop the entries of destroyed legs, the threshold keeps the cost of the scans linear in the
+        // number of misses
+        if (legData_.size() >= evictionSize_) {
+            for (auto e = legData_.begin(); e != legData_.end();) {
+                if (e->second.expired())
+                    e = legData_.erase(e);
+                else
+                    ++e;
+            }
+            evictionSize_ = std::max<Size>(64, 2 * legData_.size());
+        }
+        LegData& d = legData_[leg.front().get()];
+        d.cashflows.resize(leg.size());
+        d.alive.resize(leg.size());
+        d.data.assign(leg.size(), CashFlowData());
+        for (Size j = 0; j < leg.size(); ++j) {
+            d.cashflows[j] = leg[j].get();
+            d.alive[j] = leg[j];
+            CashFlowDataBuilder builder(d.data[j]);
+            leg[j]->accept(builder);
+        }
+        return d.data;
+    }
 };
 
 DiscountingSwapEngineMultiCurve::DiscountingSwapEngineMultiCurve(const Handle<YieldTermStructure>& discountCurve,
                                                                  bool minimalResults,
                                                                  boost::optional<bool> includeSettlementDateFlows,
-                                                                 Date settlementDate, Date npvDate)
+                                                                 Date settlementDate, Date npvDate,
+                                                                 bool cacheStaticData)
     : discountCurve_(discountCurve), minimalResults_(minimalResults),
       includeSettlementDateFlows_(includeSettlementDateFlows), settlementDate_(settlementDate), npvDate_(npvDate),
-      impl_(new AmountImpl) {
+      cacheStaticData_(cacheStaticData), impl_(new AmountImpl) {
 
     registerWith(discountCurve_);
 
@@ -176,12 +287,15 @@ void DiscountingSwapEngineMultiCurve::calculate() const {
 
     for (Size i = 0; i < numLegs; i++) {
 
-        Leg leg = arguments_.legs[i];
+        const Leg& leg = arguments_.legs[i];
         results_.legNPV[i] = 0.0;
         results_.legBPS[i] = 0.0;
 
         // Call amount() method of underlying coupon for first coupon.
         impl_->amountGetter_->setCallAmount(true);
+        bool callAmount = true;
+
+        const std::vector<CashFlowData>* data = cacheStaticData_ && !leg.empty() ? &impl_->legData(leg) : nullptr;
 
         for (Size j = 0; j < leg.size(); j++) {
 
@@ -192,14 +306,24 @@ void DiscountingSwapEngineMultiCurve::calculate() const {
             }
 
             DiscountFactor discount = discountCurve_->discount(leg[j]->date());
-            leg[j]->accept(*(impl_->amountGetter_));
-            results_.legNPV[i] += impl_->amountGetter_->amount() * discount;
-            results_.legBPS[i] += impl_->amountGetter_->bpsFactor() * discount;
+            if (data) {
+                const CashFlowData& d = (*data)[j];
+                Real amount = d.isIborCoupon && !callAmount ? d.iborAmount() : leg[j]->amount();
+                results_.legNPV[i] += amount * discount;
+                if (!minimalResults_)
+                    results_.legBPS[i] += d.bpsFactor * discount;
+            } else {
+                leg[j]->accept(*(impl_->amountGetter_));
+                results_.legNPV[i] += impl_->amountGetter_->amount() * discount;
+                results_.legBPS[i] += impl_->amountGetter_->bpsFactor() * discount;
+            }
 
             // For all coupons after second do not call amount(), since for those
             // we can be sure that they are not fixed yet
-            if (j == 1)
+            if (j == 1) {
                 impl_->amountGetter_->setCallAmount(false);
+                callAmount = false;
+            }
         }
 
         results_.legNPV[i] *= arguments_.payer[i];
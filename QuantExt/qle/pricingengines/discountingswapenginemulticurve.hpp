@@ -39,6 +39,14 @@ using namespace QuantLib;
       date.
     - start and end discounts of Swap::results not populated.
 
+    The scenario independent data of the legs (accrual dates and periods,
+    nominals, gearings, spreads, day count fractions of the index) is cached
+    per leg on the first calculation of an instrument, unless cacheStaticData
+    is false. Since one engine is usually shared by many swaps in a scenario
+    simulation, the cache holds the data of all legs priced by this engine.
+    An entry is only reused for a leg with the same cashflow objects, the
+    entries of destroyed legs are evicted as new legs are added.
+
     \warning if an IborCoupon with non-natural fixing and/or accrual
              period is present, the NPV will be false
 
@@ -49,7 +57,8 @@ public:
     DiscountingSwapEngineMultiCurve(const Handle<YieldTermStructure>& discountCurve = Handle<YieldTermStructure>(),
                                     bool minimalResults = true,
                                     boost::optional<bool> includeSettlementDateFlows = boost::none,
-                                    Date settlementDate = Date(), Date npvDate = Date());
+                                    Date settlementDate = Date(), Date npvDate = Date(),
+                                    bool cacheStaticData = true);
     void calculate() const override;
     Handle<YieldTermStructure> discountCurve() const { return discountCurve_; }
 
@@ -59,6 +68,7 @@ private:
     boost::optional<bool> includeSettlementDateFlows_;
     Date settlementDate_;
     Date npvDate_;
+    bool cacheStaticData_;
 
     class AmountImpl;
     boost::shared_ptr<AmountImpl> impl_;
@@ -16,6 +16,7 @@
  FITNESS FOR A PARTICULAR PURPOSE. See the license for more details.
 */
 
+#include <qle/math/leastsquaresregression.hpp>
 #include <qle/pricingengines/mcmultilegbaseengine.hpp>
 
 #include <ql/cashflows/capflooredcoupon.hpp>
@@ -25,22 +26,15 @@
 #include <ql/cashflows/iborcoupon.hpp>
 #include <ql/cashflows/simplecashflow.hpp>
 #include <ql/indexes/swapindex.hpp>
-#include <ql/math/generallinearleastsquares.hpp>
-#include <ql/math/matrixutilities/qrdecomposition.hpp>
+
+#include <map>
 
 namespace QuantExt {
 
 namespace {
 
-template <class I>
-#if QL_HEX_VERSION > 0x01150000
-Array regression(const std::vector<Array>& X, const I& Y, const std::vector<ext::function<Real(Array)>>& basisFn) {
-#else
-Array regression(const std::vector<Array>& X, const I& Y, const std::vector<boost::function1<Real, Array>>& basisFn) {
-#endif
-    QL_REQUIRE(X.size() == Y.size(), "McMultiLegBaseEngine: vector lenghts do not match");
-    return GeneralLinearLeastSquares(X, Y, basisFn).coefficients();
-}
+// maximum number of samples generated at once by the batched path generators
+constexpr Size maxPathBatchSize = 1024;
 
 #if QL_HEX_VERSION > 0x01150000
 Real evalRegression(const Array& c, const Array& x, const std::vector<ext::function<Real(Array)>> basisFns) {
@@ -137,16 +131,10 @@ void McMultiLegBaseEngine::rollback(const bool calibration) const {
     Size N = calibration ? calibrationSamples_ : pricingSamples_; // number of paths
     Size numIdx = indexes_.size();                                // number of exercise / sim times
 
-    std::vector<Real> option(N, 0.0); // option value
-    std::vector<Array> x;             // regressor for option
-    std::vector<Real> y;              // dependend variable for option
-    std::vector<Real> exerciseValue;  // exercise value
-    std::vector<Size> itmPaths;       // itm path indexes
-
-    x.reserve(N);
-    y.reserve(N);
-    itmPaths.reserve(N);
-    exerciseValue.reserve(N);
+    std::vector<Real> option(N, 0.0);            // option value
+    std::vector<Real> exerciseValue(N, 0.0);     // exercise value
+    std::vector<Real> continuationValue(N, 0.0); // continuation value
+    std::vector<Real> itm(N, 0.0);               // itm indicator, used as regression weights
 
     // init result vectors
     if (calibration) {
@@ -187,8 +175,28 @@ void McMultiLegBaseEngine::rollback(const bool calibration) const {
         }
     }
 
+    /* basis function values on the paths of a time index, stored column-wise, i.e. the value of basis function j on
+       path i is found at j * N + i, they are computed once and shared by all regressions on this time index */
+    std::map<Size, std::vector<Real>> basisValues;
+    auto regressionBasis = [this, &paths, &basisValues, N](const Size t) {
+        auto b = basisValues.find(t);
+        if (b == basisValues.end()) {
+            std::vector<Real> v(basisFns_.size() * N);
+            for (Size j = 0; j < basisFns_.size(); ++j) {
+                for (Size i = 0; i < N; ++i)
+                    v[j * N + i] = basisFns_[j](paths[t][i]);
+            }
+            b = basisValues.insert(std::make_pair(t, std::move(v))).first;
+        }
+        std::vector<const Real*> res(basisFns_.size());
+        for (Size j = 0; j < basisFns_.size(); ++j)
+            res[j] = &b->second[j * N];
+        return res;
+    };
+
     // roll back over live ex / sim dates (1,2...) and today (0)
     bool isLastExercise = true;
+    Size lastExerciseTs = Null<Size>();
     for (Size ts = numIdx; ts > 0; --ts) {
         // event type and indexes
         Size exIdx = exerciseIdx_[ts - 1];
@@ -198,7 +206,8 @@ void McMultiLegBaseEngine::rollback(const bool calibration) const {
         // conditional expectation of underlying value
         if (calibration) {
             if (isExercise) {
-                coeffsUndEx_[exIdx] = regression(paths[ts - 1], underlyingValueEx[exIdx + 1], basisFns_);
+                LeastSquaresRegression exRegression(N, regressionBasis(ts - 1));
+                coeffsUndEx_[exIdx] = exRegression.coefficients(underlyingValueEx[exIdx + 1].begin());
             }
             if (isSimulation) {
                 Size tmpTs = ts;
@@ -209,47 +218,39 @@ void McMultiLegBaseEngine::rollback(const bool calibration) const {
                     tmpTs = ts;
                 // skip if we know that all underlying flows are zero
                 if (simIdx <= maxUndValDirtyIdx_) {
-                    coeffsUndDirty_[simIdx] = regression(paths[tmpTs - 1], underlyingValueDirty[simIdx + 1], basisFns_);
+                    LeastSquaresRegression undRegression(N, regressionBasis(tmpTs - 1));
+                    coeffsUndDirty_[simIdx] = undRegression.coefficients(underlyingValueDirty[simIdx + 1].begin());
                     if (isTrappedDate_[simIdx])
-                        coeffsUndTrapped_[simIdx] =
-                            regression(paths[tmpTs - 1], underlyingValueTrapped[simIdx], basisFns_);
+                        coeffsUndTrapped_[simIdx] = undRegression.coefficients(underlyingValueTrapped[simIdx].begin());
                 } else
                     coeffsUndDirty_[simIdx] = Array(basisFns_.size(), 0.0);
             }
         }
         // on the last exercise date the payoff is max(underlying,0.0) ...
         if (isExercise) {
+            LeastSquaresRegression exRegression(N, regressionBasis(ts - 1));
+            exRegression.fittedValues(coeffsUndEx_[exIdx], &exerciseValue[0]);
             if (isLastExercise) {
                 for (Size i = 0; i < N; ++i) {
-                    if (evalRegression(coeffsUndEx_[exIdx], paths[ts - 1][i], basisFns_) > 0) {
+                    if (exerciseValue[i] > 0) {
                         option[i] = underlyingValueEx[exIdx + 1][i];
                     }
                 }
                 coeffsItm_[exIdx] = Array(basisFns_.size(), 0.0); // on last exercise cv = 0
             } else {
-                x.clear();
-                y.clear();
-                itmPaths.clear();
-                exerciseValue.clear();
-                // otherwise compute the exercise value and collect the itm cont vals...
+                // otherwise collect the itm paths and calibrate the continuation value coefficients on them
+                Size nItm = 0;
                 for (Size i = 0; i < N; ++i) {
-                    Real tmp = evalRegression(coeffsUndEx_[exIdx], paths[ts - 1][i], basisFns_);
-                    if (tmp > 0.0) {
-                        exerciseValue.push_back(tmp);
-                        itmPaths.push_back(i);
-                        if (calibration) {
-                            x.push_back(paths[ts - 1][i]);
-                            y.push_back(option[i]);
-                        }
-                    }
+                    itm[i] = exerciseValue[i] > 0.0 ? 1.0 : 0.0;
+                    nItm += exerciseValue[i] > 0.0 ? 1 : 0;
                 }
-            }
-            // calibrate the continuation value coefficients
-            if (calibration) {
-                if (basisFns_.size() <= x.size()) {
-                    coeffsItm_[exIdx] = regression(x, y, basisFns_);
-                } else {
-                    coeffsItm_[exIdx] = Array(basisFns_.size(), 0.0);
+                if (calibration) {
+                    if (basisFns_.size() <= nItm) {
+                        coeffsItm_[exIdx] =
+                            LeastSquaresRegression(N, regressionBasis(ts - 1), &itm[0]).coefficients(&option[0]);
+                    } else {
+                        coeffsItm_[exIdx] = Array(basisFns_.size(), 0.0);
+                    }
                 }
             }
         }
@@ -263,18 +264,29 @@ void McMultiLegBaseEngine::rollback(const bool calibration) const {
                 while (regressionOnExerciseOnly_ && tmpTs <= numIdx && exerciseIdx_[tmpTs - 1] == Null<Size>())
                     ++tmpTs;
                 QL_REQUIRE(tmpTs <= numIdx, "tmpTs > numIdx, this is unexpected");
-                coeffsFull_[simIdx] = regression(paths[tmpTs - 1], option, basisFns_);
+                coeffsFull_[simIdx] = LeastSquaresRegression(N, regressionBasis(tmpTs - 1)).coefficients(&option[0]);
             }
         }
         if (isExercise) {
             // early exercise decision + option value update
-            for (Size i = 0; i < itmPaths.size(); ++i) {
-                Real cv = evalRegression(coeffsItm_[exIdx], paths[ts - 1][itmPaths[i]], basisFns_);
-                if (exerciseValue[i] > cv) {
-                    option[itmPaths[i]] = underlyingValueEx[exIdx + 1][itmPaths[i]];
+            if (!isLastExercise) {
+                LeastSquaresRegression itmRegression(N, regressionBasis(ts - 1));
+                itmRegression.fittedValues(coeffsItm_[exIdx], &continuationValue[0]);
+                for (Size i = 0; i < N; ++i) {
+                    if (itm[i] > 0.0 && exerciseValue[i] > continuationValue[i]) {
+                        option[i] = underlyingValueEx[exIdx + 1][i];
+                    }
                 }
             }
             isLastExercise = false;
+            lastExerciseTs = ts;
+        }
+        // earlier simulation times only regress on the paths of the last exercise time seen so far
+        for (auto b = basisValues.begin(); b != basisValues.end();) {
+            if (lastExerciseTs != Null<Size>() && b->first == lastExerciseTs - 1)
+                ++b;
+            else
+                b = basisValues.erase(b);
         }
     } // end of roll back
 
@@ -641,17 +653,25 @@ void McMultiLegBaseEngine::calculate() const {
 
     // build the path generators and do the mc simulation
 
+    // the generators hold one batch of paths, the batch size is capped, since rollback() stores all paths anyway
+
     TimeGrid timeGrid(times_.begin(), times_.end());
-    pathGeneratorCalibration_ = makeMultiPathGenerator(calibrationPathGenerator_, model_->stateProcess(), timeGrid,
-                                                       calibrationSeed_, ordering_, directionIntegers_);
-    pathGeneratorPricing_ = makeMultiPathGenerator(pricingPathGenerator_, model_->stateProcess(), timeGrid,
-                                                   pricingSeed_, ordering_, directionIntegers_);
+    pathGeneratorCalibration_ = makeBatchedMultiPathGenerator(
+        calibrationPathGenerator_, model_->stateProcess(), timeGrid, calibrationSeed_, ordering_, directionIntegers_,
+        std::min<Size>(std::max<Size>(calibrationSamples_, 1), maxPathBatchSize));
+    pathGeneratorPricing_ = makeBatchedMultiPathGenerator(
+        pricingPathGenerator_, model_->stateProcess(), timeGrid, pricingSeed_, ordering_, directionIntegers_,
+        std::min<Size>(std::max<Size>(pricingSamples_, 1), maxPathBatchSize));
     // calibration phase
     rollback(true);
 
     // maybe we don't want a separate pricing run (then we just take the calibration run results)
     if (pricingSamples_ > 0)
         rollback(false);
+
+    // release the generators and their batches, they are rebuilt on the next calculation
+    pathGeneratorCalibration_.reset();
+    pathGeneratorPricing_.reset();
 }
 
 boost::shared_ptr<AmcCalculator> McMultiLegBaseEngine::amcCalculator() const {
@@ -23,6 +23,7 @@
 #pragma once
 
 #include <qle/instruments/multilegoption.hpp>
+#include <qle/methods/batchedmultipathgenerator.hpp>
 #include <qle/methods/multipathgeneratorbase.hpp>
 #include <qle/models/crossassetmodel.hpp>
 #include <qle/models/lgmimpliedyieldtermstructure.hpp>
@@ -553,6 +553,17 @@ Array CrossAssetStateProcess::evolve(Time t0, const Array& x0, Time dt, const Ar
     return res;
 }
 
+bool CrossAssetStateProcess::exactStepCoefficients(Time t0, Time dt, Array& m, Matrix& A, Matrix& D) const {
+    auto disc = boost::dynamic_pointer_cast<CrossAssetStateProcess::ExactDiscretization>(discretization_);
+    if (disc == nullptr || cirppCount_ > 0)
+        return false;
+    m = disc->driftConstant(*this, t0, dt);
+    A = disc->driftMatrix(*this, t0, dt);
+    // note that the diffusion does not depend on x0
+    D = disc->diffusion(*this, t0, Array(size(), 0.0), dt);
+    return true;
+}
+
 CrossAssetStateProcess::ExactDiscretization::ExactDiscretization(const CrossAssetModel* const model,
                                                                  SalvagingAlgorithm::Type salvaging)
     : model_(model), salvaging_(salvaging) {
@@ -563,20 +574,48 @@ CrossAssetStateProcess::ExactDiscretization::ExactDiscretization(const CrossAsse
 
 Array CrossAssetStateProcess::ExactDiscretization::drift(const StochasticProcess& p, Time t0, const Array& x0,
                                                          Time dt) const {
-    Array res;
+    Array res = driftConstant(p, t0, dt);
+    Array res2 = driftImpl2(p, t0, x0, dt);
+    for (Size i = 0; i < res.size(); ++i) {
+        res[i] += res2[i];
+    }
+    return res - x0;
+}
+
+Array CrossAssetStateProcess::ExactDiscretization::driftConstant(const StochasticProcess& p, Time t0,
+                                                                 Time dt) const {
     cache_key k = {t0, dt};
     auto i = cache_m_.find(k);
     if (i == cache_m_.end()) {
-        res = driftImpl1(p, t0, x0, dt);
+        // note that driftImpl1 does not depend on x0
+        Array res = driftImpl1(p, t0, Array(model_->dimension(), 0.0), dt);
         cache_m_.insert(std::make_pair(k, res));
+        return res;
     } else {
-        res = i->second;
+        return i->second;
     }
-    Array res2 = driftImpl2(p, t0, x0, dt);
-    for (Size i = 0; i < res.size(); ++i) {
-        res[i] += res2[i];
+}
+
+Matrix CrossAssetStateProcess::ExactDiscretization::driftMatrix(const StochasticProcess& p, Time t0, Time dt) const {
+    cache_key k = {t0, dt};
+    auto i = cache_a_.find(k);
+    if (i == cache_a_.end()) {
+        // driftImpl2 is linear in x0, so its columns are the images of the unit vectors
+        Size n = model_->dimension();
+        Matrix res(n, n);
+        Array e(n, 0.0);
+        for (Size j = 0; j < n; ++j) {
+            e[j] = 1.0;
+            Array c = driftImpl2(p, t0, e, dt);
+            for (Size r = 0; r < n; ++r)
+                res[r][j] = c[r];
+            e[j] = 0.0;
+        }
+        cache_a_.insert(std::make_pair(k, res));
+        return res;
+    } else {
+        return i->second;
     }
-    return res - x0;
 }
 
 Matrix CrossAssetStateProcess::ExactDiscretization::diffusion(const StochasticProcess& p, Time t0, const Array& x0,
@@ -921,6 +960,7 @@ void CrossAssetStateProcess::ExactDiscretization::flushCache() const {
     cache_m_.clear();
     cache_v_.clear();
     cache_d_.clear();
+    cache_a_.clear();
 }
 
 } // namespace QuantExt
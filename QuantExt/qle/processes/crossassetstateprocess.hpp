@@ -54,6 +54,11 @@ public:
     /*! specific members */
     virtual void flushCache() const;
 
+    /*! For the exact discretization the evolution over one step is affine in the state and the Brownian increments,
+        i.e. x(t0 + dt) = m + A x(t0) + D dw. This method returns m, A and D, which are cached per step. It returns
+        false and leaves the outputs untouched if the process does not use the exact discretization. */
+    bool exactStepCoefficients(Time t0, Time dt, Array& m, Matrix& A, Matrix& D) const;
+
 protected:
     virtual Matrix diffusionOnCorrelatedBrownians(Time t, const Array& x) const;
     virtual Matrix diffusionOnCorrelatedBrowniansImpl(Time t, const Array& x) const;
@@ -75,6 +80,11 @@ protected:
         virtual Matrix covariance(const StochasticProcess&, Time t0, const Array& x0, Time dt) const override;
         void flushCache() const;
 
+        //! state independent part of the conditional expectation, i.e. driftImpl1()
+        Array driftConstant(const StochasticProcess&, Time t0, Time dt) const;
+        //! matrix of the state dependent part of the conditional expectation, which is linear in x0
+        Matrix driftMatrix(const StochasticProcess&, Time t0, Time dt) const;
+
     protected:
         virtual Array driftImpl1(const StochasticProcess&, Time t0, const Array& x0, Time dt) const;
         virtual Array driftImpl2(const StochasticProcess&, Time t0, const Array& x0, Time dt) const;
@@ -98,7 +108,7 @@ protected:
             }
         };
         mutable boost::unordered_map<cache_key, Array, cache_hasher> cache_m_;
-        mutable boost::unordered_map<cache_key, Matrix, cache_hasher> cache_v_, cache_d_;
+        mutable boost::unordered_map<cache_key, Matrix, cache_hasher> cache_v_, cache_d_, cache_a_;
     }; // ExactDiscretization
 
     // cache for process drift and diffusion (e.g. used in Euler discretization)
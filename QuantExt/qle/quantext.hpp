@@ -194,6 +194,7 @@
 #include <qle/math/fillemptymatrix.hpp>
 #include <qle/math/flatextrapolation.hpp>
 #include <qle/math/flatextrapolation2d.hpp>
+#include <qle/math/leastsquaresregression.hpp>
 #include <qle/math/logquadraticinterpolation.hpp>
 #include <qle/math/method_mt.hpp>
 #include <qle/math/nadarayawatson.hpp>
@@ -203,6 +204,7 @@
 #include <qle/math/randomvariable_io.hpp>
 #include <qle/math/stabilisedglls.hpp>
 #include <qle/math/trace.hpp>
+#include <qle/methods/batchedmultipathgenerator.hpp>
 #include <qle/methods/brownianbridgepathinterpolator.hpp>
 #include <qle/methods/interpolatedvariatemultipathgenerator.hpp>
 #include <qle/methods/multipathgeneratorbase.hpp>
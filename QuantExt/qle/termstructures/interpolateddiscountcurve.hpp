@@ -25,8 +25,12 @@
 #define quantext_interpolated_discount_curve_hpp
 
 #include <boost/make_shared.hpp>
+#include <ql/patterns/observable.hpp>
+#include <ql/quote.hpp>
 #include <ql/termstructures/yieldtermstructure.hpp>
-#include <qle/quotes/logquote.hpp>
+
+#include <algorithm>
+#include <cmath>
 
 namespace QuantExt {
 using namespace QuantLib;
@@ -36,12 +40,28 @@ using namespace QuantLib;
     flat fwd extrapolation is always enabled, the term structure has always a
     floating reference date
 
+    The logs of the discount quotes are read into an array on the first discount()
+    call after one of the quotes has changed. The curve observes the quotes for this
+    purpose, but does not notify its own observers on quote changes.
+
+    Several discount factors can be retrieved with one call to discounts(), either
+    for arbitrary times or for a fixed set of times whose interpolation weights are
+    precomputed by positions().
+
         \ingroup termstructures
     */
 class InterpolatedDiscountCurve : public YieldTermStructure {
 public:
     enum class Interpolation { logLinear, linearZero };
     enum class Extrapolation { flatFwd, flatZero };
+
+    //! interpolation pillars and weights for a fixed set of times, see positions()
+    struct Positions {
+        std::vector<Time> times;
+        std::vector<Size> index;
+        std::vector<Real> weight;
+    };
+
     //! \name Constructors
     //@{
     //! default constructor
@@ -50,7 +70,7 @@ public:
                               const Interpolation interpolation = Interpolation::logLinear,
                               const Extrapolation extrapolation = Extrapolation::flatFwd)
         : YieldTermStructure(settlementDays, cal, dc), times_(times), interpolation_(interpolation),
-          extrapolation_(extrapolation) {
+          extrapolation_(extrapolation), outdated_(true), quoteObserver_(&outdated_) {
         initalise(quotes);
     }
 
@@ -60,57 +80,132 @@ public:
                               const Interpolation interpolation = Interpolation::logLinear,
                               const Extrapolation extrapolation = Extrapolation::flatFwd)
         : YieldTermStructure(settlementDays, cal, dc), times_(dates.size()), interpolation_(interpolation),
-          extrapolation_(extrapolation) {
+          extrapolation_(extrapolation), outdated_(true), quoteObserver_(&outdated_) {
         for (Size i = 0; i < dates.size(); ++i)
             times_[i] = timeFromReference(dates[i]);
         initalise(quotes);
     }
+
+    // the quote observer refers to the outdated flag of this instance, so the curve must not be copied or moved
+    InterpolatedDiscountCurve(const InterpolatedDiscountCurve&) = delete;
+    InterpolatedDiscountCurve(InterpolatedDiscountCurve&&) = delete;
+    InterpolatedDiscountCurve& operator=(const InterpolatedDiscountCurve&) = delete;
+    InterpolatedDiscountCurve& operator=(InterpolatedDiscountCurve&&) = delete;
+    //@}
+
+    //! \name Batched discount factors
+    //@{
+    //! discount factors for the times t[0], ..., t[n - 1], equal to discount(t[i], true)
+    void discounts(const Time* t, Real* out, const Size n) const {
+        snapshot();
+        for (Size k = 0; k < n; ++k) {
+            checkRange(t[k], true);
+            out[k] = discountFromSnapshot(t[k], pillar(t[k]));
+        }
+    }
+
+    //! precompute the interpolation pillars and weights for the given times
+    Positions positions(const std::vector<Time>& t) const {
+        Positions p;
+        p.times = t;
+        for (auto const& s : t) {
+            QL_REQUIRE(s >= 0.0, "negative time (" << s << ") given");
+            Size i = pillar(s);
+            p.index.push_back(i);
+            p.weight.push_back((times_[i] - s) / timeDiffs_[i - 1]);
+        }
+        return p;
+    }
+
+    //! discount factors for the times of p, out must hold p.times.size() values
+    void discounts(const Positions& p, Real* out) const {
+        snapshot();
+        for (Size k = 0; k < p.times.size(); ++k)
+            out[k] = discountFromSnapshot(p.times[k], p.index[k], p.weight[k]);
+    }
     //@}
 
 private:
+    // sets a flag when one of the quotes changes
+    class QuoteObserver : public Observer {
+    public:
+        explicit QuoteObserver(bool* outdated) : outdated_(outdated) {}
+        void update() override { *outdated_ = true; }
+
+    private:
+        bool* outdated_;
+    };
+
     void initalise(const std::vector<Handle<Quote>>& quotes) {
         QL_REQUIRE(times_.size() > 1, "at least two times required");
         QL_REQUIRE(times_[0] == 0.0, "First time must be 0, got " << times_[0]); // or date=asof
         QL_REQUIRE(times_.size() == quotes.size(), "size of time and quote vectors do not match");
-        for (Size i = 0; i < quotes.size(); ++i) {
-            quotes_.push_back(boost::make_shared<LogQuote>(quotes[i]));
-        }
+        quotes_ = quotes;
+        for (Size i = 0; i < quotes.size(); ++i)
+            quoteObserver_.registerWith(quotes[i]);
         for (Size i = 0; i < times_.size() - 1; ++i)
             timeDiffs_.push_back(times_[i + 1] - times_[i]);
+        logDiscounts_.resize(times_.size());
     }
 
-    //! \name TermStructure interface
-    //@{
-    Date maxDate() const override { return Date::maxDate(); } // flat fwd extrapolation
-    //@}
+    // read the logs of the discount quotes if one of them has changed
+    void snapshot() const {
+        if (!outdated_)
+            return;
+        for (Size i = 0; i < quotes_.size(); ++i) {
+            Real v = quotes_[i]->value();
+            QL_REQUIRE(v > 0.0, "Invalid quote, cannot take log of non-positive number");
+            logDiscounts_[i] = std::log(v);
+        }
+        outdated_ = false;
+    }
 
-protected:
-    DiscountFactor discountImpl(Time t) const override {
+    // the upper interpolation pillar for t, always in [1, times.size() - 1]
+    Size pillar(Time t) const {
+        std::vector<Time>::const_iterator it = std::upper_bound(times_.begin(), times_.end(), t);
+        return std::max<Size>(std::min<Size>(it - times_.begin(), times_.size() - 1), 1);
+    }
+
+    DiscountFactor discountFromSnapshot(Time t, Size i) const {
+        return discountFromSnapshot(t, i, (times_[i] - t) / timeDiffs_[i - 1]);
+    }
+
+    DiscountFactor discountFromSnapshot(Time t, Size i, Real weight) const {
         if (t > this->times_.back() && extrapolation_ == Extrapolation::flatZero) {
             Real tMax = this->times_.back();
-            Real dMax = std::exp(quotes_.back()->value());
+            Real dMax = std::exp(logDiscounts_.back());
             return std::pow(dMax, t / tMax);
         }
-        std::vector<Time>::const_iterator it = std::upper_bound(times_.begin(), times_.end(), t);
-        Size i = std::min<Size>(it - times_.begin(), times_.size() - 1);
-        Real weight = (times_[i] - t) / timeDiffs_[i - 1];
         if (interpolation_ == Interpolation::logLinear || t > this->times_.back()) {
             // this handles flat fwd extrapolation (t > times.back()) as well
-            Real value = (1.0 - weight) * quotes_[i]->value() + weight * quotes_[i - 1]->value();
+            Real value = (1.0 - weight) * logDiscounts_[i] + weight * logDiscounts_[i - 1];
             return ::exp(value);
         } else {
-            Real value =
-                (1.0 - weight) * quotes_[i]->value() / times_[i] + weight * quotes_[i - 1]->value() / times_[i - 1];
+            Real value = (1.0 - weight) * logDiscounts_[i] / times_[i] + weight * logDiscounts_[i - 1] / times_[i - 1];
             return ::exp(t * value);
         }
     }
 
+    //! \name TermStructure interface
+    //@{
+    Date maxDate() const override { return Date::maxDate(); } // flat fwd extrapolation
+    //@}
+
+protected:
+    DiscountFactor discountImpl(Time t) const override {
+        snapshot();
+        return discountFromSnapshot(t, pillar(t));
+    }
+
 private:
     std::vector<Time> times_;
     std::vector<Time> timeDiffs_;
-    std::vector<boost::shared_ptr<Quote>> quotes_;
+    std::vector<Handle<Quote>> quotes_;
     Interpolation interpolation_;
     Extrapolation extrapolation_;
+    mutable std::vector<Real> logDiscounts_;
+    mutable bool outdated_;
+    QuoteObserver quoteObserver_;
 };
 
 } // namespace QuantExt
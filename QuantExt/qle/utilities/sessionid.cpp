@@ -0,0 +1,57 @@
+/*
+ Copyright (C) 2023 Quaternion Risk Management Ltd
+ All rights reserved.
+
+ This file is part of ORE, a free-software/open-source library
+ for transparent pricing and risk analysis - http://opensourcerisk.org
+
+ ORE is free software: you can redistribute it and/or modify it
+ under the terms of the Modified BSD License.  You should have received a
+ copy of the license along with this program.
+ The license is also available online at <http://opensourcerisk.org>
+
+ This program is distributed on the basis that it will form a useful
+ contribution to risk analytics and model standardisation, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ FITNESS FOR A PARTICULAR PURPOSE. See the license for more details.
+*/
+
+/*! \file qle/utilities/sessionid.cpp
+    \brief session id for QuantLib builds with QL_ENABLE_SESSIONS
+
+    A QuantLib build with QL_ENABLE_SESSIONS keeps one instance of each session dependent singleton (evaluation date,
+    index fixings, observation mode etc.) per session and requires the user to define QuantLib::sessionId(). ORE runs
+    one session per thread, so that e.g. the workers of the MultiThreadedValuationEngine each see their own singletons.
+    Without QL_ENABLE_SESSIONS this file is empty and the multi-threaded engines require nThreads = 1.
+*/
+
+#include <ql/patterns/singleton.hpp>
+
+#ifdef QL_ENABLE_SESSIONS
+
+#include <atomic>
+#include <thread>
+#include <type_traits>
+
+namespace {
+
+// the thread id if the key type allows it, otherwise a number that is unique for each thread of the process
+template <class Key> Key threadSessionKey() {
+    if constexpr (std::is_integral<Key>::value) {
+        static std::atomic<Key> next(0);
+        thread_local Key key = next++;
+        return key;
+    } else {
+        return std::this_thread::get_id();
+    }
+}
+
+} // namespace
+
+namespace QuantLib {
+
+ThreadKey sessionId() { return threadSessionKey<ThreadKey>(); }
+
+} // namespace QuantLib
+
+#endif
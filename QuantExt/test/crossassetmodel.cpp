@@ -22,6 +22,7 @@
 #include <boost/test/unit_test.hpp>
 #include <boost/test/data/test_case.hpp>
 // clang-format on
+#include <qle/methods/batchedmultipathgenerator.hpp>
 #include <qle/methods/multipathgeneratorbase.hpp>
 #include <qle/models/cdsoptionhelper.hpp>
 #include <qle/models/cirppconstantfellerparametrization.hpp>
@@ -3241,6 +3242,50 @@ BOOST_AUTO_TEST_CASE(testIrFxInfCrEqMoments) {
 
 } // testIrFxInfCrEqMoments
 
+BOOST_AUTO_TEST_CASE(testBatchedPathGenerator) {
+
+    BOOST_TEST_MESSAGE("Testing batched path generator in ir-fx-inf-cr-eq model for "
+                       "Euler and exact discretizations...");
+
+    IrFxInfCrEqModelTestData d;
+
+    Size n = 100;
+    BigNatural seed = 42;
+    TimeGrid grid(5.0, 10);
+    Real tol = 1.0E-10;
+
+    for (auto const& model : {d.modelExact, d.modelEuler}) {
+        bool exact = model == d.modelExact;
+        auto process = model->stateProcess();
+        for (auto const s : {MersenneTwister, MersenneTwisterAntithetic, Sobol, SobolBrownianBridge}) {
+            BatchedMultiPathGenerator batched(process, grid, s, seed);
+            BOOST_CHECK_EQUAL(batched.batched(), exact);
+            std::vector<std::vector<RandomVariable>> paths;
+            batched.next(n, paths);
+            BOOST_REQUIRE_EQUAL(paths.size(), grid.size() - 1);
+            auto reference = makeMultiPathGenerator(s, process, grid, seed);
+            auto adaptor = makeBatchedMultiPathGenerator(s, process, grid, seed, SobolBrownianGenerator::Steps,
+                                                         SobolRsg::JoeKuoD7, 32);
+            for (Size i = 0; i < n; ++i) {
+                const MultiPath& p = reference->next().value;
+                const MultiPath& q = adaptor->next().value;
+                for (Size k = 0; k < process->size(); ++k) {
+                    for (Size j = 1; j < grid.size(); ++j) {
+                        Real r = p[k][j];
+                        if (std::abs(paths[j - 1][k][i] - r) > tol * std::max(1.0, std::abs(r)) ||
+                            std::abs(q[k][j] - r) > tol * std::max(1.0, std::abs(r))) {
+                            BOOST_ERROR("batched path generator (exact = "
+                                        << std::boolalpha << exact << ", sequence type " << s << ") sample " << i
+                                        << " state " << k << " time index " << j << ": batched " << paths[j - 1][k][i]
+                                        << ", adaptor " << q[k][j] << ", reference " << r);
+                        }
+                    }
+                }
+            }
+        }
+    }
+} // testBatchedPathGenerator
+
 namespace {
 
 struct IrFxEqModelTestData {
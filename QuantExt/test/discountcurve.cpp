@@ -22,6 +22,7 @@
 #include <ql/termstructures/yield/discountcurve.hpp>
 #include <ql/time/calendars/nullcalendar.hpp>
 #include <ql/time/daycounters/actualactual.hpp>
+#include <qle/termstructures/interpolateddiscountcurve.hpp>
 #include <qle/termstructures/interpolateddiscountcurve2.hpp>
 
 using namespace boost::unit_test_framework;
@@ -81,6 +82,62 @@ BOOST_AUTO_TEST_CASE(testDiscountCurve) {
     }
 }
 
+BOOST_AUTO_TEST_CASE(testInterpolatedDiscountCurveBatchedDiscounts) {
+
+    BOOST_TEST_MESSAGE("Testing QuantExt::InterpolatedDiscountCurve batched discount factors...");
+
+    SavedSettings backup;
+    Settings::instance().evaluationDate() = Date(1, Dec, 2015);
+
+    DayCounter dc = ActualActual(ActualActual::ISDA);
+    vector<Time> times = {0.0, 0.5, 1.0, 2.0, 5.0, 10.0, 30.0};
+    vector<boost::shared_ptr<SimpleQuote>> simpleQuotes;
+    vector<Handle<Quote>> quotes;
+    for (auto t : times) {
+        simpleQuotes.push_back(boost::make_shared<SimpleQuote>(std::exp(-(0.01 + 0.001 * t) * t)));
+        quotes.push_back(Handle<Quote>(simpleQuotes.back()));
+    }
+
+    vector<Time> queryTimes;
+    for (Time t = 0.0; t < 40.0; t += 0.25)
+        queryTimes.push_back(t);
+    vector<Real> batched(queryTimes.size()), gridded(queryTimes.size());
+
+    for (auto interpolation : {QuantExt::InterpolatedDiscountCurve::Interpolation::logLinear,
+                               QuantExt::InterpolatedDiscountCurve::Interpolation::linearZero}) {
+        for (auto extrapolation : {QuantExt::InterpolatedDiscountCurve::Extrapolation::flatFwd,
+                                   QuantExt::InterpolatedDiscountCurve::Extrapolation::flatZero}) {
+            QuantExt::InterpolatedDiscountCurve curve(times, quotes, 0, NullCalendar(), dc, interpolation,
+                                                      extrapolation);
+            QuantExt::InterpolatedDiscountCurve::Positions positions = curve.positions(queryTimes);
+            for (Real shift : {0.0, 0.01}) {
+                // the quote update must be picked up by all methods
+                for (Size i = 0; i < times.size(); ++i)
+                    simpleQuotes[i]->setValue(std::exp(-(0.01 + 0.001 * times[i] + shift) * times[i]));
+                curve.discounts(&queryTimes[0], &batched[0], queryTimes.size());
+                curve.discounts(positions, &gridded[0]);
+                // the linear zero interpolation is not defined on the first interval
+                bool linearZero = interpolation == QuantExt::InterpolatedDiscountCurve::Interpolation::linearZero;
+                for (Size k = 0; k < queryTimes.size(); ++k) {
+                    if (linearZero && queryTimes[k] < times[1])
+                        continue;
+                    Real expected = curve.discount(queryTimes[k]);
+                    BOOST_CHECK_EQUAL(batched[k], expected);
+                    BOOST_CHECK_EQUAL(gridded[k], expected);
+                    if (queryTimes[k] > times.back() &&
+                        extrapolation == QuantExt::InterpolatedDiscountCurve::Extrapolation::flatZero) {
+                        BOOST_CHECK_CLOSE(expected,
+                                          std::pow(simpleQuotes.back()->value(), queryTimes[k] / times.back()), 1E-10);
+                    }
+                }
+                // the pillars are reproduced
+                for (Size i = linearZero ? 1 : 0; i < times.size(); ++i)
+                    BOOST_CHECK_CLOSE(curve.discount(times[i]), simpleQuotes[i]->value(), 1E-10);
+            }
+        }
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 BOOST_AUTO_TEST_SUITE_END()
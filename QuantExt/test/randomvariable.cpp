@@ -23,6 +23,7 @@
 #include <boost/test/data/test_case.hpp>
 // clang-format on
 
+#include <qle/math/leastsquaresregression.hpp>
 #include <qle/math/randomvariable.hpp>
 
 #include <ql/time/date.hpp>
@@ -192,6 +193,159 @@ BOOST_AUTO_TEST_CASE(testBlack) {
     }
 }
 
+BOOST_AUTO_TEST_CASE(testKernels) {
+    BOOST_TEST_MESSAGE("Testing random variable kernels and fused operations...");
+
+    // an odd size, so that the vectorised loops have a remainder
+    Size n = 37;
+    RandomVariable det(n, 1.5), detZero(n, 0.0), x(n), y(n), z(n);
+    for (Size i = 0; i < n; ++i) {
+        x.set(i, 0.5 + 0.1 * i);
+        y.set(i, 2.0 - 0.07 * i);
+        z.set(i, -1.0 + 0.03 * i);
+    }
+
+    // binary operations, all combinations of deterministic and non-deterministic arguments
+    std::vector<RandomVariable> args = {det, x, y};
+    for (auto const& a : args) {
+        for (auto const& b : args) {
+            RandomVariable sum = a + b, diff = a - b, prod = a * b, quot = a / b, mx = max(a, b), mn = min(a, b);
+            for (Size i = 0; i < n; ++i) {
+                BOOST_CHECK_EQUAL(sum[i], a[i] + b[i]);
+                BOOST_CHECK_EQUAL(diff[i], a[i] - b[i]);
+                BOOST_CHECK_EQUAL(prod[i], a[i] * b[i]);
+                BOOST_CHECK_EQUAL(quot[i], a[i] / b[i]);
+                BOOST_CHECK_EQUAL(mx[i], std::max(a[i], b[i]));
+                BOOST_CHECK_EQUAL(mn[i], std::min(a[i], b[i]));
+            }
+            // overloads reusing the buffer of a temporary right hand side
+            BOOST_CHECK(a + RandomVariable(b) == sum);
+            BOOST_CHECK(a * RandomVariable(b) == prod);
+            // fused multiply add
+            for (auto const& c : {detZero, det, z}) {
+                RandomVariable fused = multiplyAdd(a, b, c);
+                BOOST_CHECK_EQUAL(fused.deterministic(), (a * b + c).deterministic());
+                for (Size i = 0; i < n; ++i)
+                    BOOST_CHECK_CLOSE(fused[i], a[i] * b[i] + c[i], 1E-12);
+            }
+        }
+    }
+
+    // compound assignment with itself as argument
+    RandomVariable w = x;
+    w += w;
+    for (Size i = 0; i < n; ++i)
+        BOOST_CHECK_EQUAL(w[i], 2.0 * x[i]);
+    w *= w;
+    for (Size i = 0; i < n; ++i)
+        BOOST_CHECK_EQUAL(w[i], 4.0 * x[i] * x[i]);
+
+    BOOST_CHECK(!multiplyAdd(x, y, RandomVariable()).initialised());
+    BOOST_CHECK_THROW(multiplyAdd(x, RandomVariable(n + 1, 1.0), z), QuantLib::Error);
+}
+
+BOOST_AUTO_TEST_CASE(testBufferPool) {
+    BOOST_TEST_MESSAGE("Testing random variable buffer pool...");
+
+    RandomVariableBufferPool::clear();
+    RandomVariableBufferPool::resetStatistics();
+    Size n = 1000, bytes = n * sizeof(Real);
+
+    {
+        RandomVariable x(n, 1.0);
+        x.expand();
+        auto s = RandomVariableBufferPool::statistics();
+        BOOST_CHECK_EQUAL(s.misses, 1);
+        BOOST_CHECK_EQUAL(s.hits, 0);
+        BOOST_CHECK_EQUAL(s.bytesInUse, bytes);
+    }
+
+    // the buffer of x is cached and reused by y and the temporaries of the arithmetic below
+    auto s = RandomVariableBufferPool::statistics();
+    BOOST_CHECK_EQUAL(s.bytesInUse, 0);
+    BOOST_CHECK_EQUAL(s.bytesCached, bytes);
+    RandomVariable y(n, 2.0);
+    y.set(0, 1.0);
+    for (Size i = 0; i < 10; ++i)
+        y = y * y + y;
+    s = RandomVariableBufferPool::statistics();
+    BOOST_CHECK_EQUAL(s.misses, 2);
+    BOOST_CHECK(s.hits >= 10);
+    BOOST_CHECK_EQUAL(s.peakBytesInUse, 2 * bytes);
+
+    // deterministic random variables are not pooled, setAll() releases the full buffer
+    y.setAll(1.0);
+    s = RandomVariableBufferPool::statistics();
+    BOOST_CHECK_EQUAL(s.bytesInUse, 0);
+    BOOST_CHECK_EQUAL(s.bytesCached, 2 * bytes);
+
+    // no caching beyond the limit
+    Size maxCachedBytes = RandomVariableBufferPool::maxCachedBytes();
+    RandomVariableBufferPool::setMaxCachedBytes(0);
+    RandomVariableBufferPool::clear();
+    {
+        RandomVariable z(n, 1.0);
+        z.expand();
+    }
+    BOOST_CHECK_EQUAL(RandomVariableBufferPool::statistics().bytesCached, 0);
+    RandomVariableBufferPool::setMaxCachedBytes(maxCachedBytes);
+}
+
+BOOST_AUTO_TEST_CASE(testRegression) {
+    BOOST_TEST_MESSAGE("Testing random variable regression...");
+
+    Size n = 10000;
+    RandomVariable x(n), y(n), z(n);
+    for (Size i = 0; i < n; ++i) {
+        Real t = -2.0 + 4.0 * static_cast<Real>(i) / static_cast<Real>(n - 1);
+        x.set(i, t);
+        y.set(i, 1.0 + 2.0 * t + 3.0 * t * t);
+        // z coincides with y on x > 0 only
+        z.set(i, t > 0.0 ? 1.0 + 2.0 * t + 3.0 * t * t : 100.0);
+    }
+
+    std::vector<const RandomVariable*> regressor(1, &x);
+    std::vector<std::function<RandomVariable(const std::vector<const RandomVariable*>&)>> basisFn;
+    basisFn.push_back([n](const std::vector<const RandomVariable*>&) { return RandomVariable(n, 1.0); });
+    basisFn.push_back([](const std::vector<const RandomVariable*>& r) { return *r[0]; });
+    basisFn.push_back([](const std::vector<const RandomVariable*>& r) { return *r[0] * *r[0]; });
+
+    Real tol = 1.0E-8;
+    Array c = regressionCoefficients(y, regressor, basisFn);
+    BOOST_REQUIRE_EQUAL(c.size(), 3);
+    BOOST_CHECK_SMALL(c[0] - 1.0, tol);
+    BOOST_CHECK_SMALL(c[1] - 2.0, tol);
+    BOOST_CHECK_SMALL(c[2] - 3.0, tol);
+
+    Filter positive = x > RandomVariable(n, 0.0);
+    c = regressionCoefficients(z, regressor, basisFn, positive);
+    BOOST_CHECK_SMALL(c[0] - 1.0, tol);
+    BOOST_CHECK_SMALL(c[1] - 2.0, tol);
+    BOOST_CHECK_SMALL(c[2] - 3.0, tol);
+
+    RandomVariable ce = conditionalExpectation(y, regressor, basisFn);
+    for (Size i = 0; i < n; ++i)
+        BOOST_CHECK_SMALL(ce[i] - y[i], tol);
+
+    // several regressands on the same basis function values, the second basis function is duplicated, so that the
+    // normal equations are singular and the minimum norm solution is returned
+    std::vector<Real> one(n, 1.0), v(n), w(n), fitted(n);
+    for (Size i = 0; i < n; ++i) {
+        v[i] = 1.0 + 2.0 * x[i];
+        w[i] = -3.0 * x[i];
+    }
+    LeastSquaresRegression ls(n, {&one[0], x.data(), x.data()});
+    BOOST_CHECK(ls.solver() == LeastSquaresRegression::Solver::SVD);
+    Array cv = ls.coefficients(&v[0]);
+    BOOST_CHECK_SMALL(cv[0] - 1.0, tol);
+    BOOST_CHECK_SMALL(cv[1] - 1.0, tol);
+    BOOST_CHECK_SMALL(cv[2] - 1.0, tol);
+    Array cw = ls.coefficients(&w[0]);
+    ls.fittedValues(cw, &fitted[0]);
+    for (Size i = 0; i < n; ++i)
+        BOOST_CHECK_SMALL(fitted[i] - w[i], tol);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 BOOST_AUTO_TEST_SUITE_END()